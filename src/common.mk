@@ -12,9 +12,10 @@ PPLME_SRC_DIR := $(realpath $(dir $(lastword $(MAKEFILE_LIST))))
 # Various libraries that we rely upon.
 googletest = $(THIRDPARTY)/gtest-1.7.0
 boost = $(THIRDPARTY)/boost_1_56_0
-protocol_buffers = $(THIRDPARTY)/protobuf-2.6.0
+protocol_buffers = $(THIRDPARTY)/protobuf-3.0.0
 glog = $(THIRDPARTY)/glog-0.3.3
 gflags = $(THIRDPARTY)/gflags-2.1.1
+benchmark = $(THIRDPARTY)/benchmark-1.4.1
 
 
 # Classic flags and whatnot for the builtin rules.
@@ -24,6 +25,7 @@ CPPFLAGS =  \
         -isystem $(protocol_buffers)/src  \
 	-I$(glog)/src  \
 	-I$(gflags)/include  \
+	-I$(benchmark)/include  \
 	-I$(PPLME_SRC_DIR)
 CXXFLAGS = -m64 -std=c++1y -Wall -Wextra -Werror -pedantic-errors -g -O2
 LDFLAGS = -g -O2  \
@@ -33,9 +35,11 @@ LDFLAGS = -g -O2  \
 	-L$(glog)/.libs  \
 	-L$(gflags)/lib  \
 	-L$(googletest)/lib/.libs  \
-	-Wl,-rpath $(realpath $(googletest)/lib/.libs)
+	-Wl,-rpath $(realpath $(googletest)/lib/.libs)  \
+	-L$(benchmark)/src
 LDLIBS = -lboost_system -lprotobuf -lglog -lgflags -lpthread
 GTEST_LDLIBS = -lgtest -lgtest_main
+BENCHMARK_LDLIBS = -lbenchmark
 
 
 # Stuffs related to the library/binary at hand.
@@ -53,22 +57,28 @@ $(component):	$(lib)
 $(lib):		$(proto_hdrs) $(objs)
 		$(AR) $(ARFLAGS) $@ $(filter %.o,$^)
 else
-# Build that binary!
+# Build that binary!  (The libraries depend on each other in ways that don't
+# respect alphabetical order, hence the group.)
 $(component):	$(objs) $(ALL_PPLME_LIBS)
-		$(CXX) $(LDFLAGS) $^ $(LDLIBS) -o $@
+		$(CXX) $(LDFLAGS) $(objs)  \
+			-Wl,--start-group $(ALL_PPLME_LIBS) -Wl,--end-group  \
+			$(LDLIBS) -o $@
 endif
 
 
-# Stuffs related to testing the library at hand.
+# Stuffs related to testing the library at hand.  Any tests_extra_objs are
+# linked in too (as per bench_extra_objs, below).
 tests_dir = $(component)_tests
 tests_src = $(wildcard $(tests_dir)/*.cc)
 tests_objs = $(tests_src:.cc=.o)
 tests_bin = $(tests_dir)/$(component)_tests
 
 
-# Build those tests!
-$(tests_bin):	$(tests_objs) $(lib)
-		$(CXX) $(LDFLAGS) $(LDLIBS) $^ $(ALL_PPLME_LIBS) -o $@  \
+# Build those tests!  (Grouped, as per the binaries, since a library's tests
+# may well need libraries that sort before the ones that need them.)
+$(tests_bin):	$(tests_objs) $(tests_extra_objs) $(lib)
+		$(CXX) $(LDFLAGS) $(LDLIBS) $^  \
+			-Wl,--start-group $(ALL_PPLME_LIBS) -Wl,--end-group -o $@  \
 			$(GTEST_LDLIBS) $(LDLIBS)
 
 
@@ -78,10 +88,38 @@ test:	$(tests_bin)
 	$(tests_bin)
 
 
+# Stuffs related to benchmarking the library at hand (optional; only those
+# components with a $(component)_bench directory have benchmarks).  Any
+# bench_extra_objs (e.g., libpplmeutils/bench's, which aren't in any library,
+# as they replace operator new) are linked in too.
+bench_dir = $(component)_bench
+bench_src = $(wildcard $(bench_dir)/*.cc)
+bench_objs = $(bench_src:.cc=.o)
+bench_bin = $(bench_dir)/$(component)_bench
+
+
+# Build those benchmarks!
+$(bench_bin):	$(bench_objs) $(bench_extra_objs) $(lib)
+		$(CXX) $(LDFLAGS) $(LDLIBS) $^  \
+			-Wl,--start-group $(ALL_PPLME_LIBS) -Wl,--end-group -o $@  \
+			$(BENCHMARK_LDLIBS) $(LDLIBS)
+
+
+# Run those benchmarks!
+.PHONY:	bench
+ifneq ($(bench_src),)
+bench:	$(bench_bin)
+	$(bench_bin) $(BENCHFLAGS)
+else
+bench:
+endif
+
+
 # Clean all the things!
 .PHONY:	clean
 clean:
-	-rm $(tests_bin) $(tests_objs)  \
+	-rm $(tests_bin) $(tests_objs) $(bench_bin) $(bench_objs)  \
+		$(tests_extra_objs) $(bench_extra_objs)  \
 		$(lib) $(component) $(objs) $(proto_hdrs) 2>/dev/null
 
 
@@ -6,6 +6,18 @@
 
 
 #include "geo_position.h"
+#include <math.h>
+#include <boost/math/constants/constants.hpp>
+
+
+namespace {
+
+
+// WGS84 [<http://en.wikipedia.org/wiki/World_Geodetic_System>].
+float const kRadiusOfEarth = 6378.137;
+
+
+}  // namespace
 
 
 namespace pplme {
@@ -20,5 +32,25 @@ bool GeoPosition::IsValid() const {
 }
 
 
+float ApproxDistanceBetween(GeoPosition from, GeoPosition to) {
+  using boost::math::constants::pi;
+  auto const radians_per_degree = pi<float>() / 180;
+
+  auto longitude_delta = to.longitude().value() - from.longitude().value();
+  if (longitude_delta > 180)
+    longitude_delta -= 360;
+  else if (longitude_delta < -180)
+    longitude_delta += 360;
+  auto const mean_latitude =
+      (from.latitude().value() + to.latitude().value()) / 2;
+
+  auto const x = longitude_delta * radians_per_degree
+      * cosf(mean_latitude * radians_per_degree);
+  auto const y =
+      (to.latitude().value() - from.latitude().value()) * radians_per_degree;
+  return sqrtf(x * x + y * y) * kRadiusOfEarth;
+}
+
+
 }  // namespace core
 }  // namespace pplme
@@ -73,6 +73,19 @@ class GeoPosition {
 };
 
 
+/**
+ *  @returns  The approximate distance in kilometers between @a from and
+ *            @a to.
+ *
+ *  @remarks
+ *  This is the equirectangular approximation (i.e., it pretends that the
+ *  Earth is flat between the two positions), which is plenty accurate at
+ *  the sort of distances that pplMe cares about and a lot cheaper than the
+ *  haversine formula.  It does at least know that 179 and -179 are close.
+ */
+float ApproxDistanceBetween(GeoPosition from, GeoPosition to);
+
+
 }  // namespace core
 }  // namespace pplme
 
@@ -69,3 +69,51 @@ TEST_P(GeoPositionTestIsValid, IsValid)
 INSTANTIATE_TEST_CASE_P(Default,
                         GeoPositionTestIsValid,
                         testing::ValuesIn(is_valid_testlettes));
+
+
+namespace {
+
+struct ApproxDistanceBetweenTestlette {
+  float from_latitude;
+  float from_longitude;
+  float to_latitude;
+  float to_longitude;
+  float expected_km;
+}
+  const approx_distance_between_testlettes[] = {
+    { 0, 0, 0, 0, 0 },
+    // A degree of latitude is ~111km anywhere.
+    { 0, 0, 1, 0, 111.3 },
+    { 60, 10, 61, 10, 111.3 },
+    // A degree of longitude is ~111km at the equator, half that at 60N.
+    { 0, 0, 0, 1, 111.3 },
+    { 60, 0, 60, 1, 55.7 },
+    // Across the antimeridian is the short way round.
+    { 0, 179.5, 0, -179.5, 111.3 },
+    // London -> Paris is ~344km.
+    { 51.5074, -0.1278, 48.8566, 2.3522, 343.6 },
+};
+
+}
+
+class GeoPositionTestApproxDistanceBetween :
+      public testing::TestWithParam<ApproxDistanceBetweenTestlette> {};
+
+TEST_P(GeoPositionTestApproxDistanceBetween, ApproxDistanceBetween)
+{
+  GeoPosition from{GeoPosition::DecimalLatitude{GetParam().from_latitude},
+                   GeoPosition::DecimalLongitude{GetParam().from_longitude}};
+  GeoPosition to{GeoPosition::DecimalLatitude{GetParam().to_latitude},
+                 GeoPosition::DecimalLongitude{GetParam().to_longitude}};
+
+  // Within 1%.
+  ASSERT_NEAR(GetParam().expected_km,
+              pplme::core::ApproxDistanceBetween(from, to),
+              GetParam().expected_km / 100 + 0.01);
+  ASSERT_FLOAT_EQ(pplme::core::ApproxDistanceBetween(from, to),
+                  pplme::core::ApproxDistanceBetween(to, from));
+}
+
+INSTANTIATE_TEST_CASE_P(Default,
+                        GeoPositionTestApproxDistanceBetween,
+                        testing::ValuesIn(approx_distance_between_testlettes));
@@ -0,0 +1,48 @@
+/**
+ *  @file
+ *  @brief   Tests for pplme::core::PersonFields.
+ *  @author  j.ho
+ */
+
+
+#include <gtest/gtest.h>
+#include "libpplmecore/person_fields.h"
+
+
+using pplme::core::PersonField;
+using pplme::core::PersonFields;
+
+
+TEST(PersonFieldsTest, DefaultCtorIsIdsOnly)
+{
+  PersonFields fields;
+
+  ASSERT_FALSE(fields.Has(PersonField::Name));
+  ASSERT_FALSE(fields.Has(PersonField::DateOfBirth));
+  ASSERT_FALSE(fields.Has(PersonField::LocationOfHome));
+  ASSERT_FALSE(fields.Has(PersonField::Distance));
+  ASSERT_FALSE(fields.NeedsPerson());
+}
+
+
+TEST(PersonFieldsTest, AllOfPersonDoesNotIncludeDistance)
+{
+  auto fields = PersonFields::AllOfPerson();
+
+  ASSERT_TRUE(fields.Has(PersonField::Name));
+  ASSERT_TRUE(fields.Has(PersonField::DateOfBirth));
+  ASSERT_TRUE(fields.Has(PersonField::LocationOfHome));
+  ASSERT_FALSE(fields.Has(PersonField::Distance));
+  ASSERT_TRUE(fields.NeedsPerson());
+}
+
+
+TEST(PersonFieldsTest, IdsAndDistanceDoesNotNeedPerson)
+{
+  PersonFields fields{PersonField::Distance};
+
+  ASSERT_TRUE(fields.Has(PersonField::Distance));
+  ASSERT_FALSE(fields.NeedsPerson());
+  ASSERT_TRUE(PersonFields{}.Add(PersonField::Distance) == fields);
+  ASSERT_TRUE(PersonFields{PersonField::Name} != fields);
+}
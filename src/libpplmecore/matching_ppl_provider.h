@@ -8,7 +8,9 @@
 #define PPLME_LIBPPLMECORE_MATCHINGPPLPROVIDER_H_
 
 
+#include <functional>
 #include "person.h"
+#include "ppl_matching_outcome.h"
 #include "ppl_matching_parameters.h"
 
 
@@ -31,6 +33,47 @@ class MatchingPplProvider {
    */
   virtual std::vector<Person>
   FindMatchingPpl(PplMatchingParameters const& parameters) const = 0;
+
+  /**
+   *  Find the same set of Person instances as FindMatchingPpl(), but rather
+   *  than copying them out, call @a visitor with each one in turn.
+   *
+   *  @remarks
+   *  @a visitor is called on the calling thread, and the Person it is given
+   *  should not be referenced once it has returned.  Implementations that
+   *  can hand out their own storage should override this; the default just
+   *  visits the result of FindMatchingPpl().
+   *
+   *  @returns  The cursor with which to ask for the next page of ppl (none
+   *            if there are no more, or if the implementation doesn't do
+   *            pagination, which the default doesn't), and whether the
+   *            deadline cut things short.
+   */
+  virtual PplMatchingOutcome VisitMatchingPpl(
+      PplMatchingParameters const& parameters,
+      std::function<void (Person const&)> const& visitor) const {
+    for (auto const& person : FindMatchingPpl(parameters))
+      visitor(person);
+    return PplMatchingOutcome{};
+  }
+
+  /**
+   *  As per VisitMatchingPpl(), but for callers that want nothing more than
+   *  each matching Person's id and location of home (e.g., ids-only or
+   *  ids-and-distance responses).  Implementations that keep those apart from
+   *  the rest of a Person should override this so that the rest of it never
+   *  needs to be touched.
+   */
+  virtual PplMatchingOutcome VisitMatchingPplIds(
+      PplMatchingParameters const& parameters,
+      std::function<void (PersonId const&, GeoPosition const&)> const& visitor)
+      const {
+    return VisitMatchingPpl(
+        parameters,
+        [&visitor](Person const& person) {
+          visitor(person.id(), person.location_of_home());
+        });
+  }
 };
 
 
@@ -0,0 +1,79 @@
+/**
+ *  @file
+ *  @brief   Definition of pplme::core::PersonFields, which says which details
+ *           of each matching Person a client actually cares about.
+ *  @author  j.ho
+ */
+#ifndef PPLME_LIBPPLMECORE_PERSONFIELDS_H_
+#define PPLME_LIBPPLMECORE_PERSONFIELDS_H_
+
+
+#include <stdint.h>
+#include <initializer_list>
+
+
+namespace pplme {
+namespace core {
+
+
+/**
+ *  @remarks
+ *  A Person's id isn't in here because it is always included; a
+ *  PersonFields with nothing in it means "ids only".
+ */
+enum class PersonField : uint32_t {
+  Name = 1 << 0,
+  DateOfBirth = 1 << 1,
+  LocationOfHome = 1 << 2,
+  /** Not so much a field of Person as how far they are from the user. */
+  Distance = 1 << 3,
+};
+
+
+class PersonFields {
+ public:
+  /** Ids only. */
+  PersonFields() : bits_{0} {}
+  PersonFields(std::initializer_list<PersonField> fields) : bits_{0} {
+    for (auto field : fields)
+      Add(field);
+  }
+
+  /** Everything a Person has (which is what clients get unless they say
+      otherwise). */
+  static PersonFields AllOfPerson() {
+    return PersonFields{PersonField::Name,
+                        PersonField::DateOfBirth,
+                        PersonField::LocationOfHome};
+  }
+
+  bool Has(PersonField field) const {
+    return (bits_ & static_cast<uint32_t>(field)) != 0;
+  }
+
+  PersonFields& Add(PersonField field) {
+    bits_ |= static_cast<uint32_t>(field);
+    return *this;
+  }
+
+  /** @returns  true iff anything of a Person beyond their id is wanted
+                (i.e., if the Person themself has to be looked at). */
+  bool NeedsPerson() const {
+    return Has(PersonField::Name)
+        || Has(PersonField::DateOfBirth)
+        || Has(PersonField::LocationOfHome);
+  }
+
+  bool operator==(PersonFields rhs) const { return bits_ == rhs.bits_; }
+  bool operator!=(PersonFields rhs) const { return bits_ != rhs.bits_; }
+
+ private:
+  uint32_t bits_;
+};
+
+
+}  // namespace core
+}  // namespace pplme
+
+
+#endif  // PPLME_LIBPPLMECORE_PERSONFIELDS_H_
@@ -0,0 +1,57 @@
+/**
+ *  @file
+ *  @brief   Definition of pplme::core::PplCursor, the place from which a
+ *           paginated ppl matching operation carries on.
+ *  @author  j.ho
+ */
+#ifndef PPLME_LIBPPLMECORE_PPLCURSOR_H_
+#define PPLME_LIBPPLMECORE_PPLCURSOR_H_
+
+
+#include <stdint.h>
+
+
+namespace pplme {
+namespace core {
+
+
+/**
+ *  @remarks
+ *  As far as anyone but a MatchingPplProvider is concerned, this is opaque.
+ *  For the record, though, a provider that searches outwards from the user
+ *  in rings of cells (which is to say PplmeMatchingPplProvider) uses it as
+ *  the ring, the position of the cell within that ring, and the number of
+ *  matching ppl in that cell that have already been handed out.
+ *
+ *  @note
+ *  A cursor is only meaningful when used with the same PplMatchingParameters
+ *  (give or take the limit) as the operation that produced it.
+ */
+class PplCursor {
+ public:
+  PplCursor(uint32_t ring, uint32_t position, uint32_t skip) :
+      ring_{ring}, position_{position}, skip_{skip} {}
+
+  uint32_t ring() const { return ring_; }
+  uint32_t position() const { return position_; }
+  uint32_t skip() const { return skip_; }
+
+  bool operator==(PplCursor const& rhs) const {
+    return ring_ == rhs.ring_
+        && position_ == rhs.position_
+        && skip_ == rhs.skip_;
+  }
+  bool operator!=(PplCursor const& rhs) const { return !(*this == rhs); }
+
+ private:
+  uint32_t ring_;
+  uint32_t position_;
+  uint32_t skip_;
+};
+
+
+}  // namespace core
+}  // namespace pplme
+
+
+#endif  // PPLME_LIBPPLMECORE_PPLCURSOR_H_
@@ -0,0 +1,34 @@
+/**
+ *  @file
+ *  @brief   Definition of pplme::core::PplMatchingOutcome, which is what a
+ *           ppl matching operation has to say for itself (besides the ppl).
+ *  @author  j.ho
+ */
+#ifndef PPLME_LIBPPLMECORE_PPLMATCHINGOUTCOME_H_
+#define PPLME_LIBPPLMECORE_PPLMATCHINGOUTCOME_H_
+
+
+#include <boost/optional.hpp>
+#include "ppl_cursor.h"
+
+
+namespace pplme {
+namespace core {
+
+
+struct PplMatchingOutcome {
+  /** Where the next page of ppl carries on from, if there are (or might be)
+      any more. */
+  boost::optional<PplCursor> next_cursor;
+  /** True iff the deadline passed before the search was done, in which case
+      the ppl found are merely the best so far (and next_cursor, if any,
+      carries on from wherever the search got to). */
+  bool partial = false;
+};
+
+
+}  // namespace core
+}  // namespace pplme
+
+
+#endif  // PPLME_LIBPPLMECORE_PPLMATCHINGOUTCOME_H_
@@ -7,7 +7,19 @@
 #define PPLME_LIBPPLMECORE_PPLMATCHINGPARAMETERS_H_
 
 
+#include <chrono>
+#include <memory>
+#include <utility>
+#include <boost/optional.hpp>
 #include "geo_position.h"
+#include "ppl_cursor.h"
+
+
+namespace pplme {
+namespace utils {
+class Trace;
+}  // namespace utils
+}  // namespace pplme
 
 
 namespace pplme {
@@ -16,6 +28,14 @@ namespace core {
 
 /*
  *  See comment at top of file for a complete description.
+ *
+ *  @remarks
+ *  Everything bar the user's location and age is optional, and is set after
+ *  construction, e.g.:
+ *  @code
+ *  PplMatchingParameters parameters{location_of_user, age_of_user};
+ *  parameters.set_max_distance(10).set_limit(20);
+ *  @endcode
  */
 class PplMatchingParameters {
  public:
@@ -25,9 +45,65 @@ class PplMatchingParameters {
   GeoPosition location_of_user() const { return location_of_user_; }
   int age_of_user() const { return age_of_user_; }
 
+  /** The most ppl wanted (although a provider may cap this further). */
+  boost::optional<unsigned int> limit() const { return limit_; }
+  PplMatchingParameters& set_limit(unsigned int limit) {
+    limit_ = limit;
+    return *this;
+  }
+
+  /** Where to carry on from, if this isn't the first page of ppl. */
+  boost::optional<PplCursor> cursor() const { return cursor_; }
+  PplMatchingParameters& set_cursor(PplCursor cursor) {
+    cursor_ = cursor;
+    return *this;
+  }
+
+  /** How far (in km) from the user that ppl can live; unbounded if unset. */
+  boost::optional<float> max_distance() const { return max_distance_; }
+  PplMatchingParameters& set_max_distance(float max_distance) {
+    max_distance_ = max_distance;
+    return *this;
+  }
+
+  /** The youngest and oldest ppl wanted; if unset, a provider falls back to
+      however much older/younger than the user it thinks is reasonable. */
+  boost::optional<int> min_age() const { return min_age_; }
+  PplMatchingParameters& set_min_age(int min_age) {
+    min_age_ = min_age;
+    return *this;
+  }
+  boost::optional<int> max_age() const { return max_age_; }
+  PplMatchingParameters& set_max_age(int max_age) {
+    max_age_ = max_age;
+    return *this;
+  }
+
+  using Deadline = std::chrono::steady_clock::time_point;
+  /** When to give up and make do with whoever has been found so far. */
+  boost::optional<Deadline> deadline() const { return deadline_; }
+  PplMatchingParameters& set_deadline(Deadline deadline) {
+    deadline_ = deadline;
+    return *this;
+  }
+
+  /** Where to record what the matching got up to, if anywhere. */
+  std::shared_ptr<utils::Trace> const& trace() const { return trace_; }
+  PplMatchingParameters& set_trace(std::shared_ptr<utils::Trace> trace) {
+    trace_ = std::move(trace);
+    return *this;
+  }
+
  private:
   GeoPosition location_of_user_;
   int age_of_user_;
+  boost::optional<unsigned int> limit_;
+  boost::optional<PplCursor> cursor_;
+  boost::optional<float> max_distance_;
+  boost::optional<int> min_age_;
+  boost::optional<int> max_age_;
+  boost::optional<Deadline> deadline_;
+  std::shared_ptr<utils::Trace> trace_;
 };
 
 
@@ -0,0 +1,36 @@
+/**
+ *  @file
+ *  @brief   Definition of pplme::core::PplMutation, which is a Person coming
+ *           or going.
+ *  @author  j.ho
+ */
+#ifndef PPLME_LIBPPLMECORE_PPLMUTATION_H_
+#define PPLME_LIBPPLMECORE_PPLMUTATION_H_
+
+
+#include "person.h"
+
+
+namespace pplme {
+namespace core {
+
+
+struct PplMutation {
+  enum class Kind {
+    Add,
+    Remove,
+  };
+
+  Kind kind;
+  /** The whole Person if they're being added; if they're being removed,
+      then only their id and location of home (the latter being what says
+      where to look for them) matter. */
+  Person person;
+};
+
+
+}  // namespace core
+}  // namespace pplme
+
+
+#endif  // PPLME_LIBPPLMECORE_PPLMUTATION_H_
@@ -0,0 +1,401 @@
+/**
+ *  @file
+ *  @brief   Load, memory, latency and throughput benchmarks for the
+ *           pplme::engine MatchingPplProviders, over synthetic datasets.
+ *  @author  j.ho
+ *
+ *  By default, only the 1M datasets are used, because 10M and 100M take
+ *  rather a long time to load (and, at 100M, more memory than most dev boxes
+ *  have).  Set PPLME_BENCH_MAX_PPL (e.g., to 100000000) to go bigger.
+ */
+
+
+#include <math.h>
+#include <stdlib.h>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <typeindex>
+#include <benchmark/benchmark.h>
+#include <boost/uuid/random_generator.hpp>
+#include "libpplmecore/person.h"
+#include "libpplmecore/ppl_matching_parameters.h"
+#include "libpplmeengine/my_1st_matching_ppl_provider.h"
+#include "libpplmeengine/pplme_matching_ppl_provider.h"
+#include "libpplmeengine/prototype_matching_ppl_provider.h"
+#include "libpplmeutils/bench/allocation_counter.h"
+
+
+namespace core = pplme::core;
+namespace engine = pplme::engine;
+namespace utils = pplme::utils;
+
+
+namespace {
+
+
+/** The knobs are the same as pplmed's defaults. */
+int const kResolution = 10;
+int const kMaxAgeDifference = 10;
+int const kMaxPpl = 10;
+/** Only the prototype takes this up front. */
+int const kMaxDistance = 50;
+int const kQueryCount = 1024;
+unsigned int const kSeed = 20141108;
+
+
+boost::gregorian::date GetTodaysDate() {
+  return boost::gregorian::date{2014, 11, 8};
+}
+
+
+enum class Distribution : int64_t {
+  /** Just like pplmed's test database, i.e., uniform in degrees (which is
+      anything but uniform in area, but never mind). */
+  kUniform,
+  /** Mostly huddled around some of the world's bigger cities. */
+  kCities,
+  /** Everyone within spitting distance of the Poles, where the cells are at
+      their skinniest and the sqiral is at its most dizzying. */
+  kPolar
+};
+
+
+char const* GetName(Distribution distribution) {
+  switch (distribution) {
+    case Distribution::kUniform: return "uniform";
+    case Distribution::kCities: return "cities";
+    case Distribution::kPolar: return "polar";
+  }
+  return "?";
+}
+
+
+struct City {
+  float latitude;
+  float longitude;
+  /** Metro population in millions, which is used as a weight. */
+  float population;
+};
+
+
+City const kCities[] = {
+  { 35.7f, 139.7f, 37.4f},  // Tokyo
+  { 28.6f, 77.2f, 28.5f},   // Delhi
+  { 31.2f, 121.5f, 25.6f},  // Shanghai
+  {-23.6f, -46.6f, 21.7f},  // Sao Paulo
+  { 19.4f, -99.1f, 21.6f},  // Mexico City
+  { 30.0f, 31.2f, 20.1f},   // Cairo
+  { 19.1f, 72.9f, 20.0f},   // Mumbai
+  { 39.9f, 116.4f, 19.6f},  // Beijing
+  { 23.8f, 90.4f, 19.6f},   // Dhaka
+  { 40.7f, -74.0f, 18.8f},  // New York
+  { 24.9f, 67.0f, 15.4f},   // Karachi
+  {-34.6f, -58.4f, 15.0f},  // Buenos Aires
+  { 41.0f, 29.0f, 14.8f},   // Istanbul
+  {  6.5f, 3.4f, 13.5f},    // Lagos
+  { 55.8f, 37.6f, 12.4f},   // Moscow
+  { 51.5f, -0.1f, 9.0f},    // London
+  {-33.9f, 151.2f, 4.9f},   // Sydney
+  { 64.1f, -21.9f, 0.2f},   // Reykjavik (so that the North isn't left out)
+};
+
+
+/** The fraction of ppl in the kCities distribution who live out in the
+    sticks (i.e., anywhere at all). */
+double const kRuralFraction = 0.1;
+
+
+/** A Person minus their name, which is made up when they're loaded (so as
+    not to hold two copies of every name at once). */
+struct SyntheticPerson {
+  core::PersonId id;
+  boost::gregorian::date date_of_birth;
+  core::GeoPosition location_of_home;
+};
+
+
+using SyntheticPpl = std::vector<SyntheticPerson>;
+
+
+/** @remarks  Everyone is kept just shy of the edges of the world, because
+              My1stMatchingPplProvider falls off them (as it freely admits). */
+core::GeoPosition CreateGeoPosition(float latitude, float longitude) {
+  latitude = std::max(-89.999f, std::min(89.999f, latitude));
+  if (longitude < -180)
+    longitude += 360;
+  else if (longitude >= 180)
+    longitude -= 360;
+  return core::GeoPosition{core::GeoPosition::DecimalLatitude{latitude},
+                           core::GeoPosition::DecimalLongitude{longitude}};
+}
+
+
+class LocationGenerator {
+ public:
+  explicit LocationGenerator(Distribution distribution) :
+      distribution_{distribution},
+      city_{[]() {
+          std::vector<double> weights;
+          for (auto const& city : kCities)
+            weights.push_back(city.population);
+          return std::discrete_distribution<size_t>{
+              weights.begin(), weights.end()};
+        }()} {}
+
+  template <typename RandomEngine>
+  core::GeoPosition operator()(RandomEngine& random_engine) {
+    switch (distribution_) {
+      case Distribution::kUniform:
+        break;
+      case Distribution::kCities:
+        if (rural_(random_engine) >= kRuralFraction) {
+          auto const& city = kCities[city_(random_engine)];
+          return CreateGeoPosition(
+              city.latitude + sprawl_(random_engine),
+              city.longitude + sprawl_(random_engine));
+        }
+        break;
+      case Distribution::kPolar: {
+        auto const from_pole =
+            std::min(90.0f, fabsf(from_pole_(random_engine)));
+        auto const north = rural_(random_engine) < 0.5;
+        return CreateGeoPosition(
+            north ? 90 - from_pole : from_pole - 90,
+            longitude_(random_engine));
+      }
+    }
+    return CreateGeoPosition(
+        latitude_(random_engine), longitude_(random_engine));
+  }
+
+ private:
+  Distribution distribution_;
+  std::uniform_real_distribution<float> latitude_{-90, 90};
+  std::uniform_real_distribution<float> longitude_{-180, 180};
+  std::uniform_real_distribution<double> rural_{0, 1};
+  std::discrete_distribution<size_t> city_;
+  std::normal_distribution<float> sprawl_{0, 0.25f};
+  std::normal_distribution<float> from_pole_{0, 1.5f};
+};
+
+
+SyntheticPpl CreateSyntheticPpl(int64_t count, Distribution distribution) {
+  std::mt19937 random_engine{kSeed};
+  boost::uuids::basic_random_generator<std::mt19937> random_uuid_generator{
+      &random_engine};
+  std::uniform_int_distribution<int> random_age{-100 * 365, -18 * 365};
+  LocationGenerator random_location{distribution};
+
+  SyntheticPpl ppl;
+  ppl.reserve(count);
+  for (int64_t n = 0; n < count; ++n) {
+    ppl.push_back(SyntheticPerson{
+        core::PersonId{random_uuid_generator()},
+        GetTodaysDate() + boost::gregorian::days{random_age(random_engine)},
+        random_location(random_engine)});
+  }
+  return ppl;
+}
+
+
+/** Creating a dataset takes a while, so hang on to the most recent one (but
+    only that one, because memory isn't free either). */
+std::shared_ptr<SyntheticPpl const> GetSyntheticPpl(
+    int64_t count, Distribution distribution) {
+  static std::mutex mutex;
+  static std::pair<int64_t, Distribution> key;
+  static std::shared_ptr<SyntheticPpl const> ppl;
+
+  std::unique_lock<std::mutex> lock(mutex);
+  auto const wanted = std::make_pair(count, distribution);
+  if (!ppl || key != wanted) {
+    ppl.reset();
+    ppl = std::make_shared<SyntheticPpl const>(
+        CreateSyntheticPpl(count, distribution));
+    key = wanted;
+  }
+  return ppl;
+}
+
+
+void Load(SyntheticPpl const& ppl, engine::PplRepository* repository) {
+  int64_t n = 0;
+  for (auto const& person : ppl) {
+    repository->AddPerson(std::unique_ptr<core::Person>{new core::Person{
+        person.id,
+        std::string{u8"John Malkovich "} + std::to_string(n++),
+        person.date_of_birth,
+        person.location_of_home}});
+  }
+}
+
+
+template <typename Provider>
+std::unique_ptr<Provider> CreateProvider();
+
+
+template <>
+std::unique_ptr<engine::My1stMatchingPplProvider> CreateProvider() {
+  return std::unique_ptr<engine::My1stMatchingPplProvider>{
+      new engine::My1stMatchingPplProvider{kMaxAgeDifference, &GetTodaysDate}};
+}
+
+
+template <>
+std::unique_ptr<engine::PrototypeMatchingPplProvider> CreateProvider() {
+  std::unique_ptr<engine::PrototypeMatchingPplProvider> provider{
+      new engine::PrototypeMatchingPplProvider{
+          kResolution, kMaxDistance, kMaxAgeDifference, &GetTodaysDate}};
+  provider->Start();
+  return provider;
+}
+
+
+template <>
+std::unique_ptr<engine::PplmeMatchingPplProvider> CreateProvider() {
+  return std::unique_ptr<engine::PplmeMatchingPplProvider>{
+      new engine::PplmeMatchingPplProvider{
+          kResolution, kMaxAgeDifference, kMaxPpl, boost::none,
+          &GetTodaysDate}};
+}
+
+
+/** Likewise, loading a provider takes a while, so hang on to the most
+    recently loaded one (of whatever type) for the next benchmark. */
+template <typename Provider>
+std::shared_ptr<core::MatchingPplProvider const> GetLoadedProvider(
+    int64_t count, Distribution distribution) {
+  static std::mutex mutex;
+  static std::tuple<std::type_index, int64_t, Distribution> key{
+      typeid(void), 0, Distribution::kUniform};
+  static std::shared_ptr<core::MatchingPplProvider const> provider;
+
+  std::unique_lock<std::mutex> lock(mutex);
+  auto const wanted = std::make_tuple(
+      std::type_index{typeid(Provider)}, count, distribution);
+  if (!provider || key != wanted) {
+    provider.reset();
+    auto loaded = CreateProvider<Provider>();
+    Load(*GetSyntheticPpl(count, distribution), loaded.get());
+    provider = std::move(loaded);
+    key = wanted;
+  }
+  return provider;
+}
+
+
+/** Users tend to be where ppl are, so put them where some ppl are. */
+std::vector<core::PplMatchingParameters> CreateQueries(
+    SyntheticPpl const& ppl, unsigned int seed) {
+  std::mt19937 random_engine{seed};
+  std::uniform_int_distribution<size_t> random_person{0, ppl.size() - 1};
+  std::uniform_int_distribution<int> random_age{18, 100};
+
+  std::vector<core::PplMatchingParameters> queries;
+  for (int n = 0; n < kQueryCount; ++n) {
+    queries.emplace_back(
+        ppl[random_person(random_engine)].location_of_home,
+        random_age(random_engine));
+  }
+  return queries;
+}
+
+
+/** Sizes up to PPLME_BENCH_MAX_PPL (1M by default), for each distribution. */
+void AddDatasets(benchmark::internal::Benchmark* benchmark) {
+  auto const max_ppl_env = getenv("PPLME_BENCH_MAX_PPL");
+  auto const max_ppl = max_ppl_env ? atoll(max_ppl_env) : 1000000;
+  benchmark->ArgNames({"ppl", "distribution"});
+  for (int64_t count : {1000000LL, 10000000LL, 100000000LL}) {
+    if (count > max_ppl)
+      break;
+    for (auto distribution : {Distribution::kUniform,
+                              Distribution::kCities,
+                              Distribution::kPolar}) {
+      benchmark->Args({count, static_cast<int64_t>(distribution)});
+    }
+  }
+}
+
+
+int GetThroughputThreadCount() {
+  return std::max(2U, std::thread::hardware_concurrency());
+}
+
+
+}  // namespace
+
+
+/** How long it takes to load everyone, and how much heap they take up. */
+template <typename Provider>
+void BM_Load(benchmark::State& state) {
+  auto const distribution = static_cast<Distribution>(state.range(1));
+  auto const ppl = GetSyntheticPpl(state.range(0), distribution);
+
+  int64_t octets = 0;
+  for (auto _ : state) {
+    auto const heap_before = utils::bench::GetHeapOctetsInUse();
+    auto provider = CreateProvider<Provider>();
+    Load(*ppl, provider.get());
+    octets = utils::bench::GetHeapOctetsInUse() - heap_before;
+
+    // Tearing down isn't what we're here to measure.
+    state.PauseTiming();
+    provider.reset();
+    state.ResumeTiming();
+  }
+
+  state.counters["heap_mib"] = octets / (1024.0 * 1024.0);
+  state.counters["octets_per_person"] = double(octets) / ppl->size();
+  state.SetItemsProcessed(state.iterations() * ppl->size());
+  state.SetLabel(GetName(distribution));
+}
+BENCHMARK_TEMPLATE(BM_Load, engine::My1stMatchingPplProvider)
+    ->Apply(AddDatasets)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Load, engine::PrototypeMatchingPplProvider)
+    ->Apply(AddDatasets)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Load, engine::PplmeMatchingPplProvider)
+    ->Apply(AddDatasets)->Unit(benchmark::kMillisecond);
+
+
+/** Single-threaded, this is the latency of a find; with more threads, the
+    items_per_second is the throughput. */
+template <typename Provider>
+void BM_FindMatchingPpl(benchmark::State& state) {
+  static std::atomic<unsigned int> next_seed{kSeed};
+
+  auto const distribution = static_cast<Distribution>(state.range(1));
+  auto const provider =
+      GetLoadedProvider<Provider>(state.range(0), distribution);
+  auto const queries = CreateQueries(
+      *GetSyntheticPpl(state.range(0), distribution), next_seed++);
+
+  size_t next_query = 0;
+  int64_t ppl_found = 0;
+  for (auto _ : state) {
+    auto const ppl =
+        provider->FindMatchingPpl(queries[next_query++ % queries.size()]);
+    ppl_found += ppl.size();
+  }
+
+  state.counters["ppl_per_find"] = benchmark::Counter(
+      double(ppl_found) / state.iterations(),
+      benchmark::Counter::kAvgThreads);
+  state.SetItemsProcessed(state.iterations());
+  state.SetLabel(GetName(distribution));
+}
+BENCHMARK_TEMPLATE(BM_FindMatchingPpl, engine::My1stMatchingPplProvider)
+    ->Apply(AddDatasets)->Unit(benchmark::kMicrosecond)->UseRealTime()
+    ->Threads(1)->Threads(GetThroughputThreadCount());
+BENCHMARK_TEMPLATE(BM_FindMatchingPpl, engine::PrototypeMatchingPplProvider)
+    ->Apply(AddDatasets)->Unit(benchmark::kMicrosecond)->UseRealTime()
+    ->Threads(1)->Threads(GetThroughputThreadCount());
+BENCHMARK_TEMPLATE(BM_FindMatchingPpl, engine::PplmeMatchingPplProvider)
+    ->Apply(AddDatasets)->Unit(benchmark::kMicrosecond)->UseRealTime()
+    ->Threads(1)->Threads(GetThroughputThreadCount());
+
+
+BENCHMARK_MAIN();
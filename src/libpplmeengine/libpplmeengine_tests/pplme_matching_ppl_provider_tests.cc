@@ -5,11 +5,20 @@
  */
 
 
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
 #include <boost/numeric/conversion/cast.hpp>
 #include <boost/uuid/random_generator.hpp>
 #include <boost/uuid/string_generator.hpp>
+#include <boost/uuid/uuid_io.hpp>
 #include <gtest/gtest.h>
 #include "libpplmeutils/testlettes.h"
+#include "libpplmeutils/trace.h"
 #include "libpplmeengine/pplme_matching_ppl_provider.h"
 
 
@@ -228,6 +237,889 @@ PPLME_TESTLETTES_END(find_all_matching_ppl_testlettes,
                      PplmeMatchingPplProviderTest_FindAllMatchingPpl)
 
 
+/**
+ *  @test  VisitMatchingPpl() should visit exactly who FindMatchingPpl() finds,
+ *         and hand out the ppl where they live rather than copies.
+ */
+TEST(PplmeMatchingPplProviderTest, VisitMatchingPplVisitsMatchingPplInSitu) {
+  // Arrange.
+  int const kMaxPpl = 1000;
+  PplmeMatchingPplProvider ppl_provider{
+      1, 0, kMaxPpl, kPerFindConcurrency,
+      []() { return boost::gregorian::date{2014, 11, 25}; }};
+  std::default_random_engine random_engine;
+  std::uniform_real_distribution<float> latgen{-10, 10};
+  std::uniform_real_distribution<float> longgen{-10, 10};
+  for (int n = 0; n < 200; ++n) {
+    std::unique_ptr<Person> person{new Person{
+        PersonId{boost::uuids::random_generator()()},
+        "Visitor " + std::to_string(n),
+        boost::gregorian::date{1984, 11, 25},
+        GeoPosition{GeoPosition::DecimalLatitude{latgen(random_engine)},
+                    GeoPosition::DecimalLongitude{longgen(random_engine)}}}};
+    ppl_provider.AddPerson(std::move(person));
+  }
+  PplMatchingParameters matching_params{
+      GeoPosition{GeoPosition::DecimalLatitude{0},
+                  GeoPosition::DecimalLongitude{0}},
+      30};
+
+  // Act.
+  auto found_ppl = ppl_provider.FindMatchingPpl(matching_params);
+  std::vector<Person const*> visited_ppl;
+  ppl_provider.VisitMatchingPpl(
+      matching_params,
+      [&visited_ppl](Person const& person) {
+        visited_ppl.push_back(&person);
+      });
+  std::vector<Person const*> revisited_ppl;
+  ppl_provider.VisitMatchingPpl(
+      matching_params,
+      [&revisited_ppl](Person const& person) {
+        revisited_ppl.push_back(&person);
+      });
+
+  // Assert.
+  ASSERT_EQ(200U, found_ppl.size());
+  std::set<std::string> found_names;
+  for (auto const& person : found_ppl)
+    found_names.insert(person.name());
+  std::set<std::string> visited_names;
+  for (auto person : visited_ppl)
+    visited_names.insert(person->name());
+  ASSERT_EQ(found_names, visited_names);
+  // In situ means the same Person instances each time.
+  std::sort(visited_ppl.begin(), visited_ppl.end());
+  std::sort(revisited_ppl.begin(), revisited_ppl.end());
+  ASSERT_EQ(visited_ppl, revisited_ppl);
+}
+
+
+/**
+ *  @test  VisitMatchingPplIds() should visit exactly who VisitMatchingPpl()
+ *         does, with the same ids and locations.
+ */
+TEST(PplmeMatchingPplProviderTest, VisitMatchingPplIdsVisitsMatchingPpl) {
+  // Arrange.
+  PplmeMatchingPplProvider ppl_provider{
+      1, 0, 1000, kPerFindConcurrency,
+      []() { return boost::gregorian::date{2014, 11, 25}; }};
+  std::default_random_engine random_engine;
+  std::uniform_real_distribution<float> latgen{-10, 10};
+  std::uniform_real_distribution<float> longgen{-10, 10};
+  for (int n = 0; n < 100; ++n) {
+    std::unique_ptr<Person> person{new Person{
+        PersonId{boost::uuids::random_generator()()},
+        "Projectee " + std::to_string(n),
+        boost::gregorian::date(1984, 11, 25 - n % 2),
+        GeoPosition{GeoPosition::DecimalLatitude{latgen(random_engine)},
+                    GeoPosition::DecimalLongitude{longgen(random_engine)}}}};
+    ppl_provider.AddPerson(std::move(person));
+  }
+  PplMatchingParameters matching_params{
+      GeoPosition{GeoPosition::DecimalLatitude{0},
+                  GeoPosition::DecimalLongitude{0}},
+      30};
+
+  // Act.
+  std::map<std::string, float> visited_ppl;
+  ppl_provider.VisitMatchingPpl(
+      matching_params,
+      [&visited_ppl](Person const& person) {
+        visited_ppl[to_string(person.id().value())] =
+            person.location_of_home().latitude().value();
+      });
+  std::map<std::string, float> visited_ids;
+  ppl_provider.VisitMatchingPplIds(
+      matching_params,
+      [&visited_ids](PersonId const& id, GeoPosition const& home) {
+        visited_ids[to_string(id.value())] = home.latitude().value();
+      });
+
+  // Assert.
+  ASSERT_EQ(50U, visited_ppl.size());
+  ASSERT_EQ(visited_ppl, visited_ids);
+}
+
+
+PPLME_TESTLETTE_TYPE_BEGIN(PaginationTestlette)
+  int resolution;
+  int per_find_concurrency;
+  unsigned int page_size;
+PPLME_TESTLETTE_TYPE_END(PaginationTestlette,
+                         PplmeMatchingPplProviderTest_Pagination)
+
+/**
+ *  @test  Paging through matching ppl should hand out exactly who a single
+ *         big-enough page does, in the same order, without repeats, and
+ *         should say when there's nothing left.
+ */
+TEST_P(PplmeMatchingPplProviderTest_Pagination, Tests) {
+  // Arrange.
+  PplmeMatchingPplProvider ppl_provider{
+      GetParam().resolution, 1, 1000, GetParam().per_find_concurrency,
+      []() { return boost::gregorian::date{2014, 11, 25}; }};
+  std::default_random_engine random_engine;
+  // Few enough cells that most have several ppl in them (so that pages end
+  // part way through cells).
+  std::uniform_real_distribution<float> latgen{-3, 3};
+  std::uniform_real_distribution<float> longgen{-3, 3};
+  std::uniform_int_distribution<int> daygen{0, 3 * 365};
+  for (int n = 0; n < 300; ++n) {
+    std::unique_ptr<Person> person{new Person{
+        PersonId{boost::uuids::random_generator()()},
+        "Pagee " + std::to_string(n),
+        boost::gregorian::date{1983, 1, 1}
+            + boost::gregorian::days{daygen(random_engine)},
+        GeoPosition{GeoPosition::DecimalLatitude{latgen(random_engine)},
+                    GeoPosition::DecimalLongitude{longgen(random_engine)}}}};
+    ppl_provider.AddPerson(std::move(person));
+  }
+  GeoPosition const location_of_user{GeoPosition::DecimalLatitude{0.5},
+                                     GeoPosition::DecimalLongitude{-0.5}};
+
+  // Act.
+  std::vector<std::string> all_ppl;
+  auto const everyone = ppl_provider.VisitMatchingPpl(
+      PplMatchingParameters{location_of_user, 30},
+      [&all_ppl](Person const& person) { all_ppl.push_back(person.name()); });
+  std::vector<std::string> paged_ppl;
+  PplMatchingParameters matching_params{location_of_user, 30};
+  matching_params.set_limit(GetParam().page_size);
+  for (int page_count = 1; ; ++page_count) {
+    auto const previous_size = paged_ppl.size();
+    auto const page = ppl_provider.VisitMatchingPpl(
+        matching_params,
+        [&paged_ppl](Person const& person) {
+          paged_ppl.push_back(person.name());
+        });
+    ASSERT_LE(paged_ppl.size() - previous_size, GetParam().page_size);
+    ASSERT_LT(page_count, 1000) << "Paging forever";
+    ASSERT_FALSE(page.partial);
+    if (!page.next_cursor)
+      break;
+    matching_params.set_cursor(page.next_cursor.get());
+  }
+
+  // Assert.
+  ASSERT_FALSE(everyone.next_cursor);
+  ASSERT_FALSE(everyone.partial);
+  ASSERT_LT(100U, all_ppl.size());
+  ASSERT_EQ(all_ppl, paged_ppl);
+}
+
+PPLME_TESTLETTES_BEGIN(PaginationTestlette, pagination_testlettes)
+  PPLME_TESTLETTE(1, 1, 1),
+  PPLME_TESTLETTE(1, kPerFindConcurrency, 1),
+  PPLME_TESTLETTE(1, kPerFindConcurrency, 7),
+  PPLME_TESTLETTE(2, kPerFindConcurrency, 10),
+  PPLME_TESTLETTE(2, kPerFindConcurrency, 64),
+  PPLME_TESTLETTE(1, kPerFindConcurrency, 999)
+PPLME_TESTLETTES_END(pagination_testlettes,
+                     PplmeMatchingPplProviderTest_Pagination)
+
+
+/**
+ *  @test  A deadline that has already passed should find nobody, but should
+ *         own up to it, and with a cursor that carries on from exactly where
+ *         it was asked to start (including part way through a cell).
+ */
+TEST(PplmeMatchingPplProviderTest, BlownDeadlineIsPartialAndResumable) {
+  // Arrange.
+  PplmeMatchingPplProvider ppl_provider{
+      1, 1, 1000, kPerFindConcurrency,
+      []() { return boost::gregorian::date{2014, 11, 25}; }};
+  std::default_random_engine random_engine;
+  std::uniform_real_distribution<float> posgen{-2, 2};
+  for (int n = 0; n < 100; ++n) {
+    std::unique_ptr<Person> person{new Person{
+        PersonId{boost::uuids::random_generator()()},
+        "Latecomer " + std::to_string(n),
+        boost::gregorian::date{1984, 11, 25},
+        GeoPosition{GeoPosition::DecimalLatitude{posgen(random_engine)},
+                    GeoPosition::DecimalLongitude{posgen(random_engine)}}}};
+    ppl_provider.AddPerson(std::move(person));
+  }
+  GeoPosition const location_of_user{GeoPosition::DecimalLatitude{0},
+                                     GeoPosition::DecimalLongitude{0}};
+  auto const collect = [](std::vector<std::string>* names) {
+    return [names](Person const& person) { names->push_back(person.name()); };
+  };
+  std::vector<std::string> all_ppl;
+  ppl_provider.VisitMatchingPpl(PplMatchingParameters{location_of_user, 30},
+                                collect(&all_ppl));
+  std::vector<std::string> ppl;
+  PplMatchingParameters matching_params{location_of_user, 30};
+  auto const first_page = ppl_provider.VisitMatchingPpl(
+      matching_params.set_limit(7), collect(&ppl));
+  ASSERT_TRUE(first_page.next_cursor);
+
+  // Act.
+  std::vector<std::string> late_ppl;
+  auto const late_page = ppl_provider.VisitMatchingPpl(
+      PplMatchingParameters{matching_params}
+          .set_cursor(*first_page.next_cursor)
+          .set_deadline(std::chrono::steady_clock::now()
+                        - std::chrono::seconds(1)),
+      collect(&late_ppl));
+  ASSERT_TRUE(late_page.next_cursor);
+  auto const rest = ppl_provider.VisitMatchingPpl(
+      PplMatchingParameters{location_of_user, 30}.set_cursor(
+          *late_page.next_cursor),
+      collect(&ppl));
+
+  // Assert.
+  ASSERT_TRUE(late_page.partial);
+  ASSERT_TRUE(late_ppl.empty());
+  ASSERT_EQ(*first_page.next_cursor, *late_page.next_cursor);
+  ASSERT_FALSE(rest.partial);
+  ASSERT_FALSE(rest.next_cursor);
+  ASSERT_EQ(all_ppl, ppl);
+}
+
+
+/**
+ *  @test  A generous deadline shouldn't get in the way.
+ */
+TEST(PplmeMatchingPplProviderTest, GenerousDeadlineIsNotPartial) {
+  // Arrange.
+  PplmeMatchingPplProvider ppl_provider{
+      1, 1, 1000, kPerFindConcurrency,
+      []() { return boost::gregorian::date{2014, 11, 25}; }};
+  for (int n = 0; n < 10; ++n) {
+    std::unique_ptr<Person> person{new Person{
+        PersonId{boost::uuids::random_generator()()},
+        "Early Bird " + std::to_string(n),
+        boost::gregorian::date{1984, 11, 25},
+        GeoPosition{GeoPosition::DecimalLatitude{n * 0.1f},
+                    GeoPosition::DecimalLongitude{n * -0.1f}}}};
+    ppl_provider.AddPerson(std::move(person));
+  }
+  GeoPosition const location_of_user{GeoPosition::DecimalLatitude{0},
+                                     GeoPosition::DecimalLongitude{0}};
+
+  // Act.
+  int found_count = 0;
+  auto const outcome = ppl_provider.VisitMatchingPpl(
+      PplMatchingParameters{location_of_user, 30}.set_deadline(
+          std::chrono::steady_clock::now() + std::chrono::hours(1)),
+      [&found_count](Person const&) { ++found_count; });
+
+  // Assert.
+  ASSERT_FALSE(outcome.partial);
+  ASSERT_FALSE(outcome.next_cursor);
+  ASSERT_EQ(10, found_count);
+}
+
+
+/**
+ *  @test  The stats should add up: with a max distance, some cells get
+ *         skipped, and not everyone who's scanned in the cells that are
+ *         visited is close enough to match.
+ */
+TEST(PplmeMatchingPplProviderTest, StatsAddUp) {
+  // Arrange.
+  PplmeMatchingPplProvider ppl_provider{
+      1, 5, 1000, kPerFindConcurrency,
+      []() { return boost::gregorian::date{2014, 11, 25}; }};
+  for (int n = 0; n < 20; ++n) {
+    std::unique_ptr<Person> person{new Person{
+        PersonId{boost::uuids::random_generator()()},
+        "Statistic " + std::to_string(n),
+        boost::gregorian::date{1984, 11, 25},
+        // I.e., 22km or so apart.
+        GeoPosition{GeoPosition::DecimalLatitude{n * 0.2f},
+                    GeoPosition::DecimalLongitude{0}}}};
+    ppl_provider.AddPerson(std::move(person));
+  }
+  GeoPosition const location_of_user{GeoPosition::DecimalLatitude{0},
+                                     GeoPosition::DecimalLongitude{0}};
+  auto const before = ppl_provider.GetStats();
+
+  // Act.
+  auto const ppl = ppl_provider.FindMatchingPpl(
+      PplMatchingParameters{location_of_user, 30}.set_max_distance(50));
+  auto const after = ppl_provider.GetStats();
+
+  // Assert.
+  ASSERT_EQ(0U, before.cells_visited);
+  ASSERT_EQ(0U, before.ppl_matched);
+  ASSERT_EQ(3U, ppl.size());
+  ASSERT_EQ(3U, after.ppl_matched);
+  ASSERT_LT(after.ppl_matched, after.ppl_scanned);
+  ASSERT_GE(20U, after.ppl_scanned);
+  ASSERT_LT(0U, after.cells_visited);
+  ASSERT_LT(0U, after.cells_skipped);
+}
+
+
+/**
+ *  @test  The grid's storage should be accounted for, and should grow by at
+ *         least an entry's worth per Person added.
+ */
+TEST(PplmeMatchingPplProviderTest, StorageIsAccountedFor) {
+  // Arrange.
+  PplmeMatchingPplProvider ppl_provider{
+      1, 5, 1000, kPerFindConcurrency,
+      []() { return boost::gregorian::date{2014, 11, 25}; }, 2};
+  auto const before = ppl_provider.GetStats();
+  std::vector<std::unique_ptr<Person>> ppl;
+  for (int n = 0; n < 1000; ++n) {
+    ppl.emplace_back(new Person{
+        PersonId{boost::uuids::random_generator()()},
+        "Stored " + std::to_string(n),
+        boost::gregorian::date{1984, 11, 25},
+        GeoPosition{GeoPosition::DecimalLatitude{0},
+                    GeoPosition::DecimalLongitude{n % 2 ? -90.0f : 90.0f}}});
+  }
+
+  // Act.
+  ppl_provider.AddPpl(std::move(ppl));
+  auto const after = ppl_provider.GetStats();
+
+  // Assert.
+  ASSERT_LT(0U, before.storage_octets);
+  ASSERT_LE(before.storage_octets, before.storage_mapped_octets);
+  ASSERT_LE(before.storage_huge_page_octets, before.storage_mapped_octets);
+  ASSERT_LE(before.storage_octets + 1000 * sizeof(PersonId),
+            after.storage_octets);
+  ASSERT_LE(after.storage_octets, after.storage_mapped_octets);
+}
+
+
+/**
+ *  @test  A traced find should record the find itself, each ring, and each
+ *         cell, and shouldn't find anyone different for it.
+ */
+TEST(PplmeMatchingPplProviderTest, TracedFindRecordsSqiral) {
+  // Arrange.
+  PplmeMatchingPplProvider ppl_provider{
+      1, 5, 1000, kPerFindConcurrency,
+      []() { return boost::gregorian::date{2014, 11, 25}; }};
+  for (int n = 0; n < 5; ++n) {
+    std::unique_ptr<Person> person{new Person{
+        PersonId{boost::uuids::random_generator()()},
+        "Tracee " + std::to_string(n),
+        boost::gregorian::date{1984, 11, 25},
+        GeoPosition{GeoPosition::DecimalLatitude{n * 0.5f},
+                    GeoPosition::DecimalLongitude{0}}}};
+    ppl_provider.AddPerson(std::move(person));
+  }
+  GeoPosition const location_of_user{GeoPosition::DecimalLatitude{0},
+                                     GeoPosition::DecimalLongitude{0}};
+  auto const trace = std::make_shared<pplme::utils::Trace>();
+
+  // Act.
+  auto const ppl = ppl_provider.FindMatchingPpl(
+      PplMatchingParameters{location_of_user, 30}
+          .set_max_distance(300)
+          .set_trace(trace));
+  std::ostringstream json;
+  trace->WriteJson(json);
+
+  // Assert.
+  ASSERT_EQ(5U, ppl.size());
+  // One find, a span per ring, and a span per cell queued.
+  ASSERT_LT(1U + 5U, trace->GetSpanCount());
+  ASSERT_NE(std::string::npos, json.str().find("\"name\":\"Find\""));
+  ASSERT_NE(std::string::npos, json.str().find("\"name\":\"Ring\""));
+  ASSERT_NE(std::string::npos, json.str().find("\"name\":\"Cell\""));
+  ASSERT_NE(std::string::npos, json.str().find("\"ppl\":5,\"partial\":0}"));
+}
+
+
+PPLME_TESTLETTE_TYPE_BEGIN(MaxDistanceTestlette)
+  int resolution;
+  float user_latitude;
+  float user_longitude;
+  float max_distance;
+PPLME_TESTLETTE_TYPE_END(MaxDistanceTestlette,
+                         PplmeMatchingPplProviderTest_MaxDistance)
+
+/**
+ *  @test  A max distance should find exactly who is within it (as the crow,
+ *         or rather ApproxDistanceBetween(), flies), no matter how much of
+ *         the sqiral gets pruned.
+ */
+TEST_P(PplmeMatchingPplProviderTest_MaxDistance, Tests) {
+  // Arrange.
+  PplmeMatchingPplProvider ppl_provider{
+      GetParam().resolution, 0, 100000, kPerFindConcurrency,
+      []() { return boost::gregorian::date{2014, 11, 25}; }};
+  GeoPosition const location_of_user{
+      GeoPosition::DecimalLatitude{GetParam().user_latitude},
+      GeoPosition::DecimalLongitude{GetParam().user_longitude}};
+  std::default_random_engine random_engine;
+  // Plenty of ppl near the user (wrapping around at the antimeridian, and
+  // clamping at the Poles), with a smattering further afield.
+  std::uniform_real_distribution<float> offgen{-25, 25};
+  std::set<std::string> nearby_ppl;
+  for (int n = 0; n < 2000; ++n) {
+    auto latitude = std::max(
+        -90.f,
+        std::min(90.f, GetParam().user_latitude + offgen(random_engine)));
+    auto longitude = GetParam().user_longitude + offgen(random_engine) * 3;
+    if (longitude >= 180)
+      longitude -= 360;
+    else if (longitude < -180)
+      longitude += 360;
+    GeoPosition const location_of_home{
+        GeoPosition::DecimalLatitude{latitude},
+        GeoPosition::DecimalLongitude{longitude}};
+    auto const name = "Neighbour " + std::to_string(n);
+    if (pplme::core::ApproxDistanceBetween(location_of_user, location_of_home)
+        <= GetParam().max_distance)
+      nearby_ppl.insert(name);
+    std::unique_ptr<Person> person{new Person{
+        PersonId{boost::uuids::random_generator()()},
+        name,
+        boost::gregorian::date{1984, 11, 25},
+        location_of_home}};
+    ppl_provider.AddPerson(std::move(person));
+  }
+
+  // Act.
+  std::set<std::string> found_ppl;
+  ppl_provider.VisitMatchingPpl(
+      PplMatchingParameters{location_of_user, 30}.set_max_distance(
+          GetParam().max_distance),
+      [&found_ppl](Person const& person) { found_ppl.insert(person.name()); });
+
+  // Assert.
+  ASSERT_FALSE(nearby_ppl.empty());
+  ASSERT_EQ(nearby_ppl, found_ppl);
+}
+
+PPLME_TESTLETTES_BEGIN(MaxDistanceTestlette, max_distance_testlettes)
+  PPLME_TESTLETTE(1, 51.5, -0.1, 50),
+  PPLME_TESTLETTE(1, 51.5, -0.1, 500),
+  PPLME_TESTLETTE(2, 0, 0, 1000),
+  PPLME_TESTLETTE(1, -33.9, 151.2, 2500),
+  PPLME_TESTLETTE(1, 10, 179.5, 800),
+  PPLME_TESTLETTE(1, 80, -179.9, 800),
+  PPLME_TESTLETTE(1, -89.5, 0, 300)
+PPLME_TESTLETTES_END(max_distance_testlettes,
+                     PplmeMatchingPplProviderTest_MaxDistance)
+
+
+/**
+ *  @test  An age range should override the provider's max_age_difference.
+ */
+TEST(PplmeMatchingPplProviderTest, AgeRangeOverridesMaxAgeDifference) {
+  // Arrange.
+  PplmeMatchingPplProvider ppl_provider{
+      1, 2, 1000, kPerFindConcurrency,
+      []() { return boost::gregorian::date{2014, 11, 25}; }};
+  for (int age = 0; age < 100; ++age) {
+    std::unique_ptr<Person> person{new Person{
+        PersonId{boost::uuids::random_generator()()},
+        "Aged " + std::to_string(age),
+        boost::gregorian::date(2014 - age, 11, 25),
+        GeoPosition{GeoPosition::DecimalLatitude{0},
+                    GeoPosition::DecimalLongitude{0}}}};
+    ppl_provider.AddPerson(std::move(person));
+  }
+  // Plus some whose birthdays aren't today, either side of either end of the
+  // range (39, 40, 49 and 50, as of today).
+  for (int year : {1975, 1974, 1965, 1964}) {
+    std::unique_ptr<Person> person{new Person{
+        PersonId{boost::uuids::random_generator()()},
+        "Born in May " + std::to_string(year),
+        boost::gregorian::date(year, 5, 1),
+        GeoPosition{GeoPosition::DecimalLatitude{0},
+                    GeoPosition::DecimalLongitude{0}}}};
+    ppl_provider.AddPerson(std::move(person));
+  }
+  GeoPosition const location_of_user{GeoPosition::DecimalLatitude{0},
+                                     GeoPosition::DecimalLongitude{0}};
+
+  // Act.
+  auto const default_ppl = ppl_provider.FindMatchingPpl(
+      PplMatchingParameters{location_of_user, 30});
+  auto const ranged_ppl = ppl_provider.FindMatchingPpl(
+      PplMatchingParameters{location_of_user, 30}.set_min_age(40)
+                                                 .set_max_age(49));
+  auto const older_ppl = ppl_provider.FindMatchingPpl(
+      PplMatchingParameters{location_of_user, 30}.set_min_age(90));
+
+  // Assert.
+  ASSERT_EQ(5U, default_ppl.size());
+  ASSERT_EQ(12U, ranged_ppl.size());
+  for (auto const& person : ranged_ppl) {
+    ASSERT_NE("Born in May 1975", person.name());
+    ASSERT_NE("Born in May 1964", person.name());
+  }
+  // 90 up to the default of 30 + 2 is nobody.
+  ASSERT_EQ(0U, older_ppl.size());
+}
+
+
+/**
+ *  @test  A provider-wide max_ppl should still cap a request's own limit.
+ */
+TEST(PplmeMatchingPplProviderTest, MaxPplCapsLimit) {
+  // Arrange.
+  PplmeMatchingPplProvider ppl_provider{
+      1, 0, 5, kPerFindConcurrency,
+      []() { return boost::gregorian::date{2014, 11, 25}; }};
+  for (int n = 0; n < 20; ++n) {
+    std::unique_ptr<Person> person{new Person{
+        PersonId{boost::uuids::random_generator()()},
+        "Capped " + std::to_string(n),
+        boost::gregorian::date{1984, 11, 25},
+        GeoPosition{GeoPosition::DecimalLatitude{0},
+                    GeoPosition::DecimalLongitude{0}}}};
+    ppl_provider.AddPerson(std::move(person));
+  }
+  GeoPosition const location_of_user{GeoPosition::DecimalLatitude{0},
+                                     GeoPosition::DecimalLongitude{0}};
+
+  // Act.
+  auto const capped_ppl = ppl_provider.FindMatchingPpl(
+      PplMatchingParameters{location_of_user, 30}.set_limit(10));
+  auto const limited_ppl = ppl_provider.FindMatchingPpl(
+      PplMatchingParameters{location_of_user, 30}.set_limit(2));
+
+  // Assert.
+  ASSERT_EQ(5U, capped_ppl.size());
+  ASSERT_EQ(2U, limited_ppl.size());
+}
+
+
+/**
+ *  @test  Adding ppl in bulk (on top of some already added one at a time)
+ *         should leave the grid just as adding them one at a time would,
+ *         right down to the order of those sharing a date of birth.
+ */
+TEST(PplmeMatchingPplProviderTest, AddPplIsAddPersonButQuicker) {
+  // Arrange.
+  auto const today = []() { return boost::gregorian::date{2014, 11, 25}; };
+  PplmeMatchingPplProvider one_at_a_time{1, 2, 1000, 1, today};
+  PplmeMatchingPplProvider in_bulk{1, 2, 1000, 1, today};
+  std::default_random_engine random_engine;
+  std::uniform_real_distribution<float> posgen{-3, 3};
+  std::uniform_int_distribution<int> daygen{0, 3 * 365};
+  auto const create_person = [&](int n) {
+    // Few enough dates of birth that plenty are shared.
+    return std::unique_ptr<Person>{new Person{
+        PersonId{boost::uuids::random_generator()()},
+        "Bulkee " + std::to_string(n),
+        boost::gregorian::date{1983, 1, 1}
+            + boost::gregorian::days{daygen(random_engine) % 20},
+        GeoPosition{GeoPosition::DecimalLatitude{posgen(random_engine)},
+                    GeoPosition::DecimalLongitude{posgen(random_engine)}}}};
+  };
+  for (int n = 0; n < 100; ++n) {
+    auto person = create_person(n);
+    in_bulk.AddPerson(std::unique_ptr<Person>{new Person{*person}});
+    one_at_a_time.AddPerson(std::move(person));
+  }
+  std::vector<std::unique_ptr<Person>> ppl;
+  for (int n = 100; n < 500; ++n) {
+    auto person = create_person(n);
+    one_at_a_time.AddPerson(std::unique_ptr<Person>{new Person{*person}});
+    ppl.push_back(std::move(person));
+  }
+  GeoPosition const location_of_user{GeoPosition::DecimalLatitude{0},
+                                     GeoPosition::DecimalLongitude{0}};
+
+  // Act.
+  in_bulk.AddPpl(std::move(ppl), kPerFindConcurrency);
+
+  // Assert.
+  auto const get_names = [&location_of_user](
+      PplmeMatchingPplProvider const& ppl_provider) {
+    std::vector<std::string> names;
+    ppl_provider.VisitMatchingPpl(
+        PplMatchingParameters{location_of_user, 31},
+        [&names](Person const& person) { names.push_back(person.name()); });
+    return names;
+  };
+  auto const names = get_names(one_at_a_time);
+  ASSERT_EQ(500U, names.size());
+  ASSERT_EQ(names, get_names(in_bulk));
+}
+
+
+/**
+ *  @test  Removing a Person should remove them (and only them), and only if
+ *         they're where they're said to be.
+ */
+TEST(PplmeMatchingPplProviderTest, RemovePersonRemovesThemAndOnlyThem) {
+  // Arrange.
+  auto const today = []() { return boost::gregorian::date{2014, 11, 25}; };
+  PplmeMatchingPplProvider ppl_provider{1, 2, 10, 1, today};
+  GeoPosition const location{GeoPosition::DecimalLatitude{1},
+                             GeoPosition::DecimalLongitude{1}};
+  GeoPosition const elsewhere{GeoPosition::DecimalLatitude{-40},
+                              GeoPosition::DecimalLongitude{100}};
+  Person const keeper{PersonId{boost::uuids::random_generator()()},
+                      "Keeper", boost::gregorian::date{1983, 1, 1}, location};
+  Person const goner{PersonId{boost::uuids::random_generator()()},
+                     "Goner", boost::gregorian::date{1983, 1, 1}, location};
+  ppl_provider.AddPerson(std::unique_ptr<Person>{new Person{keeper}});
+  ppl_provider.AddPerson(std::unique_ptr<Person>{new Person{goner}});
+
+  // Act.
+  auto const removed_from_elsewhere =
+      ppl_provider.RemovePerson(goner.id(), elsewhere);
+  auto const removed = ppl_provider.RemovePerson(goner.id(), location);
+  auto const removed_again = ppl_provider.RemovePerson(goner.id(), location);
+
+  // Assert.
+  ASSERT_FALSE(removed_from_elsewhere);
+  ASSERT_TRUE(removed);
+  ASSERT_FALSE(removed_again);
+  auto const ppl =
+      ppl_provider.FindMatchingPpl(PplMatchingParameters{location, 31});
+  ASSERT_EQ(1U, ppl.size());
+  ASSERT_EQ("Keeper", ppl[0].name());
+}
+
+
+/**
+ *  @test  Mutations should be applied in the order given.
+ */
+TEST(PplmeMatchingPplProviderTest, ApplyPplMutationsAppliesThemInOrder) {
+  // Arrange.
+  auto const today = []() { return boost::gregorian::date{2014, 11, 25}; };
+  PplmeMatchingPplProvider ppl_provider{1, 2, 10, 1, today};
+  GeoPosition const location{GeoPosition::DecimalLatitude{1},
+                             GeoPosition::DecimalLongitude{1}};
+  Person const fleeting{PersonId{boost::uuids::random_generator()()},
+                        "Fleeting", boost::gregorian::date{1983, 1, 1},
+                        location};
+  Person const lasting{PersonId{boost::uuids::random_generator()()},
+                       "Lasting", boost::gregorian::date{1983, 1, 1},
+                       location};
+  using Kind = pplme::core::PplMutation::Kind;
+
+  // Act.
+  ppl_provider.ApplyPplMutations({{Kind::Add, fleeting},
+                                  {Kind::Add, lasting},
+                                  {Kind::Remove, fleeting}});
+
+  // Assert.
+  auto const ppl =
+      ppl_provider.FindMatchingPpl(PplMatchingParameters{location, 31});
+  ASSERT_EQ(1U, ppl.size());
+  ASSERT_EQ("Lasting", ppl[0].name());
+}
+
+
+/**
+ *  @test  Adding and removing ppl while finds are going on should neither
+ *         upset the finds nor be upset by them.
+ */
+TEST(PplmeMatchingPplProviderTest, PplCanComeAndGoMidFind) {
+  // Arrange.
+  auto const today = []() { return boost::gregorian::date{2014, 11, 25}; };
+  PplmeMatchingPplProvider ppl_provider{1, 2, 1000, kPerFindConcurrency,
+                                        today};
+  GeoPosition const location{GeoPosition::DecimalLatitude{0},
+                             GeoPosition::DecimalLongitude{0}};
+  Person const regular{PersonId{boost::uuids::random_generator()()},
+                       "Regular", boost::gregorian::date{1983, 1, 1},
+                       location};
+  ppl_provider.AddPerson(std::unique_ptr<Person>{new Person{regular}});
+  std::atomic<bool> stop{false};
+  std::thread comer_and_goer{[&]() {
+      std::default_random_engine random_engine;
+      std::uniform_real_distribution<float> posgen{-3, 3};
+      while (!stop) {
+        Person const visitor{
+            PersonId{boost::uuids::random_generator()()},
+            "Visitor", boost::gregorian::date{1983, 6, 1},
+            GeoPosition{GeoPosition::DecimalLatitude{posgen(random_engine)},
+                        GeoPosition::DecimalLongitude{posgen(random_engine)}}};
+        ppl_provider.AddPerson(std::unique_ptr<Person>{new Person{visitor}});
+        ppl_provider.RemovePerson(visitor.id(), visitor.location_of_home());
+      }
+    }};
+
+  // Act.
+  std::vector<size_t> found_counts;
+  for (int n = 0; n < 200; ++n) {
+    size_t found_count = 0;
+    ppl_provider.VisitMatchingPpl(
+        PplMatchingParameters{location, 31},
+        [&found_count](Person const&) { ++found_count; });
+    found_counts.push_back(found_count);
+  }
+  stop = true;
+  comer_and_goer.join();
+
+  // Assert.
+  for (auto const found_count : found_counts) {
+    ASSERT_LE(1U, found_count);
+    ASSERT_GE(2U, found_count);
+  }
+}
+
+
+/**
+ *  @test  A long run of additions (which is added in one go) should end up
+ *         just as if each Person had been added in turn, and the mutations
+ *         either side of it should still happen in order.
+ */
+TEST(PplmeMatchingPplProviderTest, ApplyPplMutationsAddsLongRunsInBulk) {
+  // Arrange.
+  auto const today = []() { return boost::gregorian::date{2014, 11, 25}; };
+  PplmeMatchingPplProvider bulk{1, 2, 10, 1, today};
+  PplmeMatchingPplProvider one_by_one{1, 2, 10, 1, today};
+  std::default_random_engine random_engine;
+  std::uniform_int_distribution<int> random_month{1, 12};
+  std::uniform_real_distribution<float> random_degrees{-2, 2};
+  using Kind = pplme::core::PplMutation::Kind;
+  std::vector<pplme::core::PplMutation> mutations;
+  for (int n = 0; n < 10000; ++n) {
+    Person const person{
+        PersonId{boost::uuids::random_generator()()},
+        "Person " + std::to_string(n),
+        boost::gregorian::date(1983, random_month(random_engine), 1),
+        GeoPosition{
+            GeoPosition::DecimalLatitude{random_degrees(random_engine)},
+            GeoPosition::DecimalLongitude{random_degrees(random_engine)}}};
+    mutations.push_back({Kind::Add, person});
+    one_by_one.AddPerson(std::unique_ptr<Person>{new Person{person}});
+  }
+  // Somebody's gone before they've arrived (and so stays), and somebody
+  // else arrives and is gone again.
+  mutations.insert(mutations.begin(), {Kind::Remove, mutations[9999].person});
+  Person const fleeting{PersonId{boost::uuids::random_generator()()},
+                        "Fleeting", boost::gregorian::date{1983, 1, 1},
+                        GeoPosition{GeoPosition::DecimalLatitude{0},
+                                    GeoPosition::DecimalLongitude{0}}};
+  mutations.push_back({Kind::Add, fleeting});
+  mutations.push_back({Kind::Remove, fleeting});
+
+  // Act.
+  bulk.ApplyPplMutations(mutations);
+
+  // Assert.
+  std::vector<std::string> bulk_names;
+  bulk.VisitAllPpl([&bulk_names](Person const& person) {
+      bulk_names.push_back(person.name());
+    });
+  std::vector<std::string> one_by_one_names;
+  one_by_one.VisitAllPpl([&one_by_one_names](Person const& person) {
+      one_by_one_names.push_back(person.name());
+    });
+  ASSERT_EQ(10000U, bulk_names.size());
+  ASSERT_EQ(one_by_one_names, bulk_names);
+}
+
+
+/**
+ *  @test  Everyone should be visited, exactly once, whichever partition
+ *         they're in.
+ */
+TEST(PplmeMatchingPplProviderTest, VisitAllPplVisitsEveryone) {
+  // Arrange.
+  auto const today = []() { return boost::gregorian::date{2014, 11, 25}; };
+  PplmeMatchingPplProvider ppl_provider{2, 2, 10, 1, today, 3};
+  std::set<std::string> names;
+  for (int longitude = -180; longitude <= 180; longitude += 15) {
+    auto const name = std::to_string(longitude);
+    ppl_provider.AddPerson(std::unique_ptr<Person>{new Person{
+        PersonId{boost::uuids::random_generator()()},
+        name,
+        boost::gregorian::date{1983, 1, 1},
+        GeoPosition{GeoPosition::DecimalLatitude{-45},
+                    GeoPosition::DecimalLongitude{
+                        static_cast<float>(longitude)}}}});
+    names.insert(name);
+  }
+
+  // Act.
+  std::multiset<std::string> visited_names;
+  ppl_provider.VisitAllPpl([&visited_names](Person const& person) {
+      visited_names.insert(person.name());
+    });
+
+  // Assert.
+  ASSERT_EQ(std::multiset<std::string>(names.begin(), names.end()),
+            visited_names);
+}
+
+
+PPLME_TESTLETTE_TYPE_BEGIN(PartitionsTestlette)
+  int resolution;
+  int partitions;
+PPLME_TESTLETTE_TYPE_END(PartitionsTestlette,
+                         PplmeMatchingPplProviderTest_Partitions)
+
+/**
+ *  @test  However the grid is partitioned, the same ppl should be found in
+ *         the same order, including by sqirals that cross partitions (and
+ *         the antimeridian).
+ */
+TEST_P(PplmeMatchingPplProviderTest_Partitions, Tests) {
+  // Arrange.
+  auto const today = []() { return boost::gregorian::date{2014, 11, 25}; };
+  PplmeMatchingPplProvider unpartitioned{
+      GetParam().resolution, 5, 1000, kPerFindConcurrency, today};
+  PplmeMatchingPplProvider partitioned{
+      GetParam().resolution, 5, 1000, kPerFindConcurrency, today,
+      GetParam().partitions};
+  std::default_random_engine random_engine;
+  std::uniform_real_distribution<float> latgen{-60, 60};
+  std::uniform_real_distribution<float> longgen{-180, 180};
+  std::uniform_int_distribution<int> daygen{0, 3 * 365};
+  std::vector<std::unique_ptr<Person>> ppl;
+  for (int n = 0; n < 2000; ++n) {
+    std::unique_ptr<Person> person{new Person{
+        PersonId{boost::uuids::random_generator()()},
+        "Partitionee " + std::to_string(n),
+        boost::gregorian::date{1983, 1, 1}
+            + boost::gregorian::days{daygen(random_engine)},
+        GeoPosition{GeoPosition::DecimalLatitude{latgen(random_engine)},
+                    GeoPosition::DecimalLongitude{longgen(random_engine)}}}};
+    // Half of them one at a time, and half in bulk.
+    if (n % 2)
+      partitioned.AddPerson(std::unique_ptr<Person>{new Person{*person}});
+    else
+      ppl.emplace_back(new Person{*person});
+    unpartitioned.AddPerson(std::move(person));
+  }
+  partitioned.AddPpl(std::move(ppl), kPerFindConcurrency);
+  float const kUserLongitudes[] = { -180, -179.5, -90, -0.5, 0, 60, 179.5 };
+
+  for (auto user_longitude : kUserLongitudes) {
+    GeoPosition const location_of_user{
+        GeoPosition::DecimalLatitude{10},
+        GeoPosition::DecimalLongitude{user_longitude}};
+    PplMatchingParameters const matching_params{location_of_user, 31};
+    auto const get_names = [&matching_params](
+        PplmeMatchingPplProvider const& ppl_provider) {
+      std::vector<std::string> names;
+      ppl_provider.VisitMatchingPpl(
+          matching_params,
+          [&names](Person const& person) { names.push_back(person.name()); });
+      return names;
+    };
+
+    // Act.
+    auto const unpartitioned_names = get_names(unpartitioned);
+    auto const partitioned_names = get_names(partitioned);
+
+    // Assert.
+    ASSERT_LT(100U, unpartitioned_names.size());
+    ASSERT_EQ(unpartitioned_names, partitioned_names)
+        << "from longitude " << user_longitude;
+  }
+}
+
+PPLME_TESTLETTES_BEGIN(PartitionsTestlette, partitions_testlettes)
+  PPLME_TESTLETTE(1, 1),
+  PPLME_TESTLETTE(1, 2),
+  PPLME_TESTLETTE(2, 7),
+  PPLME_TESTLETTE(1, 361),
+  PPLME_TESTLETTE(1, 0)
+PPLME_TESTLETTES_END(partitions_testlettes,
+                     PplmeMatchingPplProviderTest_Partitions)
+
+
 /**
  *  @test  Test with Homer and The User at all the various permutations of
  *         ridiculously-quantized latitudes+longitudes.
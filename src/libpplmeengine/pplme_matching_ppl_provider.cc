@@ -7,14 +7,25 @@
 
 #include "pplme_matching_ppl_provider.h"
 #include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
-#include <deque>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <set>
+#include <shared_mutex>
 #include <thread>
+#include <utility>
 #include <boost/math/constants/constants.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <glog/logging.h>
+#include "libpplmeutils/huge_page_arena.h"
+#include "libpplmeutils/noddy_worker_pool.h"
+#include "libpplmeutils/numa.h"
+#include "libpplmeutils/trace.h"
 
 
 using pplme::core::GeoPosition;
@@ -26,6 +37,9 @@ namespace {
 
 // WGS84 [<http://en.wikipedia.org/wiki/World_Geodetic_System>].
 float const kRadiusOfEarth = 6378.137;
+/** Kilometers per degree of latitude (or of longitude at the Equator). */
+float const kKmPerDegree =
+    kRadiusOfEarth * boost::math::constants::pi<float>() / 180;
 
 
 int const kMinLatitudeDegrees = -90;
@@ -34,81 +48,21 @@ int const kMinLongitudeDegrees = -180;
 int const kMaxLongitudeDegrees = 180;
 
 
-size_t CalculateSizeForPplGrid(int resolution) {
-  // Something of an arbitrary limit, but 1000 would take us to needing a
-  // type larger than 32 bits to express all the grid position combos.
-  CHECK(resolution <= 100) << "Too granular, son!";
-
-  // + 2 because the ranges are inclusive.
-  size_t num_quantized_latitude_values =
-      ((2 + kMaxLatitudeDegrees - kMinLatitudeDegrees) * resolution);
-  size_t num_quantized_longitude_values =
-      ((2 + kMaxLongitudeDegrees - kMinLongitudeDegrees) * resolution);
-
-  return num_quantized_latitude_values * num_quantized_longitude_values;
-}
-
-
-class NoddyWorkerPool {
- public:
-  NoddyWorkerPool() {
-    for (unsigned n = 0; n < std::thread::hardware_concurrency(); ++n)
-      workers_.emplace_back([this]() { StartWorking(); });
-  }
-
-
-  ~NoddyWorkerPool() {
-    /* lock block */ {
-      std::unique_lock<std::mutex> lock(work_mutex_);
-      die_ = true;
-      work_or_die_.notify_all();
-    }
-    for (auto& worker : workers_)
-      worker.join();
-  }
-
-
-  void QueueWorklette(std::function<void()> worklette) {
-    std::unique_lock<std::mutex> lock(work_mutex_);
-    work_.push_back(worklette);
-    work_or_die_.notify_all();
+/** Run @a work(stripe) for each of @a stripes stripes, each on its own
+    thread (unless there's just the one, which gets the calling thread).
+    N.B. so @a work may pin its thread when there's more than one. */
+void ForEachStripe(unsigned int stripes,
+                   std::function<void(unsigned int)> const& work) {
+  if (stripes == 1) {
+    work(0);
+    return;
   }
-
-  
- private:
-  std::vector<std::thread> workers_;
-  std::mutex work_mutex_;
-  std::condition_variable work_or_die_;
-  std::deque<std::function<void()>> work_;
-  bool die_{false};
-
-
-  void StartWorking() {
-    for (;;) {
-      std::function<void()> worklette;
-
-      /* lock block */ {
-        std::unique_lock<std::mutex> lock(work_mutex_);
-        if (die_)
-          break;
-        else if (work_.empty())
-          work_or_die_.wait(lock);
-
-        if (die_)
-          break;
- 
-        if (!work_.empty()) {
-          worklette = work_.front();
-          work_.pop_front();
-        }
-      }
-
-      // Don't want to be holding locks while doing work!
-      if (worklette)
-        worklette();
-    }
-  }
-};
+  std::vector<std::thread> threads;
+  for (unsigned int stripe = 0; stripe < stripes; ++stripe)
+    threads.emplace_back([&work, stripe]() { work(stripe); });
+  for (auto& thread : threads)
+    thread.join();
+}
 
 
 }  // namespace
@@ -124,68 +78,287 @@ class PplmeMatchingPplProvider::Impl {
        int max_age_difference,
        int max_ppl,
        boost::optional<int> per_find_concurrency,
-       std::function<boost::gregorian::date()> date_provider) :
+       std::function<boost::gregorian::date()> date_provider,
+       int partitions) :
       resolution_{resolution},
       date_provider_{date_provider},
       max_age_difference_{max_age_difference},
       max_ppl_{boost::numeric_cast<unsigned int>(max_ppl)},
       per_find_concurrency_{
           per_find_concurrency ?
-              *per_find_concurrency : std::thread::hardware_concurrency()},
-      ppl_{CalculateSizeForPplGrid(resolution)} {
+              *per_find_concurrency : std::thread::hardware_concurrency()} {
     CHECK(max_age_difference >= 0);
     CHECK(max_ppl_ > 0);
     CHECK(!per_find_concurrency || per_find_concurrency > 0);
     CHECK(date_provider);
-        
-    workers_.reset(new NoddyWorkerPool{});
+    // Something of an arbitrary limit, but 1000 would take us to needing a
+    // type larger than 32 bits to express all the grid position combos.
+    CHECK(resolution > 0 && resolution <= 100) << "Too granular, son!";
+    CHECK(partitions >= 0 && partitions <= kLongitudeDegrees)
+        << "Can't split " << kLongitudeDegrees << " degrees of longitude "
+        << partitions << " ways!";
+    CreatePartitions(partitions);
   }
 
   
   ~Impl() {
-    workers_.reset();
+    for (auto& partition : partitions_)
+      partition->workers.reset();
   }
   
 
   void AddPerson(std::unique_ptr<Person> person) {
+    std::unique_lock<std::shared_timed_mutex> lock(grid_mutex_);
+    AddPersonLocked(std::move(person));
+  }
+
+
+  bool RemovePerson(core::PersonId const& id, GeoPosition location_of_home) {
+    std::unique_lock<std::shared_timed_mutex> lock(grid_mutex_);
+    return RemovePersonLocked(id, location_of_home);
+  }
+
+
+  void ApplyPplMutations(std::vector<core::PplMutation> mutations) {
+    std::unique_lock<std::shared_timed_mutex> lock(grid_mutex_);
+    // Each run of additions is added in one go, as per AddPpl(), if it's
+    // long enough to be worth it (as it is when a whole log's worth of
+    // mutations is being replayed); either way, it's as if each Person had
+    // been AddPerson()ed in turn.
+    std::vector<std::unique_ptr<Person>> additions;
+    auto const add_additions = [this, &additions]() {
+      if (additions.size() >= kMinPplPerStripe) {
+        AddPplLocked(std::move(additions), boost::none);
+      } else {
+        for (auto& person : additions)
+          AddPersonLocked(std::move(person));
+      }
+      additions.clear();
+    };
+    for (auto& mutation : mutations) {
+      if (mutation.kind == core::PplMutation::Kind::Add) {
+        additions.emplace_back(new Person{std::move(mutation.person)});
+      } else {
+        add_additions();
+        RemovePersonLocked(mutation.person.id(),
+                           mutation.person.location_of_home());
+      }
+    }
+    add_additions();
+  }
+
+
+  /** Must be called with the grid to ourselves, as must
+      RemovePersonLocked(). */
+  void AddPersonLocked(std::unique_ptr<Person> person) {
     // We assume / don't-care if we've already seen a Person with the same id.
-    auto& cell = ppl_[GetPplIndex(person->location_of_home())];
+    auto& cell = GetCell(ToCellLocator(person->location_of_home()));
+    auto const date_of_birth = person->date_of_birth();
     auto insertion_pos = std::upper_bound(
-        begin(cell), end(cell), person,
-        [](std::unique_ptr<Person> const& lhs,
-           std::unique_ptr<Person> const& rhs) {
-          return lhs->date_of_birth() < rhs->date_of_birth();
+        begin(cell), end(cell), date_of_birth,
+        [](boost::gregorian::date lhs, PplCellEntry const& rhs) {
+          return lhs < rhs.date_of_birth;
         });
-    cell.insert(insertion_pos, std::move(person));
+    cell.insert(insertion_pos, PplCellEntry{
+        date_of_birth,
+        person->location_of_home(),
+        person->id(),
+        std::move(person)});
   }
 
 
-  std::vector<Person>
-  FindMatchingPpl(core::PplMatchingParameters const& parameters) const
-  {
-    FindContext context;
-    context.parameters = &parameters;
-    
-    Sqiral(ToCellLocator(parameters.location_of_user()),
-           [this, &context](CellLocator cell) {
-             return TryFindPpl(cell, &context);
-           });
-
-    std::unique_lock<std::mutex> lock(context.mutex);
-    context.condvar.wait(
-        lock,
-        [&context]() {
-          return context.pending_cells.empty();
+  bool RemovePersonLocked(core::PersonId const& id,
+                          GeoPosition location_of_home) {
+    auto& cell = GetCell(ToCellLocator(location_of_home));
+    auto const entry = std::find_if(
+        begin(cell), end(cell),
+        [&id](PplCellEntry const& that) {
+          return that.id.value() == id.value();
         });
+    if (entry == end(cell))
+      return false;
+    cell.erase(entry);
+    return true;
+  }
+
+
+  void AddPpl(std::vector<std::unique_ptr<Person>> ppl,
+              boost::optional<int> concurrency) {
+    CHECK(!concurrency || *concurrency > 0);
+    std::unique_lock<std::shared_timed_mutex> lock(grid_mutex_);
+    AddPplLocked(std::move(ppl), concurrency);
+  }
 
-    // Because we're likely multi-threaded, this list may not necessarily be
-    // in order of distance.  If we were going for accuracy, we could sort
-    // based on the haversine formula; however, this should be good enough for
-    // pplMe purposes.
-    if (context.ppl.size() > max_ppl_)
-      context.ppl.resize(max_ppl_);
 
-    return context.ppl;
+  /** Must be called with the grid to ourselves. */
+  void AddPplLocked(std::vector<std::unique_ptr<Person>> ppl,
+                    boost::optional<int> concurrency) {
+    auto const stripes = std::max(1u, std::min(
+        concurrency ?
+            boost::numeric_cast<unsigned int>(*concurrency) :
+            std::thread::hardware_concurrency(),
+        boost::numeric_cast<unsigned int>(
+            std::max<size_t>(1, ppl.size() / kMinPplPerStripe))));
+
+    auto const partition_count =
+        boost::numeric_cast<unsigned int>(partitions_.size());
+    auto const stripes_per_partition =
+        std::max(1u, stripes / partition_count);
+    auto const buckets = partition_count * stripes_per_partition;
+    // Which stripe of which partition ends up with @a address.
+    auto const get_bucket = [&](CellAddress const& address) {
+        return address.partition * stripes_per_partition + GetStripeOf(
+            partitions_[address.partition]->ppl.size(),
+            stripes_per_partition, address.index);
+      };
+
+    // First, work out where everyone goes, a chunk of ppl per stripe, and
+    // keep count of how many each chunk has for each bucket (i.e. stripe of
+    // a partition).
+    std::vector<CellAddress> addresses(ppl.size());
+    std::vector<size_t> counts(stripes * buckets);
+    ForEachStripe(stripes, [&](unsigned int stripe) {
+        auto const chunk_counts = &counts[stripe * buckets];
+        auto const end = GetStripeBegin(ppl.size(), stripes, stripe + 1);
+        for (auto n = GetStripeBegin(ppl.size(), stripes, stripe); n < end;
+             ++n) {
+          addresses[n] =
+              GetCellAddress(ToCellLocator(ppl[n]->location_of_home()));
+          ++chunk_counts[get_bucket(addresses[n])];
+        }
+      });
+
+    // Turn the counts into where each chunk's lot starts in each bucket
+    // (bucket by bucket, then chunk by chunk), and then have each chunk
+    // drop its ppl's indices in: a counting sort, which keeps them in order
+    // within each bucket.
+    std::vector<size_t> bucket_begins(buckets + 1);
+    size_t offset = 0;
+    for (unsigned int bucket = 0; bucket < buckets; ++bucket) {
+      bucket_begins[bucket] = offset;
+      for (unsigned int chunk = 0; chunk < stripes; ++chunk) {
+        auto& count = counts[chunk * buckets + bucket];
+        auto const chunk_count = count;
+        count = offset;
+        offset += chunk_count;
+      }
+    }
+    bucket_begins[buckets] = offset;
+    std::vector<size_t> bucketed(ppl.size());
+    ForEachStripe(stripes, [&](unsigned int stripe) {
+        auto const chunk_offsets = &counts[stripe * buckets];
+        auto const end = GetStripeBegin(ppl.size(), stripes, stripe + 1);
+        for (auto n = GetStripeBegin(ppl.size(), stripes, stripe); n < end;
+             ++n)
+          bucketed[chunk_offsets[get_bucket(addresses[n])]++] = n;
+      });
+
+    // Then each stripe of each partition gets filled in and sorted by its
+    // own thread (on the partition's node, if it has one), so nobody's cells
+    // are anybody else's.  Appending in order and then stable sorting leaves
+    // those with the same date of birth in the order that AddPerson() would
+    // have put them in.
+    ForEachStripe(buckets, [&](unsigned int stripe) {
+        auto const partition_index = stripe / stripes_per_partition;
+        auto& partition = *partitions_[partition_index];
+        if (!partition.cpus.empty())
+          utils::PinThisThreadToCpus(partition.cpus);
+        // (Cell, n) for each of our ppl, so that we can tell how many
+        // each cell is getting, and so only grow it the once.
+        std::vector<std::pair<PplGrid::size_type, size_t>> arrivals;
+        arrivals.reserve(bucket_begins[stripe + 1] - bucket_begins[stripe]);
+        for (auto b = bucket_begins[stripe]; b < bucket_begins[stripe + 1];
+             ++b)
+          arrivals.emplace_back(addresses[bucketed[b]].index, bucketed[b]);
+        std::sort(begin(arrivals), end(arrivals));
+
+        for (auto arrival = begin(arrivals); arrival != end(arrivals); ) {
+          auto const index = arrival->first;
+          auto const last_arrival = std::find_if(
+              arrival, end(arrivals),
+              [index](std::pair<PplGrid::size_type, size_t> const& that) {
+                return that.first != index;
+              });
+          auto& cell = partition.ppl[index];
+          cell.reserve(cell.size() + (last_arrival - arrival));
+          for (; arrival != last_arrival; ++arrival) {
+            auto& person = ppl[arrival->second];
+            cell.push_back(PplCellEntry{
+                person->date_of_birth(),
+                person->location_of_home(),
+                person->id(),
+                std::move(person)});
+          }
+          std::stable_sort(
+              begin(cell), end(cell),
+              [](PplCellEntry const& lhs, PplCellEntry const& rhs) {
+                return lhs.date_of_birth < rhs.date_of_birth;
+              });
+        }
+      });
+  }
+
+
+  std::vector<Person>
+  FindMatchingPpl(core::PplMatchingParameters const& parameters) const {
+    std::shared_lock<std::shared_timed_mutex> lock(grid_mutex_);
+    auto const matching_ppl = FindMatchingPplInSitu(parameters).ppl;
+    std::vector<Person> ppl;
+    ppl.reserve(matching_ppl.size());
+    for (auto entry : matching_ppl)
+      ppl.push_back(*entry->person);
+    return ppl;
+  }
+
+
+  core::PplMatchingOutcome VisitMatchingPpl(
+      core::PplMatchingParameters const& parameters,
+      std::function<void (Person const&)> const& visitor) const {
+    std::shared_lock<std::shared_timed_mutex> lock(grid_mutex_);
+    auto const matching_ppl = FindMatchingPplInSitu(parameters);
+    for (auto entry : matching_ppl.ppl)
+      visitor(*entry->person);
+    return core::PplMatchingOutcome{
+        matching_ppl.next_cursor, matching_ppl.partial};
+  }
+
+
+  core::PplMatchingOutcome VisitMatchingPplIds(
+      core::PplMatchingParameters const& parameters,
+      std::function<void (core::PersonId const&, GeoPosition const&)> const&
+          visitor) const {
+    std::shared_lock<std::shared_timed_mutex> lock(grid_mutex_);
+    auto const matching_ppl = FindMatchingPplInSitu(parameters);
+    for (auto entry : matching_ppl.ppl)
+      visitor(entry->id, entry->location_of_home);
+    return core::PplMatchingOutcome{
+        matching_ppl.next_cursor, matching_ppl.partial};
+  }
+
+
+  void VisitAllPpl(std::function<void (Person const&)> const& visitor)
+      const {
+    std::shared_lock<std::shared_timed_mutex> lock(grid_mutex_);
+    for (auto const& partition : partitions_) {
+      for (auto const& cell : partition->ppl) {
+        for (auto const& entry : cell)
+          visitor(*entry.person);
+      }
+    }
+  }
+
+
+  PplmeMatchingPplProvider::Stats GetStats() const {
+    PplmeMatchingPplProvider::Stats stats{
+        cells_visited_, cells_skipped_, ppl_scanned_, ppl_matched_, 0, 0, 0};
+    for (auto const& partition : partitions_) {
+      auto const arena_stats = partition->arena.GetStats();
+      stats.storage_octets += arena_stats.allocated_octets;
+      stats.storage_mapped_octets += arena_stats.mapped_octets;
+      stats.storage_huge_page_octets +=
+          arena_stats.huge_tlb_octets + arena_stats.transparent_huge_octets;
+    }
+    return stats;
   }
 
 
@@ -193,9 +366,69 @@ class PplmeMatchingPplProvider::Impl {
   using Latitude = GeoPosition::DecimalLatitude;
   using Longitude = GeoPosition::DecimalLongitude;
   
-  using PplCell = std::vector<std::unique_ptr<core::Person>>;
+  /**
+   *  What the grid holds for each Person.
+   *
+   *  @remarks
+   *  Everything that finding (and ids-only responding) needs is held inline
+   *  so that the date-of-birth search through a cell is over contiguous
+   *  memory, and so that the rest of the Person (most notably their name) is
+   *  only ever touched when it's actually wanted.
+   */
+  struct PplCellEntry {
+    boost::gregorian::date date_of_birth;
+    GeoPosition location_of_home;
+    core::PersonId id;
+    std::unique_ptr<Person> person;
+  };
   /** @note  This is sorted in date-of-birth order. */
-  using PplGrid = std::vector<PplCell>;
+  using PplCell =
+      std::vector<PplCellEntry, utils::ArenaAllocator<PplCellEntry>>;
+  using PplGrid = std::vector<PplCell, utils::ArenaAllocator<PplCell>>;
+
+  /**
+   *  A band of longitude's worth of the grid, along with the workers that
+   *  search it.
+   *
+   *  @remarks
+   *  On a NUMA box, each partition is on a node: its workers are pinned to
+   *  the node's CPUs, and its cells are first touched (and so allocated) by
+   *  threads that are pinned likewise; that way, searching a cell is all
+   *  local memory, rather than half of everything being on the far side of
+   *  the interconnect.  (AddPerson() is a law unto itself, though, and puts
+   *  ppl wherever the calling thread's memory is; it's AddPpl() that's
+   *  NUMA-savvy.)
+   *
+   *  Both the grid and its cells live in the partition's arena, and so on
+   *  huge pages (if there are any to be had), as the sqiral hops from cell
+   *  to cell all over the place, and there's only so much that a TLB can
+   *  remember.
+   */
+  struct Partition {
+    /** The longitude indices that this partition has. */
+    PplGrid::size_type first_longitude_index;
+    PplGrid::size_type longitude_index_count;
+    /** Where the partition lives, if it's been put anywhere in particular. */
+    std::vector<int> cpus;
+    utils::HugePageArena arena;
+    /** @note  In (latitude, longitude - first_longitude_index) order. */
+    PplGrid ppl;
+    boost::scoped_ptr<utils::NoddyWorkerPool> workers;
+  };
+
+  /** Where a cell is in which partition's grid. */
+  struct CellAddress {
+    unsigned int partition;
+    PplGrid::size_type index;
+  };
+
+  /** (One more than there are, as both -180 and 180 get a look in.) */
+  static int const kLongitudeDegrees =
+      kMaxLongitudeDegrees - kMinLongitudeDegrees + 1;
+
+  /** Fewer than this many ppl per thread, and AddPpl() would spend longer
+      starting threads than adding ppl. */
+  static size_t const kMinPplPerStripe = 4096;
 
   int resolution_;
   std::function<boost::gregorian::date()> date_provider_;
@@ -205,9 +438,108 @@ class PplmeMatchingPplProvider::Impl {
      about signed/unsigned comparisons and all that guff. */
   unsigned int max_ppl_;
   unsigned int per_find_concurrency_;
-  /** @note  This is sorted in date-of-birth order. */
-  PplGrid ppl_;
-  boost::scoped_ptr<NoddyWorkerPool> workers_;
+  std::vector<std::unique_ptr<Partition>> partitions_;
+  /** Finds (up to and including their visiting of whoever they found)
+      share the grid; adding and removing ppl has it to itself. */
+  mutable std::shared_timed_mutex grid_mutex_;
+  /** Which partition has each degree of longitude. */
+  std::vector<unsigned int> partition_by_longitude_degree_;
+  /** @see  PplmeMatchingPplProvider::Stats. */
+  mutable std::atomic<uint64_t> cells_visited_{0};
+  mutable std::atomic<uint64_t> cells_skipped_{0};
+  mutable std::atomic<uint64_t> ppl_scanned_{0};
+  mutable std::atomic<uint64_t> ppl_matched_{0};
+
+
+  /** @returns  Where stripe @a stripe of @a stripes starts when splitting
+                up @a size things (so stripe @a stripes starts at the end). */
+  static size_t GetStripeBegin(
+      size_t size, unsigned int stripes, unsigned int stripe) {
+    return size * stripe / stripes;
+  }
+
+
+  /** @returns  Which of @a stripes stripes (as per GetStripeBegin()) thing
+                @a index of @a size things is in. */
+  static unsigned int GetStripeOf(
+      size_t size, unsigned int stripes, size_t index) {
+    return boost::numeric_cast<unsigned int>(
+        ((index + 1) * stripes - 1) / size);
+  }
+
+
+  void CreatePartitions(int partition_count) {
+    auto const nodes = utils::GetNumaNodeCpus();
+    if (partition_count == 0)
+      partition_count = boost::numeric_cast<int>(nodes.size());
+    // Only bother pinning when there's more than one of each (one partition
+    // over many nodes might as well float, and many partitions on one node
+    // are just for show).
+    auto const pinned = partition_count > 1 && nodes.size() > 1;
+
+    for (int n = 0; n < partition_count; ++n) {
+      auto const first_degree = n * kLongitudeDegrees / partition_count;
+      auto const end_degree = (n + 1) * kLongitudeDegrees / partition_count;
+      for (auto degree = first_degree; degree < end_degree; ++degree)
+        partition_by_longitude_degree_.push_back(n);
+
+      std::unique_ptr<Partition> partition{new Partition{}};
+      partition->first_longitude_index = first_degree * resolution_;
+      partition->longitude_index_count =
+          (end_degree - first_degree) * resolution_;
+      // Each partition gets its share of its node's CPUs as workers (or of
+      // all of them, if it's not on a node in particular).
+      auto const node = GetNode(n, partition_count, nodes.size());
+      unsigned int partitions_on_node = partition_count;
+      unsigned int cpu_count = std::thread::hardware_concurrency();
+      if (pinned) {
+        partition->cpus = nodes[node];
+        partitions_on_node = 0;
+        for (int m = 0; m < partition_count; ++m) {
+          if (GetNode(m, partition_count, nodes.size()) == node)
+            ++partitions_on_node;
+        }
+        cpu_count = boost::numeric_cast<unsigned int>(nodes[node].size());
+      }
+      partition->workers.reset(new utils::NoddyWorkerPool{
+          std::max(1u, cpu_count / partitions_on_node), partition->cpus});
+      partitions_.push_back(std::move(partition));
+    }
+
+    // The grids are allocated by threads on the partitions' nodes, so that
+    // that's where they end up.
+    ForEachStripe(
+        boost::numeric_cast<unsigned int>(partitions_.size()),
+        [this](unsigned int n) {
+          auto& partition = *partitions_[n];
+          if (!partition.cpus.empty())
+            utils::PinThisThreadToCpus(partition.cpus);
+          // + 2 because the ranges are inclusive.
+          auto const cell_count =
+              (2 + kMaxLatitudeDegrees - kMinLatitudeDegrees) * resolution_
+              * partition.longitude_index_count;
+          PplGrid ppl{utils::ArenaAllocator<PplCell>{&partition.arena}};
+          ppl.reserve(cell_count);
+          for (size_t n = 0; n < cell_count; ++n)
+            ppl.emplace_back(
+                utils::ArenaAllocator<PplCellEntry>{&partition.arena});
+          partition.ppl = std::move(ppl);
+        });
+
+    VLOG(1) << "Split the grid into " << partitions_.size()
+            << " partitions over " << nodes.size() << " NUMA nodes"
+            << (pinned ? "" : " (unpinned)");
+  }
+
+
+  /** @returns  The NUMA node (of @a node_count) that partition @a partition
+                (of @a partition_count) belongs on; neighbouring partitions
+                share nodes, so that a sqiral that strays over a partition
+                boundary probably doesn't stray off its node. */
+  static size_t GetNode(int partition, int partition_count,
+                        size_t node_count) {
+    return partition * node_count / partition_count;
+  }
 
 
   PplGrid::size_type GetLatitudeIndex(Latitude latitude) const {
@@ -243,60 +575,174 @@ class PplmeMatchingPplProvider::Impl {
   }
 
   
-  PplGrid::size_type GetPplIndex(CellLocator cell) const {
-    return cell.latitude_index * 361 * resolution_ + cell.longitude_index;
+  CellAddress GetCellAddress(CellLocator cell) const {
+    auto const partition_index = partition_by_longitude_degree_[
+        cell.longitude_index / resolution_];
+    auto const& partition = *partitions_[partition_index];
+    return CellAddress{
+        partition_index,
+        cell.latitude_index * partition.longitude_index_count
+            + cell.longitude_index - partition.first_longitude_index};
   }
 
-  
-  PplGrid::size_type GetPplIndex(GeoPosition geopos) const {
-    return GetPplIndex(ToCellLocator(geopos));
+
+  PplCell& GetCell(CellLocator cell) {
+    auto const address = GetCellAddress(cell);
+    return partitions_[address.partition]->ppl[address.index];
   }
 
-  
-  enum class CheckOffsetsResult {
-    Valid,
-    Terminal,
-    Invalid,
-  };
 
+  PplCell const& GetCell(CellLocator cell) const {
+    auto const address = GetCellAddress(cell);
+    return partitions_[address.partition]->ppl[address.index];
+  }
 
-  CheckOffsetsResult CheckOffsets(CellLocator origin,
-                                  int lat_off,
-                                  int long_off) const {
-    auto result = CheckOffsetsResult::Invalid;
-    
+  
+  bool CheckOffsets(CellLocator origin, int lat_off, int long_off) const {
     int max_long_offset = 180 * resolution_;
     int max_lat_index = 181 * resolution_;
     int lat_index = boost::numeric_cast<int>(origin.latitude_index) + lat_off;
-    
-    if (long_off <= max_long_offset && long_off >= -max_long_offset) {
-      if (lat_index >= 0 && lat_index <= max_lat_index) {
-        if ((long_off == max_long_offset || long_off == -max_long_offset)
-            && (lat_index == 0 || lat_index == max_lat_index))
-          result = CheckOffsetsResult::Terminal;
-        else
-          result = CheckOffsetsResult::Valid;
-      }
+
+    return long_off <= max_long_offset && long_off >= -max_long_offset
+        && lat_index >= 0 && lat_index <= max_lat_index;
+  }
+
+
+  /** Where a cell is in the sqiral, relative to its origin. */
+  struct SqiralPosition {
+    uint32_t ring;
+    uint32_t position;
+    bool operator<(SqiralPosition rhs) const {
+      if (ring == rhs.ring)
+        return position < rhs.position;
+      else
+        return ring < rhs.ring;
     }
-    
-    return result;
+  };
+
+
+  /** @returns  The ring beyond which there are no valid cells, i.e., the
+                one containing the furthest of the four corners of the grid
+                from @a origin. */
+  uint32_t GetLastRing(CellLocator origin) const {
+    int max_lat_index = 181 * resolution_;
+    int lat_index = boost::numeric_cast<int>(origin.latitude_index);
+    return boost::numeric_cast<uint32_t>(
+        180 * resolution_ + std::max(lat_index, max_lat_index - lat_index));
   }
 
-  
-  bool Sqiral(CellLocator origin, std::function<bool (CellLocator)> fun) const {
-    bool we_done_here = false;
 
-    int corner_count = 0;
-    
-    auto do_cell =
-        [origin, fun, this, &corner_count](int lat_off, int long_off) {
-      auto check_offsets_result = CheckOffsets(origin, lat_off, long_off);
+  /** How far from the origin the sqiral need go.  All offsets are in cells
+      (i.e., 1/resolution_ of a degree). */
+  struct SqiralBounds {
+    int max_lat_offset;
+    int max_long_offset;
+    uint32_t last_ring;
+  };
+
+
+  SqiralBounds GetSqiralBounds(
+      CellLocator origin,
+      core::PplMatchingParameters const& parameters) const {
+    SqiralBounds bounds{
+        181 * resolution_, 180 * resolution_, GetLastRing(origin)};
+    if (!parameters.max_distance())
+      return bounds;
+
+    // Ppl live in cells quantized to the whole degree, hence the extra degree
+    // of slack.  Then, a degree of longitude is shortest at whichever end of
+    // the search is nearest a Pole, and at some point that gets so short
+    // that we may as well go all the way around.
+    using boost::math::constants::pi;
+    auto const latitude_degrees = *parameters.max_distance() / kKmPerDegree;
+    bounds.max_lat_offset = std::min(
+        bounds.max_lat_offset,
+        static_cast<int>(ceil(latitude_degrees) + 1) * resolution_);
+    auto const extreme_latitude =
+        fabs(parameters.location_of_user().latitude().value())
+        + latitude_degrees + 1;
+    if (extreme_latitude < 89) {
+      auto const longitude_degrees =
+          latitude_degrees / cos(extreme_latitude * pi<float>() / 180);
+      bounds.max_long_offset = std::min(
+          bounds.max_long_offset,
+          static_cast<int>(ceil(longitude_degrees) + 1) * resolution_);
+    }
+    bounds.last_ring = std::min(
+        bounds.last_ring,
+        boost::numeric_cast<uint32_t>(
+            bounds.max_lat_offset + bounds.max_long_offset));
+
+    return bounds;
+  }
+
+
+  /** Ring 0 is just the origin; ring n is the 4n cells that are n steps
+      (in a Manhattan sense) away from it. */
+  static uint32_t GetRingSize(uint32_t ring) {
+    return ring == 0 ? 1 : 4 * ring;
+  }
+
+
+  /** Work out the offsets from the origin of @a position, going N -> E ->
+      S -> W -> N around the ring. */
+  static void GetOffsets(SqiralPosition position, int* lat_off, int* long_off) {
+    if (position.ring == 0) {
+      *lat_off = *long_off = 0;
+      return;
+    }
+
+    int const ring = boost::numeric_cast<int>(position.ring);
+    int const leg = boost::numeric_cast<int>(position.position / position.ring);
+    int const step =
+        boost::numeric_cast<int>(position.position % position.ring);
+    switch (leg) {
+      case 0:  // N -> E
+        *lat_off = ring - step;
+        *long_off = step;
+        break;
+      case 1:  // E -> S
+        *lat_off = -step;
+        *long_off = ring - step;
+        break;
+      case 2:  // S -> W
+        *lat_off = -(ring - step);
+        *long_off = -step;
+        break;
+      default:  // W -> N
+        *lat_off = step;
+        *long_off = -(ring - step);
+        break;
+    }
+  }
+
 
-      if (check_offsets_result == CheckOffsetsResult::Terminal)
-        ++corner_count;
+  /** Call @a fun with each valid cell within @a bounds, in sqiral order,
+      starting at @a start and ending either with the last ring or when @a fun
+      returns true (in which case, so do we). */
+  bool Sqiral(CellLocator origin,
+              SqiralBounds bounds,
+              SqiralPosition start,
+              std::function<bool (CellLocator, SqiralPosition)> fun) const {
+    bool we_done_here = false;
+    uint64_t skipped_count = 0;
+
+    for (auto ring = start.ring;
+         ring <= bounds.last_ring && !we_done_here;
+         ++ring) {
+      auto const ring_size = GetRingSize(ring);
+      auto position = ring == start.ring ? start.position : 0;
+      for (; position < ring_size && !we_done_here; ++position) {
+        int lat_off;
+        int long_off;
+        GetOffsets(SqiralPosition{ring, position}, &lat_off, &long_off);
+        if (!CheckOffsets(origin, lat_off, long_off)
+            || abs(lat_off) > bounds.max_lat_offset
+            || abs(long_off) > bounds.max_long_offset) {
+          ++skipped_count;
+          continue;
+        }
 
-      if (check_offsets_result == CheckOffsetsResult::Terminal ||
-          check_offsets_result == CheckOffsetsResult::Valid) {
         int long_index =
             boost::numeric_cast<int>(origin.longitude_index) + long_off;
         if (long_index > 0)
@@ -308,106 +754,292 @@ class PplmeMatchingPplProvider::Impl {
             static_cast<unsigned int>(
                 boost::numeric_cast<int>(origin.latitude_index) + lat_off),
             static_cast<unsigned int>(long_index)};
-        return fun(cell);
-      }
-      return false;
-    };
-
-    we_done_here = do_cell(0, 0);
-
-    for (int max_offset = 1; corner_count != 4 && !we_done_here; ++max_offset) {
-      int north_offset = max_offset;
-      int east_offset = 0;
-      // N -> E
-      for (; !we_done_here && north_offset > 0;
-           ++east_offset, --north_offset) {
-        we_done_here = do_cell(north_offset, east_offset);
-      }
-      // E -> S
-      int south_offset = 0;
-      east_offset = max_offset;
-      for (; !we_done_here && east_offset > 0;
-           ++south_offset, --east_offset) {
-        we_done_here = do_cell(-south_offset, east_offset);
-      }
-      // S -> W
-      int west_offset = 0;
-      south_offset = max_offset;
-      for (; !we_done_here && south_offset > 0;
-           ++west_offset, --south_offset) {
-        we_done_here = do_cell(-south_offset, -west_offset);
-      }
-      // W -> N
-      north_offset = 0;
-      west_offset = max_offset;
-      for (; !we_done_here && west_offset > 0;
-           ++north_offset, --west_offset) {
-        we_done_here = do_cell(north_offset, -west_offset);
+        we_done_here = fun(cell, SqiralPosition{ring, position});
       }
     }
 
+    cells_skipped_.fetch_add(skipped_count, std::memory_order_relaxed);
     return we_done_here;
   }
 
 
+  /**
+   *  @remarks
+   *  This is shared with the worklettes searching each cell so that, if the
+   *  deadline passes, we can return without waiting for them to finish (or
+   *  even to start); hence it has its own copy of the parameters, too.
+   */
   struct FindContext {
-    core::PplMatchingParameters const* parameters;
-    std::vector<Person> ppl;
-    std::set<CellLocator> pending_cells;
+    explicit FindContext(core::PplMatchingParameters const& parameters) :
+        parameters{parameters} {}
+
+    core::PplMatchingParameters const parameters;
+    unsigned int limit;
+    /** Where we started, and how many of that cell's matches to skip. */
+    SqiralPosition start;
+    uint32_t skip;
+    /** Each searched cell's matches, in sqiral order. */
+    std::map<SqiralPosition, std::vector<PplCellEntry const*>> ppl;
+    std::vector<PplCellEntry const*>::size_type ppl_count = 0;
+    std::set<SqiralPosition> pending_cells;
+    /** How many of those are actually being searched right now (as opposed
+        to waiting their turn). */
+    uint32_t cells_searching = 0;
+    /** How many cells were queued, and how many of those had nobody at all
+        in them (for tracing). */
+    uint32_t cells_queued = 0;
+    uint32_t cells_empty = 0;
     std::mutex mutex;
     std::condition_variable condvar;
     bool we_done_here = false;
+    /** Set IFF the deadline passed, in which case nothing from here on has
+        been searched (or, at least, is to be trusted). */
+    boost::optional<SqiralPosition> first_unsearched;
   };
 
 
-  bool TryFindPpl(CellLocator cell, FindContext* context) const {
-    CHECK_NOTNULL(context);
-    CHECK_NOTNULL(context->parameters);
-    
-    std::unique_lock<std::mutex> lock(context->mutex);
-    context->condvar.wait(
-        lock,
-        [this, context]() {
-          return context->we_done_here
-              || context->ppl.size() >= max_ppl_
-              || context->pending_cells.size() < per_find_concurrency_;
+  /** The deadline has passed, so down tools; @a position (if any) is the
+      first cell that we didn't get to.  Must be called with the mutex held. */
+  static void Abandon(FindContext* context,
+                      boost::optional<SqiralPosition> position) {
+    context->we_done_here = true;
+    if (!context->pending_cells.empty()
+        && (!position || *context->pending_cells.begin() < *position))
+      position = *context->pending_cells.begin();
+    if (position
+        && (!context->first_unsearched
+            || *position < *context->first_unsearched))
+      context->first_unsearched = position;
+  }
+
+
+  struct FindResult {
+    /** Pointers to the matching ppl as they live in the grid. */
+    std::vector<PplCellEntry const*> ppl;
+    boost::optional<core::PplCursor> next_cursor;
+    bool partial = false;
+  };
+
+
+  FindResult
+  FindMatchingPplInSitu(core::PplMatchingParameters const& parameters) const {
+    auto const context = std::make_shared<FindContext>(parameters);
+    context->limit = std::min(parameters.limit().value_or(max_ppl_), max_ppl_);
+    auto const cursor =
+        parameters.cursor().value_or(core::PplCursor{0, 0, 0});
+    context->start = SqiralPosition{cursor.ring(), cursor.position()};
+    context->skip = cursor.skip();
+
+    if (context->limit == 0)
+      return FindResult{};
+
+    // When tracing, each ring gets a span (which includes any waiting for
+    // its cells to be queued).
+    auto const trace = parameters.trace().get();
+    auto const find_begin = trace ? utils::Trace::Clock::now() :
+                                    utils::Trace::Clock::time_point{};
+    auto ring = context->start.ring;
+    auto ring_begin = find_begin;
+    int64_t ring_cell_count = 0;
+    auto const trace_ring = [trace, &ring, &ring_begin, &ring_cell_count]() {
+      auto const now = utils::Trace::Clock::now();
+      trace->AddSpan("Ring", ring_begin, now,
+                     {{"ring", ring}, {"cells", ring_cell_count}});
+      ring_begin = now;
+      ring_cell_count = 0;
+    };
+
+    auto const origin = ToCellLocator(parameters.location_of_user());
+    auto const stopped_early = Sqiral(
+        origin,
+        GetSqiralBounds(origin, parameters),
+        context->start,
+        [&](CellLocator cell, SqiralPosition position) {
+          if (trace) {
+            if (position.ring != ring) {
+              trace_ring();
+              ring = position.ring;
+            }
+            ++ring_cell_count;
+          }
+          return TryFindPpl(cell, position, context);
         });
-    if (context->ppl.size() >= max_ppl_) {
+    if (trace)
+      trace_ring();
+
+    std::unique_lock<std::mutex> lock(context->mutex);
+    auto const all_done = [&context]() {
+      return context->pending_cells.empty();
+    };
+    if (!parameters.deadline())
+      context->condvar.wait(lock, all_done);
+    else if (!context->condvar.wait_until(lock, *parameters.deadline(),
+                                          all_done))
+      Abandon(context.get(), boost::none);
+    // Abandoned or not, nobody may still be looking at a cell once we've
+    // gone (and let go of the grid).
+    context->condvar.wait(lock, [&context]() {
+        return context->cells_searching == 0;
+      });
+
+    auto const result = AssembleFindResult(*context, stopped_early);
+    if (trace) {
+      trace->AddSpan("Find", find_begin, utils::Trace::Clock::now(),
+                     {{"last_ring", ring},
+                      {"cells_queued", context->cells_queued},
+                      {"cells_empty", context->cells_empty},
+                      {"ppl", result.ppl.size()},
+                      {"partial", result.partial}});
+    }
+
+    return result;
+  }
+
+
+  /** Must be called with the mutex held, and once the searching is done
+      (or abandoned). */
+  static FindResult AssembleFindResult(FindContext const& context,
+                                       bool stopped_early) {
+    FindResult result;
+
+    // Cells may have been searched concurrently, but we hand ppl out in
+    // sqiral order regardless (which is also roughly, if not exactly, in
+    // order of distance), so that where we stop is a sensible place for the
+    // next page to start.
+    auto const get_skip = [&context](SqiralPosition position) {
+      return (position.ring == context.start.ring
+              && position.position == context.start.position) ?
+          context.skip : 0;
+    };
+    for (auto const& cell_ppl : context.ppl) {
+      auto const& position = cell_ppl.first;
+      auto const& ppl = cell_ppl.second;
+      // Anything beyond where the deadline struck will be found again next
+      // time, so leave it for then.
+      if (context.first_unsearched && !(position < *context.first_unsearched))
+        break;
+      auto const wanted = context.limit - result.ppl.size();
+      if (ppl.size() >= wanted) {
+        result.ppl.insert(result.ppl.end(), ppl.begin(), ppl.begin() + wanted);
+        // If that was the very last of everything, then there's no next page.
+        if (ppl.size() > wanted || stopped_early) {
+          result.next_cursor = core::PplCursor{
+              position.ring,
+              position.position,
+              boost::numeric_cast<uint32_t>(get_skip(position) + wanted)};
+        }
+        return result;
+      }
+      result.ppl.insert(result.ppl.end(), ppl.begin(), ppl.end());
+    }
+
+    if (context.first_unsearched) {
+      auto const& position = *context.first_unsearched;
+      result.partial = true;
+      result.next_cursor = core::PplCursor{
+          position.ring, position.position, get_skip(position)};
+    }
+
+    return result;
+  }
+
+
+  bool TryFindPpl(CellLocator cell,
+                  SqiralPosition position,
+                  std::shared_ptr<FindContext> const& context) const {
+    CHECK_NOTNULL(context.get());
+
+    std::unique_lock<std::mutex> lock(context->mutex);
+    auto const ready = [this, &context]() {
+      return context->we_done_here
+          || context->ppl_count >= context->limit
+          || context->pending_cells.size() < per_find_concurrency_;
+    };
+    auto const deadline = context->parameters.deadline();
+    if (!deadline)
+      context->condvar.wait(lock, ready);
+    else if (!context->condvar.wait_until(lock, *deadline, ready)
+             || std::chrono::steady_clock::now() >= *deadline)
+      Abandon(context.get(), position);
+
+    if (context->ppl_count >= context->limit) {
       context->we_done_here = true;
-      context->condvar.wait(
-          lock,
-          [context]() {
-            return context->pending_cells.empty();
-          });
     } else if (!context->we_done_here) {
-      CHECK(context->pending_cells.insert(cell).second);
-      workers_->QueueWorklette([this, context, cell]() {
-          TryFindPplAsync(cell, context);
-        });
+      CHECK(context->pending_cells.insert(position).second);
+      ++context->cells_queued;
+      if (GetCell(cell).empty())
+        ++context->cells_empty;
+      auto const queued = context->parameters.trace() ?
+          utils::Trace::Clock::now() : utils::Trace::Clock::time_point{};
+      // Each cell is searched by its own partition's workers (so, on a NUMA
+      // box, by a CPU that's next to it).
+      auto const& partition =
+          *partitions_[GetCellAddress(cell).partition];
+      partition.workers->QueueWorklette(
+          [this, context, cell, position, queued]() {
+            TryFindPplAsync(cell, position, queued, context.get());
+          });
     }
         
     return context->we_done_here;
   }
 
 
-  void TryFindPplAsync(CellLocator cell, FindContext* context) const {
+  void TryFindPplAsync(CellLocator cell,
+                       SqiralPosition position,
+                       utils::Trace::Clock::time_point queued,
+                       FindContext* context) const {
+    auto const trace = context->parameters.trace().get();
+    auto const started = trace ? utils::Trace::Clock::now() :
+                                 utils::Trace::Clock::time_point{};
     bool done;
     /* lock block */ {
       std::unique_lock<std::mutex> lock(context->mutex);
       done = context->we_done_here;
       if (done) {
-        CHECK(context->pending_cells.erase(cell) == 1);
+        cells_skipped_.fetch_add(1, std::memory_order_relaxed);
+        CHECK(context->pending_cells.erase(position) == 1);
         context->condvar.notify_all();
+      } else {
+        ++context->cells_searching;
       }
     }
           
+    auto const wait_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        started - queued).count();
+    if (done && trace) {
+      trace->AddSpan("Cancelled cell", started, started,
+                     {{"ring", position.ring},
+                      {"position", position.position},
+                      {"wait_us", wait_us}});
+    }
+
     if (!done) {
-      std::vector<Person> my_ppl;
-      FindMatchingPpl(*context->parameters, ppl_[GetPplIndex(cell)], &my_ppl);
+      std::vector<PplCellEntry const*> my_ppl;
+      auto const& ppl_cell = GetCell(cell);
+      FindMatchingPpl(context->parameters, ppl_cell, &my_ppl);
+      if (trace) {
+        // N.B. the wait is how long the worklette sat in the worker pool.
+        trace->AddSpan("Cell", started, utils::Trace::Clock::now(),
+                       {{"ring", position.ring},
+                        {"position", position.position},
+                        {"wait_us", wait_us},
+                        {"ppl", ppl_cell.size()},
+                        {"matches", my_ppl.size()}});
+      }
+      // The first cell may have been partly handed out on the last page.
+      if (position.ring == context->start.ring
+          && position.position == context->start.position) {
+        my_ppl.erase(
+            my_ppl.begin(),
+            my_ppl.begin() + std::min<size_t>(context->skip, my_ppl.size()));
+      }
       std::unique_lock<std::mutex> lock(context->mutex);
-      for (auto const& person : my_ppl)
-        context->ppl.push_back(person);
-      CHECK(context->pending_cells.erase(cell) == 1);
+      context->ppl_count += my_ppl.size();
+      if (!my_ppl.empty())
+        context->ppl[position] = std::move(my_ppl);
+      --context->cells_searching;
+      CHECK(context->pending_cells.erase(position) == 1);
       context->condvar.notify_all();            
     }
   }
@@ -415,23 +1047,42 @@ class PplmeMatchingPplProvider::Impl {
   
   void FindMatchingPpl(
       core::PplMatchingParameters const& parameters,
-      std::vector<std::unique_ptr<Person>> const& ppl_cell,
-      std::vector<Person>* ppl) const {
+      PplCell const& ppl_cell,
+      std::vector<PplCellEntry const*>* ppl) const {
     auto const today = date_provider_();
-    auto const earliest = today - boost::gregorian::years(
-        parameters.age_of_user() + max_age_difference_);
+    // At most max_age means born no earlier than the day after the
+    // max_age + 1'th birthday of someone born on today's date.
+    auto const earliest = parameters.max_age() ?
+        today - boost::gregorian::years(*parameters.max_age() + 1)
+              + boost::gregorian::days(1) :
+        today - boost::gregorian::years(
+            parameters.age_of_user() + max_age_difference_);
     auto const latest = today - boost::gregorian::years(
-        parameters.age_of_user() - max_age_difference_);
+        parameters.min_age().value_or(
+            parameters.age_of_user() - max_age_difference_));
+    auto const location_of_user = parameters.location_of_user();
+    auto const max_distance = parameters.max_distance();
 
-    auto person = std::lower_bound(
+    auto entry = std::lower_bound(
         begin(ppl_cell), end(ppl_cell), earliest,
-        [](std::unique_ptr<Person> const& lhs, boost::gregorian::date rhs) {
-          return lhs->date_of_birth() < rhs;
+        [](PplCellEntry const& lhs, boost::gregorian::date rhs) {
+          return lhs.date_of_birth < rhs;
         });
+    auto const first_entry = entry;
+    auto const previous_ppl_size = ppl->size();
     for (;
-         person != end(ppl_cell) && (*person)->date_of_birth() <= latest;
-         ++person)
-      ppl->push_back(**person);
+         entry != end(ppl_cell) && entry->date_of_birth <= latest;
+         ++entry) {
+      if (!max_distance
+          || core::ApproxDistanceBetween(
+                 location_of_user, entry->location_of_home) <= *max_distance)
+        ppl->push_back(&*entry);
+    }
+
+    cells_visited_.fetch_add(1, std::memory_order_relaxed);
+    ppl_scanned_.fetch_add(entry - first_entry, std::memory_order_relaxed);
+    ppl_matched_.fetch_add(ppl->size() - previous_ppl_size,
+                           std::memory_order_relaxed);
   }
 };
 
@@ -441,13 +1092,15 @@ PplmeMatchingPplProvider::PplmeMatchingPplProvider(
     int max_age_difference,
     int max_ppl,
     boost::optional<int> per_find_concurrency,
-    std::function<boost::gregorian::date()> date_provider) :
+    std::function<boost::gregorian::date()> date_provider,
+    int partitions) :
     impl_{new Impl{
         resolution,
         max_age_difference,
         max_ppl,
         per_find_concurrency,
-        date_provider}} {}
+        date_provider,
+        partitions}} {}
 
 
 PplmeMatchingPplProvider::~PplmeMatchingPplProvider() noexcept(true) = default;
@@ -458,6 +1111,25 @@ void PplmeMatchingPplProvider::AddPerson(
   impl_->AddPerson(std::move(person));
 }
 
+
+bool PplmeMatchingPplProvider::RemovePerson(
+    core::PersonId const& id, core::GeoPosition location_of_home) {
+  return impl_->RemovePerson(id, location_of_home);
+}
+
+
+void PplmeMatchingPplProvider::ApplyPplMutations(
+    std::vector<core::PplMutation> mutations) {
+  impl_->ApplyPplMutations(std::move(mutations));
+}
+
+
+void PplmeMatchingPplProvider::AddPpl(
+    std::vector<std::unique_ptr<core::Person>> ppl,
+    boost::optional<int> concurrency) {
+  impl_->AddPpl(std::move(ppl), concurrency);
+}
+
   
 std::vector<core::Person>
 PplmeMatchingPplProvider::FindMatchingPpl(
@@ -466,5 +1138,31 @@ PplmeMatchingPplProvider::FindMatchingPpl(
 }
 
 
+core::PplMatchingOutcome PplmeMatchingPplProvider::VisitMatchingPpl(
+    core::PplMatchingParameters const& parameters,
+    std::function<void (core::Person const&)> const& visitor) const {
+  return impl_->VisitMatchingPpl(parameters, visitor);
+}
+
+
+core::PplMatchingOutcome PplmeMatchingPplProvider::VisitMatchingPplIds(
+    core::PplMatchingParameters const& parameters,
+    std::function<void (core::PersonId const&, core::GeoPosition const&)> const&
+        visitor) const {
+  return impl_->VisitMatchingPplIds(parameters, visitor);
+}
+
+
+void PplmeMatchingPplProvider::VisitAllPpl(
+    std::function<void (core::Person const&)> const& visitor) const {
+  impl_->VisitAllPpl(visitor);
+}
+
+
+PplmeMatchingPplProvider::Stats PplmeMatchingPplProvider::GetStats() const {
+  return impl_->GetStats();
+}
+
+
 }  // namespace engine
 }  // namespace pplme
@@ -8,8 +8,12 @@
 #define PPLME_LIBPPLMEENGINE_PPLMEMATCHINGPPLPROVIDER_H_
 
 
+#include <stdint.h>
+#include <memory>
+#include <vector>
 #include <boost/optional.hpp>
 #include "libpplmecore/matching_ppl_provider.h"
+#include "libpplmecore/ppl_mutation.h"
 #include "libpplmeutils/pimpl.h"
 #include "ppl_repository.h"
 
@@ -20,6 +24,37 @@ namespace engine {
 
 /**
  *  @todoco ...
+ *
+ *  @remarks
+ *  Matching ppl are found by searching outwards from the user's cell in
+ *  rings of cells, and are handed out in (ring, position-in-ring,
+ *  date-of-birth) order, no matter how many cells were searched at once.
+ *  That order is what makes a core::PplCursor meaningful: it's just where
+ *  the last page stopped, so the next page carries on from there rather than
+ *  searching (and throwing away) everything before it again.
+ *
+ *  A max distance in the core::PplMatchingParameters bounds how many rings
+ *  (and how far north/south and east/west within them) are searched at all,
+ *  so tighter requests search fewer cells.  An age range bounds the
+ *  date-of-birth search within each cell, overriding max_age_difference.
+ *
+ *  The grid can be split into partitions (by band of longitude), each with
+ *  its own workers to search its cells; a cell is only ever searched by its
+ *  own partition's workers.  On a NUMA box, with a partition per node, each
+ *  partition's workers are pinned to its node and its cells are allocated
+ *  there, so that searches don't keep reaching across to the other socket.
+ *  Elsewhere, partitions behave just the same, bar the pinning (which is
+ *  handy for testing, if nothing else).  Asking for 0 partitions means one
+ *  per NUMA node.
+ *
+ *  If the deadline passes mid-search, no more cells are queued, cells that
+ *  are queued but not yet started are skipped, and we return straight away
+ *  with whoever was found in the cells before the first one that wasn't
+ *  searched (and a cursor that carries on from that cell).
+ *
+ *  Ppl may be added and removed while finds are going on: each find has the
+ *  grid to itself (bar other finds) from start to (visiting) finish, and
+ *  each add or remove waits its turn, and vice versa.
  */
 class PplmeMatchingPplProvider :
       public PplRepository,
@@ -30,7 +65,8 @@ class PplmeMatchingPplProvider :
       int max_age_difference,
       int max_ppl,
       boost::optional<int> per_find_concurrency,
-      std::function<boost::gregorian::date()> date_provider);
+      std::function<boost::gregorian::date()> date_provider,
+      int partitions = 1);
   // Need noexcept to work-around gcc bug 53613.
   ~PplmeMatchingPplProvider() noexcept (true);
 
@@ -41,10 +77,79 @@ class PplmeMatchingPplProvider :
   PplmeMatchingPplProvider& operator=(PplmeMatchingPplProvider const&) = delete;
 
   void AddPerson(std::unique_ptr<core::Person> person) override;
+
+  /**
+   *  Remove the Person with id @a id, who lives at @a location_of_home (which
+   *  is what says where in the grid to look for them).
+   *
+   *  @returns  true IFF they were there to be removed.
+   */
+  bool RemovePerson(core::PersonId const& id,
+                    core::GeoPosition location_of_home);
+
+  /**
+   *  AddPerson() or RemovePerson() each of @a mutations in turn, all in one
+   *  go (i.e., no find sees some of them but not others).
+   */
+  void ApplyPplMutations(std::vector<core::PplMutation> mutations);
+
+  /**
+   *  Equivalent to AddPerson()ing each of @a ppl in turn, only much quicker
+   *  for lots of ppl: they're appended to their cells (by @a concurrency
+   *  threads, each looking after its own stripe of the grid, defaulting to
+   *  std::thread::hardware_concurrency()), and then each cell is sorted just
+   *  the once, rather than inserted into in order one Person at a time.
+   *
+   *  @note  Finds wait for the whole lot to be added, so this is best kept
+   *         for populating, or for modest batches.
+   */
+  void AddPpl(std::vector<std::unique_ptr<core::Person>> ppl,
+              boost::optional<int> concurrency = boost::none);
   
   std::vector<core::Person>
   FindMatchingPpl(core::PplMatchingParameters const& parameters) const override;
-  
+
+  /** Visits matching ppl in situ, i.e., without copying them out of the
+      grid. */
+  core::PplMatchingOutcome VisitMatchingPpl(
+      core::PplMatchingParameters const& parameters,
+      std::function<void (core::Person const&)> const& visitor) const override;
+
+  /** Never touches anything but the grid's inline copies of each matching
+      Person's id and location. */
+  core::PplMatchingOutcome VisitMatchingPplIds(
+      core::PplMatchingParameters const& parameters,
+      std::function<void (core::PersonId const&, core::GeoPosition const&)>
+          const& visitor) const override;
+
+  /** Visits everyone, in no particular order (e.g., for snapshotting them);
+      adds and removes wait until it's done. */
+  void VisitAllPpl(std::function<void (core::Person const&)> const& visitor)
+      const;
+
+  /** Running totals across all finds so far, for the metrics. */
+  struct Stats {
+    /** Cells that were actually searched. */
+    uint64_t cells_visited;
+    /** Cells that the sqiral passed over, either because they were out of
+        bounds or because they were queued but the find was done (or out of
+        time) by the time their turn came. */
+    uint64_t cells_skipped;
+    /** Ppl in the searched cells whose date of birth put them in the
+        running, and those of them who actually matched. */
+    uint64_t ppl_scanned;
+    uint64_t ppl_matched;
+    /** What the grid (not including the rest of each Person) takes up: how
+        much is allocated, how much has been mapped from the OS to allocate
+        it from, and how much of that is on huge pages (as asked for, at
+        least, in the case of transparent ones). */
+    uint64_t storage_octets;
+    uint64_t storage_mapped_octets;
+    uint64_t storage_huge_page_octets;
+  };
+
+  Stats GetStats() const;
+
  private:
   class Impl;
   utils::Pimpl<Impl> impl_;
@@ -7,6 +7,8 @@
 
 #include "prototype_matching_ppl_provider.h"
 #include <math.h>
+#include <algorithm>
+#include <chrono>
 #include <condition_variable>
 #include <deque>
 #include <mutex>
@@ -266,11 +268,15 @@ class PrototypeMatchingPplProvider::Impl {
     if (orchestration) {
       std::unique_lock<std::mutex> lock(orchestration->mutex);
       if (orchestration->pending_ops != 0) {
-        orchestration->condvar.wait_for(
+        // Spec says to return within 1 second.  This is where that magic
+        // happens (unless the request is in even more of a hurry).
+        auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        if (parameters.deadline())
+          deadline = std::min(deadline, *parameters.deadline());
+        orchestration->condvar.wait_until(
             lock,
-            // Spec says to return within 1 second.  This is where that magic
-            // happens.
-            std::chrono::seconds(1),
+            deadline,
             [orchestration]() { return orchestration->pending_ops == 0; });
       }
       // Make sure that any unfinished work doesn't smash us up.
@@ -0,0 +1,44 @@
+/**
+ *  @file
+ *  @brief   Implementation for pplme::net::Backend.
+ *  @author  j.ho
+ */
+
+
+#include "backend.h"
+#include <atomic>
+#include <glog/logging.h>
+#include "detail/io_uring.h"
+
+
+namespace pplme {
+namespace net {
+
+
+Backend ResolveBackend(Backend backend) {
+  if (backend == Backend::IoUring && !detail::IoUring::IsAvailable()) {
+    static std::atomic<bool> warned{false};
+    LOG_IF(WARNING, !warned.exchange(true))
+        << "io_uring isn't available here; falling back to epoll";
+    return Backend::Epoll;
+  }
+  return backend;
+}
+
+
+char const* GetBackendName(Backend backend) {
+  return backend == Backend::IoUring ? "io_uring" : "epoll";
+}
+
+
+boost::optional<Backend> ParseBackend(std::string const& name) {
+  for (auto const backend : {Backend::Epoll, Backend::IoUring}) {
+    if (name == GetBackendName(backend))
+      return backend;
+  }
+  return boost::none;
+}
+
+
+}  // namespace net
+}  // namespace pplme
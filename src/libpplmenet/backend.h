@@ -0,0 +1,52 @@
+/**
+ *  @file
+ *  @brief   Definition of pplme::net::Backend, which says how libpplmenet
+ *           does its socket I/O.
+ *  @author  j.ho
+ */
+#ifndef PPLME_LIBPPLMENET_BACKEND_H_
+#define PPLME_LIBPPLMENET_BACKEND_H_
+
+
+#include <string>
+#include <boost/optional.hpp>
+
+
+namespace pplme {
+namespace net {
+
+
+/**
+ *  @remarks
+ *  Epoll is ASIO's reactor (which is epoll, on Linux), with a system call
+ *  per read and per write.  IoUring does its reads and writes (and accepts)
+ *  by way of io_uring: a request's write and the read of its response are
+ *  submitted together, reads go into buffers registered with the kernel up
+ *  front, and one (multishot) accept keeps on accepting.  Where io_uring
+ *  can't be had, IoUring quietly falls back to Epoll (@see ResolveBackend()).
+ */
+enum class Backend {
+  Epoll,
+  IoUring,
+};
+
+
+/** @returns  @a backend, unless that's IoUring and this kernel won't let us
+              have it, in which case Epoll (with a warning, the first time
+              that happens). */
+Backend ResolveBackend(Backend backend);
+
+
+/** @returns  "epoll" or "io_uring". */
+char const* GetBackendName(Backend backend);
+
+
+/** @returns  The Backend named @a name (as per GetBackendName()), if any. */
+boost::optional<Backend> ParseBackend(std::string const& name);
+
+
+}  // namespace net
+}  // namespace pplme
+
+
+#endif  // PPLME_LIBPPLMENET_BACKEND_H_
@@ -0,0 +1,129 @@
+/**
+ *  @file
+ *  @brief   Implementation for pplme::net::BufferPool.
+ *  @author  j.ho
+ */
+
+
+#include "buffer_pool.h"
+#include <algorithm>
+
+
+namespace {
+
+
+uint32_t GetClassSize(unsigned size_class) {
+  return pplme::net::BufferPool::kMinClassSize << size_class;
+}
+
+
+/** @returns  The smallest size class that fits @a size (which had better
+              not be beyond kMaxClassSize). */
+unsigned GetSizeClass(uint32_t size) {
+  unsigned size_class = 0;
+  while (GetClassSize(size_class) < size)
+    ++size_class;
+  return size_class;
+}
+
+
+}  // namespace
+
+
+namespace pplme {
+namespace net {
+
+
+uint32_t const BufferPool::kMinClassSize;
+uint32_t const BufferPool::kMaxClassSize;
+uint32_t const BufferPool::kMaxRetainedOctetsPerClass;
+
+
+void BufferPool::Releaser::operator()(uint8_t* octets) const {
+  if (pool_)
+    pool_->Release(octets, size_class_);
+  else
+    delete [] octets;
+}
+
+
+BufferPool::BufferPool() :
+    allocation_count_{0},
+    reuse_count_{0} {
+  for (unsigned n = 0; n < kNumSizeClasses; ++n) {
+    auto const max_retained = std::max<uint32_t>(
+        2, kMaxRetainedOctetsPerClass / GetClassSize(n));
+    size_classes_[n].free_buffers.reserve(max_retained);
+  }
+}
+
+
+BufferPool::~BufferPool() {
+  for (auto& size_class : size_classes_) {
+    for (auto octets : size_class.free_buffers)
+      delete [] octets;
+  }
+}
+
+
+BufferPool& BufferPool::GetDefault() {
+  // Intentionally leaked so that buffers released during static destruction
+  // still have somewhere to go.
+  static BufferPool* const default_pool = new BufferPool;
+  return *default_pool;
+}
+
+
+BufferPool::Buffer BufferPool::Acquire(uint32_t size) {
+  if (size > kMaxClassSize) {
+    ++allocation_count_;
+    return Buffer{new uint8_t[size], Releaser{}};
+  }
+
+  auto const size_class = GetSizeClass(size);
+  uint8_t* octets = nullptr;
+  /* lock block */ {
+    auto& pooled = size_classes_[size_class];
+    std::unique_lock<std::mutex> lock(pooled.mutex);
+    if (!pooled.free_buffers.empty()) {
+      octets = pooled.free_buffers.back();
+      pooled.free_buffers.pop_back();
+    }
+  }
+
+  if (octets)
+    ++reuse_count_;
+  else {
+    ++allocation_count_;
+    octets = new uint8_t[GetClassSize(size_class)];
+  }
+
+  return Buffer{octets, Releaser{this, size_class}};
+}
+
+
+void BufferPool::Recycle(uint8_t* octets, uint32_t size) {
+  if (size > kMaxClassSize)
+    delete [] octets;
+  else
+    Release(octets, GetSizeClass(size));
+}
+
+
+void BufferPool::Release(uint8_t* octets, unsigned size_class) {
+  /* lock block */ {
+    auto& pooled = size_classes_[size_class];
+    std::unique_lock<std::mutex> lock(pooled.mutex);
+    if (pooled.free_buffers.size() < pooled.free_buffers.capacity()) {
+      pooled.free_buffers.push_back(octets);
+      octets = nullptr;
+    }
+  }
+
+  // The class is already holding on to as much as it's allowed.
+  delete [] octets;
+}
+
+
+}  // namespace net
+}  // namespace pplme
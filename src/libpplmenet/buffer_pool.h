@@ -0,0 +1,115 @@
+/**
+ *  @file
+ *  @brief   Definition of pplme::net::BufferPool, a size-classed pool of
+ *           reusable octet buffers for message bodies.
+ *  @author  j.ho
+ */
+#ifndef PPLME_LIBPPLMENET_BUFFERPOOL_H_
+#define PPLME_LIBPPLMENET_BUFFERPOOL_H_
+
+
+#include <stdint.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace pplme {
+namespace net {
+
+
+/**
+ *  Example:
+ *  @code
+ *  auto buffer = BufferPool::GetDefault().Acquire(request_pb.ByteSize());
+ *  request_pb.SerializeWithCachedSizesToArray(buffer.get());
+ *  // [...]
+ *  // buffer goes back to the pool when it goes out of scope.
+ *  @endcode
+ *
+ *  @remarks
+ *  Buffers are handed out in power-of-two size classes, from kMinClassSize
+ *  up to kMaxClassSize, and returned to their class's free list when the
+ *  handle is destroyed.  Each class only holds on to a bounded amount of
+ *  memory, so a burst of big responses doesn't leave the pool bloated
+ *  forever.  Requests beyond kMaxClassSize are simply new[]'d and delete[]'d.
+ *
+ *  @note
+ *  This class is safe to use concurrently, and buffers may be released on a
+ *  different thread to the one that acquired them.  The pool must outlive
+ *  all of its buffers (which is why GetDefault() is never destroyed).
+ */
+class BufferPool {
+ public:
+  /** Returns a buffer to its pool (or delete[]s it if it has no pool). */
+  class Releaser {
+   public:
+    Releaser() : pool_{nullptr}, size_class_{0} {}
+    Releaser(BufferPool* pool, unsigned size_class) :
+        pool_{pool}, size_class_{size_class} {}
+
+    void operator()(uint8_t* octets) const;
+
+   private:
+    BufferPool* pool_;
+    unsigned size_class_;
+  };
+
+  /** A handle to a pooled buffer. */
+  using Buffer = std::unique_ptr<uint8_t[], Releaser>;
+
+  /** The smallest buffer that we'll hand out. */
+  static uint32_t const kMinClassSize = 64;
+  /** The biggest buffer that we pool (big enough for
+      Message::kMaxBodyLength). */
+  static uint32_t const kMaxClassSize = 1048576;
+  /** The most (in octets) that each size class retains for reuse. */
+  static uint32_t const kMaxRetainedOctetsPerClass = 4 * 1048576;
+
+  BufferPool();
+  ~BufferPool();
+
+  BufferPool(BufferPool const&) = delete;
+  BufferPool& operator=(BufferPool const&) = delete;
+
+  /** The process-wide pool used by Message. */
+  static BufferPool& GetDefault();
+
+  /** Acquire a buffer of at least @a size octets (contents unspecified). */
+  Buffer Acquire(uint32_t size);
+
+  /** Give back @a octets, having release()d them from a Buffer that was
+      Acquire()d for @a size octets (e.g., to make an object out of them). */
+  void Recycle(uint8_t* octets, uint32_t size);
+
+  /** @returns  The number of times Acquire() had to actually allocate. */
+  uint64_t GetAllocationCount() const { return allocation_count_; }
+  /** @returns  The number of times Acquire() was satisfied from the pool. */
+  uint64_t GetReuseCount() const { return reuse_count_; }
+
+ private:
+  static unsigned const kNumSizeClasses = 15;
+  static_assert(kMinClassSize << (kNumSizeClasses - 1) == kMaxClassSize,
+                "Size classes don't add up");
+
+  struct SizeClass {
+    std::mutex mutex;
+    /** @note  Capacity is reserved up front so that releasing a buffer never
+               allocates. */
+    std::vector<uint8_t*> free_buffers;
+  };
+  std::array<SizeClass, kNumSizeClasses> size_classes_;
+  std::atomic<uint64_t> allocation_count_;
+  std::atomic<uint64_t> reuse_count_;
+
+  void Release(uint8_t* octets, unsigned size_class);
+};
+
+
+}  // namespace net
+}  // namespace pplme
+
+
+#endif  // PPLME_LIBPPLMENET_BUFFERPOOL_H_
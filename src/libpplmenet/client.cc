@@ -26,9 +26,10 @@ namespace net {
 
 class Client::Impl {
  public:
-  Impl(std::string const& address, unsigned short port) :
+  Impl(std::string const& address, unsigned short port, Backend backend) :
       address_{address},
       port_{port},
+      backend_{backend},
       io_service_token_work_{io_service_} {}
     
 
@@ -56,7 +57,8 @@ class Client::Impl {
         error_code error;
         socket.connect(endpoint, error);
         if (!error)
-          connection_.reset(new detail::Connection{std::move(socket)});
+          connection_.reset(
+              new detail::Connection{std::move(socket), backend_});
         else {
           LOG(ERROR) << "Failed to connect to " << address_ << ":" << port_
                      << ": " << error << ": " << error.message();
@@ -72,12 +74,13 @@ class Client::Impl {
 
 
   std::unique_ptr<Message> SendRequest(Message const& request) {
-    std::unique_ptr<Message> response;
+    return connection_->SendMessageAndReceive(request);
+  }
 
-    if (connection_->SendMessage(request))
-      response = connection_->ReceiveMessage();
 
-    return response;
+  void Hangup() {
+    if (connection_)
+      connection_->Shutdown();
   }
 
 
@@ -91,6 +94,8 @@ class Client::Impl {
   std::string address_;
   /** The port to connect to. */
   unsigned short port_;
+  /** How to do the connection's I/O. */
+  Backend backend_;
   /** The ASIO io_service used to process this connection. */
   boost::asio::io_service io_service_;
   /** Token work to keep io_service_ busy. */
@@ -159,8 +164,10 @@ class Client::Impl {
 };
 
 
-Client::Client(std::string const& address, unsigned short port) :
-    impl_{new Impl{address, port}} {}
+Client::Client(std::string const& address,
+               unsigned short port,
+               Backend backend) :
+    impl_{new Impl{address, port, backend}} {}
 
 
 Client::~Client() = default;
@@ -176,6 +183,11 @@ std::unique_ptr<Message> Client::SendRequest(Message const& request) {
 }
 
 
+void Client::Hangup() {
+  impl_->Hangup();
+}
+
+
 void Client::Disconnect() {
   impl_->Disconnect();
 }
@@ -11,6 +11,7 @@
 #include <memory>
 #include <string>
 #include "libpplmeutils/pimpl.h"
+#include "backend.h"
 
 
 namespace pplme {
@@ -55,7 +56,7 @@ namespace net {
  *  @note
  *  This class is not safe to use in an unsychronized manner; that is,
  *  calls to Connect()/SendRequest()/Disconnect() should be appropriately
- *  ordered and should not occur concurrently.
+ *  ordered and should not occur concurrently (bar Hangup()).
  */
 class Client {
  public:
@@ -63,8 +64,11 @@ class Client {
    *  @param address is the hostname, DNS name, or IP address of the TCP/IP
    *         server host to connect to.
    *  @param port is the TCP/IP port number to connect to.
+   *  @param backend is how to do the connection's I/O.
    */
-  Client(std::string const& address, unsigned short port);
+  Client(std::string const& address,
+         unsigned short port,
+         Backend backend = Backend::Epoll);
   ~Client();
 
   /**
@@ -92,6 +96,17 @@ class Client {
    */
   std::unique_ptr<Message> SendRequest(Message const& request);
 
+  /**
+   *  Hang up on the server, so that a SendRequest() under way (on another
+   *  thread) gives up, as do any after it.
+   *
+   *  @remarks
+   *  Unlike the rest of this class's methods, this may be called while
+   *  SendRequest() is, but it must still be ordered with respect to
+   *  Connect() and Disconnect().
+   */
+  void Hangup();
+
   /**
    *  Disconnect from the server.
    *
@@ -6,85 +6,420 @@
 
 
 #include "connection.h"
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <array>
 #include <boost/asio.hpp>
 #include <glog/logging.h>
 #include "../message.h"
+#include "io_uring.h"
 
 
 using batcpip = boost::asio::ip::tcp;
 using boost::system::error_code;
 
 
+namespace {
+
+
+/** Comfortably big enough for a PplmeRequest (or several pipelined ones) and
+    for a typical PplmeResponse; anything bigger bypasses the buffer. */
+std::size_t const kReadBufferSize = 64 * 1024;
+
+/** A send and a read (or a poll) at most are ever in flight at once. */
+unsigned int const kRingEntries = 4;
+
+
+/** @returns  @a result (of a read), as octets read and/or an error. */
+std::size_t TakeReadResult(int32_t result, error_code& error) {
+  if (result > 0)
+    return static_cast<std::size_t>(result);
+  error = result == 0 ?
+      error_code{boost::asio::error::eof} :
+      error_code{-result, boost::system::system_category()};
+  return 0;
+}
+
+
+/** Point @a iovecs at what of @a message remains after the first @a sent
+    octets.  @returns  How many of them there are. */
+std::size_t GatherUnsent(pplme::net::Message const& message,
+                         std::size_t sent,
+                         iovec* iovecs) {
+  std::array<iovec, 2> const whole{{
+      {const_cast<pplme::net::Message::Header*>(&message.GetHeader()),
+       sizeof(pplme::net::Message::Header)},
+      {const_cast<void*>(message.GetBodyOctets()), message.GetBodyLength()}}};
+  std::size_t count = 0;
+  for (auto const& part : whole) {
+    if (sent >= part.iov_len) {
+      sent -= part.iov_len;
+      continue;
+    }
+    iovecs[count].iov_base = static_cast<uint8_t*>(part.iov_base) + sent;
+    iovecs[count].iov_len = part.iov_len - sent;
+    ++count;
+    sent = 0;
+  }
+  return count;
+}
+
+
+void PrepareSend(int fd, msghdr* header, io_uring_sqe* sqe) {
+  sqe->opcode = IORING_OP_SENDMSG;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(header);
+  sqe->len = 1;
+  sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+}
+
+
+}  // namespace
+
+
 namespace pplme {
 namespace net {
 namespace detail {
 
 
-Connection::Connection(batcpip::socket&& socket) :
-    socket_{std::move(socket)} {}
+Connection::Connection(batcpip::socket&& socket, Backend backend) :
+    socket_{std::move(socket)},
+    read_buffer_(kReadBufferSize),
+    read_begin_{0},
+    read_end_{0},
+    read_buffer_registered_{false} {
+  // We only ever do request -> response, so all Nagle buys us is a stall
+  // waiting on the peer's delayed ACK.
+  error_code error;
+  socket_.set_option(batcpip::no_delay{true}, error);
+  if (error)
+    LOG(WARNING) << "Failed to set TCP_NODELAY: " << error;
+  peer_endpoint_ = socket_.remote_endpoint(error);
+
+  if (ResolveBackend(backend) == Backend::IoUring) {
+    ring_.reset(new IoUring{kRingEntries});
+    if (ring_->IsOpen()) {
+      // io_uring waits on a blocking socket for us (rather than telling us
+      // to try again), which is one less system call.
+      socket_.native_non_blocking(false, error);
+      iovec const buffer{&read_buffer_[0], read_buffer_.size()};
+      read_buffer_registered_ = ring_->RegisterBuffers(&buffer, 1);
+    } else {
+      LOG(WARNING) << "Failed to set up io_uring for " << peer_endpoint_
+                   << "; falling back to epoll";
+      ring_.reset();
+    }
+  }
+}
+
+
+Connection::~Connection() = default;
 
 
 batcpip::endpoint Connection::GetPeerEndpoint() const {
-  return socket_.remote_endpoint();
+  return peer_endpoint_;
 }
 
 
 bool Connection::SendMessage(Message const& message) {
-  // First write the Message's header...
-  auto const* header = &message.GetHeader();
-  auto header_octets = boost::asio::buffer(header, sizeof(*header));
   error_code error;
-  boost::asio::write(socket_, header_octets, error);
-  if (!error) {
-    // ...then write the Message's body.
-    auto body_octets = boost::asio::buffer(message.GetBodyOctets(),
-                                           message.GetBodyLength());
-    boost::asio::write(socket_, body_octets, error);
+  if (ring_)
+    SendWithIoUring(message, 0, error);
+  else {
+    // Gather the Message's header and body into a single write.
+    std::array<boost::asio::const_buffer, 2> const octets{{
+        boost::asio::buffer(&message.GetHeader(), sizeof(Message::Header)),
+        boost::asio::buffer(message.GetBodyOctets(),
+                            message.GetBodyLength())}};
+    boost::asio::write(socket_, octets, error);
   }
 
   if (error) {
-    LOG(ERROR) << "Failed to send message to " << socket_.remote_endpoint()
+    LOG(ERROR) << "Failed to send message to " << peer_endpoint_
                << ": " << error;
-  }     
-  
+  }
+
   return !error;
 }
 
 
 std::unique_ptr<Message> Connection::ReceiveMessage() {
   std::unique_ptr<Message> message;
-
-  // First read the Message's header...
-  Message::Header header;
-  auto header_octets = boost::asio::buffer(&header, sizeof(header));
   error_code error;
-  boost::asio::read(socket_, header_octets, error);
-  if (!error) {
-    // ...then receive the Message's body.
-    if (header.GetBodyLength() <= Message::kMaxBodyLength) {
-      auto body_octets = Message::CreateBodyBuffer(header.GetBodyLength());
-      boost::asio::read(
-          socket_,
-          boost::asio::buffer(body_octets.get(), header.GetBodyLength()),
-          error);
-      if (!error)
-        message.reset(new Message{header, std::move(body_octets)});
+  bool garbage = false;
+  bool mid_message = false;
+
+  while (!message && !error && !garbage) {
+    // What's already been read may well have a message in it (e.g., if the
+    // peer pipelines its messages).
+    garbage = !ParseReceivedOctets(&message);
+    if (message || garbage)
+      continue;
+
+    auto const available = read_end_ - read_begin_;
+
+    // If the message at the front is too big to ever fit in read_buffer_,
+    // then read the remainder of its body directly into the message itself.
+    Message::Header header;
+    if (available >= sizeof(header)) {
+      memcpy(&header, &read_buffer_[read_begin_], sizeof(header));
+      auto const body_length = header.GetBodyLength();
+      if (body_length <= Message::kMaxBodyLength
+          && sizeof(header) + body_length > read_buffer_.size()) {
+        auto body_octets = Message::CreateBodyBuffer(body_length);
+        auto const buffered = available - sizeof(header);
+        memcpy(body_octets.get(),
+               &read_buffer_[read_begin_ + sizeof(header)],
+               buffered);
+        read_begin_ = read_end_ = 0;
+        Read(body_octets.get() + buffered, body_length - buffered, error);
+        if (!error)
+          message.reset(new Message{header, std::move(body_octets)});
+        else
+          mid_message = true;
+        continue;
+      }
     }
-    else {
-      LOG(ERROR) << "Message received from " << socket_.remote_endpoint()
-                 << " was too big at " << header.GetBodyLength() << " octets";
-    }     
+
+    // Otherwise, shuffle any partial message down to the front of the buffer
+    // and read as much as the peer has sent us.
+    CompactReadBuffer();
+    read_end_ += ReadSome(&read_buffer_[read_end_],
+                          read_buffer_.size() - read_end_,
+                          error);
   }
 
-  if (error) {
-    LOG(ERROR) << "Failed to receive message from " << socket_.remote_endpoint()
+  // The peer hanging up between messages is just the end of a conversation
+  // (and is how every kept-alive one ends).
+  if (   error == boost::asio::error::eof
+      && !mid_message
+      && read_begin_ == read_end_)
+    VLOG(1) << "Connection closed by " << peer_endpoint_;
+  else if (error) {
+    LOG(ERROR) << "Failed to receive message from " << peer_endpoint_
                << ": " << error;
   }
-  
+
   return message;
 }
 
 
+std::unique_ptr<Message> Connection::SendMessageAndReceive(
+    Message const& message) {
+  // Anything already read (be it a whole message or the start of one) is
+  // left to ReceiveMessage() to make sense of.
+  CompactReadBuffer();
+  if (!ring_ || read_end_ != 0)
+    return SendMessage(message) ? ReceiveMessage() : nullptr;
+
+  // The message goes out and the start of the response is read in on the
+  // one io_uring_enter(), the read being linked to the send so that it's
+  // only issued once the send is done with.
+  std::array<iovec, 2> iovecs;
+  msghdr header;
+  memset(&header, 0, sizeof(header));
+  header.msg_iov = &iovecs[0];
+  header.msg_iovlen = GatherUnsent(message, 0, &iovecs[0]);
+  auto const send_sqe = GetSubmission();
+  PrepareSend(socket_.native_handle(), &header, send_sqe);
+  send_sqe->flags |= IOSQE_IO_LINK;
+  send_sqe->user_data = 0;
+  auto const read_sqe = GetSubmission();
+  PrepareRead(&read_buffer_[read_end_],
+              read_buffer_.size() - read_end_,
+              read_sqe);
+  read_sqe->user_data = 1;
+  int32_t results[2] = {0, 0};
+  error_code error;
+  if (!Complete(results, 2))
+    error = boost::asio::error::fault;
+  else {
+    // A short send (or one that would have blocked) cancels the read, so
+    // there's more to send; a read that came to nothing (or didn't happen)
+    // is retried by ReceiveMessage(), which says what went wrong, if
+    // anything.
+    auto const total = sizeof(Message::Header) + message.GetBodyLength();
+    auto const sent = static_cast<std::size_t>(std::max(results[0], 0));
+    if (results[0] < 0 && results[0] != -EAGAIN)
+      error = error_code{-results[0], boost::system::system_category()};
+    else if (sent < total)
+      SendWithIoUring(message, sent, error);
+  }
+  if (error) {
+    LOG(ERROR) << "Failed to send message to " << peer_endpoint_
+               << ": " << error;
+    return nullptr;
+  }
+
+  if (results[1] > 0)
+    read_end_ += results[1];
+  return ReceiveMessage();
+}
+
+
+void Connection::Shutdown() {
+  error_code error;
+  socket_.shutdown(batcpip::socket::shutdown_both, error);
+}
+
+
+bool Connection::ParseReceivedOctets(std::unique_ptr<Message>* message) {
+  auto const available = read_end_ - read_begin_;
+  Message::Header header;
+  if (available >= sizeof(header)) {
+    memcpy(&header, &read_buffer_[read_begin_], sizeof(header));
+    auto const body_length = header.GetBodyLength();
+    if (body_length > Message::kMaxBodyLength) {
+      LOG(ERROR) << "Message received from " << peer_endpoint_
+                 << " was too big at " << body_length << " octets";
+      return false;
+    }
+
+    if (available >= sizeof(header) + body_length) {
+      auto body_octets = Message::CreateBodyBuffer(body_length);
+      memcpy(body_octets.get(),
+             &read_buffer_[read_begin_ + sizeof(header)],
+             body_length);
+      message->reset(new Message{header, std::move(body_octets)});
+      read_begin_ += sizeof(header) + body_length;
+    }
+  }
+
+  if (read_begin_ == read_end_)
+    read_begin_ = read_end_ = 0;
+
+  return true;
+}
+
+
+void Connection::CompactReadBuffer() {
+  if (read_begin_ != 0) {
+    std::copy(read_buffer_.begin() + read_begin_,
+              read_buffer_.begin() + read_end_,
+              read_buffer_.begin());
+    read_end_ -= read_begin_;
+    read_begin_ = 0;
+  }
+}
+
+
+std::size_t Connection::ReadSome(uint8_t* octets,
+                                 std::size_t length,
+                                 error_code& error) {
+  if (!ring_)
+    return socket_.read_some(boost::asio::buffer(octets, length), error);
+
+  io_uring_sqe sqe;
+  memset(&sqe, 0, sizeof(sqe));
+  PrepareRead(octets, length, &sqe);
+  return TakeReadResult(Perform(sqe, POLLIN), error);
+}
+
+
+void Connection::Read(uint8_t* octets,
+                      std::size_t length,
+                      error_code& error) {
+  if (!ring_) {
+    boost::asio::read(socket_, boost::asio::buffer(octets, length), error);
+    return;
+  }
+
+  while (length > 0 && !error) {
+    auto const read = ReadSome(octets, length, error);
+    octets += read;
+    length -= read;
+  }
+}
+
+
+void Connection::SendWithIoUring(Message const& message,
+                                 std::size_t sent,
+                                 error_code& error) {
+  auto const total = sizeof(Message::Header) + message.GetBodyLength();
+  while (sent < total && !error) {
+    std::array<iovec, 2> iovecs;
+    msghdr header;
+    memset(&header, 0, sizeof(header));
+    header.msg_iov = &iovecs[0];
+    header.msg_iovlen = GatherUnsent(message, sent, &iovecs[0]);
+    io_uring_sqe sqe;
+    memset(&sqe, 0, sizeof(sqe));
+    PrepareSend(socket_.native_handle(), &header, &sqe);
+    auto const result = Perform(sqe, POLLOUT);
+    if (result > 0)
+      sent += result;
+    else {
+      error = result == 0 ?
+          error_code{boost::asio::error::broken_pipe} :
+          error_code{-result, boost::system::system_category()};
+    }
+  }
+}
+
+
+bool Connection::Complete(int32_t* results, unsigned int count) {
+  for (unsigned int completed = 0; completed < count; ) {
+    if (!ring_->Submit(count - completed)) {
+      // Who knows what state it's in, so it's epoll from here on in.
+      ring_.reset();
+      return false;
+    }
+    IoUring::Completion completion;
+    while (ring_->TakeCompletion(&completion)) {
+      results[completion.user_data] = completion.result;
+      ++completed;
+    }
+  }
+  return true;
+}
+
+
+int32_t Connection::Perform(io_uring_sqe const& prepared, short poll_events) {
+  for (;;) {
+    *GetSubmission() = prepared;
+    int32_t result;
+    if (!Complete(&result, 1))
+      return -EIO;
+    if (result != -EAGAIN)
+      return result;
+
+    auto const poll_sqe = GetSubmission();
+    poll_sqe->opcode = IORING_OP_POLL_ADD;
+    poll_sqe->fd = socket_.native_handle();
+    poll_sqe->poll_events = poll_events;
+    if (!Complete(&result, 1))
+      return -EIO;
+  }
+}
+
+
+io_uring_sqe* Connection::GetSubmission() {
+  // Complete() doesn't return until everything submitted has completed (or
+  // else it's given up on ring_), so ring_ is empty between operations, and
+  // no operation takes more than two of its kRingEntries.
+  return CHECK_NOTNULL(ring_->GetSubmission());
+}
+
+
+void Connection::PrepareRead(uint8_t* octets,
+                             std::size_t length,
+                             io_uring_sqe* sqe) {
+  sqe->fd = socket_.native_handle();
+  sqe->addr = reinterpret_cast<uint64_t>(octets);
+  sqe->len = static_cast<uint32_t>(length);
+  if (   read_buffer_registered_
+      && octets >= &read_buffer_.front()
+      && octets + length <= &read_buffer_.front() + read_buffer_.size()) {
+    sqe->opcode = IORING_OP_READ_FIXED;
+    sqe->buf_index = 0;
+  } else
+    sqe->opcode = IORING_OP_RECV;
+}
+
+
 }  // namespace detail
 }  // namespace net
 }  // namespace pplme
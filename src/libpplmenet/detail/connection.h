@@ -8,12 +8,19 @@
 #define PPLME_LIBPPLMENETDETAIL_CONNECTION_H_
 
 
+#include <memory>
+#include <vector>
 #include <boost/asio/ip/tcp.hpp>
+#include "../backend.h"
 
 
+struct io_uring_sqe;
 namespace pplme {
 namespace net {
 class Message;
+namespace detail {
+class IoUring;
+}  // namespace detail
 }  // namespace net
 }  // namespace pplme
 
@@ -24,6 +31,19 @@ namespace detail {
 
 
 /**
+ *  @remarks
+ *  Messages are sent with a single gathered write (i.e., the header and the
+ *  body go out in one writev(2)-esque call), and Nagle is disabled so that
+ *  a response doesn't sit around waiting for a delayed ACK.  Receiving reads
+ *  into a reusable buffer as much as the peer has sent, and then carves out
+ *  the first complete message to have arrived; any surplus octets (e.g., the
+ *  next of several pipelined messages) are left where they are for
+ *  subsequent calls to ReceiveMessage() to carve up.
+ *
+ *  With the IoUring Backend, the connection has an io_uring of its own, with
+ *  its read buffer registered with it, and SendMessageAndReceive() submits
+ *  the write and the first read in one go.
+ *
  *  @note
  *  Instances of this class typically require synchronization in terms of
  *  the coordination of sending and receiving messages (e.g., multiple threads
@@ -32,8 +52,11 @@ namespace detail {
  */
 class Connection {
  public:
-  /** Takes ownership of @a socket. */
-  explicit Connection(boost::asio::ip::tcp::socket&& socket);
+  /** Takes ownership of @a socket, which is read and written by way of
+      @a backend (bar ResolveBackend() saying otherwise). */
+  explicit Connection(boost::asio::ip::tcp::socket&& socket,
+                      Backend backend = Backend::Epoll);
+  ~Connection();
 
   /** Get the endpoint on the remote side of this connection. */
   boost::asio::ip::tcp::endpoint GetPeerEndpoint() const;
@@ -44,9 +67,74 @@ class Connection {
   /** Blocks until a message is received.  Returns non-owning on error. */
   std::unique_ptr<Message> ReceiveMessage();
 
+  /** SendMessage() and then ReceiveMessage(), but (with the IoUring
+      Backend) with fewer system calls between them. */
+  std::unique_ptr<Message> SendMessageAndReceive(Message const& message);
+
+  /** Shut the connection down in both directions, so that whoever is
+      blocked in ReceiveMessage() (e.g., waiting on an idle peer) gives up.
+      Unlike the rest of this class, this may be called from any thread. */
+  void Shutdown();
+
  private:
   /** The connection's underlying socket. */
   boost::asio::ip::tcp::socket socket_;
+  /** Remembered up front, because the socket forgets once it's shut down. */
+  boost::asio::ip::tcp::endpoint peer_endpoint_;
+  /** Octets that have been read from socket_ but not yet carved up into
+      messages live in [read_begin_, read_end_) of this buffer. */
+  std::vector<uint8_t> read_buffer_;
+  std::vector<uint8_t>::size_type read_begin_;
+  std::vector<uint8_t>::size_type read_end_;
+  /** Non-null IFF we're doing our I/O by way of io_uring. */
+  std::unique_ptr<IoUring> ring_;
+  /** Whether read_buffer_ is registered with ring_ (as buffer 0). */
+  bool read_buffer_registered_;
+
+  /** Shuffle any partial message in read_buffer_ down to the front. */
+  void CompactReadBuffer();
+
+  /** Read what the peer has sent (up to @a length octets) into @a octets,
+      waiting for something if there's nothing yet.  @returns  How much was
+      read. */
+  std::size_t ReadSome(uint8_t* octets,
+                       std::size_t length,
+                       boost::system::error_code& error);
+
+  /** Read exactly @a length octets into @a octets. */
+  void Read(uint8_t* octets,
+            std::size_t length,
+            boost::system::error_code& error);
+
+  /** Send the rest of @a message (bar the first @a sent octets) by way of
+      ring_. */
+  void SendWithIoUring(Message const& message,
+                       std::size_t sent,
+                       boost::system::error_code& error);
+
+  /** Submit what has been got from ring_, and wait on @a count completions,
+      whose results go in @a results (as indexed by their user_data).
+      @returns  False (having done away with ring_) iff the kernel wouldn't
+                have it. */
+  bool Complete(int32_t* results, unsigned int count);
+
+  /** Submit (a copy of) the one operation @a prepared, and wait for it,
+      waiting for the socket to be ready for @a poll_events (and trying
+      again) if it would have blocked.  @returns  Its result. */
+  int32_t Perform(io_uring_sqe const& prepared, short poll_events);
+
+  /** @returns  The next of ring_'s submissions (of which there's always
+                one to be had). */
+  io_uring_sqe* GetSubmission();
+
+  /** Prepare @a sqe to read into @a octets (preferring read_buffer_'s
+      registration, if that's where they are). */
+  void PrepareRead(uint8_t* octets, std::size_t length, io_uring_sqe* sqe);
+
+  /** Carve the first complete message (if there is one yet) out of
+      read_buffer_ into @a message.  Returns false IFF the peer sent
+      garbage. */
+  bool ParseReceivedOctets(std::unique_ptr<Message>* message);
 };
 
 
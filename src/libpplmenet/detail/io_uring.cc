@@ -0,0 +1,223 @@
+/**
+ *  @file
+ *  @brief   Implementation for pplme::net::detail::IoUring.
+ *  @author  j.ho
+ */
+
+
+#include "io_uring.h"
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+#include <glog/logging.h>
+
+
+namespace {
+
+
+/** The operations that libpplmenet's io_uring backend can't do without. */
+uint8_t const kRequiredOps[] = {
+  IORING_OP_ACCEPT,
+  IORING_OP_SENDMSG,
+  IORING_OP_RECV,
+  IORING_OP_READ_FIXED,
+  IORING_OP_POLL_ADD
+};
+
+
+void* MapRing(int fd, size_t size, off_t offset) {
+  auto const ring = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, fd, offset);
+  return ring == MAP_FAILED ? nullptr : ring;
+}
+
+
+}  // namespace
+
+
+namespace pplme {
+namespace net {
+namespace detail {
+
+
+IoUring::IoUring(unsigned int entries) :
+    fd_{-1},
+    sq_ring_{nullptr},
+    sq_ring_size_{0},
+    cq_ring_{nullptr},
+    cq_ring_size_{0},
+    sqes_{nullptr},
+    sqes_size_{0},
+    unsubmitted_{0} {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+  if (fd_ < 0) {
+    VLOG(1) << "io_uring_setup() failed: " << strerror(errno);
+    return;
+  }
+
+  // Since 5.4, both rings come in the one mapping.
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  auto const single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap)
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  sq_ring_ = MapRing(fd_, sq_ring_size_, IORING_OFF_SQ_RING);
+  cq_ring_ = single_mmap ?
+      sq_ring_ : MapRing(fd_, cq_ring_size_, IORING_OFF_CQ_RING);
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = static_cast<io_uring_sqe*>(
+      MapRing(fd_, sqes_size_, IORING_OFF_SQES));
+  if (!sq_ring_ || !cq_ring_ || !sqes_) {
+    LOG(ERROR) << "Failed to map io_uring rings: " << strerror(errno);
+    Close();
+    return;
+  }
+
+  auto const sq = static_cast<uint8_t*>(sq_ring_);
+  sq_head_ = reinterpret_cast<unsigned int*>(sq + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+  sq_mask_ = *reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+  sq_entries_ =
+      *reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_entries);
+  sq_array_ = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+  auto const cq = static_cast<uint8_t*>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+  cq_mask_ = *reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+}
+
+
+IoUring::~IoUring() {
+  Close();
+}
+
+
+bool IoUring::IsOpen() const {
+  return fd_ >= 0;
+}
+
+
+io_uring_sqe* IoUring::GetSubmission() {
+  // We're the only one that moves the tail, and the kernel only ever moves
+  // the head on (freeing up more room).
+  auto const head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+  auto const tail = *sq_tail_ + unsubmitted_;
+  if (tail - head >= sq_entries_)
+    return nullptr;
+
+  auto const index = tail & sq_mask_;
+  sq_array_[index] = index;
+  ++unsubmitted_;
+  auto const sqe = &sqes_[index];
+  memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+
+bool IoUring::Submit(unsigned int min_completions) {
+  __atomic_store_n(sq_tail_, *sq_tail_ + unsubmitted_, __ATOMIC_RELEASE);
+  auto to_submit = unsubmitted_;
+  unsubmitted_ = 0;
+
+  for (;;) {
+    auto const submitted = syscall(
+        __NR_io_uring_enter,
+        fd_,
+        to_submit,
+        min_completions,
+        min_completions > 0 ? IORING_ENTER_GETEVENTS : 0,
+        nullptr,
+        0);
+    if (submitted >= 0) {
+      to_submit -= static_cast<unsigned int>(submitted);
+      if (to_submit == 0)
+        return true;
+    } else if (errno != EINTR) {
+      LOG(ERROR) << "io_uring_enter() failed: " << strerror(errno);
+      return false;
+    }
+  }
+}
+
+
+bool IoUring::TakeCompletion(Completion* completion) {
+  auto const head = *cq_head_;
+  if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE))
+    return false;
+
+  auto const& cqe = cqes_[head & cq_mask_];
+  completion->user_data = cqe.user_data;
+  completion->result = cqe.res;
+  completion->flags = cqe.flags;
+  __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+
+bool IoUring::RegisterBuffers(iovec const* buffers, unsigned int count) {
+  auto const registered = syscall(__NR_io_uring_register,
+                                  fd_,
+                                  IORING_REGISTER_BUFFERS,
+                                  buffers,
+                                  count) == 0;
+  if (!registered)
+    VLOG(1) << "Failed to register buffers: " << strerror(errno);
+  return registered;
+}
+
+
+bool IoUring::IsAvailable() {
+  static bool const available = []() {
+    IoUring ring{2};
+    if (!ring.IsOpen())
+      return false;
+
+    unsigned int const kMaxOps = 256;
+    std::vector<uint8_t> probe_octets(
+        sizeof(io_uring_probe) + kMaxOps * sizeof(io_uring_probe_op));
+    auto const probe = reinterpret_cast<io_uring_probe*>(&probe_octets[0]);
+    if (syscall(__NR_io_uring_register,
+                ring.fd_,
+                IORING_REGISTER_PROBE,
+                probe,
+                kMaxOps) != 0)
+      return false;
+
+    return std::all_of(
+        std::begin(kRequiredOps),
+        std::end(kRequiredOps),
+        [probe](uint8_t op) {
+          return op <= probe->last_op
+              && (probe->ops[op].flags & IO_URING_OP_SUPPORTED) != 0;
+        });
+  }();
+  return available;
+}
+
+
+void IoUring::Close() {
+  if (sqes_)
+    munmap(sqes_, sqes_size_);
+  if (cq_ring_ && cq_ring_ != sq_ring_)
+    munmap(cq_ring_, cq_ring_size_);
+  if (sq_ring_)
+    munmap(sq_ring_, sq_ring_size_);
+  sqes_ = nullptr;
+  cq_ring_ = sq_ring_ = nullptr;
+  if (fd_ >= 0)
+    close(fd_);
+  fd_ = -1;
+}
+
+
+}  // namespace detail
+}  // namespace net
+}  // namespace pplme
@@ -0,0 +1,124 @@
+/**
+ *  @file
+ *  @brief   Definition of pplme::net::detail::IoUring, a bare-bones wrapper
+ *           of a Linux io_uring (as used by libpplmenet's io_uring
+ *           backend).
+ *  @author  j.ho
+ */
+#ifndef PPLME_LIBPPLMENETDETAIL_IOURING_H_
+#define PPLME_LIBPPLMENETDETAIL_IOURING_H_
+
+
+#include <stdint.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+
+namespace pplme {
+namespace net {
+namespace detail {
+
+
+/**
+ *  Example:
+ *  @code
+ *  IoUring ring{4};
+ *  if (ring.IsOpen()) {
+ *    auto const sqe = ring.GetSubmission();
+ *    sqe->opcode = IORING_OP_RECV;
+ *    sqe->fd = fd;
+ *    sqe->addr = reinterpret_cast<uint64_t>(octets);
+ *    sqe->len = length;
+ *    IoUring::Completion completion;
+ *    if (ring.Submit(1) && ring.TakeCompletion(&completion))
+ *      HandleRecvResult(completion.result);
+ *  }
+ *  @endcode
+ *
+ *  @remarks
+ *  This speaks to the kernel directly (io_uring_setup(2) and friends), so
+ *  there's no liburing to be had, and no more of io_uring than libpplmenet
+ *  needs: submissions are filled in by hand, and Submit() both submits and
+ *  waits, in the one system call.
+ *
+ *  @note
+ *  Instances of this class are not safe to use concurrently.
+ */
+class IoUring {
+ public:
+  /** What became of a submission. */
+  struct Completion {
+    uint64_t user_data;
+    /** As per the equivalent system call, but -errno on failure. */
+    int32_t result;
+    /** IORING_CQE_F_*. */
+    uint32_t flags;
+  };
+
+  /** Set up a ring with room for @a entries submissions at a time (see
+      IsOpen()). */
+  explicit IoUring(unsigned int entries);
+  ~IoUring();
+
+  IoUring(IoUring const&) = delete;
+  IoUring& operator=(IoUring const&) = delete;
+
+  /** @returns  True iff the kernel gave us a ring (which it won't if it's
+                too old, or io_uring is disabled). */
+  bool IsOpen() const;
+
+  /** @returns  The next free submission (zeroed), or null if there isn't
+                one until Submit() is called. */
+  io_uring_sqe* GetSubmission();
+
+  /** Submit everything got since the last call, and then wait until at
+      least @a min_completions have completed.  @returns  False iff the
+      kernel wouldn't have it. */
+  bool Submit(unsigned int min_completions);
+
+  /** Take the next completion, if there is one.  @returns  True iff there
+      was. */
+  bool TakeCompletion(Completion* completion);
+
+  /** Register @a count of @a buffers for the IORING_OP_*_FIXED operations
+      (the first being buf_index 0, and so on).  @returns  True iff they
+      were. */
+  bool RegisterBuffers(iovec const* buffers, unsigned int count);
+
+  /** @returns  True iff this kernel has io_uring, with all of the operations
+                that libpplmenet uses (worked out once, and remembered). */
+  static bool IsAvailable();
+
+ private:
+  int fd_;
+  /** The rings and the submissions, as mapped in from the kernel. */
+  void* sq_ring_;
+  size_t sq_ring_size_;
+  void* cq_ring_;
+  size_t cq_ring_size_;
+  io_uring_sqe* sqes_;
+  size_t sqes_size_;
+  /** Bits of the submission ring. */
+  unsigned int* sq_head_;
+  unsigned int* sq_tail_;
+  unsigned int sq_mask_;
+  unsigned int sq_entries_;
+  unsigned int* sq_array_;
+  /** Bits of the completion ring. */
+  unsigned int* cq_head_;
+  unsigned int* cq_tail_;
+  unsigned int cq_mask_;
+  io_uring_cqe* cqes_;
+  /** Submissions got but not yet submitted. */
+  unsigned int unsubmitted_;
+
+  void Close();
+};
+
+
+}  // namespace detail
+}  // namespace net
+}  // namespace pplme
+
+
+#endif  // PPLME_LIBPPLMENETDETAIL_IOURING_H_
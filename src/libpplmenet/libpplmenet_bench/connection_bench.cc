@@ -0,0 +1,119 @@
+/**
+ *  @file
+ *  @brief   Loopback latency benchmarks for pplme::net::detail::Connection.
+ *  @author  j.ho
+ */
+
+
+#include <string.h>
+#include <thread>
+#include <benchmark/benchmark.h>
+#include <boost/asio.hpp>
+#include "libpplmenet/detail/connection.h"
+#include "libpplmenet/message.h"
+
+
+using batcpip = boost::asio::ip::tcp;
+using pplme::net::Backend;
+using pplme::net::Message;
+using pplme::net::detail::Connection;
+
+
+namespace {
+
+
+/**
+ *  A client Connection talking over loopback to an echo server Connection
+ *  that is serviced by its own thread, both by way of the same backend.  The
+ *  echo server stops when it gets an empty message.
+ */
+class LoopbackEcho {
+ public:
+  explicit LoopbackEcho(Backend backend = Backend::Epoll) {
+    batcpip::acceptor acceptor{
+        io_service_,
+        batcpip::endpoint{boost::asio::ip::address_v4::loopback(), 0}};
+    batcpip::socket client_socket{io_service_};
+    batcpip::socket server_socket{io_service_};
+    client_socket.connect(acceptor.local_endpoint());
+    acceptor.accept(server_socket);
+    client_.reset(new Connection{std::move(client_socket), backend});
+    server_.reset(new Connection{std::move(server_socket), backend});
+
+    echoer_ = std::thread{[this]() {
+        for (;;) {
+          auto message = server_->ReceiveMessage();
+          if (!message || message->GetBodyLength() == 0)
+            break;
+          server_->SendMessage(*message);
+        }
+      }};
+  }
+
+  ~LoopbackEcho() {
+    client_->SendMessage(*CreateMessage(0));
+    echoer_.join();
+  }
+
+  Connection& client() { return *client_; }
+
+  static std::unique_ptr<Message> CreateMessage(uint32_t body_length) {
+    auto body = Message::CreateBodyBuffer(body_length);
+    memset(body.get(), 'p', body_length);
+    return std::unique_ptr<Message>{new Message{std::move(body), body_length}};
+  }
+
+ private:
+  boost::asio::io_service io_service_;
+  std::unique_ptr<Connection> client_;
+  std::unique_ptr<Connection> server_;
+  std::thread echoer_;
+};
+
+
+}  // namespace
+
+
+/** One message out, one message back, one at a time, by way of backend
+    range(1) (as a client would). */
+void BM_RoundTrip(benchmark::State& state) {
+  LoopbackEcho echo{static_cast<Backend>(state.range(1))};
+  auto const request = LoopbackEcho::CreateMessage(state.range(0));
+
+  for (auto _ : state) {
+    auto response = echo.client().SendMessageAndReceive(*request);
+    benchmark::DoNotOptimize(response);
+  }
+
+  state.SetBytesProcessed(2 * state.iterations() * state.range(0));
+}
+BENCHMARK(BM_RoundTrip)->Apply([](benchmark::internal::Benchmark* benchmark) {
+      for (int64_t length : {16, 512, 16 << 10, 256 << 10}) {
+        for (auto backend : {Backend::Epoll, Backend::IoUring})
+          benchmark->Args({length, static_cast<int64_t>(backend)});
+      }
+    })->UseRealTime();
+
+
+/** A burst of messages out, then the burst back; exercises carving multiple
+    messages out of a single read. */
+void BM_PipelinedRoundTrips(benchmark::State& state) {
+  int const kBurst = 16;
+  LoopbackEcho echo;
+  auto const request = LoopbackEcho::CreateMessage(state.range(0));
+
+  for (auto _ : state) {
+    for (int n = 0; n < kBurst; ++n)
+      echo.client().SendMessage(*request);
+    for (int n = 0; n < kBurst; ++n) {
+      auto response = echo.client().ReceiveMessage();
+      benchmark::DoNotOptimize(response);
+    }
+  }
+
+  state.SetItemsProcessed(kBurst * state.iterations());
+}
+BENCHMARK(BM_PipelinedRoundTrips)->Arg(16)->Arg(512)->UseRealTime();
+
+
+BENCHMARK_MAIN();
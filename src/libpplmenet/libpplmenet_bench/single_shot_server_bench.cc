@@ -0,0 +1,90 @@
+/**
+ *  @file
+ *  @brief   Connection-burst throughput benchmarks for
+ *           pplme::net::SingleShotServer (run by connection_bench.cc's
+ *           main).
+ *  @author  j.ho
+ */
+
+
+#include <string.h>
+#include <thread>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include <glog/logging.h>
+#include "libpplmenet/client.h"
+#include "libpplmenet/message.h"
+#include "libpplmenet/single_shot_server.h"
+
+
+using pplme::net::Backend;
+using pplme::net::Client;
+using pplme::net::Message;
+using pplme::net::SingleShotServer;
+
+
+namespace {
+
+
+std::unique_ptr<Message> CreateMessage() {
+  auto body = Message::CreateBodyBuffer(4);
+  memcpy(body.get(), "PING", 4);
+  return std::unique_ptr<Message>{new Message{std::move(body), 4}};
+}
+
+
+std::unique_ptr<Message> EchoRequestHandler(std::string const&,
+                                            unsigned short,
+                                            Message const& request) {
+  auto body = Message::CreateBodyBuffer(request.GetBodyLength());
+  memcpy(body.get(), request.GetBodyOctets(), request.GetBodyLength());
+  return std::unique_ptr<Message>{
+      new Message{std::move(body), request.GetBodyLength()}};
+}
+
+
+}  // namespace
+
+
+/** Bursts of clients, each connecting, sending one request and getting its
+    response, against a server with range(0) acceptors, all by way of
+    backend range(1). */
+void BM_ConnectionBurst(benchmark::State& state) {
+  int const kClientThreads = 8;
+  int const kConnectionsPerThread = 16;
+  auto const backend = static_cast<Backend>(state.range(1));
+  SingleShotServer server{0,
+                          EchoRequestHandler,
+                          false,
+                          static_cast<unsigned int>(state.range(0)),
+                          backend};
+  CHECK(server.Start());
+  auto const port = server.GetLocalPort();
+  auto const request = CreateMessage();
+
+  for (auto _ : state) {
+    std::vector<std::thread> clients;
+    for (int n = 0; n < kClientThreads; ++n) {
+      clients.emplace_back([port, backend, &request]() {
+          for (int c = 0; c < kConnectionsPerThread; ++c) {
+            Client client{"127.0.0.1", port, backend};
+            if (client.Connect())
+              benchmark::DoNotOptimize(client.SendRequest(*request));
+          }
+        });
+    }
+    for (auto& client : clients)
+      client.join();
+  }
+
+  state.SetItemsProcessed(
+      state.iterations() * kClientThreads * kConnectionsPerThread);
+}
+BENCHMARK(BM_ConnectionBurst)
+    ->Apply([](benchmark::internal::Benchmark* benchmark) {
+        for (int64_t acceptors : {1, 2, 4}) {
+          for (auto backend : {Backend::Epoll, Backend::IoUring})
+            benchmark->Args({acceptors, static_cast<int64_t>(backend)});
+        }
+      })
+    ->UseRealTime();
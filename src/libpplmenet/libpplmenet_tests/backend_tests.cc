@@ -0,0 +1,47 @@
+/**
+ *  @file
+ *  @brief   Tests for pplme::net::Backend.
+ *  @author  j.ho
+ */
+
+
+#include <gtest/gtest.h>
+#include "libpplmenet/backend.h"
+
+
+using pplme::net::Backend;
+using pplme::net::GetBackendName;
+using pplme::net::ParseBackend;
+using pplme::net::ResolveBackend;
+
+
+/**
+ *  @test  Every backend should be parsed back from its name.
+ */
+TEST(BackendTest, ParsesNames) {
+  for (auto const backend : {Backend::Epoll, Backend::IoUring}) {
+    // Act.
+    auto const parsed = ParseBackend(GetBackendName(backend));
+
+    // Assert.
+    ASSERT_TRUE(parsed);
+    ASSERT_EQ(backend, *parsed);
+  }
+}
+
+
+/**
+ *  @test  Anything else shouldn't be.
+ */
+TEST(BackendTest, RejectsUnknownNames) {
+  ASSERT_FALSE(ParseBackend("kqueue"));
+  ASSERT_FALSE(ParseBackend(""));
+}
+
+
+/**
+ *  @test  Epoll is always to be had.
+ */
+TEST(BackendTest, ResolvesEpollToItself) {
+  ASSERT_EQ(Backend::Epoll, ResolveBackend(Backend::Epoll));
+}
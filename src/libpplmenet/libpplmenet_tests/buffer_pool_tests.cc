@@ -0,0 +1,111 @@
+/**
+ *  @file
+ *  @brief   Tests for pplme::net::BufferPool.
+ *  @author  j.ho
+ */
+
+
+#include <gtest/gtest.h>
+#include "libpplmenet/buffer_pool.h"
+
+
+using pplme::net::BufferPool;
+
+
+TEST(BufferPoolTest, ReleasedBufferIsReused) {
+  BufferPool pool;
+
+  uint8_t* first_octets;
+  /* scope block */ {
+    auto buffer = pool.Acquire(100);
+    first_octets = buffer.get();
+  }
+  auto buffer = pool.Acquire(100);
+
+  ASSERT_EQ(first_octets, buffer.get());
+  ASSERT_EQ(1U, pool.GetAllocationCount());
+  ASSERT_EQ(1U, pool.GetReuseCount());
+}
+
+
+TEST(BufferPoolTest, SizeClassesAreShared) {
+  BufferPool pool;
+
+  // 65 and 128 both land in the 128 octet class.
+  uint8_t* first_octets;
+  /* scope block */ {
+    auto buffer = pool.Acquire(65);
+    first_octets = buffer.get();
+  }
+  auto buffer = pool.Acquire(128);
+
+  ASSERT_EQ(first_octets, buffer.get());
+}
+
+
+TEST(BufferPoolTest, DifferentSizeClassesAreNotShared) {
+  BufferPool pool;
+
+  /* scope block */ {
+    auto buffer = pool.Acquire(64);
+  }
+  auto buffer = pool.Acquire(65);
+
+  ASSERT_EQ(2U, pool.GetAllocationCount());
+  ASSERT_EQ(0U, pool.GetReuseCount());
+}
+
+
+TEST(BufferPoolTest, SteadyStateDoesNotAllocate) {
+  BufferPool pool;
+
+  for (int n = 0; n < 1000; ++n) {
+    auto request = pool.Acquire(37);
+    auto response = pool.Acquire(BufferPool::kMaxClassSize);
+  }
+
+  ASSERT_EQ(2U, pool.GetAllocationCount());
+}
+
+
+TEST(BufferPoolTest, RecycledOctetsAreReused) {
+  BufferPool pool;
+  auto const octets = pool.Acquire(40).release();
+
+  pool.Recycle(octets, 40);
+  auto buffer = pool.Acquire(33);
+
+  ASSERT_EQ(octets, buffer.get());
+  ASSERT_EQ(1U, pool.GetAllocationCount());
+}
+
+
+TEST(BufferPoolTest, OversizedBuffersAreNotPooled) {
+  BufferPool pool;
+
+  /* scope block */ {
+    auto buffer = pool.Acquire(BufferPool::kMaxClassSize + 1);
+    buffer[BufferPool::kMaxClassSize] = 0xFF;
+  }
+  auto buffer = pool.Acquire(BufferPool::kMaxClassSize + 1);
+
+  ASSERT_EQ(2U, pool.GetAllocationCount());
+}
+
+
+TEST(BufferPoolTest, RetentionIsBounded) {
+  BufferPool pool;
+  auto const kMaxRetained =
+      BufferPool::kMaxRetainedOctetsPerClass / BufferPool::kMaxClassSize;
+
+  /* scope block */ {
+    std::vector<BufferPool::Buffer> buffers;
+    for (unsigned n = 0; n < kMaxRetained + 1; ++n)
+      buffers.push_back(pool.Acquire(BufferPool::kMaxClassSize));
+  }
+  std::vector<BufferPool::Buffer> buffers;
+  for (unsigned n = 0; n < kMaxRetained + 1; ++n)
+    buffers.push_back(pool.Acquire(BufferPool::kMaxClassSize));
+
+  ASSERT_EQ(kMaxRetained, pool.GetReuseCount());
+}
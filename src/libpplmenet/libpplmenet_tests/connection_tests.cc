@@ -0,0 +1,196 @@
+/**
+ *  @file
+ *  @brief   Tests for pplme::net::detail::Connection.
+ *  @author  j.ho
+ */
+
+
+#include <string.h>
+#include <algorithm>
+#include <thread>
+#include <boost/asio.hpp>
+#include <gtest/gtest.h>
+#include "libpplmenet/detail/connection.h"
+#include "libpplmenet/message.h"
+
+
+using batcpip = boost::asio::ip::tcp;
+using pplme::net::Backend;
+using pplme::net::Message;
+using pplme::net::detail::Connection;
+
+
+namespace {
+
+
+/** A pair of Connections that are connected to each other over loopback. */
+struct ConnectionPair {
+  boost::asio::io_service io_service;
+  std::unique_ptr<Connection> client;
+  std::unique_ptr<Connection> server;
+
+  explicit ConnectionPair(Backend backend = Backend::Epoll) {
+    batcpip::acceptor acceptor{
+        io_service,
+        batcpip::endpoint{boost::asio::ip::address_v4::loopback(), 0}};
+    batcpip::socket client_socket{io_service};
+    batcpip::socket server_socket{io_service};
+    client_socket.connect(acceptor.local_endpoint());
+    acceptor.accept(server_socket);
+    client.reset(new Connection{std::move(client_socket), backend});
+    server.reset(new Connection{std::move(server_socket), backend});
+  }
+};
+
+
+std::unique_ptr<Message> CreateMessage(uint32_t body_length, uint8_t fill) {
+  auto body = Message::CreateBodyBuffer(body_length);
+  memset(body.get(), fill, body_length);
+  return std::unique_ptr<Message>{new Message{std::move(body), body_length}};
+}
+
+
+bool IsFilledWith(Message const& message, uint8_t fill) {
+  auto octets = static_cast<uint8_t const*>(message.GetBodyOctets());
+  return std::all_of(octets, octets + message.GetBodyLength(),
+                     [fill](uint8_t octet) { return octet == fill; });
+}
+
+
+}  // namespace
+
+
+TEST(ConnectionTest, ReceivesBackToBackMessagesInOrder) {
+  ConnectionPair connections;
+
+  // These will almost certainly arrive in a single read.
+  for (uint8_t n = 1; n <= 3; ++n)
+    ASSERT_TRUE(connections.client->SendMessage(*CreateMessage(n * 10, n)));
+
+  for (uint8_t n = 1; n <= 3; ++n) {
+    auto message = connections.server->ReceiveMessage();
+    ASSERT_TRUE(message != nullptr);
+    ASSERT_EQ(n * 10U, message->GetBodyLength());
+    ASSERT_TRUE(IsFilledWith(*message, n));
+  }
+}
+
+
+TEST(ConnectionTest, ReceivesEmptyMessage) {
+  ConnectionPair connections;
+
+  ASSERT_TRUE(connections.client->SendMessage(*CreateMessage(0, 0)));
+
+  auto message = connections.server->ReceiveMessage();
+  ASSERT_TRUE(message != nullptr);
+  ASSERT_EQ(0U, message->GetBodyLength());
+}
+
+
+TEST(ConnectionTest, ReceivesMessagesBiggerThanReadBuffer) {
+  ConnectionPair connections;
+  uint32_t const kBigBodyLength = Message::kMaxBodyLength;
+
+  // Sent from another thread since this is going to fill the socket buffers.
+  std::thread sender{[&connections, kBigBodyLength]() {
+      connections.client->SendMessage(*CreateMessage(kBigBodyLength, 0xAB));
+      connections.client->SendMessage(*CreateMessage(7, 0xCD));
+    }};
+
+  auto big_message = connections.server->ReceiveMessage();
+  auto small_message = connections.server->ReceiveMessage();
+  sender.join();
+
+  ASSERT_TRUE(big_message != nullptr);
+  ASSERT_EQ(kBigBodyLength, big_message->GetBodyLength());
+  ASSERT_TRUE(IsFilledWith(*big_message, 0xAB));
+  ASSERT_TRUE(small_message != nullptr);
+  ASSERT_EQ(7U, small_message->GetBodyLength());
+  ASSERT_TRUE(IsFilledWith(*small_message, 0xCD));
+}
+
+
+TEST(ConnectionTest, RejectsMessageThatIsTooBig) {
+  boost::asio::io_service io_service;
+  batcpip::acceptor acceptor{
+      io_service,
+      batcpip::endpoint{boost::asio::ip::address_v4::loopback(), 0}};
+  batcpip::socket client_socket{io_service};
+  batcpip::socket server_socket{io_service};
+  client_socket.connect(acceptor.local_endpoint());
+  acceptor.accept(server_socket);
+  Connection server{std::move(server_socket)};
+
+  // Only the header is needed for the message to be judged.
+  Message::Header const header{Message::kMaxBodyLength + 1};
+  boost::asio::write(client_socket,
+                     boost::asio::buffer(&header, sizeof(header)));
+
+  ASSERT_TRUE(server.ReceiveMessage() == nullptr);
+}
+
+
+/** The same again, but for every backend. */
+class ConnectionBackendTest : public testing::TestWithParam<Backend> {};
+
+
+/**
+ *  @test  Messages too big for the (registered) read buffer should still
+ *         make it across whole, and so should what comes after them.
+ */
+TEST_P(ConnectionBackendTest, ReceivesMessagesBiggerThanReadBuffer) {
+  // Arrange.
+  ConnectionPair connections{GetParam()};
+  uint32_t const kBigBodyLength = Message::kMaxBodyLength;
+
+  // Act.
+  std::thread sender{[&connections, kBigBodyLength]() {
+      connections.client->SendMessage(*CreateMessage(kBigBodyLength, 0xAB));
+      connections.client->SendMessage(*CreateMessage(7, 0xCD));
+    }};
+  auto big_message = connections.server->ReceiveMessage();
+  auto small_message = connections.server->ReceiveMessage();
+  sender.join();
+
+  // Assert.
+  ASSERT_TRUE(big_message != nullptr);
+  ASSERT_EQ(kBigBodyLength, big_message->GetBodyLength());
+  ASSERT_TRUE(IsFilledWith(*big_message, 0xAB));
+  ASSERT_TRUE(small_message != nullptr);
+  ASSERT_EQ(7U, small_message->GetBodyLength());
+  ASSERT_TRUE(IsFilledWith(*small_message, 0xCD));
+}
+
+
+/**
+ *  @test  SendMessageAndReceive() should get the response to what it sent,
+ *         and not lose any that came along with it.
+ */
+TEST_P(ConnectionBackendTest, SendMessageAndReceiveGetsTheResponses) {
+  // Arrange.
+  ConnectionPair connections{GetParam()};
+  std::thread responder{[&connections]() {
+      auto request = connections.server->ReceiveMessage();
+      connections.server->SendMessage(*CreateMessage(10, 1));
+      connections.server->SendMessage(*CreateMessage(20, 2));
+    }};
+
+  // Act.
+  auto first = connections.client->SendMessageAndReceive(
+      *CreateMessage(5, 0));
+  auto second = connections.client->ReceiveMessage();
+  responder.join();
+
+  // Assert.
+  ASSERT_TRUE(first != nullptr);
+  ASSERT_EQ(10U, first->GetBodyLength());
+  ASSERT_TRUE(IsFilledWith(*first, 1));
+  ASSERT_TRUE(second != nullptr);
+  ASSERT_EQ(20U, second->GetBodyLength());
+  ASSERT_TRUE(IsFilledWith(*second, 2));
+}
+
+
+INSTANTIATE_TEST_CASE_P(Backends,
+                        ConnectionBackendTest,
+                        testing::Values(Backend::Epoll, Backend::IoUring));
@@ -5,12 +5,18 @@
  */
 
 
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
 #include <gtest/gtest.h>
 #include "libpplmenet/client.h"
 #include "libpplmenet/message.h"
 #include "libpplmenet/single_shot_server.h"
+#include "libpplmeutils/bench/allocation_counter.h"
 
 
+using pplme::net::Backend;
 using pplme::net::Client;
 using pplme::net::SingleShotServer;
 
@@ -39,17 +45,304 @@ std::unique_ptr<pplme::net::Message> PingPongRequestHandler(
 }
 
 
+/** Handles requests like PingPongRequestHandler, once @a go is set off
+    (having said as much by way of @a started). */
+pplme::net::SingleShotServer::RequestHandler CreateHeldUpRequestHandler(
+    std::promise<void>* started,
+    std::shared_future<void> go) {
+  return [started, go](std::string const& address,
+                       unsigned short port,
+                       pplme::net::Message const& request) {
+    started->set_value();
+    go.wait();
+    return PingPongRequestHandler(address, port, request);
+  };
+}
+
+
 }  // namespace
 
 
-TEST(libpplmenetTest, RequestResponseCycle)
+/** Everything here goes for every backend (though io_uring may well turn
+    out to be epoll, in which case it's tested twice). */
+class libpplmenetTest : public testing::TestWithParam<Backend> {};
+
+
+TEST_P(libpplmenetTest, RequestResponseCycle)
 {
-  SingleShotServer server{0, PingPongRequestHandler};
+  SingleShotServer server{0, PingPongRequestHandler, false, 1, GetParam()};
   server.Start();
 
-  Client client{"127.0.0.1", server.GetLocalPort()};
+  Client client{"127.0.0.1", server.GetLocalPort(), GetParam()};
   client.Connect();
   auto response = client.SendRequest(*CreatePxng('I'));
 
   ASSERT_EQ(0, memcmp(response->GetBodyOctets(), "PONG", 4));
 }
+
+
+/**
+ *  @test  A kept-alive connection should be good for any number of requests.
+ */
+TEST_P(libpplmenetTest, KeepAliveServesManyRequestsPerConnection)
+{
+  // Arrange.
+  SingleShotServer server{0, PingPongRequestHandler, true, 1, GetParam()};
+  server.Start();
+  Client client{"127.0.0.1", server.GetLocalPort(), GetParam()};
+  client.Connect();
+
+  for (int n = 0; n < 3; ++n) {
+    // Act.
+    auto response = client.SendRequest(*CreatePxng('I'));
+
+    // Assert.
+    ASSERT_TRUE(response != nullptr);
+    ASSERT_EQ(0, memcmp(response->GetBodyOctets(), "PONG", 4));
+  }
+}
+
+
+/**
+ *  @test  Once a kept-alive connection has warmed up, a round trip (client
+ *         and server both) shouldn't allocate anything at all.
+ */
+TEST_P(libpplmenetTest, SteadyStateRoundTripsDontAllocate)
+{
+  // Arrange.
+  SingleShotServer server{0, PingPongRequestHandler, true, 1, GetParam()};
+  server.Start();
+  Client client{"127.0.0.1", server.GetLocalPort(), GetParam()};
+  client.Connect();
+  for (int n = 0; n < 100; ++n)
+    ASSERT_TRUE(client.SendRequest(*CreatePxng('I')) != nullptr);
+
+  // Act.
+  auto const allocations_before = pplme::utils::bench::GetAllocationCount();
+  int bad_responses = 0;
+  for (int n = 0; n < 1000; ++n) {
+    auto response = client.SendRequest(*CreatePxng('I'));
+    if (!response || memcmp(response->GetBodyOctets(), "PONG", 4) != 0)
+      ++bad_responses;
+  }
+  auto const allocations_after = pplme::utils::bench::GetAllocationCount();
+
+  // Assert.
+  ASSERT_EQ(0, bad_responses);
+  ASSERT_EQ(allocations_before, allocations_after);
+}
+
+
+/**
+ *  @test  Without keep-alive, a connection should be good for one request
+ *         only (it is a SingleShotServer, after all).
+ */
+TEST_P(libpplmenetTest, WithoutKeepAliveConnectionIsClosedAfterResponse)
+{
+  // Arrange.
+  SingleShotServer server{0, PingPongRequestHandler, false, 1, GetParam()};
+  server.Start();
+  Client client{"127.0.0.1", server.GetLocalPort(), GetParam()};
+  client.Connect();
+  ASSERT_TRUE(client.SendRequest(*CreatePxng('I')) != nullptr);
+
+  // Act.
+  auto response = client.SendRequest(*CreatePxng('I'));
+
+  // Assert.
+  ASSERT_TRUE(response == nullptr);
+}
+
+
+/**
+ *  @test  Shutting down shouldn't wait forever on a kept-alive client that
+ *         has nothing more to say.
+ */
+TEST_P(libpplmenetTest, ShutdownHangsUpOnIdleKeptAliveConnections)
+{
+  // Arrange.
+  SingleShotServer server{0, PingPongRequestHandler, true, 1, GetParam()};
+  server.Start();
+  Client client{"127.0.0.1", server.GetLocalPort(), GetParam()};
+  client.Connect();
+  ASSERT_TRUE(client.SendRequest(*CreatePxng('I')) != nullptr);
+
+  // Act.
+  server.Shutdown();
+
+  // Assert.
+  ASSERT_TRUE(client.SendRequest(*CreatePxng('I')) == nullptr);
+}
+
+
+/**
+ *  @test  Whichever of a server's acceptors gets a connection, it should be
+ *         served the same.
+ */
+TEST_P(libpplmenetTest, ManyAcceptorsServeConnectionsOnOnePort)
+{
+  // Arrange.
+  int const kClients = 32;
+  SingleShotServer server{0, PingPongRequestHandler, false, 4, GetParam()};
+  ASSERT_TRUE(server.Start());
+
+  for (int n = 0; n < kClients; ++n) {
+    Client client{"127.0.0.1", server.GetLocalPort(), GetParam()};
+    ASSERT_TRUE(client.Connect());
+
+    // Act.
+    auto response = client.SendRequest(*CreatePxng('I'));
+
+    // Assert.
+    ASSERT_TRUE(response != nullptr);
+    ASSERT_EQ(0, memcmp(response->GetBodyOctets(), "PONG", 4));
+  }
+}
+
+
+/**
+ *  @test  Draining should turn away new connections, but see the request
+ *         that is under way answered.
+ */
+TEST_P(libpplmenetTest, DrainAnswersRequestsInFlightButNoMore)
+{
+  // Arrange.
+  std::promise<void> started;
+  std::promise<void> go;
+  SingleShotServer server{
+      0,
+      CreateHeldUpRequestHandler(&started, go.get_future().share()),
+      false,
+      1,
+      GetParam()};
+  server.Start();
+  auto const port = server.GetLocalPort();
+  Client client{"127.0.0.1", port, GetParam()};
+  client.Connect();
+  auto response = std::async(std::launch::async, [&client]() {
+      return client.SendRequest(*CreatePxng('I'));
+    });
+  started.get_future().wait();
+
+  // Act.
+  auto drain = std::async(std::launch::async, [&server]() {
+      return server.Drain(std::chrono::seconds{10});
+    });
+  std::this_thread::sleep_for(std::chrono::milliseconds{50});
+  Client latecomer{"127.0.0.1", port, GetParam()};
+  auto const latecomer_connected = latecomer.Connect();
+  go.set_value();
+
+  // Assert.
+  ASSERT_TRUE(drain.get());
+  auto const pong = response.get();
+  ASSERT_TRUE(pong != nullptr);
+  ASSERT_EQ(0, memcmp(pong->GetBodyOctets(), "PONG", 4));
+  ASSERT_FALSE(latecomer_connected);
+}
+
+
+/**
+ *  @test  Draining shouldn't wait on a request for longer than it's allowed
+ *         to.
+ */
+TEST_P(libpplmenetTest, DrainGivesUpWhenItsBudgetRunsOut)
+{
+  // Arrange.
+  std::promise<void> started;
+  std::promise<void> go;
+  SingleShotServer server{
+      0,
+      CreateHeldUpRequestHandler(&started, go.get_future().share()),
+      false,
+      1,
+      GetParam()};
+  server.Start();
+  Client client{"127.0.0.1", server.GetLocalPort(), GetParam()};
+  client.Connect();
+  auto response = std::async(std::launch::async, [&client]() {
+      return client.SendRequest(*CreatePxng('I'));
+    });
+  started.get_future().wait();
+
+  // Act.
+  auto const drained = server.Drain(std::chrono::milliseconds{50});
+  go.set_value();
+
+  // Assert.
+  ASSERT_FALSE(drained);
+  ASSERT_TRUE(response.get() != nullptr);
+}
+
+
+/**
+ *  @test  Hanging up should see a request under way on another thread give
+ *         up, rather than wait on a server that's taking its time.
+ */
+TEST_P(libpplmenetTest, HangupGivesUpOnRequestUnderWay)
+{
+  // Arrange.
+  std::promise<void> started;
+  std::promise<void> go;
+  SingleShotServer server{
+      0,
+      CreateHeldUpRequestHandler(&started, go.get_future().share()),
+      false,
+      1,
+      GetParam()};
+  server.Start();
+  Client client{"127.0.0.1", server.GetLocalPort(), GetParam()};
+  client.Connect();
+  auto response = std::async(std::launch::async, [&client]() {
+      return client.SendRequest(*CreatePxng('I'));
+    });
+  started.get_future().wait();
+
+  // Act.
+  client.Hangup();
+  auto const status = response.wait_for(std::chrono::seconds{10});
+  go.set_value();
+
+  // Assert.
+  ASSERT_EQ(std::future_status::ready, status);
+  ASSERT_TRUE(response.get() == nullptr);
+}
+
+
+/**
+ *  @test  Connections that turn up while a server is draining should be
+ *         turned away (rather than the server falling over on them).
+ */
+TEST_P(libpplmenetTest, DrainTurnsAwayConnectionsThatTurnUpMeanwhile)
+{
+  int const kRounds = 20;
+  for (int round = 0; round < kRounds; ++round) {
+    // Arrange.
+    SingleShotServer server{0, PingPongRequestHandler, false, 2, GetParam()};
+    ASSERT_TRUE(server.Start());
+    auto const port = server.GetLocalPort();
+    std::atomic<bool> drained{false};
+    auto const backend = GetParam();
+    std::thread latecomers{[port, backend, &drained]() {
+        while (!drained) {
+          Client client{"127.0.0.1", port, backend};
+          if (client.Connect())
+            client.SendRequest(*CreatePxng('I'));
+        }
+      }};
+    std::this_thread::sleep_for(std::chrono::milliseconds{5});
+
+    // Act.
+    auto const drain_completed = server.Drain(std::chrono::seconds{10});
+    drained = true;
+    latecomers.join();
+
+    // Assert.
+    ASSERT_TRUE(drain_completed);
+  }
+}
+
+
+INSTANTIATE_TEST_CASE_P(Backends,
+                        libpplmenetTest,
+                        testing::Values(Backend::Epoll, Backend::IoUring));
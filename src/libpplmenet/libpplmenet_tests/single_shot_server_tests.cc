@@ -20,3 +20,22 @@ TEST(SingleShotServerTest, TestPortInUse) {
       {server1.GetLocalPort(), SingleShotServer::RequestHandler{}};
   ASSERT_FALSE(server2.Start());
 }
+
+
+/**
+ *  @test  Acceptors sharing a port amongst themselves shouldn't share it
+ *         with anyone else.
+ */
+TEST(SingleShotServerTest, TestPortInUseWithManyAcceptors) {
+  // Arrange.
+  SingleShotServer server1{0, SingleShotServer::RequestHandler{}, false, 4};
+  ASSERT_TRUE(server1.Start());
+
+  // Act.
+  SingleShotServer server2
+      {server1.GetLocalPort(), SingleShotServer::RequestHandler{}};
+  auto const started = server2.Start();
+
+  // Assert.
+  ASSERT_FALSE(started);
+}
@@ -10,7 +10,9 @@
 
 #include <limits.h>
 #include <arpa/inet.h>
+#include <cstddef>
 #include <memory>
+#include "buffer_pool.h"
 
 
 namespace pplme {
@@ -60,10 +62,10 @@ class Message {
    */
   static uint32_t const kMaxBodyLength = 1048576;
 
-  Message(Header header, std::unique_ptr<uint8_t[]> body) :
+  Message(Header header, BufferPool::Buffer body) :
       header_{header},
       body_{std::move(body)} {}
-  Message(std::unique_ptr<uint8_t[]> body, uint32_t body_length) :
+  Message(BufferPool::Buffer body, uint32_t body_length) :
       Message{Header{body_length}, std::move(body)} {}
 
   /**
@@ -75,19 +77,35 @@ class Message {
   Message& operator=(Message const&) = delete;
   /** @} */
 
-  /** Simple buffer factory function, mostly because we don't have
-      std::make_unique yet. */
-  static std::unique_ptr<uint8_t[]> CreateBodyBuffer(uint32_t body_length) {
-    return std::unique_ptr<uint8_t[]>{new uint8_t[body_length]};
+  /** Simple buffer factory function.  The buffer comes from (and, once the
+      Message that ends up owning it is destroyed, goes back to) the default
+      BufferPool, so serializing straight into it costs no allocation once
+      the pool has warmed up. */
+  static BufferPool::Buffer CreateBodyBuffer(uint32_t body_length) {
+    return BufferPool::GetDefault().Acquire(body_length);
   }
 
+  /**
+   *  Messages themselves come from (and go back to) the default BufferPool
+   *  too, so that the steady state of a connection (a request in, a
+   *  response out, and so on) costs no allocation whatsoever.
+   *  @{
+   */
+  static void* operator new(std::size_t size) {
+    return BufferPool::GetDefault().Acquire(size).release();
+  }
+  static void operator delete(void* octets, std::size_t size) {
+    BufferPool::GetDefault().Recycle(static_cast<uint8_t*>(octets), size);
+  }
+  /** @} */
+
   Header const& GetHeader() const { return header_; }
   void const* GetBodyOctets() const { return body_.get(); }
   uint32_t GetBodyLength() const { return header_.GetBodyLength(); }
   
  private:
   Header header_;
-  std::unique_ptr<uint8_t[]> body_;
+  BufferPool::Buffer body_;
 };
 
 
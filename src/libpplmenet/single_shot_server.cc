@@ -6,16 +6,36 @@
 
 
 #include "single_shot_server.h"
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <condition_variable>
+#include <future>
 #include <mutex>
 #include <thread>
+#include <vector>
 #include <boost/asio.hpp>
 #include <glog/logging.h>
 #include "message.h"
 #include "detail/connection.h"
+#include "detail/io_uring.h"
 
 
 using batcpip = boost::asio::ip::tcp;
 using boost::system::error_code;
+using pplme::net::detail::IoUring;
+
+
+namespace {
+
+
+/** Accepts (or, at a pinch, a completion or two more) at a time. */
+unsigned int const kAcceptRingEntries = 4;
+
+
+}  // namespace
 
 
 namespace pplme {
@@ -25,15 +45,36 @@ namespace net {
 /**
  *  This implementation is kinda simple in that it uses a
  *  one-thread-per-connection model.  This obviously doesn't scale well, but
- *  is surely good enough for the humble purposes of pplMe.
+ *  is surely good enough for the humble purposes of pplMe.  (Keeping
+ *  connections alive makes that a thread per client rather than per request,
+ *  which is better or worse depending on how chatty the clients are.)
+ *
+ *  With more than one acceptor, each has a listening socket of its own (all
+ *  bound to the same port, by way of SO_REUSEPORT) and an I/O thread of its
+ *  own, and the kernel shares incoming connections out amongst them, so
+ *  that a burst of connections isn't accepted one at a time by the one
+ *  thread.
+ *
+ *  With the IoUring backend, each acceptor's thread accepts by way of an
+ *  io_uring (one multishot accept doing for every connection) rather than
+ *  running its io_service, though that still owns the sockets.
  */
 class SingleShotServer::Impl {
  public:
-  explicit Impl(unsigned short port, RequestHandler request_handler) :
+  Impl(unsigned short port,
+       RequestHandler request_handler,
+       bool keep_alive,
+       unsigned int acceptors,
+       Backend backend) :
       request_handler_{request_handler},
-      io_service_token_work_{io_service_},
+      keep_alive_{keep_alive},
+      backend_{ResolveBackend(backend)},
       endpoint_{batcpip::v4(), port},
-      acceptor_{io_service_} {}
+      draining_{false} {
+    CHECK_GT(acceptors, 0U);
+    for (unsigned int n = 0; n < acceptors; ++n)
+      listeners_.emplace_back(new Listener);
+  }
 
 
   ~Impl() {
@@ -43,27 +84,49 @@ class SingleShotServer::Impl {
   
   bool Start() {
     error_code error;
-    acceptor_.open(endpoint_.protocol(), error);
-    if (!error)
-      acceptor_.bind(endpoint_, error);
-    if (!error)
-      acceptor_.listen(boost::asio::socket_base::max_connections, error);
-    if (error) {
-      LOG(ERROR) << "Failed to initialize a local listening socket: "
-                 << error << ": " << error.message();
+    auto endpoint = endpoint_;
+    for (auto const& listener : listeners_) {
+      auto& acceptor = listener->acceptor;
+      acceptor.open(endpoint.protocol(), error);
+      // (Only when asked to, lest we share a port with a stranger.)
+      if (!error && listeners_.size() > 1)
+        acceptor.set_option(ReusePort{true}, error);
+      if (!error)
+        acceptor.bind(endpoint, error);
+      if (!error)
+        acceptor.listen(boost::asio::socket_base::max_connections, error);
+      if (error) {
+        LOG(ERROR) << "Failed to initialize a local listening socket: "
+                   << error << ": " << error.message();
+        break;
+      }
+      // If the port was 0, then the rest go wherever the first ended up.
+      endpoint = acceptor.local_endpoint();
     }
 
     bool success = !error;
     if (success) {
       LOG(INFO) << "SingleShotServer is listening for connections on "
-                << endpoint_;
+                << endpoint << " (with " << listeners_.size()
+                << " acceptor(s), by way of " << GetBackendName(backend_)
+                << ")";
     }
  
     try {
-      if (success)
-        io_thread_ = std::thread([this]() { GoIoServiceGo(); });
+      for (auto const& listener : listeners_) {
+        if (!success)
+          break;
+        auto const raw_listener = listener.get();
+        listener->io_thread = std::thread([this, raw_listener]() {
+            if (backend_ == Backend::IoUring)
+              AcceptWithIoUring(raw_listener);
+            else
+              GoIoServiceGo(&raw_listener->io_service);
+          });
+      }
     } catch (std::system_error const& error) {
       success = false;
+      StopIoThreads();
     }
 
     if (success) {
@@ -71,8 +134,11 @@ class SingleShotServer::Impl {
       connection_threads_ =
           std::make_unique<std::map<std::thread::id, std::thread>>();
 
-      // Kick off the first accept (which is asynchronously "recursive").
-      KickOffAccept();
+      // Kick off the first accepts (which are asynchronously "recursive").
+      for (auto const& listener : listeners_) {
+        if (backend_ == Backend::Epoll)
+          KickOffAccept(listener.get());
+      }
     }
 
     return success;
@@ -80,7 +146,7 @@ class SingleShotServer::Impl {
 
 
   unsigned short GetLocalPort() const {
-    return acceptor_.local_endpoint().port();
+    return listeners_.front()->acceptor.local_endpoint().port();
   }
   
   
@@ -91,6 +157,11 @@ class SingleShotServer::Impl {
     /* lock block */ {
       std::unique_lock<std::mutex> lock(connection_threads_lock_);
       threads = std::move(connection_threads_);
+      // Otherwise, we'd be waiting on clients that have nothing to say.
+      for (auto const& serviced : serviced_connections_) {
+        if (serviced.second.state != ServicedConnection::State::Busy)
+          serviced.second.connection->Shutdown();
+      }
     }
 
     if (threads) {
@@ -99,38 +170,131 @@ class SingleShotServer::Impl {
       for (auto& thread : *threads)
         thread.second.join();
 
-      io_service_.stop();
-      io_thread_.join();
+      StopIoThreads();
 
       LOG(INFO) << "Shutdown of SingleShotServer is complete.";
     }
   }
 
+
+  bool Drain(std::chrono::milliseconds budget) {
+    /* lock block */ {
+      std::unique_lock<std::mutex> lock(connection_threads_lock_);
+      if (!connection_threads_)
+        return true;
+      if (!draining_) {
+        LOG(INFO) << "Draining SingleShotServer ...";
+        draining_ = true;
+        // Kept-alive clients between requests have nothing in flight, so
+        // there's no call to wait on them (whereas new connections are owed
+        // an answer to their first request).
+        for (auto const& serviced : serviced_connections_) {
+          if (serviced.second.state
+              == ServicedConnection::State::AwaitingNext)
+            serviced.second.connection->Shutdown();
+        }
+      }
+    }
+
+    // Each acceptor is its I/O thread's, so it's closed there (or, if
+    // accepting by way of io_uring, once the thread is done), and it's as
+    // well to know that they all have been before telling anyone so.
+    if (backend_ == Backend::IoUring) {
+      StopIoThreads();
+      for (auto const& listener : listeners_) {
+        error_code error;
+        listener->acceptor.close(error);
+      }
+    }
+    else {
+      for (auto const& listener : listeners_) {
+        std::promise<void> closed;
+        auto const acceptor = &listener->acceptor;
+        listener->io_service.post([acceptor, &closed]() {
+            error_code error;
+            acceptor->close(error);
+            closed.set_value();
+          });
+        closed.get_future().wait();
+      }
+    }
+
+    std::unique_lock<std::mutex> lock(connection_threads_lock_);
+    auto const drained = connection_threads_drained_.wait_for(
+        lock,
+        budget,
+        [this]() {
+          return !connection_threads_ || connection_threads_->empty();
+        });
+    if (drained)
+      LOG(INFO) << "Drain of SingleShotServer is complete.";
+    else {
+      LOG(WARNING) << "Drain of SingleShotServer ran out of time with "
+                   << connection_threads_->size() << " connection(s) to go";
+    }
+    return drained;
+  }
+
   
  private:
   /** The object that handles a client's request. */
   RequestHandler request_handler_;
-  /** The ASIO io_service used to process this connection. */
-  boost::asio::io_service io_service_;
-  /** Token work to keep io_service_ busy. */
-  boost::asio::io_service::work io_service_token_work_;
-  /** The thread that spins work for io_service_. */
-  std::thread io_thread_;
-  /** The server's local listening endpoint. */
+  /** Whether to carry on servicing a connection after its first request. */
+  bool keep_alive_;
+  /** How we accept connections and do their I/O. */
+  Backend backend_;
+  typedef boost::asio::detail::socket_option::boolean<SOL_SOCKET,
+                                                      SO_REUSEPORT>
+      ReusePort;
+  /** A listening socket, and the I/O loop that accepts connections on it. */
+  struct Listener {
+    Listener() :
+        io_service_token_work{io_service},
+        acceptor{io_service},
+        stopping{false} {}
+
+    /** The ASIO io_service used to process this listener's connections. */
+    boost::asio::io_service io_service;
+    /** Token work to keep io_service busy. */
+    boost::asio::io_service::work io_service_token_work;
+    /** The thread that spins work for io_service. */
+    std::thread io_thread;
+    /** The ASIO magic responsible for processing client connections. */
+    batcpip::acceptor acceptor;
+    /** Whether io_thread is to stop accepting by way of io_uring. */
+    std::atomic<bool> stopping;
+  };
+  /** The server's local listening endpoint (as asked for). */
   batcpip::endpoint endpoint_;
-  /** The ASIO magic responsible for processing client connections. */
-  batcpip::acceptor acceptor_;
+  /** One per acceptor. */
+  std::vector<std::unique_ptr<Listener>> listeners_;
   /** Lock for messing with connection_threads_. */
   std::mutex connection_threads_lock_;
   /** This is used for keeping track of all the active connection threads.
       If it is non-owning, then either we haven't been Start()ed, or we've
       already been Shutdown(). */
   std::unique_ptr<std::map<std::thread::id, std::thread>> connection_threads_;
+  /** A connection being serviced, and whether it's waiting on a request. */
+  struct ServicedConnection {
+    enum class State { AwaitingFirst, AwaitingNext, Busy };
+
+    std::shared_ptr<detail::Connection> connection;
+    State state;
+  };
+  /** The connections (by thread) being serviced (also guarded by
+      connection_threads_lock_).  Each is registered the once, rather than
+      per request, so that the steady state costs no allocation. */
+  std::map<std::thread::id, ServicedConnection> serviced_connections_;
+  /** Whether we've stopped accepting connections, and are seeing out those
+      that we have (also guarded by connection_threads_lock_). */
+  bool draining_;
+  /** Signalled whenever a connection thread is done, for Drain(). */
+  std::condition_variable connection_threads_drained_;
 
   
-  void GoIoServiceGo() {
+  void GoIoServiceGo(boost::asio::io_service* io_service) {
     boost::system::error_code error;
-    io_service_.run(error);
+    io_service->run(error);
     if (error) {
       LOG(ERROR) << "SingleShotServer I/O loop stopped unexpectedly: "
                  << error << ": " << error.message();
@@ -138,15 +302,86 @@ class SingleShotServer::Impl {
   }
 
 
-  void KickOffAccept() {
+  void StopIoThreads() {
+    for (auto const& listener : listeners_) {
+      listener->io_service.stop();
+      // A listening socket that's shut down fails the accept that's waiting
+      // on it (and refuses any more connections).
+      listener->stopping = true;
+      if (backend_ == Backend::IoUring && listener->acceptor.is_open())
+        shutdown(listener->acceptor.native_handle(), SHUT_RDWR);
+      if (listener->io_thread.joinable())
+        listener->io_thread.join();
+    }
+  }
+
+
+  /** Accept connections on @a listener until it's stopping, by way of
+      io_uring (or by way of its io_service, if there's no io_uring to be
+      had after all). */
+  void AcceptWithIoUring(Listener* listener) {
+    IoUring ring{kAcceptRingEntries};
+    if (!ring.IsOpen()) {
+      LOG(WARNING) << "Failed to set up io_uring for accepting; falling "
+                      "back to epoll";
+      KickOffAccept(listener);
+      GoIoServiceGo(&listener->io_service);
+      return;
+    }
+
+    // Kernels before 5.19 don't do multishot accepts, so it's one accept
+    // per connection for them.
+    auto multishot = true;
+    auto armed = false;
+    while (!listener->stopping) {
+      if (!armed) {
+        // Only the one accept is ever submitted at once, so there's room.
+        auto const sqe = CHECK_NOTNULL(ring.GetSubmission());
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = listener->acceptor.native_handle();
+        sqe->ioprio = multishot ? IORING_ACCEPT_MULTISHOT : 0;
+        sqe->accept_flags = SOCK_CLOEXEC;
+        armed = true;
+      }
+      if (!ring.Submit(1))
+        break;
+
+      IoUring::Completion completion;
+      while (ring.TakeCompletion(&completion)) {
+        if (!(completion.flags & IORING_CQE_F_MORE))
+          armed = false;
+        if (completion.result >= 0) {
+          auto socket =
+              std::make_shared<batcpip::socket>(listener->io_service);
+          error_code error;
+          socket->assign(batcpip::v4(), completion.result, error);
+          if (error)
+            close(completion.result);
+          HandleAcceptResult(socket, error);
+        } else if (listener->stopping) {
+          break;
+        } else if (completion.result == -EINVAL && multishot) {
+          multishot = false;
+        } else {
+          LOG(ERROR) << "Accept error: " << strerror(-completion.result);
+        }
+      }
+    }
+  }
+
+
+  void KickOffAccept(Listener* listener) {
     // Ideally this would be std::make_unique'd, but due to the fact that
     // the handler function object may be copied, that doesn't work.
-    auto socket = std::make_shared<batcpip::socket>(io_service_);
-    acceptor_.async_accept(
+    auto socket = std::make_shared<batcpip::socket>(listener->io_service);
+    listener->acceptor.async_accept(
         *socket,
-        [this, socket](boost::system::error_code const& error) {
+        [this, listener, socket](boost::system::error_code const& error) {
+          // (Drain() closed the acceptor, so that's the last of them.)
+          if (error == boost::asio::error::operation_aborted)
+            return;
           HandleAcceptResult(socket, error);
-          KickOffAccept();
+          KickOffAccept(listener);
         });
   }     
 
@@ -155,68 +390,134 @@ class SingleShotServer::Impl {
                           error_code const& error) {
     if (!error) {
       auto connection =
-          std::make_shared<detail::Connection>(std::move(*socket));
+          std::make_shared<detail::Connection>(std::move(*socket), backend_);
 
       std::unique_lock<std::mutex> lock(connection_threads_lock_);
-      if (connection_threads_) {
+      if (connection_threads_ && !draining_) {
+        // (Moved, so that Service() holds the thread's one and only
+        // reference, and can let go of it before it lets go of itself.)
         std::thread connection_thread{
-            [this, connection]() { Service(connection); }};
+            [this, connection]() mutable {
+              Service(std::move(connection));
+            }};
         connection_threads_->emplace(connection_thread.get_id(),
                                       std::move(connection_thread));
       } else {
         LOG(WARNING) << "Not processing connection from "
-                     << socket->remote_endpoint()
-                     << " due to SingleShotServer shutting down";
+                     << connection->GetPeerEndpoint()
+                     << " due to SingleShotServer shutting down (or "
+                     << "draining)";
       }
     } else
       LOG(ERROR) << "Accept error: " << error << ": " << error.message();
   }
 
   
+  /** Wait for the next (or @a first) request on @a serviced, during which
+      time Shutdown() (or, unless it's the first, Drain()) is free to hang up
+      on it. */
+  std::unique_ptr<Message> ReceiveRequest(ServicedConnection* serviced,
+                                          bool first) {
+    /* lock block */ {
+      std::unique_lock<std::mutex> lock(connection_threads_lock_);
+      if (!connection_threads_ || (draining_ && !first))
+        return nullptr;
+      serviced->state = first ?
+          ServicedConnection::State::AwaitingFirst :
+          ServicedConnection::State::AwaitingNext;
+    }
+
+    auto request = serviced->connection->ReceiveMessage();
+
+    /* lock block */ {
+      std::unique_lock<std::mutex> lock(connection_threads_lock_);
+      serviced->state = ServicedConnection::State::Busy;
+    }
+
+    return request;
+  }
+
+
   void Service(std::shared_ptr<detail::Connection> connection) 
   {
     LOG(INFO) << "Connection from " << connection->GetPeerEndpoint();
 
-    // First, we try to receive a message....
-    auto request = connection->ReceiveMessage();
-    if (request) {
-      auto response = request_handler_(
-          connection->GetPeerEndpoint().address().to_string(),
-          connection->GetPeerEndpoint().port(),
-          *request);
-      if (response) {
-        // ...then we send our response.
-        if (!connection->SendMessage(*response)) {
-          LOG(INFO) << "Failed to send response to "
+    // (The same for every request, so there's no call to work them out (or
+    // allocate them) more than the once.)
+    auto const peer_address =
+        connection->GetPeerEndpoint().address().to_string();
+    auto const peer_port = connection->GetPeerEndpoint().port();
+
+    ServicedConnection* serviced;
+    /* lock block */ {
+      std::unique_lock<std::mutex> lock(connection_threads_lock_);
+      serviced = &serviced_connections_.emplace(
+          std::this_thread::get_id(),
+          ServicedConnection{connection,
+                             ServicedConnection::State::Busy}).first->second;
+    }
+
+    for (bool first = true; ; first = false) {
+      // First, we try to receive a message....
+      auto request = ReceiveRequest(serviced, first);
+      if (!request) {
+        // (After the first, the client is entitled to hang up whenever.)
+        if (first) {
+          LOG(INFO) << "Failed to receive request from "
                     << connection->GetPeerEndpoint();
         }
+        break;
+      }
+
+      auto response = request_handler_(peer_address, peer_port, *request);
+      if (!response)
+        break;
+
+      // ...then we send our response.
+      if (!connection->SendMessage(*response)) {
+        LOG(INFO) << "Failed to send response to "
+                  << connection->GetPeerEndpoint();
+        break;
       }
-    }     else {
-      LOG(INFO) << "Failed to receive request from "
-                << connection->GetPeerEndpoint();
+
+      if (!keep_alive_)
+        break;
     }
 
     // Heheh.  But more seriously, we need to do this so that this thread
     // no-longer owns anything because once we remove it from the collection
     // of connection threads, we need to be certain that it can't touch
     // anything that may very well be about to be destroyed.
+    /* lock block */ {
+      std::unique_lock<std::mutex> lock(connection_threads_lock_);
+      serviced_connections_.erase(std::this_thread::get_id());
+    }
     connection.reset();
 
     std::thread me;
     /* lock block */ {
       std::unique_lock<std::mutex> lock(connection_threads_lock_);
-      auto my_entry = connection_threads_->find(std::this_thread::get_id());
-      me = std::move(my_entry->second);
-      connection_threads_->erase(my_entry);
+      // If we're shutting down, then Shutdown() has already taken ownership
+      // of us (and is waiting to join us).
+      if (connection_threads_) {
+        auto my_entry = connection_threads_->find(std::this_thread::get_id());
+        me = std::move(my_entry->second);
+        connection_threads_->erase(my_entry);
+      }
     }
-    me.detach();
+    connection_threads_drained_.notify_all();
+    if (me.joinable())
+      me.detach();
   }
 };
 
 
 SingleShotServer::SingleShotServer(unsigned short port,
-                                   RequestHandler request_handler) :
-    impl_{new Impl{port, request_handler}} {}
+                                   RequestHandler request_handler,
+                                   bool keep_alive,
+                                   unsigned int acceptors,
+                                   Backend backend) :
+    impl_{new Impl{port, request_handler, keep_alive, acceptors, backend}} {}
 
 
 SingleShotServer::~SingleShotServer() = default;
@@ -237,5 +538,10 @@ void SingleShotServer::Shutdown() {
 }
 
 
+bool SingleShotServer::Drain(std::chrono::milliseconds budget) {
+  return impl_->Drain(budget);
+}
+
+
 }  // namespace net
 }  // namespace pplme
@@ -9,9 +9,11 @@
 #define PPLME_LIBPPLMENET_SINGLESHOTSERVER_H_
 
 
+#include <chrono>
 #include <functional>
 #include <memory>
 #include "libpplmeutils/pimpl.h"
+#include "backend.h"
 
 
 namespace pplme {
@@ -34,7 +36,7 @@ namespace net {
  *      Message const& request) {
  *    LOG(INFO) << "Processing request of length " << request.GetBodyLength()
  *              << " from " << address << ":" << port;  
- *    std::unique_ptr<uint8_t[]> response_body{new uint8_t[0]};
+ *    auto response_body = Message::CreateBodyBuffer(0);
  *    return std::unique_ptr<Message>{new Message{std::move(response_body), 0}};
  *  };
  *
@@ -43,6 +45,8 @@ namespace net {
  *  if (null_server.Start()) {
  *    // Token stop signal:
  *    std::cin.get();
+ *    // Give those clients that we're serving a few seconds to be served.
+ *    null_server.Drain(std::chrono::seconds{5});
  *    null_server.Shutdown();
  *  }
  *  @endcode
@@ -61,10 +65,11 @@ class SingleShotServer {
    *  Function object type that is used for handling requests sent by clients.
    *
    *  This handler is inboked once per each client connection (assuming that
-   *  the client is not disconnected before it manages to send a request)
-   *  and is given the address:port of the client along with the client's
-   *  request.  The handler is then responsible for returning a Message that
-   *  should be sent back to the client as a respose to the request.
+   *  the client is not disconnected before it manages to send a request),
+   *  or once per request on a kept-alive connection, and is given the
+   *  address:port of the client along with the client's request.  The
+   *  handler is then responsible for returning a Message that should be
+   *  sent back to the client as a respose to the request.
    */
   typedef
     std::function<std::unique_ptr<Message> (std::string const& address,
@@ -73,8 +78,19 @@ class SingleShotServer {
     RequestHandler;
 
   /** Create a server that will listen on @a port, where if that port is 0,
-      dynamically assign a port. */
-  SingleShotServer(unsigned short port, RequestHandler request_handler);
+      dynamically assign a port.  If @a keep_alive, then a client may send
+      any number of requests (one at a time) over its connection, which is
+      kept until the client hangs up; otherwise, the connection is closed
+      after the first response, just as the name suggests.  With more than
+      one of @a acceptors, each listens (and accepts) on a socket and a
+      thread of its own, all bound to @a port with SO_REUSEPORT, and the
+      kernel spreads connections across them.  @a backend is how to do the
+      accepting, and the connections' I/O. */
+  SingleShotServer(unsigned short port,
+                   RequestHandler request_handler,
+                   bool keep_alive = false,
+                   unsigned int acceptors = 1,
+                   Backend backend = Backend::Epoll);
   ~SingleShotServer();
 
   /** Start the server listening for client connections and hence requests
@@ -85,8 +101,20 @@ class SingleShotServer {
       Can only be called inbetween Start() and Shutdown(). */
   unsigned short GetLocalPort() const;
   
-  /** Shut the server down. */
+  /** Shut the server down (which includes hanging up on any kept-alive
+      connections that are waiting on their next request). */
   void Shutdown();
+
+  /**
+   *  Stop accepting connections, hang up on kept-alive connections that are
+   *  between requests, and wait (for up to @a budget) for those requests
+   *  that are under way (or are yet to arrive on connections already
+   *  accepted) to be answered.  Shutdown() is still needed afterwards, and
+   *  still waits on anything that this didn't.
+   *
+   *  @returns  True iff every connection was done with inside @a budget.
+   */
+  bool Drain(std::chrono::milliseconds budget);
   
  private:
   class Impl;
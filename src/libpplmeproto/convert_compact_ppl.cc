@@ -0,0 +1,84 @@
+/**
+ *  @file
+ *  @brief   Definition of functionality for converting between domain Person
+ *           collections and the protocol CompactPpl type.
+ *  @author  j.ho
+ */
+
+
+#include <string.h>
+#include <glog/logging.h>
+#include "libpplmecore/person.h"
+#include "compact_ppl.pb.h"
+#include "convert_compact_ppl.h"
+#include "convert_date.h"
+
+
+namespace pplme {
+namespace proto {
+
+
+void Convert(std::vector<core::Person> const& from, CompactPpl* to) {
+  CHECK_NOTNULL(to);
+
+  auto& ids = *to->mutable_ids();
+  ids.reserve(ids.size() + from.size() * boost::uuids::uuid::static_size());
+  to->mutable_names()->Reserve(to->names_size() + from.size());
+  to->mutable_dates_of_birth()->Reserve(
+      to->dates_of_birth_size() + from.size());
+  to->mutable_latitudes()->Reserve(to->latitudes_size() + from.size());
+  to->mutable_longitudes()->Reserve(to->longitudes_size() + from.size());
+
+  for (auto const& person : from) {
+    auto const& id = person.id().value();
+    ids.append(reinterpret_cast<char const*>(&*id.begin()), id.size());
+    to->add_names(person.name());
+    to->add_dates_of_birth(PackYmd(person.date_of_birth()));
+    to->add_latitudes(person.location_of_home().latitude().value());
+    to->add_longitudes(person.location_of_home().longitude().value());
+  }
+}
+
+
+bool Convert(CompactPpl const& from, std::vector<core::Person>* to) {
+  CHECK_NOTNULL(to);
+
+  if (!from.has_ids()) {
+    DLOG(ERROR) << "CompactPpl does not have ids";
+    return false;
+  }
+
+  using boost::uuids::uuid;
+  auto const count = from.names_size();
+  if (from.ids().size() != static_cast<size_t>(count) * uuid::static_size()
+      || from.dates_of_birth_size() != count
+      || from.latitudes_size() != count
+      || from.longitudes_size() != count) {
+    DLOG(ERROR) << "CompactPpl has mismatched columns";
+    return false;
+  }
+
+  to->reserve(to->size() + count);
+  for (int n = 0; n < count; ++n) {
+    uuid id;
+    memcpy(id.data,
+           from.ids().data() + n * uuid::static_size(),
+           sizeof(id.data));
+    boost::gregorian::date dob;
+    if (!UnpackYmd(from.dates_of_birth(n), &dob))
+      return false;
+    to->emplace_back(
+        core::PersonId{id},
+        from.names(n),
+        dob,
+        core::GeoPosition{
+            core::GeoPosition::DecimalLatitude(from.latitudes(n)),
+            core::GeoPosition::DecimalLongitude(from.longitudes(n))});
+  }
+
+  return true;
+}
+
+
+}  // namespace proto
+}  // namespace pplme
@@ -0,0 +1,37 @@
+/**
+ *  @file
+ *  @brief   Declaration of functionality for converting between domain Person
+ *           collections and the protocol CompactPpl type.
+ *  @author  j.ho
+ */
+#ifndef PPLME_LIBPPLMEPROTO_CONVERTCOMPACTPPL_H_
+#define PPLME_LIBPPLMEPROTO_CONVERTCOMPACTPPL_H_
+
+
+#include <vector>
+
+
+namespace pplme {
+namespace core {
+class Person;
+}
+namespace proto {
+class CompactPpl;
+}
+}
+
+
+namespace pplme {
+namespace proto {
+
+
+/** @remarks  Like the PplmeResponse overloads, these append to @a to. */
+void Convert(std::vector<core::Person> const& from, CompactPpl* to);
+bool Convert(CompactPpl const& from, std::vector<core::Person>* to);
+
+
+}  // namespace proto
+}  // namespace pplme
+
+
+#endif  // PPLME_LIBPPLMEPROTO_CONVERTCOMPACTPPL_H_
@@ -20,12 +20,7 @@ namespace proto {
 void Convert(boost::gregorian::date const& from, Date* to) {
   CHECK_NOTNULL(to);
   
-  uint32_t ymd = from.year();
-  ymd <<= 16;
-  ymd += static_cast<uint32_t>(from.month()) << 8;
-  ymd += from.day();
-
-  to->set_ymd(htonl(ymd));
+  to->set_ymd(ConvertToYmd(from));
 }
 
 
@@ -37,7 +32,27 @@ bool Convert(Date const& from, boost::gregorian::date* to) {
     return false;
   }
 
-  uint32_t ymd = ntohl(from.ymd());
+  return UnpackYmd(ntohl(from.ymd()), to);
+}
+
+
+uint32_t ConvertToYmd(boost::gregorian::date const& from) {
+  return htonl(PackYmd(from));
+}
+
+
+uint32_t PackYmd(boost::gregorian::date const& from) {
+  uint32_t ymd = from.year();
+  ymd <<= 16;
+  ymd += static_cast<uint32_t>(from.month()) << 8;
+  ymd += from.day();
+
+  return ymd;
+}
+
+
+bool UnpackYmd(uint32_t ymd, boost::gregorian::date* to) {
+  CHECK_NOTNULL(to);
 
   uint32_t year = ymd >> 16;
   uint32_t month = (ymd & 0xFF00) >> 8;
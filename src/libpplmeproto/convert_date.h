@@ -8,6 +8,9 @@
 #define PPLME_LIBPPLMEPROTO_CONVERTDATE_H_
 
 
+#include <stdint.h>
+
+
 namespace boost {
 namespace gregorian {
 class date;
@@ -27,6 +30,18 @@ namespace proto {
 void Convert(boost::gregorian::date const& from, Date* to);
 bool Convert(Date const& from, boost::gregorian::date* to);
 
+/** @returns  What Convert() would set Date::ymd to for @a from. */
+uint32_t ConvertToYmd(boost::gregorian::date const& from);
+
+/**
+ *  Pack/unpack a date as year (16 bits), month (8 bits) and day (8 bits),
+ *  from MSB to LSB, in host octet order.
+ *  @{
+ */
+uint32_t PackYmd(boost::gregorian::date const& from);
+bool UnpackYmd(uint32_t ymd, boost::gregorian::date* to);
+/** @} */
+
 
 }  // namespace proto
 }  // namespace pplme
@@ -8,6 +8,7 @@
 
 #include <glog/logging.h>
 #include "libpplmecore/person.h"
+#include "libpplmecore/person_fields.h"
 #include "convert_date.h"
 #include "convert_geo_position.h"
 #include "convert_person.h"
@@ -20,12 +21,22 @@ namespace proto {
 
 
 void Convert(core::Person const& from, Person* to) {
+  Convert(from, core::PersonFields::AllOfPerson(), to);
+}
+
+
+void Convert(core::Person const& from,
+             core::PersonFields const& fields,
+             Person* to) {
   CHECK_NOTNULL(to);
 
   Convert(from.id().value(), to->mutable_id());
-  to->set_name(from.name());
-  Convert(from.date_of_birth(), to->mutable_date_of_birth());
-  Convert(from.location_of_home(), to->mutable_location_of_home());
+  if (fields.Has(core::PersonField::Name))
+    to->set_name(from.name());
+  if (fields.Has(core::PersonField::DateOfBirth))
+    Convert(from.date_of_birth(), to->mutable_date_of_birth());
+  if (fields.Has(core::PersonField::LocationOfHome))
+    Convert(from.location_of_home(), to->mutable_location_of_home());
 }
 
 
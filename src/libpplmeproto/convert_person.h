@@ -11,6 +11,7 @@
 namespace pplme {
 namespace core {
 class Person;
+class PersonFields;
 }
 namespace proto {
 class Person;
@@ -23,6 +24,11 @@ namespace proto {
 
 
 void Convert(core::Person const& from, Person* to);
+/** Only the id plus whichever of @a fields are set in @a to (although note
+    that a distance is not something that a core::Person knows about). */
+void Convert(core::Person const& from,
+             core::PersonFields const& fields,
+             Person* to);
 bool Convert(Person const& from, core::Person* to);
 
 
@@ -0,0 +1,70 @@
+/**
+ *  @file
+ *  @brief   Definition of functionality for converting between domain and
+ *           protocol person field mask types.
+ *  @author  j.ho
+ */
+
+
+#include <glog/logging.h>
+#include "libpplmecore/person_fields.h"
+#include "convert_person_field_mask.h"
+#include "person_field_mask.pb.h"
+
+
+namespace {
+
+
+struct FieldMapping {
+  pplme::core::PersonField domain;
+  pplme::proto::PersonFieldMask::Field proto;
+}
+  const kFieldMappings[] = {
+    { pplme::core::PersonField::Name, pplme::proto::PersonFieldMask::NAME },
+    { pplme::core::PersonField::DateOfBirth,
+      pplme::proto::PersonFieldMask::DATE_OF_BIRTH },
+    { pplme::core::PersonField::LocationOfHome,
+      pplme::proto::PersonFieldMask::LOCATION_OF_HOME },
+    { pplme::core::PersonField::Distance,
+      pplme::proto::PersonFieldMask::DISTANCE },
+};
+
+
+}  // namespace
+
+
+namespace pplme {
+namespace proto {
+
+
+void Convert(core::PersonFields const& from, PersonFieldMask* to) {
+  CHECK_NOTNULL(to);
+
+  to->clear_fields();
+  for (auto const& mapping : kFieldMappings) {
+    if (from.Has(mapping.domain))
+      to->add_fields(mapping.proto);
+  }
+}
+
+
+bool Convert(PersonFieldMask const& from, core::PersonFields* to) {
+  CHECK_NOTNULL(to);
+
+  // Unknown enumerators never make it this far (protobuf squirrels them away
+  // as unknown fields), so there's nothing here that can be invalid.
+  core::PersonFields fields;
+  for (auto field : from.fields()) {
+    for (auto const& mapping : kFieldMappings) {
+      if (field == mapping.proto)
+        fields.Add(mapping.domain);
+    }
+  }
+  *to = fields;
+
+  return true;
+}
+
+
+}  // namespace proto
+}  // namespace pplme
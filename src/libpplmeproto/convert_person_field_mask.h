@@ -0,0 +1,33 @@
+/**
+ *  @file
+ *  @brief   Declaration of functionality for converting between domain and
+ *           protocol person field mask types.
+ *  @author  j.ho
+ */
+#ifndef PPLME_LIBPPLMEPROTO_CONVERTPERSONFIELDMASK_H_
+#define PPLME_LIBPPLMEPROTO_CONVERTPERSONFIELDMASK_H_
+
+
+namespace pplme {
+namespace core {
+class PersonFields;
+}
+namespace proto {
+class PersonFieldMask;
+}
+}
+
+
+namespace pplme {
+namespace proto {
+
+
+void Convert(core::PersonFields const& from, PersonFieldMask* to);
+bool Convert(PersonFieldMask const& from, core::PersonFields* to);
+
+
+}  // namespace proto
+}  // namespace pplme
+
+
+#endif  // PPLME_LIBPPLMEPROTO_CONVERTPERSONFIELDMASK_H_
@@ -0,0 +1,53 @@
+/**
+ *  @file
+ *  @brief   Definition of functionality for converting between domain ppl
+ *           cursors and the opaque octets that clients see of them.
+ *  @author  j.ho
+ */
+
+
+#include <glog/logging.h>
+#include "libpplmecore/ppl_cursor.h"
+#include "convert_ppl_cursor.h"
+#include "ppl_cursor.pb.h"
+
+
+namespace pplme {
+namespace proto {
+
+
+void Convert(core::PplCursor const& from, std::string* to) {
+  CHECK_NOTNULL(to);
+
+  PplCursor cursor_pb;
+  cursor_pb.set_ring(from.ring());
+  cursor_pb.set_position(from.position());
+  cursor_pb.set_skip(from.skip());
+  CHECK(cursor_pb.SerializeToString(to));
+}
+
+
+bool Convert(std::string const& from, core::PplCursor* to) {
+  CHECK_NOTNULL(to);
+
+  PplCursor cursor_pb;
+  if (!cursor_pb.ParseFromString(from)) {
+    DLOG(ERROR) << "PplCursor does not parse";
+    return false;
+  }
+  if (!cursor_pb.has_ring()
+      || !cursor_pb.has_position()
+      || !cursor_pb.has_skip()) {
+    DLOG(ERROR) << "PplCursor is incomplete";
+    return false;
+  }
+
+  *to = core::PplCursor{
+      cursor_pb.ring(), cursor_pb.position(), cursor_pb.skip()};
+
+  return true;
+}
+
+
+}  // namespace proto
+}  // namespace pplme
@@ -0,0 +1,40 @@
+/**
+ *  @file
+ *  @brief   Declaration of functionality for converting between domain ppl
+ *           cursors and the opaque octets that clients see of them.
+ *  @author  j.ho
+ */
+#ifndef PPLME_LIBPPLMEPROTO_CONVERTPPLCURSOR_H_
+#define PPLME_LIBPPLMEPROTO_CONVERTPPLCURSOR_H_
+
+
+#include <string>
+
+
+namespace pplme {
+namespace core {
+class PplCursor;
+}
+}
+
+
+namespace pplme {
+namespace proto {
+
+
+/**
+ *  @remarks
+ *  The octets are a serialized PplCursor message, but clients are none the
+ *  wiser; they just get bytes in PplmeResponse.next_cursor and send them
+ *  back as PplmeRequest.cursor.  Going from octets returns false IFF they
+ *  don't parse as a complete PplCursor.
+ */
+void Convert(core::PplCursor const& from, std::string* to);
+bool Convert(std::string const& from, core::PplCursor* to);
+
+
+}  // namespace proto
+}  // namespace pplme
+
+
+#endif  // PPLME_LIBPPLMEPROTO_CONVERTPPLCURSOR_H_
@@ -0,0 +1,69 @@
+/**
+ *  @file
+ *  @brief   Definition of functionality for converting between domain and
+ *           protocol PplMutation types.
+ *  @author  j.ho
+ */
+
+
+#include <glog/logging.h>
+#include "libpplmecore/ppl_mutation.h"
+#include "convert_geo_position.h"
+#include "convert_person.h"
+#include "convert_ppl_mutation.h"
+#include "convert_uuid.h"
+#include "ppl_mutation.pb.h"
+
+
+namespace pplme {
+namespace proto {
+
+
+void Convert(core::PplMutation const& from, PplMutation* to) {
+  CHECK_NOTNULL(to);
+
+  if (from.kind == core::PplMutation::Kind::Add) {
+    Convert(from.person, to->mutable_added());
+  } else {
+    Convert(from.person.id().value(), to->mutable_removed()->mutable_id());
+    Convert(from.person.location_of_home(),
+            to->mutable_removed()->mutable_location_of_home());
+  }
+}
+
+
+bool Convert(PplMutation const& from, core::PplMutation* to) {
+  CHECK_NOTNULL(to);
+
+  if (from.has_added() == from.has_removed()) {
+    DLOG(ERROR) << "PplMutation is not exactly one of added or removed";
+    return false;
+  }
+
+  // (The engine takes a Person's location on trust, so it had better be
+  // somewhere on Earth.)
+  if (from.has_added()) {
+    to->kind = core::PplMutation::Kind::Add;
+    return Convert(from.added(), &to->person)
+        && to->person.location_of_home().IsValid();
+  }
+
+  if (!from.removed().has_id() || !from.removed().has_location_of_home()) {
+    DLOG(ERROR) << "Removed Person does not have id and location of home";
+    return false;
+  }
+  boost::uuids::uuid id;
+  if (!Convert(from.removed().id(), &id))
+    return false;
+  core::GeoPosition home;
+  if (!Convert(from.removed().location_of_home(), &home) || !home.IsValid())
+    return false;
+  to->kind = core::PplMutation::Kind::Remove;
+  to->person = core::Person{
+      core::PersonId{id}, std::string{}, boost::gregorian::date{}, home};
+  return true;
+}
+
+
+}  // namespace proto
+}  // namespace pplme
@@ -0,0 +1,39 @@
+/**
+ *  @file
+ *  @brief   Declaration of functionality for converting between domain and
+ *           protocol PplMutation types.
+ *  @author  j.ho
+ */
+#ifndef PPLME_LIBPPLMEPROTO_CONVERTPPLMUTATION_H_
+#define PPLME_LIBPPLMEPROTO_CONVERTPPLMUTATION_H_
+
+
+namespace pplme {
+namespace core {
+struct PplMutation;
+}
+namespace proto {
+class PplMutation;
+}
+}
+
+
+namespace pplme {
+namespace proto {
+
+
+/**
+ *  @remarks
+ *  Going to a PplMutation, a removal only takes the Person's id and location
+ *  of home.  Going from one returns false IFF it isn't exactly one of an
+ *  addition of a whole Person or a removal of an id at a valid location.
+ */
+void Convert(core::PplMutation const& from, PplMutation* to);
+bool Convert(PplMutation const& from, core::PplMutation* to);
+
+
+}  // namespace proto
+}  // namespace pplme
+
+
+#endif  // PPLME_LIBPPLMEPROTO_CONVERTPPLMUTATION_H_
@@ -0,0 +1,46 @@
+/**
+ *  @file
+ *  @brief   Definition of functionality for converting between domain and
+ *           proto PplmeResponse types.
+ *  @author  j.ho
+ */
+
+
+#include <glog/logging.h>
+#include "libpplmecore/person.h"
+#include "convert_compact_ppl.h"
+#include "convert_person.h"
+#include "convert_pplme_response.h"
+#include "pplme_response.pb.h"
+
+
+namespace pplme {
+namespace proto {
+
+
+void Convert(std::vector<core::Person> const& from, PplmeResponse* to) {
+  CHECK_NOTNULL(to);
+
+  to->mutable_ppl()->Reserve(to->ppl_size() + from.size());
+  for (auto const& person : from)
+    Convert(person, to->add_ppl());
+}
+
+
+bool Convert(PplmeResponse const& from, std::vector<core::Person>* to) {
+  CHECK_NOTNULL(to);
+
+  to->reserve(to->size() + from.ppl_size());
+  for (auto const& person_pb : from.ppl()) {
+    core::Person person;
+    if (!Convert(person_pb, &person))
+      return false;
+    to->push_back(std::move(person));
+  }
+
+  return !from.has_compact_ppl() || Convert(from.compact_ppl(), to);
+}
+
+
+}  // namespace proto
+}  // namespace pplme
@@ -0,0 +1,43 @@
+/**
+ *  @file
+ *  @brief   Declaration of functionality for converting between domain and
+ *           protocol PplmeResponse types.
+ *  @author  j.ho
+ */
+#ifndef PPLME_LIBPPLMEPROTO_CONVERTPPLMERESPONSE_H_
+#define PPLME_LIBPPLMEPROTO_CONVERTPPLMERESPONSE_H_
+
+
+#include <vector>
+
+
+namespace pplme {
+namespace core {
+class Person;
+}
+namespace proto {
+class PplmeResponse;
+}
+}
+
+
+namespace pplme {
+namespace proto {
+
+
+/**
+ *  @remarks
+ *  Going to a PplmeResponse produces a version 1 response (use the CompactPpl
+ *  overload on mutable_compact_ppl() for version 2).  If @a to lives on an
+ *  Arena, then so will all of the Person submessages that this adds to it.
+ *  Going from a PplmeResponse understands either version.
+ */
+void Convert(std::vector<core::Person> const& from, PplmeResponse* to);
+bool Convert(PplmeResponse const& from, std::vector<core::Person>* to);
+
+
+}  // namespace proto
+}  // namespace pplme
+
+
+#endif  // PPLME_LIBPPLMEPROTO_CONVERTPPLMERESPONSE_H_
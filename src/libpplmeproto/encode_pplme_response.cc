@@ -0,0 +1,337 @@
+/**
+ *  @file
+ *  @brief   Definition of functionality for encoding a PplmeResponse
+ *           directly from domain Person instances.
+ *  @author  j.ho
+ */
+
+
+#include "encode_pplme_response.h"
+#include <string.h>
+#include <glog/logging.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+#include "compact_ppl.pb.h"
+#include "convert_date.h"
+#include "date.pb.h"
+#include "geo_position.pb.h"
+#include "person.pb.h"
+#include "pplme_response.pb.h"
+#include "uuid.pb.h"
+
+
+using google::protobuf::io::CodedOutputStream;
+using google::protobuf::internal::WireFormatLite;
+using pplme::core::PersonField;
+using pplme::core::PersonFields;
+using pplme::proto::PplEntry;
+
+
+namespace {
+
+
+// All of the sizes below assume single-octet tags.
+static_assert(pplme::proto::PplmeResponse::kPplFieldNumber < 16
+              && pplme::proto::Person::kIdFieldNumber < 16
+              && pplme::proto::Person::kNameFieldNumber < 16
+              && pplme::proto::Person::kDateOfBirthFieldNumber < 16
+              && pplme::proto::Person::kLocationOfHomeFieldNumber < 16
+              && pplme::proto::Uuid::kOctetsFieldNumber < 16
+              && pplme::proto::Date::kYmdFieldNumber < 16
+              && pplme::proto::GeoPosition::kLatitudeFieldNumber < 16
+              && pplme::proto::GeoPosition::kLongitudeFieldNumber < 16
+              && pplme::proto::PplmeResponse::kCompactPplFieldNumber < 16
+              && pplme::proto::CompactPpl::kIdsFieldNumber < 16
+              && pplme::proto::CompactPpl::kNamesFieldNumber < 16
+              && pplme::proto::CompactPpl::kDatesOfBirthFieldNumber < 16
+              && pplme::proto::CompactPpl::kLatitudesFieldNumber < 16
+              && pplme::proto::CompactPpl::kLongitudesFieldNumber < 16
+              && pplme::proto::CompactPpl::kDistancesFieldNumber < 16
+              && pplme::proto::Person::kDistanceFieldNumber < 16
+              && pplme::proto::PplmeResponse::kNextCursorFieldNumber < 16
+              && pplme::proto::PplmeResponse::kPartialFieldNumber < 16,
+              "Field numbers too big for single-octet tags");
+
+
+/** Uuid.octets is always exactly 16 octets. */
+uint32_t const kUuidOctetsSize = 16;
+/** Uuid is just its tagged and length-prefixed octets. */
+uint32_t const kUuidSize = 1 + 1 + kUuidOctetsSize;
+/** GeoPosition is two tagged fixed32s. */
+uint32_t const kGeoPositionSize = 2 * (1 + 4);
+
+
+uint32_t GetLengthDelimitedSize(uint32_t length) {
+  return 1 + CodedOutputStream::VarintSize32(length) + length;
+}
+
+
+/** Protobuf doesn't bother writing empty packed fields at all. */
+uint32_t GetPackedFixed32Size(size_t count) {
+  return count ? GetLengthDelimitedSize(static_cast<uint32_t>(count * 4)) : 0;
+}
+
+
+uint32_t GetDateSize(uint32_t ymd) {
+  return 1 + CodedOutputStream::VarintSize32(ymd);
+}
+
+
+uint32_t GetPersonSize(PplEntry const& entry,
+                       PersonFields const& fields,
+                       uint32_t ymd) {
+  uint32_t size = GetLengthDelimitedSize(kUuidSize);
+  if (fields.Has(PersonField::Name)) {
+    size += GetLengthDelimitedSize(
+        static_cast<uint32_t>(entry.person->name().size()));
+  }
+  if (fields.Has(PersonField::DateOfBirth))
+    size += GetLengthDelimitedSize(GetDateSize(ymd));
+  if (fields.Has(PersonField::LocationOfHome))
+    size += GetLengthDelimitedSize(kGeoPositionSize);
+  if (fields.Has(PersonField::Distance))
+    size += 1 + 4;
+  return size;
+}
+
+
+/** @returns  The ymd of @a entry's date of birth, if it's wanted at all. */
+uint32_t GetYmd(PplEntry const& entry, PersonFields const& fields) {
+  return fields.Has(PersonField::DateOfBirth) ?
+      pplme::proto::ConvertToYmd(entry.person->date_of_birth()) : 0;
+}
+
+
+uint8_t* WriteTag(int field_number,
+                  WireFormatLite::WireType wire_type,
+                  uint8_t* target) {
+  return CodedOutputStream::WriteTagToArray(
+      WireFormatLite::MakeTag(field_number, wire_type), target);
+}
+
+
+uint8_t* WriteLengthDelimitedPrefix(int field_number,
+                                    uint32_t length,
+                                    uint8_t* target) {
+  target = WriteTag(field_number,
+                    WireFormatLite::WIRETYPE_LENGTH_DELIMITED,
+                    target);
+  return CodedOutputStream::WriteVarint32ToArray(length, target);
+}
+
+
+uint8_t* WriteFloat(int field_number, float value, uint8_t* target) {
+  target = WriteTag(field_number, WireFormatLite::WIRETYPE_FIXED32, target);
+  return CodedOutputStream::WriteLittleEndian32ToArray(
+      WireFormatLite::EncodeFloat(value), target);
+}
+
+
+template <typename T>
+uint8_t* WritePackedFixed32(int field_number,
+                            std::vector<T> const& values,
+                            uint8_t* target) {
+  static_assert(sizeof(T) == 4, "Not a fixed32");
+  if (values.empty())
+    return target;
+
+  target = WriteLengthDelimitedPrefix(
+      field_number, static_cast<uint32_t>(values.size() * 4), target);
+  for (auto value : values) {
+    uint32_t octets;
+    memcpy(&octets, &value, sizeof(octets));
+    target = CodedOutputStream::WriteLittleEndian32ToArray(octets, target);
+  }
+  return target;
+}
+
+
+}  // namespace
+
+
+namespace pplme {
+namespace proto {
+
+
+size_t GetEncodedPplEntrySize(PplEntry const& entry,
+                              core::PersonFields const& fields) {
+  DCHECK(entry.person || !fields.NeedsPerson());
+  return GetLengthDelimitedSize(
+      GetPersonSize(entry, fields, GetYmd(entry, fields)));
+}
+
+
+uint8_t* EncodePplEntry(PplEntry const& entry,
+                        core::PersonFields const& fields,
+                        uint8_t* target) {
+  DCHECK(entry.person || !fields.NeedsPerson());
+  auto const ymd = GetYmd(entry, fields);
+
+  // N.B. Fields are written in field number order, just as protobuf itself
+  //      does, otherwise we wouldn't be byte-for-byte compatible.
+  target = WriteLengthDelimitedPrefix(
+      PplmeResponse::kPplFieldNumber,
+      GetPersonSize(entry, fields, ymd),
+      target);
+
+  // Person.id
+  auto const& id = entry.id.value();
+  target = WriteLengthDelimitedPrefix(
+      Person::kIdFieldNumber, kUuidSize, target);
+  target = WriteLengthDelimitedPrefix(
+      Uuid::kOctetsFieldNumber, kUuidOctetsSize, target);
+  target = CodedOutputStream::WriteRawToArray(
+      &*id.begin(), kUuidOctetsSize, target);
+
+  // Person.name
+  if (fields.Has(PersonField::Name)) {
+    auto const& name = entry.person->name();
+    target = WriteLengthDelimitedPrefix(
+        Person::kNameFieldNumber, static_cast<uint32_t>(name.size()), target);
+    target = CodedOutputStream::WriteRawToArray(
+        name.data(), static_cast<int>(name.size()), target);
+  }
+
+  // Person.date_of_birth
+  if (fields.Has(PersonField::DateOfBirth)) {
+    target = WriteLengthDelimitedPrefix(
+        Person::kDateOfBirthFieldNumber, GetDateSize(ymd), target);
+    target = WriteTag(
+        Date::kYmdFieldNumber, WireFormatLite::WIRETYPE_VARINT, target);
+    target = CodedOutputStream::WriteVarint32ToArray(ymd, target);
+  }
+
+  // Person.location_of_home
+  if (fields.Has(PersonField::LocationOfHome)) {
+    auto const& home = entry.person->location_of_home();
+    target = WriteLengthDelimitedPrefix(
+        Person::kLocationOfHomeFieldNumber, kGeoPositionSize, target);
+    target = WriteFloat(
+        GeoPosition::kLatitudeFieldNumber, home.latitude().value(), target);
+    target = WriteFloat(
+        GeoPosition::kLongitudeFieldNumber, home.longitude().value(), target);
+  }
+
+  // Person.distance
+  if (fields.Has(PersonField::Distance))
+    target = WriteFloat(Person::kDistanceFieldNumber, entry.distance, target);
+
+  return target;
+}
+
+
+size_t GetEncodedPplEntrySize(core::Person const& person) {
+  return GetEncodedPplEntrySize(PplEntry{person},
+                                core::PersonFields::AllOfPerson());
+}
+
+
+uint8_t* EncodePplEntry(core::Person const& person, uint8_t* target) {
+  return EncodePplEntry(PplEntry{person},
+                        core::PersonFields::AllOfPerson(),
+                        target);
+}
+
+
+void CompactPplEncoder::Add(PplEntry const& entry) {
+  DCHECK(entry.person || !fields_.NeedsPerson());
+
+  auto const& id = entry.id.value();
+  ids_.append(reinterpret_cast<char const*>(&*id.begin()), kUuidOctetsSize);
+
+  if (fields_.Has(PersonField::Name)) {
+    auto const& name = entry.person->name();
+    uint8_t prefix[1 + 5];
+    auto const prefix_end = WriteLengthDelimitedPrefix(
+        CompactPpl::kNamesFieldNumber,
+        static_cast<uint32_t>(name.size()),
+        prefix);
+    encoded_names_.append(reinterpret_cast<char const*>(prefix),
+                          prefix_end - prefix);
+    encoded_names_.append(name);
+  }
+
+  if (fields_.Has(PersonField::DateOfBirth))
+    dates_of_birth_.push_back(PackYmd(entry.person->date_of_birth()));
+
+  if (fields_.Has(PersonField::LocationOfHome)) {
+    auto const& home = entry.person->location_of_home();
+    latitudes_.push_back(home.latitude().value());
+    longitudes_.push_back(home.longitude().value());
+  }
+
+  if (fields_.Has(PersonField::Distance))
+    distances_.push_back(entry.distance);
+}
+
+
+size_t CompactPplEncoder::GetEncodedSize() const {
+  return GetLengthDelimitedSize(GetCompactPplSize());
+}
+
+
+uint8_t* CompactPplEncoder::Encode(uint8_t* target) const {
+  target = WriteLengthDelimitedPrefix(
+      PplmeResponse::kCompactPplFieldNumber, GetCompactPplSize(), target);
+
+  target = WriteLengthDelimitedPrefix(
+      CompactPpl::kIdsFieldNumber, static_cast<uint32_t>(ids_.size()), target);
+  target = CodedOutputStream::WriteRawToArray(
+      ids_.data(), static_cast<int>(ids_.size()), target);
+  target = CodedOutputStream::WriteRawToArray(
+      encoded_names_.data(), static_cast<int>(encoded_names_.size()), target);
+  target = WritePackedFixed32(
+      CompactPpl::kDatesOfBirthFieldNumber, dates_of_birth_, target);
+  target = WritePackedFixed32(
+      CompactPpl::kLatitudesFieldNumber, latitudes_, target);
+  target = WritePackedFixed32(
+      CompactPpl::kLongitudesFieldNumber, longitudes_, target);
+  target = WritePackedFixed32(
+      CompactPpl::kDistancesFieldNumber, distances_, target);
+
+  return target;
+}
+
+
+uint32_t CompactPplEncoder::GetCompactPplSize() const {
+  // N.B. ids is always present (even when empty), just as per Convert().
+  return GetLengthDelimitedSize(static_cast<uint32_t>(ids_.size()))
+      + static_cast<uint32_t>(encoded_names_.size())
+      + GetPackedFixed32Size(dates_of_birth_.size())
+      + GetPackedFixed32Size(latitudes_.size())
+      + GetPackedFixed32Size(longitudes_.size())
+      + GetPackedFixed32Size(distances_.size());
+}
+
+
+size_t GetEncodedNextCursorSize(std::string const& next_cursor) {
+  return GetLengthDelimitedSize(static_cast<uint32_t>(next_cursor.size()));
+}
+
+
+uint8_t* EncodeNextCursor(std::string const& next_cursor, uint8_t* target) {
+  target = WriteLengthDelimitedPrefix(
+      PplmeResponse::kNextCursorFieldNumber,
+      static_cast<uint32_t>(next_cursor.size()),
+      target);
+  return CodedOutputStream::WriteRawToArray(
+      next_cursor.data(), static_cast<int>(next_cursor.size()), target);
+}
+
+
+size_t GetEncodedPartialSize() {
+  // A tag and a single-octet varint.
+  return 1 + 1;
+}
+
+
+uint8_t* EncodePartial(uint8_t* target) {
+  target = WriteTag(PplmeResponse::kPartialFieldNumber,
+                    WireFormatLite::WIRETYPE_VARINT,
+                    target);
+  return CodedOutputStream::WriteVarint32ToArray(1, target);
+}
+
+
+}  // namespace proto
+}  // namespace pplme
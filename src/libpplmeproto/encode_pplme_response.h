@@ -0,0 +1,163 @@
+/**
+ *  @file
+ *  @brief   Declaration of functionality for encoding a PplmeResponse
+ *           directly from domain Person instances.
+ *  @author  j.ho
+ */
+#ifndef PPLME_LIBPPLMEPROTO_ENCODEPPLMERESPONSE_H_
+#define PPLME_LIBPPLMEPROTO_ENCODEPPLMERESPONSE_H_
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "libpplmecore/person.h"
+#include "libpplmecore/person_fields.h"
+
+
+namespace pplme {
+namespace proto {
+
+
+/** A matching Person, as far as encoding a response is concerned. */
+struct PplEntry {
+  /** For when the whole Person is to hand. */
+  explicit PplEntry(core::Person const& person, float distance = 0) :
+      id(person.id()), person{&person}, distance{distance} {}
+  /** For when only their id (and maybe distance) is wanted. */
+  PplEntry(core::PersonId const& id, float distance) :
+      id(id), person{nullptr}, distance{distance} {}
+
+  core::PersonId const& id;
+  /** Must be non-null if any of the Person's name, date-of-birth, or
+      location-of-home are wanted. */
+  core::Person const* person;
+  /** Only looked at if core::PersonField::Distance is wanted. */
+  float distance;
+};
+
+
+/**
+ *  @returns  The number of octets that EncodePplEntry() will write for
+ *            @a entry.
+ */
+size_t GetEncodedPplEntrySize(PplEntry const& entry,
+                              core::PersonFields const& fields);
+
+/**
+ *  Encode @a entry (or, rather, its id plus whichever of @a fields) as a
+ *  single `ppl` entry of a PplmeResponse into @a target, which must have room
+ *  for GetEncodedPplEntrySize() octets.
+ *
+ *  @returns  One past the last octet written.
+ *
+ *  @remarks
+ *  On the wire, a PplmeResponse is nothing more than its `ppl` entries one
+ *  after the other, so a whole response is encoded by encoding each Person
+ *  in turn.  The octets are identical to those that Convert()ing to a
+ *  PplmeResponse and serializing it would produce; it's just that this way
+ *  there's no intermediate proto::Person (or core::Person copy) to build.
+ */
+uint8_t* EncodePplEntry(PplEntry const& entry,
+                        core::PersonFields const& fields,
+                        uint8_t* target);
+
+/** Shorthands for the whole of @a person (but not their distance).
+    @{ */
+size_t GetEncodedPplEntrySize(core::Person const& person);
+uint8_t* EncodePplEntry(core::Person const& person, uint8_t* target);
+/** @} */
+
+
+/**
+ *  Example:
+ *  @code
+ *  CompactPplEncoder encoder;
+ *  for (auto const& person : ppl)
+ *    encoder.Add(person);
+ *  auto buffer = net::Message::CreateBodyBuffer(encoder.GetEncodedSize());
+ *  encoder.Encode(buffer.get());
+ *  @endcode
+ *
+ *  @remarks
+ *  This is the version 2 counterpart of EncodePplEntry(): it encodes a
+ *  PplmeResponse whose compact_ppl is populated, with octets identical to
+ *  those of Convert()ing into mutable_compact_ppl() (and adding any distances)
+ *  and serializing.  Because CompactPpl is column-wise, nothing can be
+ *  written until every Person has been seen, so Add() squirrels away each
+ *  column as it goes (which is still a lot less than a proto::Person apiece).
+ */
+class CompactPplEncoder {
+ public:
+  /** Only ids plus @a fields will be encoded. */
+  explicit CompactPplEncoder(
+      core::PersonFields fields = core::PersonFields::AllOfPerson()) :
+      fields_{fields} {}
+
+  CompactPplEncoder(CompactPplEncoder const&) = delete;
+  CompactPplEncoder& operator=(CompactPplEncoder const&) = delete;
+
+  void Add(PplEntry const& entry);
+  void Add(core::Person const& person) { Add(PplEntry{person}); }
+
+  /** @returns  The number of octets that Encode() will write. */
+  size_t GetEncodedSize() const;
+
+  /**
+   *  Encode everything that has been Add()ed into @a target, which must have
+   *  room for GetEncodedSize() octets.
+   *
+   *  @returns  One past the last octet written.
+   */
+  uint8_t* Encode(uint8_t* target) const;
+
+ private:
+  core::PersonFields fields_;
+  std::string ids_;
+  /** Each name already has its tag and length prefixed. */
+  std::string encoded_names_;
+  std::vector<uint32_t> dates_of_birth_;
+  std::vector<float> latitudes_;
+  std::vector<float> longitudes_;
+  std::vector<float> distances_;
+
+  uint32_t GetCompactPplSize() const;
+};
+
+
+/**
+ *  @returns  The number of octets that EncodeNextCursor() will write for
+ *            @a next_cursor.
+ */
+size_t GetEncodedNextCursorSize(std::string const& next_cursor);
+
+/**
+ *  Encode @a next_cursor (as per Convert()ing a core::PplCursor) as the
+ *  `next_cursor' of a PplmeResponse into @a target, which must have room for
+ *  GetEncodedNextCursorSize() octets.  Because next_cursor has a higher field
+ *  number than either version's ppl, it goes after them.
+ *
+ *  @returns  One past the last octet written.
+ */
+uint8_t* EncodeNextCursor(std::string const& next_cursor, uint8_t* target);
+
+
+/** @returns  The number of octets that EncodePartial() will write. */
+size_t GetEncodedPartialSize();
+
+/**
+ *  Encode a PplmeResponse's `partial' (as true; there's no point encoding it
+ *  otherwise) into @a target, which must have room for
+ *  GetEncodedPartialSize() octets.  It goes after any next_cursor.
+ *
+ *  @returns  One past the last octet written.
+ */
+uint8_t* EncodePartial(uint8_t* target);
+
+
+}  // namespace proto
+}  // namespace pplme
+
+
+#endif  // PPLME_LIBPPLMEPROTO_ENCODEPPLMERESPONSE_H_
@@ -0,0 +1,180 @@
+/**
+ *  @file
+ *  @brief   Allocation-counting benchmarks for building PplmeResponses.
+ *  @author  j.ho
+ */
+
+
+#include <functional>
+#include <benchmark/benchmark.h>
+#include <boost/uuid/random_generator.hpp>
+#include <google/protobuf/arena.h>
+#include "libpplmecore/person.h"
+#include "libpplmeproto/convert_compact_ppl.h"
+#include "libpplmeproto/convert_pplme_response.h"
+#include "libpplmeproto/encode_pplme_response.h"
+#include "libpplmeproto/pplme_response.pb.h"
+#include "libpplmeutils/bench/allocation_counter.h"
+
+
+namespace core = pplme::core;
+namespace proto = pplme::proto;
+namespace utils = pplme::utils;
+
+
+namespace {
+
+
+std::vector<core::Person> CreatePpl(int count) {
+  boost::uuids::random_generator random_uuid_generator;
+  std::vector<core::Person> ppl;
+  for (int n = 0; n < count; ++n) {
+    ppl.emplace_back(
+        core::PersonId{random_uuid_generator()},
+        std::string{u8"John Malkovich "} + std::to_string(n),
+        boost::gregorian::date{1970, 1, 1} + boost::gregorian::days{n},
+        core::GeoPosition{core::GeoPosition::DecimalLatitude(51.5f),
+                          core::GeoPosition::DecimalLongitude(-0.1f)});
+  }
+  return ppl;
+}
+
+
+/** Build and serialize a response for @a ppl using @a create_response, and
+    report how many allocations that took per response. */
+template <typename CreateResponse>
+void BuildResponses(benchmark::State& state, CreateResponse create_response) {
+  auto const ppl = CreatePpl(state.range(0));
+  std::string serialized;
+
+  auto const allocations_before = utils::bench::GetAllocationCount();
+  for (auto _ : state) {
+    create_response([&ppl, &serialized](proto::PplmeResponse* response_pb) {
+        proto::Convert(ppl, response_pb);
+        response_pb->SerializeToString(&serialized);
+      });
+  }
+  auto const allocations =
+      utils::bench::GetAllocationCount() - allocations_before;
+
+  state.counters["allocs_per_response"] =
+      double(allocations) / state.iterations();
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+
+}  // namespace
+
+
+/** A PplmeResponse (and so every submessage) on the heap. */
+void BM_BuildResponseOnHeap(benchmark::State& state) {
+  BuildResponses(state, [](std::function<void (proto::PplmeResponse*)> build) {
+      proto::PplmeResponse response_pb;
+      build(&response_pb);
+    });
+}
+BENCHMARK(BM_BuildResponseOnHeap)->Arg(10)->Arg(1000);
+
+
+/** A PplmeResponse on a fresh default arena, as per a pplmed request. */
+void BM_BuildResponseOnArena(benchmark::State& state) {
+  BuildResponses(state, [](std::function<void (proto::PplmeResponse*)> build) {
+      google::protobuf::Arena arena;
+      build(google::protobuf::Arena::CreateMessage<proto::PplmeResponse>(
+          &arena));
+    });
+}
+BENCHMARK(BM_BuildResponseOnArena)->Arg(10)->Arg(1000);
+
+
+/** A PplmeResponse on an arena whose first block is big enough for the whole
+    response (which is what pplmed does with a pooled buffer). */
+void BM_BuildResponseOnArenaWithInitialBlock(benchmark::State& state) {
+  std::vector<char> initial_block(256 * 1024);
+  BuildResponses(
+      state,
+      [&initial_block](std::function<void (proto::PplmeResponse*)> build) {
+        google::protobuf::ArenaOptions arena_options;
+        arena_options.initial_block = initial_block.data();
+        arena_options.initial_block_size = initial_block.size();
+        google::protobuf::Arena arena{arena_options};
+        build(google::protobuf::Arena::CreateMessage<proto::PplmeResponse>(
+            &arena));
+      });
+}
+BENCHMARK(BM_BuildResponseOnArenaWithInitialBlock)->Arg(10)->Arg(1000);
+
+
+/** No PplmeResponse at all: encode each Person directly into the output. */
+void BM_EncodeResponseDirectly(benchmark::State& state) {
+  auto const ppl = CreatePpl(state.range(0));
+  std::vector<uint8_t> encoded(1024 * 1024);
+
+  auto const allocations_before = utils::bench::GetAllocationCount();
+  for (auto _ : state) {
+    auto target = encoded.data();
+    for (auto const& person : ppl)
+      target = proto::EncodePplEntry(person, target);
+    benchmark::DoNotOptimize(target);
+  }
+  auto const allocations =
+      utils::bench::GetAllocationCount() - allocations_before;
+
+  state.counters["allocs_per_response"] =
+      double(allocations) / state.iterations();
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EncodeResponseDirectly)->Arg(10)->Arg(1000);
+
+
+/** Version 2: gather the columns, then encode them in one go. */
+void BM_EncodeCompactResponseDirectly(benchmark::State& state) {
+  auto const ppl = CreatePpl(state.range(0));
+  std::vector<uint8_t> encoded(1024 * 1024);
+
+  size_t encoded_size = 0;
+  for (auto _ : state) {
+    proto::CompactPplEncoder encoder;
+    for (auto const& person : ppl)
+      encoder.Add(person);
+    encoded_size = encoder.GetEncodedSize();
+    benchmark::DoNotOptimize(encoder.Encode(encoded.data()));
+  }
+
+  state.counters["octets_per_response"] = encoded_size;
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EncodeCompactResponseDirectly)->Arg(10)->Arg(1000);
+
+
+/** What a client has to do with a response of either version. */
+void DecodeResponses(benchmark::State& state, std::string const& octets) {
+  for (auto _ : state) {
+    proto::PplmeResponse response_pb;
+    std::vector<core::Person> ppl;
+    response_pb.ParseFromString(octets);
+    benchmark::DoNotOptimize(proto::Convert(response_pb, &ppl));
+  }
+
+  state.counters["octets_per_response"] = octets.size();
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+
+void BM_DecodeResponse(benchmark::State& state) {
+  proto::PplmeResponse response_pb;
+  proto::Convert(CreatePpl(state.range(0)), &response_pb);
+  DecodeResponses(state, response_pb.SerializeAsString());
+}
+BENCHMARK(BM_DecodeResponse)->Arg(10)->Arg(1000);
+
+
+void BM_DecodeCompactResponse(benchmark::State& state) {
+  proto::PplmeResponse response_pb;
+  proto::Convert(CreatePpl(state.range(0)), response_pb.mutable_compact_ppl());
+  DecodeResponses(state, response_pb.SerializeAsString());
+}
+BENCHMARK(BM_DecodeCompactResponse)->Arg(10)->Arg(1000);
+
+
+BENCHMARK_MAIN();
@@ -0,0 +1,125 @@
+/**
+ *  @file
+ *  @brief   Tests for the pplme::proto::CompactPpl-based overloads of
+ *           pplme::proto::Convert().
+ *  @author  j.ho
+ */
+
+
+#include <boost/uuid/random_generator.hpp>
+#include <gtest/gtest.h>
+#include "libpplmecore/person.h"
+#include "libpplmeproto/compact_ppl.pb.h"
+#include "libpplmeproto/convert_compact_ppl.h"
+#include "libpplmeproto/convert_pplme_response.h"
+#include "libpplmeproto/pplme_response.pb.h"
+
+
+namespace core = pplme::core;
+namespace proto = pplme::proto;
+using pplme::proto::Convert;
+
+
+namespace {
+
+std::vector<core::Person> CreateTokenPpl() {
+  std::vector<core::Person> ppl;
+  for (int n = 0; n < 3; ++n) {
+    ppl.emplace_back(
+        core::PersonId{boost::uuids::random_generator()()},
+        "Compact Babe " + std::to_string(n),
+        boost::gregorian::date(1990 + n, 1 + n, 10 + n),
+        core::GeoPosition{core::GeoPosition::DecimalLatitude(10.5f * n),
+                          core::GeoPosition::DecimalLongitude(-20.25f * n)});
+  }
+  return ppl;
+}
+
+
+void AssertSamePpl(std::vector<core::Person> const& expected,
+                   std::vector<core::Person> const& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (size_t n = 0; n < expected.size(); ++n) {
+    ASSERT_EQ(expected[n].id(), actual[n].id());
+    ASSERT_EQ(expected[n].name(), actual[n].name());
+    ASSERT_EQ(expected[n].date_of_birth(), actual[n].date_of_birth());
+    ASSERT_EQ(expected[n].location_of_home().latitude(),
+              actual[n].location_of_home().latitude());
+    ASSERT_EQ(expected[n].location_of_home().longitude(),
+              actual[n].location_of_home().longitude());
+  }
+}
+
+}  // namespace
+
+
+TEST(ConvertCompactPplTest, Roundtrip) {
+  // Arrange.
+  auto ppl_in = CreateTokenPpl();
+
+  // Act.
+  proto::CompactPpl compact_ppl_pb;
+  Convert(ppl_in, &compact_ppl_pb);
+  std::vector<core::Person> ppl_out;
+  EXPECT_TRUE(Convert(compact_ppl_pb, &ppl_out));
+
+  // Assert.
+  AssertSamePpl(ppl_in, ppl_out);
+}
+
+
+TEST(ConvertCompactPplTest, PplmeResponseOfEitherVersionConverts) {
+  // Arrange.
+  auto ppl_in = CreateTokenPpl();
+  proto::PplmeResponse v1_response_pb;
+  Convert(ppl_in, &v1_response_pb);
+  proto::PplmeResponse v2_response_pb;
+  Convert(ppl_in, v2_response_pb.mutable_compact_ppl());
+
+  // Act.
+  std::vector<core::Person> v1_ppl_out;
+  EXPECT_TRUE(Convert(v1_response_pb, &v1_ppl_out));
+  std::vector<core::Person> v2_ppl_out;
+  EXPECT_TRUE(Convert(v2_response_pb, &v2_ppl_out));
+
+  // Assert.
+  AssertSamePpl(ppl_in, v1_ppl_out);
+  AssertSamePpl(ppl_in, v2_ppl_out);
+  ASSERT_LT(v2_response_pb.ByteSize(), v1_response_pb.ByteSize());
+}
+
+
+TEST(ConvertCompactPplTest, ConvertFailsForCompactPplWithoutIds) {
+  // Arrange.
+  proto::CompactPpl compact_ppl_pb;
+  Convert(CreateTokenPpl(), &compact_ppl_pb);
+  compact_ppl_pb.clear_ids();
+
+  // Act & Assert.
+  std::vector<core::Person> ppl;
+  ASSERT_FALSE(Convert(compact_ppl_pb, &ppl));
+}
+
+
+TEST(ConvertCompactPplTest, ConvertFailsForCompactPplWithMismatchedColumns) {
+  // Arrange.
+  proto::CompactPpl compact_ppl_pb;
+  Convert(CreateTokenPpl(), &compact_ppl_pb);
+  compact_ppl_pb.mutable_latitudes()->RemoveLast();
+
+  // Act & Assert.
+  std::vector<core::Person> ppl;
+  ASSERT_FALSE(Convert(compact_ppl_pb, &ppl));
+}
+
+
+TEST(ConvertCompactPplTest, ConvertFailsForCompactPplWithInvalidDate) {
+  // Arrange.
+  proto::CompactPpl compact_ppl_pb;
+  Convert(CreateTokenPpl(), &compact_ppl_pb);
+  compact_ppl_pb.set_dates_of_birth(1, 0xFFFFFFFF);
+
+  // Act & Assert.
+  std::vector<core::Person> ppl;
+  ASSERT_FALSE(Convert(compact_ppl_pb, &ppl));
+}
@@ -0,0 +1,71 @@
+/**
+ *  @file
+ *  @brief   Tests for the pplme::proto::PersonFieldMask-based overloads of
+ *           pplme::proto::Convert().
+ *  @author  j.ho
+ */
+
+
+#include "libpplmecore/person_fields.h"
+#include "libpplmeproto/convert_person_field_mask.h"
+#include "libpplmeproto/person_field_mask.pb.h"
+#include "libpplmeutils/testlettes.h"
+
+
+namespace core = pplme::core;
+namespace proto = pplme::proto;
+using pplme::core::PersonField;
+using pplme::proto::Convert;
+
+
+PPLME_TESTLETTE_TYPE_BEGIN(PersonFieldMaskRoundtripTestlette)
+  core::PersonFields fields;
+PPLME_TESTLETTE_TYPE_END(PersonFieldMaskRoundtripTestlette,
+                         ConvertPersonFieldMaskTest_Roundtrip)
+
+TEST_P(ConvertPersonFieldMaskTest_Roundtrip, Tests) {
+  // Arrange.
+  auto const fields_in = GetParam().fields;
+
+  // Act.
+  proto::PersonFieldMask mask_pb;
+  Convert(fields_in, &mask_pb);
+  // (Something to be overwritten.)
+  core::PersonFields fields_out{PersonField::Name};
+  EXPECT_TRUE(Convert(mask_pb, &fields_out));
+
+  // Assert.
+  ASSERT_EQ(fields_in, fields_out);
+}
+
+PPLME_TESTLETTES_BEGIN(PersonFieldMaskRoundtripTestlette,
+                       person_field_mask_roundtrip_testlettes)
+  PPLME_TESTLETTE(core::PersonFields{}),
+  PPLME_TESTLETTE(core::PersonFields{PersonField::Name}),
+  PPLME_TESTLETTE(core::PersonFields{PersonField::DateOfBirth}),
+  PPLME_TESTLETTE(core::PersonFields{PersonField::LocationOfHome}),
+  PPLME_TESTLETTE(core::PersonFields{PersonField::Distance}),
+  PPLME_TESTLETTE(core::PersonFields::AllOfPerson()),
+  PPLME_TESTLETTE(core::PersonFields::AllOfPerson().Add(PersonField::Distance))
+PPLME_TESTLETTES_END(person_field_mask_roundtrip_testlettes,
+                     ConvertPersonFieldMaskTest_Roundtrip)
+
+
+TEST(ConvertPersonFieldMaskTest, EmptyMaskIsIdsOnly) {
+  proto::PersonFieldMask mask_pb;
+  auto fields = core::PersonFields::AllOfPerson();
+
+  ASSERT_TRUE(Convert(mask_pb, &fields));
+  ASSERT_EQ(core::PersonFields{}, fields);
+}
+
+
+TEST(ConvertPersonFieldMaskTest, DuplicateFieldsAreHarmless) {
+  proto::PersonFieldMask mask_pb;
+  mask_pb.add_fields(proto::PersonFieldMask::DISTANCE);
+  mask_pb.add_fields(proto::PersonFieldMask::DISTANCE);
+  core::PersonFields fields;
+
+  ASSERT_TRUE(Convert(mask_pb, &fields));
+  ASSERT_EQ(core::PersonFields{PersonField::Distance}, fields);
+}
@@ -0,0 +1,73 @@
+/**
+ *  @file
+ *  @brief   Tests for the pplme::core::PplCursor-based overloads of
+ *           pplme::proto::Convert().
+ *  @author  j.ho
+ */
+
+
+#include "libpplmecore/ppl_cursor.h"
+#include "libpplmeproto/convert_ppl_cursor.h"
+#include "libpplmeproto/ppl_cursor.pb.h"
+#include "libpplmeutils/testlettes.h"
+
+
+namespace core = pplme::core;
+namespace proto = pplme::proto;
+using pplme::proto::Convert;
+
+
+PPLME_TESTLETTE_TYPE_BEGIN(PplCursorRoundtripTestlette)
+  uint32_t ring;
+  uint32_t position;
+  uint32_t skip;
+PPLME_TESTLETTE_TYPE_END(PplCursorRoundtripTestlette,
+                         ConvertPplCursorTest_Roundtrip)
+
+TEST_P(ConvertPplCursorTest_Roundtrip, Tests) {
+  // Arrange.
+  core::PplCursor const cursor_in{
+      GetParam().ring, GetParam().position, GetParam().skip};
+
+  // Act.
+  std::string octets;
+  Convert(cursor_in, &octets);
+  core::PplCursor cursor_out{42, 42, 42};
+  EXPECT_TRUE(Convert(octets, &cursor_out));
+
+  // Assert.
+  ASSERT_FALSE(octets.empty());
+  ASSERT_EQ(cursor_in, cursor_out);
+}
+
+PPLME_TESTLETTES_BEGIN(PplCursorRoundtripTestlette,
+                       ppl_cursor_roundtrip_testlettes)
+  PPLME_TESTLETTE(0, 0, 0),
+  PPLME_TESTLETTE(0, 0, 10),
+  PPLME_TESTLETTE(1, 3, 0),
+  PPLME_TESTLETTE(36280, 145119, 4294967295u)
+PPLME_TESTLETTES_END(ppl_cursor_roundtrip_testlettes,
+                     ConvertPplCursorTest_Roundtrip)
+
+
+PPLME_TESTLETTE_TYPE_BEGIN(InvalidPplCursorTestlette)
+  std::string octets;
+PPLME_TESTLETTE_TYPE_END(InvalidPplCursorTestlette,
+                         ConvertPplCursorTest_InvalidPplCursor)
+
+TEST_P(ConvertPplCursorTest_InvalidPplCursor, Tests) {
+  core::PplCursor cursor{0, 0, 0};
+  ASSERT_FALSE(Convert(GetParam().octets, &cursor));
+}
+
+PPLME_TESTLETTES_BEGIN(InvalidPplCursorTestlette,
+                       invalid_ppl_cursor_testlettes)
+  PPLME_TESTLETTE(""),
+  PPLME_TESTLETTE("\xff"),
+  PPLME_TESTLETTE("garbage"),
+  // Just a ring.
+  PPLME_TESTLETTE("\x08\x01"),
+  // A ring and a position, but no skip.
+  PPLME_TESTLETTE("\x08\x01\x10\x02")
+PPLME_TESTLETTES_END(invalid_ppl_cursor_testlettes,
+                     ConvertPplCursorTest_InvalidPplCursor)
@@ -0,0 +1,115 @@
+/**
+ *  @file
+ *  @brief   Tests for the pplme::proto::PplMutation-based overloads of
+ *           pplme::proto::Convert().
+ *  @author  j.ho
+ */
+
+
+#include <boost/uuid/string_generator.hpp>
+#include <gtest/gtest.h>
+#include "libpplmecore/ppl_mutation.h"
+#include "libpplmeproto/convert_ppl_mutation.h"
+#include "libpplmeproto/ppl_mutation.pb.h"
+
+
+namespace core = pplme::core;
+namespace proto = pplme::proto;
+using pplme::proto::Convert;
+
+
+namespace {
+
+core::Person CreateTokenPerson() {
+  core::PersonId const kTokenPersonId{boost::uuids::string_generator()(
+      "3b1d6e0a-7d55-4e8b-9a54-2c1f0e8f4b11")};
+  core::GeoPosition const kTokenPos{core::GeoPosition::DecimalLatitude{52.2},
+                                    core::GeoPosition::DecimalLongitude{0.12}};
+  return core::Person{kTokenPersonId,
+                      "Ada Claddicker",
+                      boost::gregorian::date{1990, 3, 14},
+                      kTokenPos};
+}
+
+}  // namespace
+
+
+TEST(ConvertPplMutationTest, AddRoundtrip) {
+  // Arrange.
+  core::PplMutation const mutation_in{core::PplMutation::Kind::Add,
+                                      CreateTokenPerson()};
+
+  // Act.
+  proto::PplMutation proto_mutation;
+  Convert(mutation_in, &proto_mutation);
+  core::PplMutation mutation_out;
+  EXPECT_TRUE(Convert(proto_mutation, &mutation_out));
+
+  // Assert.
+  ASSERT_TRUE(mutation_out.kind == core::PplMutation::Kind::Add);
+  ASSERT_EQ(mutation_in.person.id(), mutation_out.person.id());
+  ASSERT_EQ(mutation_in.person.name(), mutation_out.person.name());
+  ASSERT_EQ(mutation_in.person.date_of_birth(),
+            mutation_out.person.date_of_birth());
+}
+
+
+/**
+ *  @test  A removal should only take (and only need) the id and location of
+ *         home.
+ */
+TEST(ConvertPplMutationTest, RemoveRoundtrip) {
+  // Arrange.
+  core::PplMutation const mutation_in{core::PplMutation::Kind::Remove,
+                                      CreateTokenPerson()};
+
+  // Act.
+  proto::PplMutation proto_mutation;
+  Convert(mutation_in, &proto_mutation);
+  core::PplMutation mutation_out;
+  EXPECT_TRUE(Convert(proto_mutation, &mutation_out));
+
+  // Assert.
+  ASSERT_FALSE(proto_mutation.removed().has_name());
+  ASSERT_FALSE(proto_mutation.removed().has_date_of_birth());
+  ASSERT_TRUE(mutation_out.kind == core::PplMutation::Kind::Remove);
+  ASSERT_EQ(mutation_in.person.id(), mutation_out.person.id());
+  ASSERT_EQ(mutation_in.person.location_of_home().latitude(),
+            mutation_out.person.location_of_home().latitude());
+  ASSERT_EQ(mutation_in.person.location_of_home().longitude(),
+            mutation_out.person.location_of_home().longitude());
+}
+
+
+TEST(ConvertPplMutationTest, ConvertFailsForNeitherOrBoth) {
+  // Arrange.
+  proto::PplMutation neither;
+  proto::PplMutation both;
+  Convert(core::PplMutation{core::PplMutation::Kind::Add, CreateTokenPerson()},
+          &both);
+  *both.mutable_removed() = both.added();
+
+  // Act & Assert.
+  core::PplMutation mutation;
+  ASSERT_FALSE(Convert(neither, &mutation));
+  ASSERT_FALSE(Convert(both, &mutation));
+}
+
+
+TEST(ConvertPplMutationTest, ConvertFailsForSomewhereOffTheMap) {
+  // Arrange.
+  proto::PplMutation added;
+  Convert(core::PplMutation{core::PplMutation::Kind::Add, CreateTokenPerson()},
+          &added);
+  added.mutable_added()->mutable_location_of_home()->set_latitude(91);
+  proto::PplMutation removed;
+  Convert(core::PplMutation{core::PplMutation::Kind::Remove,
+                            CreateTokenPerson()},
+          &removed);
+  removed.mutable_removed()->mutable_location_of_home()->set_longitude(-181);
+
+  // Act & Assert.
+  core::PplMutation mutation;
+  ASSERT_FALSE(Convert(added, &mutation));
+  ASSERT_FALSE(Convert(removed, &mutation));
+}
@@ -0,0 +1,88 @@
+/**
+ *  @file
+ *  @brief   Tests for the pplme::proto::PplmeResponse-based overloads of
+ *           pplme::proto::Convert().
+ *  @author  j.ho
+ */
+
+
+#include <boost/uuid/random_generator.hpp>
+#include <google/protobuf/arena.h>
+#include <gtest/gtest.h>
+#include "libpplmecore/person.h"
+#include "libpplmeproto/convert_pplme_response.h"
+#include "libpplmeproto/pplme_response.pb.h"
+
+
+namespace core = pplme::core;
+namespace proto = pplme::proto;
+using pplme::proto::Convert;
+
+
+namespace {
+
+std::vector<core::Person> CreateTokenPpl() {
+  std::vector<core::Person> ppl;
+  for (int n = 0; n < 3; ++n) {
+    ppl.emplace_back(
+        core::PersonId{boost::uuids::random_generator()()},
+        "Babe " + std::to_string(n),
+        boost::gregorian::date(1990 + n, 1 + n, 10 + n),
+        core::GeoPosition{core::GeoPosition::DecimalLatitude(10.0f * n),
+                          core::GeoPosition::DecimalLongitude(-20.0f * n)});
+  }
+  return ppl;
+}
+
+}  // namespace
+
+
+TEST(ConvertPplmeResponseTest, Roundtrip) {
+  // Arrange.
+  auto ppl_in = CreateTokenPpl();
+
+  // Act.
+  proto::PplmeResponse response_pb;
+  Convert(ppl_in, &response_pb);
+  std::vector<core::Person> ppl_out;
+  EXPECT_TRUE(Convert(response_pb, &ppl_out));
+
+  // Assert.
+  ASSERT_EQ(ppl_in.size(), ppl_out.size());
+  for (size_t n = 0; n < ppl_in.size(); ++n) {
+    ASSERT_EQ(ppl_in[n].id(), ppl_out[n].id());
+    ASSERT_EQ(ppl_in[n].name(), ppl_out[n].name());
+    ASSERT_EQ(ppl_in[n].date_of_birth(), ppl_out[n].date_of_birth());
+  }
+}
+
+
+TEST(ConvertPplmeResponseTest, ArenaAndHeapSerializeIdentically) {
+  // Arrange.
+  auto ppl = CreateTokenPpl();
+  google::protobuf::Arena arena;
+
+  // Act.
+  proto::PplmeResponse heap_response_pb;
+  Convert(ppl, &heap_response_pb);
+  auto arena_response_pb =
+      google::protobuf::Arena::CreateMessage<proto::PplmeResponse>(&arena);
+  Convert(ppl, arena_response_pb);
+
+  // Assert.
+  ASSERT_EQ(&arena, arena_response_pb->mutable_ppl(0)->GetArena());
+  ASSERT_EQ(heap_response_pb.SerializeAsString(),
+            arena_response_pb->SerializeAsString());
+}
+
+
+TEST(ConvertPplmeResponseTest, ConvertFailsForInvalidProtoPerson) {
+  // Arrange.
+  proto::PplmeResponse response_pb;
+  Convert(CreateTokenPpl(), &response_pb);
+  response_pb.mutable_ppl(1)->clear_id();
+
+  // Act & Assert.
+  std::vector<core::Person> ppl;
+  ASSERT_FALSE(Convert(response_pb, &ppl));
+}
@@ -0,0 +1,315 @@
+/**
+ *  @file
+ *  @brief   Tests for pplme::proto::EncodePplEntry() and friends.
+ *  @author  j.ho
+ */
+
+
+#include <boost/uuid/string_generator.hpp>
+#include "libpplmecore/person.h"
+#include "libpplmeproto/convert_compact_ppl.h"
+#include "libpplmeproto/convert_date.h"
+#include "libpplmeproto/convert_person.h"
+#include "libpplmeproto/convert_pplme_response.h"
+#include "libpplmeproto/encode_pplme_response.h"
+#include "libpplmeproto/convert_uuid.h"
+#include "libpplmeproto/person.pb.h"
+#include "libpplmeproto/pplme_response.pb.h"
+#include "libpplmeutils/testlettes.h"
+
+
+namespace core = pplme::core;
+namespace proto = pplme::proto;
+
+
+namespace {
+
+core::Person CreatePerson(std::string name,
+                          boost::gregorian::date date_of_birth,
+                          float latitude,
+                          float longitude) {
+  core::PersonId const kTokenPersonId{boost::uuids::string_generator()(
+      "7d1c3c1e-5f0b-4d55-9a3c-2b8e4f1a6c90")};
+  return core::Person{
+      kTokenPersonId,
+      std::move(name),
+      date_of_birth,
+      core::GeoPosition{core::GeoPosition::DecimalLatitude{latitude},
+                        core::GeoPosition::DecimalLongitude{longitude}}};
+}
+
+
+/** Encode @a ppl the hand-rolled way. */
+std::string Encode(std::vector<core::Person> const& ppl) {
+  size_t size = 0;
+  for (auto const& person : ppl)
+    size += proto::GetEncodedPplEntrySize(person);
+
+  std::string octets(size, '\0');
+  auto target = reinterpret_cast<uint8_t*>(&octets[0]);
+  for (auto const& person : ppl) {
+    auto const entry_end = proto::EncodePplEntry(person, target);
+    EXPECT_EQ(proto::GetEncodedPplEntrySize(person),
+              static_cast<size_t>(entry_end - target));
+    target = entry_end;
+  }
+
+  return octets;
+}
+
+
+/** Encode @a ppl the protobuf way. */
+std::string Serialize(std::vector<core::Person> const& ppl) {
+  proto::PplmeResponse response_pb;
+  proto::Convert(ppl, &response_pb);
+  return response_pb.SerializeAsString();
+}
+
+
+/** Encode @a ppl the hand-rolled, version 2 way. */
+std::string EncodeCompact(std::vector<core::Person> const& ppl) {
+  proto::CompactPplEncoder encoder;
+  for (auto const& person : ppl)
+    encoder.Add(person);
+
+  std::string octets(encoder.GetEncodedSize(), '\0');
+  auto target = reinterpret_cast<uint8_t*>(&octets[0]);
+  EXPECT_EQ(target + octets.size(), encoder.Encode(target));
+
+  return octets;
+}
+
+
+/** Encode @a ppl the protobuf, version 2 way. */
+std::string SerializeCompact(std::vector<core::Person> const& ppl) {
+  proto::PplmeResponse response_pb;
+  proto::Convert(ppl, response_pb.mutable_compact_ppl());
+  return response_pb.SerializeAsString();
+}
+
+
+/** Encode @a ppl's @a fields (and some made up distances) the hand-rolled way,
+    in both versions, one after the other. */
+std::string EncodeFields(std::vector<core::Person> const& ppl,
+                         core::PersonFields const& fields) {
+  std::string octets;
+  proto::CompactPplEncoder encoder{fields};
+  for (size_t n = 0; n < ppl.size(); ++n) {
+    // If the Person isn't wanted, then don't give the encoder one.
+    auto const entry = fields.NeedsPerson() ?
+        proto::PplEntry{ppl[n], n * 1.5f} :
+        proto::PplEntry{ppl[n].id(), n * 1.5f};
+    std::string entry_octets(proto::GetEncodedPplEntrySize(entry, fields),
+                             '\0');
+    auto target = reinterpret_cast<uint8_t*>(&entry_octets[0]);
+    EXPECT_EQ(target + entry_octets.size(),
+              proto::EncodePplEntry(entry, fields, target));
+    octets += entry_octets;
+    encoder.Add(entry);
+  }
+
+  std::string compact_octets(encoder.GetEncodedSize(), '\0');
+  encoder.Encode(reinterpret_cast<uint8_t*>(&compact_octets[0]));
+  return octets + compact_octets;
+}
+
+
+/** Encode @a ppl's @a fields (and the same made up distances) the protobuf
+    way, in both versions, one after the other. */
+std::string SerializeFields(std::vector<core::Person> const& ppl,
+                            core::PersonFields const& fields) {
+  using core::PersonField;
+  proto::PplmeResponse response_pb;
+  proto::PplmeResponse compact_response_pb;
+  auto& compact_pb = *compact_response_pb.mutable_compact_ppl();
+  compact_pb.set_ids("");
+  for (size_t n = 0; n < ppl.size(); ++n) {
+    auto const& person = ppl[n];
+    auto const distance = n * 1.5f;
+
+    auto& person_pb = *response_pb.add_ppl();
+    proto::Convert(person, fields, &person_pb);
+    if (fields.Has(PersonField::Distance))
+      person_pb.set_distance(distance);
+
+    compact_pb.mutable_ids()->append(
+        reinterpret_cast<char const*>(&*person.id().value().begin()), 16);
+    if (fields.Has(PersonField::Name))
+      compact_pb.add_names(person.name());
+    if (fields.Has(PersonField::DateOfBirth))
+      compact_pb.add_dates_of_birth(proto::PackYmd(person.date_of_birth()));
+    if (fields.Has(PersonField::LocationOfHome)) {
+      auto const& home = person.location_of_home();
+      compact_pb.add_latitudes(home.latitude().value());
+      compact_pb.add_longitudes(home.longitude().value());
+    }
+    if (fields.Has(PersonField::Distance))
+      compact_pb.add_distances(distance);
+  }
+
+  return response_pb.SerializeAsString()
+      + compact_response_pb.SerializeAsString();
+}
+
+}  // namespace
+
+
+PPLME_TESTLETTE_TYPE_BEGIN(EncodePplEntryTestlette)
+  std::string name;
+  boost::gregorian::date date_of_birth;
+  float latitude;
+  float longitude;
+PPLME_TESTLETTE_TYPE_END(EncodePplEntryTestlette,
+                         EncodePplmeResponseTest_EncodePplEntry)
+
+TEST_P(EncodePplmeResponseTest_EncodePplEntry, Tests) {
+  // Arrange.
+  std::vector<core::Person> ppl{CreatePerson(GetParam().name,
+                                             GetParam().date_of_birth,
+                                             GetParam().latitude,
+                                             GetParam().longitude)};
+
+  // Act & Assert.
+  ASSERT_EQ(Serialize(ppl), Encode(ppl));
+  ASSERT_EQ(SerializeCompact(ppl), EncodeCompact(ppl));
+}
+
+PPLME_TESTLETTES_BEGIN(EncodePplEntryTestlette, encode_ppl_entry_testlettes)
+  PPLME_TESTLETTE("Baberaham Lincoln", { 2014, 10, 28 }, 65.4, -10.9),
+  PPLME_TESTLETTE("", { 1984, 11, 8 }, 0, 0),
+  // Long enough to need a two-octet length (and so push the Person's length
+  // into two octets too).
+  PPLME_TESTLETTE(std::string(200, 'J'), { 1970, 1, 1 }, -90, 180),
+  PPLME_TESTLETTE(std::string(20000, 'M'), { 1970, 1, 1 }, 90, -180),
+  PPLME_TESTLETTE(u8"Zoë Château", { 1400, 1, 1 }, -0.0, 1e-6),
+  PPLME_TESTLETTE("Babe Ruth", { 9999, 12, 31 }, 51.5, -0.1)
+PPLME_TESTLETTES_END(encode_ppl_entry_testlettes,
+                     EncodePplmeResponseTest_EncodePplEntry)
+
+
+TEST(EncodePplmeResponseTest, EncodesMultiplePplAsAResponse) {
+  // Arrange.
+  std::vector<core::Person> ppl;
+  for (int n = 0; n < 100; ++n) {
+    ppl.push_back(CreatePerson(
+        "John Malkovich " + std::to_string(n),
+        boost::gregorian::date{1970, 1, 1} + boost::gregorian::days{n * 97},
+        n * 0.9f - 45,
+        n * 1.8f - 90));
+  }
+
+  // Act.
+  auto const octets = Encode(ppl);
+  proto::PplmeResponse response_pb;
+  std::vector<core::Person> decoded_ppl;
+
+  // Assert.
+  ASSERT_EQ(Serialize(ppl), octets);
+  ASSERT_EQ(SerializeCompact(ppl), EncodeCompact(ppl));
+  ASSERT_TRUE(response_pb.ParseFromString(octets));
+  ASSERT_TRUE(proto::Convert(response_pb, &decoded_ppl));
+  ASSERT_EQ(ppl.size(), decoded_ppl.size());
+}
+
+
+TEST(EncodePplmeResponseTest, EmptyResponseIsNoOctets) {
+  ASSERT_EQ(Serialize({}), Encode({}));
+  ASSERT_TRUE(Encode({}).empty());
+}
+
+
+TEST(EncodePplmeResponseTest, EmptyCompactResponseIsStillCompact) {
+  auto const octets = EncodeCompact({});
+  proto::PplmeResponse response_pb;
+
+  ASSERT_EQ(SerializeCompact({}), octets);
+  ASSERT_TRUE(response_pb.ParseFromString(octets));
+  ASSERT_TRUE(response_pb.has_compact_ppl());
+}
+
+
+PPLME_TESTLETTE_TYPE_BEGIN(EncodeFieldsTestlette)
+  core::PersonFields fields;
+PPLME_TESTLETTE_TYPE_END(EncodeFieldsTestlette,
+                         EncodePplmeResponseTest_EncodeFields)
+
+TEST_P(EncodePplmeResponseTest_EncodeFields, Tests) {
+  // Arrange.
+  std::vector<core::Person> ppl;
+  for (int n = 0; n < 10; ++n) {
+    ppl.push_back(CreatePerson(
+        "Ruth Babe " + std::to_string(n),
+        boost::gregorian::date{1970, 1, 1} + boost::gregorian::days{n * 97},
+        n * 9.f - 45,
+        n * 18.f - 90));
+  }
+
+  // Act & Assert.
+  ASSERT_EQ(SerializeFields(ppl, GetParam().fields),
+            EncodeFields(ppl, GetParam().fields));
+}
+
+using core::PersonField;
+PPLME_TESTLETTES_BEGIN(EncodeFieldsTestlette, encode_fields_testlettes)
+  PPLME_TESTLETTE(core::PersonFields{}),
+  PPLME_TESTLETTE(core::PersonFields{PersonField::Distance}),
+  PPLME_TESTLETTE(core::PersonFields{PersonField::Name}),
+  PPLME_TESTLETTE(core::PersonFields{PersonField::DateOfBirth}),
+  PPLME_TESTLETTE(core::PersonFields{PersonField::LocationOfHome,
+                                     PersonField::Distance}),
+  PPLME_TESTLETTE(core::PersonFields::AllOfPerson()),
+  PPLME_TESTLETTE(core::PersonFields::AllOfPerson().Add(PersonField::Distance))
+PPLME_TESTLETTES_END(encode_fields_testlettes,
+                     EncodePplmeResponseTest_EncodeFields)
+
+
+TEST(EncodePplmeResponseTest, EncodesNextCursorAfterEitherVersion) {
+  // Arrange.
+  std::vector<core::Person> ppl{
+      CreatePerson("Page Turner", { 1980, 2, 29 }, 1, 2)};
+  std::string const next_cursor{"\x08\x01\x10\x02\x18\x03"};
+  proto::PplmeResponse response_pb;
+  proto::Convert(ppl, &response_pb);
+  response_pb.set_next_cursor(next_cursor);
+  proto::PplmeResponse compact_response_pb;
+  proto::Convert(ppl, compact_response_pb.mutable_compact_ppl());
+  compact_response_pb.set_next_cursor(next_cursor);
+
+  // Act.
+  std::string encoded_next_cursor(
+      proto::GetEncodedNextCursorSize(next_cursor), '\0');
+  auto const target = reinterpret_cast<uint8_t*>(&encoded_next_cursor[0]);
+  auto const end = proto::EncodeNextCursor(next_cursor, target);
+
+  // Assert.
+  ASSERT_EQ(target + encoded_next_cursor.size(), end);
+  ASSERT_EQ(response_pb.SerializeAsString(),
+            Encode(ppl) + encoded_next_cursor);
+  ASSERT_EQ(compact_response_pb.SerializeAsString(),
+            EncodeCompact(ppl) + encoded_next_cursor);
+}
+
+
+TEST(EncodePplmeResponseTest, EncodesPartialAfterNextCursor) {
+  // Arrange.
+  std::vector<core::Person> ppl{
+      CreatePerson("Rush Job", { 1979, 6, 1 }, 3, 4)};
+  std::string const next_cursor{"\x08\x02\x10\x05"};
+  proto::PplmeResponse response_pb;
+  proto::Convert(ppl, &response_pb);
+  response_pb.set_next_cursor(next_cursor);
+  response_pb.set_partial(true);
+
+  // Act.
+  std::string encoded_tail(
+      proto::GetEncodedNextCursorSize(next_cursor)
+          + proto::GetEncodedPartialSize(),
+      '\0');
+  auto const target = reinterpret_cast<uint8_t*>(&encoded_tail[0]);
+  auto const end =
+      proto::EncodePartial(proto::EncodeNextCursor(next_cursor, target));
+
+  // Assert.
+  ASSERT_EQ(target + encoded_tail.size(), end);
+  ASSERT_EQ(response_pb.SerializeAsString(), Encode(ppl) + encoded_tail);
+}
@@ -0,0 +1,269 @@
+/**
+ *  @file
+ *  @brief   Implementation for pplme::repl::ChangeFeedFollower.
+ *  @author  j.ho
+ */
+
+
+#include "change_feed_follower.h"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <boost/numeric/conversion/cast.hpp>
+#include <boost/optional.hpp>
+#include <glog/logging.h>
+#include "libpplmecore/ppl_mutation.h"
+#include "libpplmeengine/pplme_matching_ppl_provider.h"
+#include "libpplmenet/client.h"
+#include "libpplmenet/message.h"
+#include "libpplmeproto/change_feed.pb.h"
+#include "libpplmeproto/convert_ppl_mutation.h"
+#include "libpplmeproto/ppl_mutation.pb.h"
+#include "libpplmeproto/request.pb.h"
+
+
+namespace {
+
+
+/** How long the writer may sit on a request when there's nothing new. */
+std::chrono::milliseconds const kWait{500};
+
+/** How long to leave it before trying an unreachable writer again. */
+std::chrono::seconds const kRetryInterval{1};
+
+
+}  // namespace
+
+
+namespace pplme {
+namespace repl {
+
+
+class ChangeFeedFollower::Impl {
+ public:
+  Impl(std::string const& writer_address,
+       unsigned short writer_port,
+       engine::PplmeMatchingPplProvider* ppl_provider) :
+      writer_address_{writer_address},
+      writer_port_{writer_port},
+      ppl_provider_{CHECK_NOTNULL(ppl_provider)},
+      stopping_{false},
+      applied_sequence_{0},
+      latest_sequence_{0},
+      last_contact_{std::chrono::steady_clock::now()},
+      derailed_{false} {}
+
+
+  ~Impl() {
+    /* lock block */ {
+      std::unique_lock<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    stopping_or_applied_.notify_all();
+    if (thread_.joinable())
+      thread_.join();
+  }
+
+
+  void Start() {
+    CHECK(!thread_.joinable()) << "Already started";
+    last_contact_ = std::chrono::steady_clock::now();
+    thread_ = std::thread{[this]() { Follow(); }};
+  }
+
+
+  Status GetStatus() const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return Status{applied_sequence_,
+                  latest_sequence_,
+                  std::chrono::duration_cast<std::chrono::milliseconds>(
+                      std::chrono::steady_clock::now() - last_contact_),
+                  derailed_};
+  }
+
+
+  bool WaitUntilCaughtUp() const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stopping_or_applied_.wait(lock, [this]() {
+        return derailed_
+            || (first_latest_sequence_
+                && applied_sequence_ >= *first_latest_sequence_);
+      });
+    return !derailed_;
+  }
+
+
+  bool WaitUntilApplied(uint64_t sequence,
+                        std::chrono::milliseconds timeout) const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return stopping_or_applied_.wait_for(lock, timeout, [this, sequence]() {
+        return applied_sequence_ >= sequence;
+      });
+  }
+
+
+ private:
+  std::string const writer_address_;
+  unsigned short const writer_port_;
+  engine::PplmeMatchingPplProvider* const ppl_provider_;
+  std::thread thread_;
+  mutable std::mutex mutex_;
+  mutable std::condition_variable stopping_or_applied_;
+  bool stopping_;
+  /** @see  ChangeFeedFollower::Status. */
+  uint64_t applied_sequence_;
+  uint64_t latest_sequence_;
+  std::chrono::steady_clock::time_point last_contact_;
+  bool derailed_;
+  /** As of when the writer was first heard from. */
+  boost::optional<uint64_t> first_latest_sequence_;
+  boost::optional<uint64_t> feed_id_;
+
+
+  void Follow() {
+    std::unique_ptr<net::Client> client;
+    while (!IsStopping()) {
+      auto const reusing_client = client != nullptr;
+      if (!client) {
+        client.reset(new net::Client{writer_address_, writer_port_});
+        if (!client->Connect()) {
+          LOG(WARNING) << "Unable to connect to writer " << writer_address_
+                       << ":" << writer_port_ << "; will try again";
+          client.reset();
+          WaitToRetry();
+          continue;
+        }
+      }
+
+      auto const response = client->SendRequest(*CreateRequest());
+      proto::ChangeFeedResponse response_pb;
+      if (!response) {
+        client.reset();
+        // (A writer without --keep_alive hangs up after every response.)
+        if (reusing_client)
+          continue;
+        LOG(WARNING) << "No response from writer " << writer_address_ << ":"
+                     << writer_port_ << "; will try again";
+        WaitToRetry();
+        continue;
+      }
+      if (!response_pb.ParseFromArray(response->GetBodyOctets(),
+                                      response->GetBodyLength())) {
+        Derail("Invalid response from writer");
+        return;
+      }
+      if (response_pb.rejected()) {
+        Derail("Not a writer");
+        return;
+      }
+      if (feed_id_ && *feed_id_ != response_pb.feed_id()) {
+        Derail("Writer has been restarted");
+        return;
+      }
+
+      std::vector<core::PplMutation> mutations(response_pb.mutations_size());
+      for (int n = 0; n < response_pb.mutations_size(); ++n) {
+        proto::PplMutation mutation_pb;
+        if (!mutation_pb.ParseFromString(response_pb.mutations(n))
+            || !proto::Convert(mutation_pb, &mutations[n])) {
+          Derail("Invalid mutation from writer");
+          return;
+        }
+      }
+      if (!mutations.empty())
+        ppl_provider_->ApplyPplMutations(std::move(mutations));
+
+      /* lock block */ {
+        std::unique_lock<std::mutex> lock(mutex_);
+        feed_id_ = response_pb.feed_id();
+        applied_sequence_ += response_pb.mutations_size();
+        latest_sequence_ =
+            std::max(response_pb.latest_sequence(), applied_sequence_);
+        last_contact_ = std::chrono::steady_clock::now();
+        if (!first_latest_sequence_)
+          first_latest_sequence_ = latest_sequence_;
+      }
+      stopping_or_applied_.notify_all();
+    }
+  }
+
+
+  bool IsStopping() const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return stopping_;
+  }
+
+
+  void WaitToRetry() const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stopping_or_applied_.wait_for(lock, kRetryInterval,
+                                  [this]() { return stopping_; });
+  }
+
+
+  void Derail(char const* reason) {
+    LOG(ERROR) << reason << " (" << writer_address_ << ":" << writer_port_
+               << "); no longer following it";
+    /* lock block */ {
+      std::unique_lock<std::mutex> lock(mutex_);
+      derailed_ = true;
+    }
+    stopping_or_applied_.notify_all();
+  }
+
+
+  std::unique_ptr<net::Message> CreateRequest() const {
+    proto::Request request_pb;
+    auto& change_feed_request_pb = *request_pb.mutable_change_feed_request();
+    /* lock block */ {
+      std::unique_lock<std::mutex> lock(mutex_);
+      change_feed_request_pb.set_after_sequence(applied_sequence_);
+    }
+    change_feed_request_pb.set_wait_ms(
+        boost::numeric_cast<uint32_t>(kWait.count()));
+
+    auto const request_size =
+        boost::numeric_cast<uint32_t>(request_pb.ByteSize());
+    auto request_body = net::Message::CreateBodyBuffer(request_size);
+    request_pb.SerializeWithCachedSizesToArray(request_body.get());
+    return std::unique_ptr<net::Message>{
+        new net::Message{std::move(request_body), request_size}};
+  }
+};
+
+
+ChangeFeedFollower::ChangeFeedFollower(
+    std::string const& writer_address,
+    unsigned short writer_port,
+    engine::PplmeMatchingPplProvider* ppl_provider) :
+    impl_{new Impl{writer_address, writer_port, ppl_provider}} {}
+
+
+ChangeFeedFollower::~ChangeFeedFollower() = default;
+
+
+void ChangeFeedFollower::Start() {
+  impl_->Start();
+}
+
+
+ChangeFeedFollower::Status ChangeFeedFollower::GetStatus() const {
+  return impl_->GetStatus();
+}
+
+
+bool ChangeFeedFollower::WaitUntilCaughtUp() const {
+  return impl_->WaitUntilCaughtUp();
+}
+
+
+bool ChangeFeedFollower::WaitUntilApplied(
+    uint64_t sequence, std::chrono::milliseconds timeout) const {
+  return impl_->WaitUntilApplied(sequence, timeout);
+}
+
+
+}  // namespace repl
+}  // namespace pplme
@@ -0,0 +1,102 @@
+/**
+ *  @file
+ *  @brief   Definition of pplme::repl::ChangeFeedFollower, which keeps a read
+ *           replica's ppl in step with a writer pplmed's.
+ *  @author  j.ho
+ */
+#ifndef PPLME_LIBPPLMEREPL_CHANGEFEEDFOLLOWER_H_
+#define PPLME_LIBPPLMEREPL_CHANGEFEEDFOLLOWER_H_
+
+
+#include <stdint.h>
+#include <chrono>
+#include <string>
+#include "libpplmeutils/pimpl.h"
+
+
+namespace pplme {
+namespace engine {
+class PplmeMatchingPplProvider;
+}  // namespace engine
+}  // namespace pplme
+
+
+namespace pplme {
+namespace repl {
+
+
+/**
+ *  Example:
+ *  @code
+ *  ChangeFeedFollower follower{"writer", 3333, &ppl_provider};
+ *  follower.Start();
+ *  follower.WaitUntilCaughtUp();
+ *  @endcode
+ *
+ *  @remarks
+ *  A thread of the follower's own asks the writer for whatever mutations
+ *  come after the last one that it has applied (waiting a while at the
+ *  writer's end if there aren't any yet), applies them, and asks again.
+ *  Mutations are applied in the batches that they come in, each batch all
+ *  in one go (@see engine::PplmeMatchingPplProvider::ApplyPplMutations()).
+ *  The one connection is used throughout, so the writer should be run with
+ *  --keep_alive (without it, every request needs a new connection).
+ *
+ *  If the writer can't be reached, the follower keeps trying (every second
+ *  or so) for as long as it takes.  If the writer turns out to have been
+ *  restarted (its feed id is different), or it sends a mutation that makes
+ *  no sense, then the follower can't know how the ppl that it has differ
+ *  from the writer's, so it stops following and says so (in the logs and
+ *  its Status); the replica needs restarting.
+ *
+ *  @note
+ *  This class is safe to use concurrently.
+ */
+class ChangeFeedFollower {
+ public:
+  ChangeFeedFollower(std::string const& writer_address,
+                     unsigned short writer_port,
+                     engine::PplmeMatchingPplProvider* ppl_provider);
+  /** Stops following (which may take as long as a request to the writer). */
+  ~ChangeFeedFollower();
+
+  ChangeFeedFollower(ChangeFeedFollower const&) = delete;
+  ChangeFeedFollower& operator=(ChangeFeedFollower const&) = delete;
+
+  void Start();
+
+  struct Status {
+    /** The last mutation applied (0 for none). */
+    uint64_t applied_sequence;
+    /** The writer's latest mutation, as of when it was last heard from. */
+    uint64_t latest_sequence;
+    /** How long since the writer was last heard from (or since Start(), if
+        it never has been). */
+    std::chrono::milliseconds since_contact;
+    /** True iff the follower has given up (@see the class remarks). */
+    bool derailed;
+  };
+
+  Status GetStatus() const;
+
+  /** Wait until every mutation that the writer had when it was first heard
+      from has been applied (or the follower has derailed).  @returns  True
+      iff it was the former. */
+  bool WaitUntilCaughtUp() const;
+
+  /** Wait up to @a timeout for @a sequence to have been applied.  @returns
+      True iff it was. */
+  bool WaitUntilApplied(uint64_t sequence,
+                        std::chrono::milliseconds timeout) const;
+
+ private:
+  class Impl;
+  utils::Pimpl<Impl> impl_;
+};
+
+
+}  // namespace repl
+}  // namespace pplme
+
+
+#endif  // PPLME_LIBPPLMEREPL_CHANGEFEEDFOLLOWER_H_
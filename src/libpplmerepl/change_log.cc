@@ -0,0 +1,87 @@
+/**
+ *  @file
+ *  @brief   Implementation for pplme::repl::ChangeLog.
+ *  @author  j.ho
+ */
+
+
+#include "change_log.h"
+#include <random>
+#include <glog/logging.h>
+#include "libpplmeproto/change_feed.pb.h"
+
+
+namespace pplme {
+namespace repl {
+
+
+size_t const ChangeLog::kChunkSize;
+size_t const ChangeLog::kMaxReadOctets;
+
+
+ChangeLog::ChangeLog() :
+    feed_id_{[]() {
+        std::random_device random_device;
+        return (uint64_t{random_device()} << 32) | random_device();
+      }()} {}
+
+
+uint64_t ChangeLog::Append(std::vector<std::string> const& mutations) {
+  uint64_t sequence;
+  /* lock block */ {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (auto const& mutation : mutations) {
+      CHECK(mutation.size() <= kChunkSize) << "Mutation too big to log";
+      if (chunks_.empty()
+          || chunks_.back().size() + mutation.size() > kChunkSize) {
+        chunks_.emplace_back();
+        chunks_.back().reserve(kChunkSize);
+      }
+      auto& chunk = chunks_.back();
+      entries_.push_back(Entry{static_cast<uint32_t>(chunks_.size() - 1),
+                               static_cast<uint32_t>(chunk.size()),
+                               static_cast<uint32_t>(mutation.size())});
+      chunk.append(mutation);
+    }
+    sequence = entries_.size();
+  }
+  if (!mutations.empty())
+    appended_.notify_all();
+  return sequence;
+}
+
+
+uint64_t ChangeLog::GetLatestSequence() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+
+void ChangeLog::Read(uint64_t after_sequence,
+                     std::chrono::milliseconds wait,
+                     proto::ChangeFeedResponse* response) const {
+  CHECK_NOTNULL(response);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  appended_.wait_for(lock, wait, [this, after_sequence]() {
+      return entries_.size() > after_sequence;
+    });
+
+  size_t octets = 0;
+  for (auto sequence = after_sequence;
+       sequence < entries_.size()
+           && (octets == 0 || octets + entries_[sequence].size
+                                  <= kMaxReadOctets);
+       ++sequence) {
+    auto const& entry = entries_[sequence];
+    response->add_mutations(chunks_[entry.chunk].data() + entry.offset,
+                            entry.size);
+    octets += entry.size;
+  }
+  response->set_latest_sequence(entries_.size());
+  response->set_feed_id(feed_id_);
+}
+
+
+}  // namespace repl
+}  // namespace pplme
@@ -0,0 +1,105 @@
+/**
+ *  @file
+ *  @brief   Definition of pplme::repl::ChangeLog, a writer pplmed's
+ *           append-only log of ppl coming and going, from which its read
+ *           replicas follow along.
+ *  @author  j.ho
+ */
+#ifndef PPLME_LIBPPLMEREPL_CHANGELOG_H_
+#define PPLME_LIBPPLMEREPL_CHANGELOG_H_
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+namespace pplme {
+namespace proto {
+class ChangeFeedResponse;
+}  // namespace proto
+}  // namespace pplme
+
+
+namespace pplme {
+namespace repl {
+
+
+/**
+ *  Example:
+ *  @code
+ *  ChangeLog change_log;
+ *  // The writer, having made some mutations:
+ *  auto const sequence = change_log.Append(serialized_ppl_mutations);
+ *  // And for a replica that has everything up to after_sequence:
+ *  proto::ChangeFeedResponse response;
+ *  change_log.Read(after_sequence, std::chrono::seconds(1), &response);
+ *  @endcode
+ *
+ *  @remarks
+ *  Each mutation is a serialized proto::PplMutation, numbered from 1 in the
+ *  order appended (its sequence).  They're kept in chunks, a few octets of
+ *  bookkeeping apiece, rather than as a string each, since a writer that
+ *  logs its whole dataset has an awful lot of them.  Nothing is ever let
+ *  go of, so a replica can always start from scratch.
+ *
+ *  @note
+ *  This class is safe to use concurrently.
+ */
+class ChangeLog {
+ public:
+  /** Chunks are this big, and so, too, is the biggest mutation. */
+  static size_t const kChunkSize = 1024 * 1024;
+  /** About how much of the log goes in each ChangeFeedResponse (so as to
+      stay well inside net::Message::kMaxBodyLength). */
+  static size_t const kMaxReadOctets = 512 * 1024;
+
+  /** Makes up a feed id, so that replicas can tell one log from another. */
+  ChangeLog();
+
+  ChangeLog(ChangeLog const&) = delete;
+  ChangeLog& operator=(ChangeLog const&) = delete;
+
+  /** @returns  The sequence of the last of @a mutations (or the latest
+                sequence, if there aren't any). */
+  uint64_t Append(std::vector<std::string> const& mutations);
+
+  uint64_t GetLatestSequence() const;
+  uint64_t GetFeedId() const { return feed_id_; }
+
+  /**
+   *  Fill in @a response with those mutations after @a after_sequence (as
+   *  many as kMaxReadOctets allows, but at least one), waiting up to @a wait
+   *  for there to be any if there aren't yet, plus the latest sequence and
+   *  the feed id.
+   */
+  void Read(uint64_t after_sequence,
+            std::chrono::milliseconds wait,
+            proto::ChangeFeedResponse* response) const;
+
+ private:
+  /** Where a mutation is. */
+  struct Entry {
+    uint32_t chunk;
+    uint32_t offset;
+    uint32_t size;
+  };
+
+  uint64_t const feed_id_;
+  mutable std::mutex mutex_;
+  mutable std::condition_variable appended_;
+  std::vector<std::string> chunks_;
+  /** Mutation n (in sequence) is entries_[n - 1]. */
+  std::vector<Entry> entries_;
+};
+
+
+}  // namespace repl
+}  // namespace pplme
+
+
+#endif  // PPLME_LIBPPLMEREPL_CHANGELOG_H_
@@ -0,0 +1,163 @@
+/**
+ *  @file
+ *  @brief   Commit and replay throughput benchmarks for
+ *           pplme::repl::WriteAheadLog.
+ *  @author  j.ho
+ *
+ *  The logs go in $TMPDIR (or /tmp), so the commit figures are only as
+ *  meaningful as the disk that that's on.
+ */
+
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <random>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include <boost/uuid/random_generator.hpp>
+#include <glog/logging.h>
+#include "libpplmecore/person.h"
+#include "libpplmecore/ppl_mutation.h"
+#include "libpplmeengine/pplme_matching_ppl_provider.h"
+#include "libpplmeproto/convert_ppl_mutation.h"
+#include "libpplmeproto/ppl_mutation.pb.h"
+#include "libpplmerepl/write_ahead_log.h"
+
+
+namespace core = pplme::core;
+using pplme::engine::PplmeMatchingPplProvider;
+using pplme::repl::WriteAheadLog;
+
+
+namespace {
+
+
+unsigned int const kSeed = 20150606;
+
+
+boost::gregorian::date GetTodaysDate() {
+  return boost::gregorian::date{2015, 6, 6};
+}
+
+
+/** A log directory of its own, gone again afterwards. */
+class TemporaryDirectory {
+ public:
+  TemporaryDirectory() {
+    auto const tmpdir = getenv("TMPDIR");
+    auto path = std::string{tmpdir ? tmpdir : "/tmp"}
+        + "/pplme_wal_benchXXXXXX";
+    CHECK(mkdtemp(&path[0]) != nullptr) << "Failed to create " << path;
+    path_ = path;
+  }
+
+  ~TemporaryDirectory() {
+    if (auto const dir = opendir(path_.c_str())) {
+      while (auto const entry = readdir(dir))
+        unlink((path_ + "/" + entry->d_name).c_str());
+      closedir(dir);
+    }
+    rmdir(path_.c_str());
+  }
+
+  std::string const& GetPath() const { return path_; }
+
+ private:
+  std::string path_;
+};
+
+
+/** @returns  @a count serialized additions of ppl scattered about. */
+std::vector<std::string> CreateAdditions(int64_t count) {
+  std::mt19937 generator{kSeed};
+  std::uniform_real_distribution<float> latitudes{-90, 90};
+  std::uniform_real_distribution<float> longitudes{-180, 180};
+  std::uniform_int_distribution<int> ages{0, 100 * 365};
+  boost::uuids::random_generator uuid_generator;
+
+  std::vector<std::string> additions;
+  additions.reserve(count);
+  for (int64_t n = 0; n < count; ++n) {
+    core::PplMutation mutation{
+        core::PplMutation::Kind::Add,
+        core::Person{
+            core::PersonId{uuid_generator()},
+            "Person " + std::to_string(n),
+            GetTodaysDate() - boost::gregorian::days{ages(generator)},
+            core::GeoPosition{
+                core::GeoPosition::DecimalLatitude{latitudes(generator)},
+                core::GeoPosition::DecimalLongitude{longitudes(generator)}}}};
+    pplme::proto::PplMutation mutation_pb;
+    pplme::proto::Convert(mutation, &mutation_pb);
+    additions.push_back(mutation_pb.SerializeAsString());
+  }
+  return additions;
+}
+
+
+}  // namespace
+
+
+/** A batch of range(0) additions appended and then waited for, i.e., what
+    one of pplmed's mutation requests costs the log. */
+void BM_AppendAndCommit(benchmark::State& state) {
+  TemporaryDirectory directory;
+  WriteAheadLog wal{directory.GetPath()};
+  CHECK(wal.Replay([](std::vector<std::string> const&) { return true; }));
+  CHECK(wal.Start());
+  auto const additions = CreateAdditions(state.range(0));
+
+  for (auto _ : state)
+    wal.WaitForCommit(wal.Append(additions));
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AppendAndCommit)->Arg(1)->Arg(100)->Arg(1000)->UseRealTime();
+
+
+/** A log of range(0) additions replayed into a fresh engine, as pplmed
+    does at startup (with the parsing, conversion and all). */
+void BM_Replay(benchmark::State& state) {
+  TemporaryDirectory directory;
+  /* the log's first life */ {
+    WriteAheadLog wal{directory.GetPath()};
+    CHECK(wal.Replay([](std::vector<std::string> const&) { return true; }));
+    CHECK(wal.Start());
+    wal.WaitForCommit(wal.Append(CreateAdditions(state.range(0))));
+  }
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::unique_ptr<PplmeMatchingPplProvider> ppl_provider{
+        new PplmeMatchingPplProvider{10, 10, 10, 1, &GetTodaysDate}};
+    WriteAheadLog wal{directory.GetPath()};
+    state.ResumeTiming();
+
+    auto const replayed = wal.Replay(
+        [&ppl_provider](std::vector<std::string> const& records) {
+          std::vector<core::PplMutation> mutations(records.size());
+          for (size_t n = 0; n < records.size(); ++n) {
+            pplme::proto::PplMutation mutation_pb;
+            if (!mutation_pb.ParseFromString(records[n])
+                || !pplme::proto::Convert(mutation_pb, &mutations[n]))
+              return false;
+          }
+          ppl_provider->ApplyPplMutations(std::move(mutations));
+          return true;
+        });
+    CHECK(replayed);
+
+    state.PauseTiming();
+    ppl_provider.reset();
+    state.ResumeTiming();
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Replay)->Arg(10000)->Arg(1000000)->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+
+BENCHMARK_MAIN();
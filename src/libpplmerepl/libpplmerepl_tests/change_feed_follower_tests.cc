@@ -0,0 +1,204 @@
+/**
+ *  @file
+ *  @brief   Tests for pplme::repl::ChangeFeedFollower.
+ *  @author  j.ho
+ */
+
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/numeric/conversion/cast.hpp>
+#include <boost/uuid/random_generator.hpp>
+#include <gtest/gtest.h>
+#include "libpplmecore/ppl_mutation.h"
+#include "libpplmeengine/pplme_matching_ppl_provider.h"
+#include "libpplmenet/message.h"
+#include "libpplmenet/single_shot_server.h"
+#include "libpplmeproto/change_feed.pb.h"
+#include "libpplmeproto/convert_ppl_mutation.h"
+#include "libpplmeproto/ppl_mutation.pb.h"
+#include "libpplmeproto/request.pb.h"
+#include "libpplmerepl/change_feed_follower.h"
+#include "libpplmerepl/change_log.h"
+
+
+using pplme::core::GeoPosition;
+using pplme::core::Person;
+using pplme::core::PersonId;
+using pplme::core::PplMatchingParameters;
+using pplme::core::PplMutation;
+using pplme::engine::PplmeMatchingPplProvider;
+using pplme::net::Message;
+using pplme::net::SingleShotServer;
+using pplme::repl::ChangeFeedFollower;
+using pplme::repl::ChangeLog;
+
+
+namespace {
+
+
+std::chrono::seconds const kPatience{10};
+
+GeoPosition const kLocation{GeoPosition::DecimalLatitude{1},
+                            GeoPosition::DecimalLongitude{1}};
+
+
+Person CreatePerson(std::string const& name) {
+  return Person{PersonId{boost::uuids::random_generator()()},
+                name,
+                boost::gregorian::date{1983, 1, 1},
+                kLocation};
+}
+
+
+/** A writer pplmed in miniature, running on localhost, that serves nothing
+    but its change feed. */
+class FakeWriter {
+ public:
+  FakeWriter() :
+      change_log_{new ChangeLog},
+      server_{0,
+              [this](std::string const&,
+                     unsigned short,
+                     Message const& request) {
+                return HandleRequest(request);
+              },
+              true} {
+    server_.Start();
+  }
+
+  unsigned short GetPort() { return server_.GetLocalPort(); }
+
+  uint64_t Apply(std::vector<PplMutation> const& mutations) {
+    std::vector<std::string> serialized_mutations;
+    for (auto const& mutation : mutations) {
+      pplme::proto::PplMutation mutation_pb;
+      pplme::proto::Convert(mutation, &mutation_pb);
+      serialized_mutations.push_back(mutation_pb.SerializeAsString());
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    return change_log_->Append(serialized_mutations);
+  }
+
+  /** As if the writer had been restarted: everything it had is forgotten,
+      and it starts a new change log. */
+  void Restart() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    change_log_.reset(new ChangeLog);
+  }
+
+ private:
+  std::mutex mutex_;
+  std::shared_ptr<ChangeLog> change_log_;
+  SingleShotServer server_;
+
+
+  std::unique_ptr<Message> HandleRequest(Message const& request) {
+    pplme::proto::Request request_pb;
+    if (!request_pb.ParseFromArray(request.GetBodyOctets(),
+                                   request.GetBodyLength()))
+      return std::unique_ptr<Message>{};
+    auto const& change_feed_request_pb = request_pb.change_feed_request();
+
+    std::shared_ptr<ChangeLog> change_log;
+    /* lock block */ {
+      std::unique_lock<std::mutex> lock(mutex_);
+      change_log = change_log_;
+    }
+
+    pplme::proto::ChangeFeedResponse response_pb;
+    change_log->Read(
+        change_feed_request_pb.after_sequence(),
+        std::chrono::milliseconds{change_feed_request_pb.wait_ms()},
+        &response_pb);
+    auto const response_size =
+        boost::numeric_cast<uint32_t>(response_pb.ByteSize());
+    auto response_body = Message::CreateBodyBuffer(response_size);
+    response_pb.SerializeWithCachedSizesToArray(response_body.get());
+    return std::unique_ptr<Message>{
+        new Message{std::move(response_body), response_size}};
+  }
+};
+
+
+std::vector<std::string> FindNames(PplmeMatchingPplProvider const& provider) {
+  std::vector<std::string> names;
+  for (auto const& person :
+           provider.FindMatchingPpl(PplMatchingParameters{kLocation, 31}))
+    names.push_back(person.name());
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+
+}  // namespace
+
+
+/**
+ *  @test  A replica should end up with whoever the writer had to begin
+ *         with, and then keep up with ppl coming and going.
+ */
+TEST(ChangeFeedFollowerTest, KeepsUpWithTheWriter) {
+  // Arrange.
+  FakeWriter writer;
+  auto const early = CreatePerson("Early");
+  auto const later = CreatePerson("Later");
+  writer.Apply({{PplMutation::Kind::Add, early}});
+  PplmeMatchingPplProvider replica{
+      1, 2, 10, 1, []() { return boost::gregorian::date{2014, 11, 25}; }};
+  ChangeFeedFollower follower{"127.0.0.1", writer.GetPort(), &replica};
+
+  // Act.
+  follower.Start();
+  auto const caught_up = follower.WaitUntilCaughtUp();
+  auto const names_at_first = FindNames(replica);
+  auto const last_sequence =
+      writer.Apply({{PplMutation::Kind::Add, later},
+                    {PplMutation::Kind::Remove, early}});
+  auto const applied =
+      follower.WaitUntilApplied(last_sequence, kPatience);
+
+  // Assert.
+  ASSERT_TRUE(caught_up);
+  ASSERT_EQ(std::vector<std::string>{"Early"}, names_at_first);
+  ASSERT_TRUE(applied);
+  ASSERT_EQ(std::vector<std::string>{"Later"}, FindNames(replica));
+  auto const status = follower.GetStatus();
+  ASSERT_EQ(3U, status.applied_sequence);
+  ASSERT_EQ(3U, status.latest_sequence);
+  ASSERT_FALSE(status.derailed);
+}
+
+
+/**
+ *  @test  A replica whose writer has been restarted (with a new change log)
+ *         should stop following it rather than make a mess.
+ */
+TEST(ChangeFeedFollowerTest, DerailsWhenTheWriterIsRestarted) {
+  // Arrange.
+  FakeWriter writer;
+  writer.Apply({{PplMutation::Kind::Add, CreatePerson("Whoever")}});
+  PplmeMatchingPplProvider replica{
+      1, 2, 10, 1, []() { return boost::gregorian::date{2014, 11, 25}; }};
+  ChangeFeedFollower follower{"127.0.0.1", writer.GetPort(), &replica};
+  follower.Start();
+  ASSERT_TRUE(follower.WaitUntilCaughtUp());
+
+  // Act.
+  writer.Restart();
+  writer.Apply({{PplMutation::Kind::Add, CreatePerson("Whoever else")},
+                {PplMutation::Kind::Add, CreatePerson("And another")}});
+  auto const deadline = std::chrono::steady_clock::now() + kPatience;
+  while (!follower.GetStatus().derailed
+         && std::chrono::steady_clock::now() < deadline)
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+
+  // Assert.
+  ASSERT_TRUE(follower.GetStatus().derailed);
+  ASSERT_EQ(std::vector<std::string>{"Whoever"}, FindNames(replica));
+}
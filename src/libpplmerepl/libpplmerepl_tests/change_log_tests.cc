@@ -0,0 +1,119 @@
+/**
+ *  @file
+ *  @brief   Tests for pplme::repl::ChangeLog.
+ *  @author  j.ho
+ */
+
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "libpplmeproto/change_feed.pb.h"
+#include "libpplmerepl/change_log.h"
+
+
+using pplme::proto::ChangeFeedResponse;
+using pplme::repl::ChangeLog;
+
+
+namespace {
+
+
+std::vector<std::string> GetMutations(ChangeFeedResponse const& response) {
+  return std::vector<std::string>(response.mutations().begin(),
+                                  response.mutations().end());
+}
+
+
+}  // namespace
+
+
+/**
+ *  @test  Sequences should start at 1 and go up by one per mutation, and
+ *         reading after one should get those after it (and only those).
+ */
+TEST(ChangeLogTest, ReadGetsWhatCameAfter) {
+  // Arrange.
+  ChangeLog change_log;
+
+  // Act.
+  auto const first_sequence = change_log.Append({"one", "two"});
+  auto const second_sequence = change_log.Append({"three"});
+  auto const nothing_sequence = change_log.Append({});
+  ChangeFeedResponse from_scratch;
+  change_log.Read(0, std::chrono::milliseconds{0}, &from_scratch);
+  ChangeFeedResponse after_one;
+  change_log.Read(1, std::chrono::milliseconds{0}, &after_one);
+  ChangeFeedResponse after_all;
+  change_log.Read(3, std::chrono::milliseconds{0}, &after_all);
+
+  // Assert.
+  ASSERT_EQ(2U, first_sequence);
+  ASSERT_EQ(3U, second_sequence);
+  ASSERT_EQ(3U, nothing_sequence);
+  ASSERT_EQ(3U, change_log.GetLatestSequence());
+  ASSERT_EQ((std::vector<std::string>{"one", "two", "three"}),
+            GetMutations(from_scratch));
+  ASSERT_EQ((std::vector<std::string>{"two", "three"}),
+            GetMutations(after_one));
+  ASSERT_TRUE(GetMutations(after_all).empty());
+  ASSERT_EQ(3U, after_all.latest_sequence());
+  ASSERT_EQ(change_log.GetFeedId(), after_all.feed_id());
+}
+
+
+/**
+ *  @test  Mutations should come out as they went in, however the chunks
+ *         fall, but a read shouldn't take (much) more than its share.
+ */
+TEST(ChangeLogTest, ReadTakesItsShareAcrossChunks) {
+  // Arrange.
+  ChangeLog change_log;
+  std::vector<std::string> mutations;
+  for (char c = 'a'; c <= 'f'; ++c)
+    mutations.push_back(std::string(ChangeLog::kChunkSize / 4 + 1, c));
+  change_log.Append(mutations);
+
+  // Act.
+  std::vector<std::string> read_mutations;
+  int reads = 0;
+  while (read_mutations.size() < mutations.size()) {
+    ChangeFeedResponse response;
+    change_log.Read(read_mutations.size(), std::chrono::milliseconds{0},
+                    &response);
+    ++reads;
+    auto const some_mutations = GetMutations(response);
+    ASSERT_FALSE(some_mutations.empty());
+    read_mutations.insert(read_mutations.end(), some_mutations.begin(),
+                          some_mutations.end());
+  }
+
+  // Assert.
+  ASSERT_EQ(mutations, read_mutations);
+  ASSERT_EQ(6, reads);
+}
+
+
+/**
+ *  @test  A read with nothing to read should wait for something to turn
+ *         up, and get it when it does.
+ */
+TEST(ChangeLogTest, ReadWaitsForMutations) {
+  // Arrange.
+  ChangeLog change_log;
+  std::thread appender{[&change_log]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds{50});
+      change_log.Append({"late"});
+    }};
+
+  // Act.
+  ChangeFeedResponse response;
+  change_log.Read(0, std::chrono::seconds{10}, &response);
+  appender.join();
+
+  // Assert.
+  ASSERT_EQ(std::vector<std::string>{"late"}, GetMutations(response));
+  ASSERT_EQ(1U, response.latest_sequence());
+}
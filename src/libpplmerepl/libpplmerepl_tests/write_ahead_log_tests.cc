@@ -0,0 +1,207 @@
+/**
+ *  @file
+ *  @brief   Tests for pplme::repl::WriteAheadLog.
+ *  @author  j.ho
+ */
+
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "libpplmerepl/write_ahead_log.h"
+
+
+using pplme::repl::WriteAheadLog;
+
+
+namespace {
+
+
+/** A directory of its own for each test, gone again afterwards. */
+class TemporaryDirectory {
+ public:
+  TemporaryDirectory() {
+    char path[] = "/tmp/pplme_wal_testsXXXXXX";
+    EXPECT_NE(nullptr, mkdtemp(path));
+    path_ = path;
+  }
+
+  ~TemporaryDirectory() {
+    for (auto const& name : List())
+      unlink((path_ + "/" + name).c_str());
+    rmdir(path_.c_str());
+  }
+
+  std::string const& GetPath() const { return path_; }
+
+  /** @returns  The names of the files therein, in order. */
+  std::vector<std::string> List() const {
+    std::vector<std::string> names;
+    if (auto const dir = opendir(path_.c_str())) {
+      while (auto const entry = readdir(dir)) {
+        std::string const name{entry->d_name};
+        if (name != "." && name != "..")
+          names.push_back(name);
+      }
+      closedir(dir);
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+  }
+
+ private:
+  std::string path_;
+};
+
+
+/** @returns  Everything replayed from @a wal (and whether it all was). */
+std::pair<bool, std::vector<std::string>> Replay(WriteAheadLog* wal) {
+  std::vector<std::string> records;
+  auto const replayed = wal->Replay(
+      [&records](std::vector<std::string> const& batch) {
+        records.insert(records.end(), batch.begin(), batch.end());
+        return true;
+      });
+  return std::make_pair(replayed, records);
+}
+
+
+}  // namespace
+
+
+/**
+ *  @test  Whatever was appended (and committed) should be replayed, in
+ *         order, by the next log in the same directory.
+ */
+TEST(WriteAheadLogTest, ReplayGetsWhatWasAppended) {
+  // Arrange.
+  TemporaryDirectory directory;
+  /* first life */ {
+    WriteAheadLog wal{directory.GetPath()};
+    ASSERT_TRUE(Replay(&wal).first);
+    ASSERT_TRUE(wal.Start());
+    ASSERT_EQ(2U, wal.Append({"one", "two"}));
+    wal.WaitForCommit(wal.Append({"three"}));
+  }
+
+  // Act.
+  WriteAheadLog wal{directory.GetPath()};
+  auto const has_snapshot = wal.HasSnapshot();
+  auto const replayed = Replay(&wal);
+
+  // Assert.
+  ASSERT_FALSE(has_snapshot);
+  ASSERT_TRUE(replayed.first);
+  ASSERT_EQ((std::vector<std::string>{"one", "two", "three"}),
+            replayed.second);
+  ASSERT_EQ(3U, wal.GetStats().sequence);
+}
+
+
+/**
+ *  @test  A record that only half made it to disk (as when the power goes
+ *         mid-write) should be cut off, and appending carry on after those
+ *         that came before it.
+ */
+TEST(WriteAheadLogTest, ReplayCutsOffATornTail) {
+  // Arrange.
+  TemporaryDirectory directory;
+  /* first life */ {
+    WriteAheadLog wal{directory.GetPath()};
+    ASSERT_TRUE(Replay(&wal).first);
+    ASSERT_TRUE(wal.Start());
+    wal.WaitForCommit(wal.Append({"one", "two"}));
+  }
+  auto const segment = directory.GetPath() + "/" + directory.List().back();
+  struct stat segment_stat;
+  ASSERT_EQ(0, stat(segment.c_str(), &segment_stat));
+  ASSERT_EQ(0, truncate(segment.c_str(), segment_stat.st_size - 1));
+
+  // Act.
+  std::pair<bool, std::vector<std::string>> torn_replayed;
+  /* second life */ {
+    WriteAheadLog wal{directory.GetPath()};
+    torn_replayed = Replay(&wal);
+    ASSERT_TRUE(wal.Start());
+    wal.WaitForCommit(wal.Append({"three"}));
+  }
+  WriteAheadLog wal{directory.GetPath()};
+  auto const replayed = Replay(&wal);
+
+  // Assert.
+  ASSERT_TRUE(torn_replayed.first);
+  ASSERT_EQ(std::vector<std::string>{"one"}, torn_replayed.second);
+  ASSERT_TRUE(replayed.first);
+  ASSERT_EQ((std::vector<std::string>{"one", "three"}), replayed.second);
+}
+
+
+/**
+ *  @test  After a checkpoint, there should be just the new snapshot and a
+ *         segment for what comes after it, and replaying should get both.
+ */
+TEST(WriteAheadLogTest, CheckpointReplacesWhatCameBefore) {
+  // Arrange.
+  TemporaryDirectory directory;
+  /* first life */ {
+    WriteAheadLog wal{directory.GetPath()};
+    ASSERT_TRUE(Replay(&wal).first);
+    ASSERT_TRUE(wal.Start());
+    wal.Append({"one", "two", "three"});
+
+    // Act.
+    ASSERT_TRUE(wal.Checkpoint(
+        [](std::function<void (std::string const&)> const& write) {
+          write("one");
+          write("three");
+        }));
+    wal.WaitForCommit(wal.Append({"four"}));
+  }
+  WriteAheadLog wal{directory.GetPath()};
+  auto const has_snapshot = wal.HasSnapshot();
+  auto const replayed = Replay(&wal);
+
+  // Assert.
+  ASSERT_EQ((std::vector<std::string>{"snapshot-00000000000000000003",
+                                      "wal-00000000000000000004"}),
+            directory.List());
+  ASSERT_TRUE(has_snapshot);
+  ASSERT_TRUE(replayed.first);
+  ASSERT_EQ((std::vector<std::string>{"one", "three", "four"}),
+            replayed.second);
+  ASSERT_EQ(4U, wal.GetStats().sequence);
+  ASSERT_EQ(3U, wal.GetStats().snapshot_sequence);
+}
+
+
+/**
+ *  @test  Records appended while a commit is under way should be committed
+ *         together, rather than a sync apiece.
+ */
+TEST(WriteAheadLogTest, CommitsAreShared) {
+  // Arrange.
+  int const kAppends = 1000;
+  TemporaryDirectory directory;
+  WriteAheadLog wal{directory.GetPath()};
+  ASSERT_TRUE(Replay(&wal).first);
+  ASSERT_TRUE(wal.Start());
+
+  // Act.
+  uint64_t sequence = 0;
+  for (int n = 0; n < kAppends; ++n)
+    sequence = wal.Append({std::to_string(n)});
+  wal.WaitForCommit(sequence);
+
+  // Assert.
+  auto const stats = wal.GetStats();
+  ASSERT_EQ(uint64_t{kAppends}, stats.records);
+  ASSERT_EQ(uint64_t{kAppends}, stats.sequence);
+  ASSERT_GE(stats.commits, 1U);
+  ASSERT_LT(stats.commits, uint64_t{kAppends});
+}
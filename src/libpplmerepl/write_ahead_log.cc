@@ -0,0 +1,676 @@
+/**
+ *  @file
+ *  @brief   Implementation for pplme::repl::WriteAheadLog.
+ *  @author  j.ho
+ */
+
+
+#include "write_ahead_log.h"
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <algorithm>
+#include <condition_variable>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <boost/crc.hpp>
+#include <boost/optional.hpp>
+#include <glog/logging.h>
+
+
+namespace {
+
+
+char const kSnapshotPrefix[] = "snapshot-";
+char const kSegmentPrefix[] = "wal-";
+char const kTemporarySuffix[] = ".tmp";
+/** Enough for any uint64_t, and so file names sort by sequence. */
+int const kSequenceDigits = 20;
+
+/** Each record goes: size (4 octets), CRC-32 of the rest (4), sequence (8),
+    and then the record itself, little-endian throughout. */
+size_t const kHeaderSize = 4 + 4 + 8;
+
+/** How much is read (or, for snapshots, written) at a time. */
+size_t const kBufferSize = 1024 * 1024;
+
+
+void EncodeLittleEndian(uint64_t value, int octets, char* out) {
+  for (int n = 0; n < octets; ++n)
+    out[n] = static_cast<char>((value >> (8 * n)) & 0xff);
+}
+
+
+uint64_t DecodeLittleEndian(char const* in, int octets) {
+  uint64_t value = 0;
+  for (int n = octets - 1; n >= 0; --n)
+    value = (value << 8) | static_cast<unsigned char>(in[n]);
+  return value;
+}
+
+
+uint32_t ComputeCrc(char const* sequence, char const* record, size_t size) {
+  boost::crc_32_type crc;
+  crc.process_bytes(sequence, 8);
+  crc.process_bytes(record, size);
+  return crc.checksum();
+}
+
+
+void AppendRecord(uint64_t sequence, std::string const& record,
+                  std::string* out) {
+  char header[kHeaderSize];
+  EncodeLittleEndian(record.size(), 4, header);
+  EncodeLittleEndian(sequence, 8, header + 8);
+  EncodeLittleEndian(ComputeCrc(header + 8, record.data(), record.size()),
+                     4,
+                     header + 4);
+  out->append(header, kHeaderSize);
+  out->append(record);
+}
+
+
+std::string CreateFileName(char const* prefix, uint64_t sequence) {
+  std::ostringstream name;
+  name << prefix << std::setw(kSequenceDigits) << std::setfill('0')
+       << sequence;
+  return name.str();
+}
+
+
+boost::optional<uint64_t> ParseFileName(std::string const& name,
+                                        std::string const& prefix) {
+  if (name.size() != prefix.size() + kSequenceDigits
+      || name.compare(0, prefix.size(), prefix) != 0)
+    return boost::none;
+  uint64_t sequence = 0;
+  for (auto n = prefix.size(); n < name.size(); ++n) {
+    if (!isdigit(static_cast<unsigned char>(name[n])))
+      return boost::none;
+    sequence = sequence * 10 + (name[n] - '0');
+  }
+  return sequence;
+}
+
+
+bool EndsWith(std::string const& s, std::string const& suffix) {
+  return s.size() >= suffix.size()
+      && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+
+/** What's in a log's directory, with the sequences in order. */
+struct Listing {
+  std::vector<uint64_t> snapshots;
+  /** (By the sequence that each starts from.) */
+  std::vector<uint64_t> segments;
+  /** Snapshots that never got finished. */
+  std::vector<std::string> temporaries;
+};
+
+
+bool List(std::string const& directory, Listing* listing) {
+  auto const dir = opendir(directory.c_str());
+  if (!dir)
+    return false;
+  while (auto const entry = readdir(dir)) {
+    std::string const name{entry->d_name};
+    if (auto const sequence = ParseFileName(name, kSnapshotPrefix))
+      listing->snapshots.push_back(*sequence);
+    else if (auto const segment = ParseFileName(name, kSegmentPrefix))
+      listing->segments.push_back(*segment);
+    else if (name.compare(0, strlen(kSnapshotPrefix), kSnapshotPrefix) == 0
+             && EndsWith(name, kTemporarySuffix))
+      listing->temporaries.push_back(name);
+  }
+  closedir(dir);
+  std::sort(listing->snapshots.begin(), listing->snapshots.end());
+  std::sort(listing->segments.begin(), listing->segments.end());
+  return true;
+}
+
+
+bool WriteFully(int fd, char const* data, size_t size) {
+  while (size > 0) {
+    auto const written = write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+
+/** So that files created in (or renamed into, or removed from) it stay that
+    way. */
+bool SyncDirectory(std::string const& directory) {
+  auto const fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  auto const synced = fsync(fd) == 0;
+  close(fd);
+  return synced;
+}
+
+
+/** Reads a file a record at a time. */
+class RecordReader {
+ public:
+  enum class Result { Record, End, Torn, Failed };
+
+  explicit RecordReader(int fd) :
+      fd_{fd},
+      buffer_(kBufferSize),
+      begin_{0},
+      end_{0},
+      offset_{0},
+      failed_{false} {}
+
+  Result Next(uint64_t* sequence, std::string* record) {
+    if (!Fill(kHeaderSize))
+      return failed_ ? Result::Failed : begin_ == end_ ? Result::End
+                                                       : Result::Torn;
+    auto const header = buffer_.data() + begin_;
+    auto const size = DecodeLittleEndian(header, 4);
+    if (size > pplme::repl::WriteAheadLog::kMaxRecordSize)
+      return Result::Torn;
+    if (!Fill(kHeaderSize + size))
+      return failed_ ? Result::Failed : Result::Torn;
+    // (Fill() may have moved things.)
+    auto const record_header = buffer_.data() + begin_;
+    auto const record_data = record_header + kHeaderSize;
+    if (ComputeCrc(record_header + 8, record_data, size)
+        != DecodeLittleEndian(record_header + 4, 4))
+      return Result::Torn;
+
+    *sequence = DecodeLittleEndian(record_header + 8, 8);
+    record->assign(record_data, size);
+    begin_ += kHeaderSize + size;
+    offset_ += kHeaderSize + size;
+    return Result::Record;
+  }
+
+  /** Where the next record starts. */
+  off_t GetOffset() const { return offset_; }
+
+ private:
+  int const fd_;
+  std::vector<char> buffer_;
+  size_t begin_;
+  size_t end_;
+  off_t offset_;
+  bool failed_;
+
+
+  /** @returns  True iff there are @a size octets to be had. */
+  bool Fill(size_t size) {
+    if (end_ - begin_ >= size)
+      return true;
+    std::copy(buffer_.begin() + begin_, buffer_.begin() + end_,
+              buffer_.begin());
+    end_ -= begin_;
+    begin_ = 0;
+    if (buffer_.size() < size)
+      buffer_.resize(size);
+    while (end_ < size) {
+      auto const got = read(fd_, buffer_.data() + end_, buffer_.size() - end_);
+      if (got < 0 && errno == EINTR)
+        continue;
+      if (got < 0)
+        failed_ = true;
+      if (got <= 0)
+        return false;
+      end_ += got;
+    }
+    return true;
+  }
+};
+
+
+}  // namespace
+
+
+namespace pplme {
+namespace repl {
+
+
+size_t const WriteAheadLog::kReplayBatchSize;
+size_t const WriteAheadLog::kMaxRecordSize;
+
+
+class WriteAheadLog::Impl {
+ public:
+  explicit Impl(std::string const& directory) :
+      directory_{directory},
+      replayed_{false},
+      next_sequence_{1},
+      fd_{-1},
+      segment_sequence_{0},
+      stopping_{false},
+      committed_sequence_{0},
+      records_{0},
+      commits_{0},
+      committed_octets_{0} {}
+
+
+  ~Impl() {
+    /* lock block */ {
+      std::unique_lock<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    appended_or_stopping_.notify_all();
+    if (thread_.joinable())
+      thread_.join();
+    if (fd_ >= 0)
+      close(fd_);
+  }
+
+
+  bool HasSnapshot() const {
+    Listing listing;
+    return List(directory_, &listing) && !listing.snapshots.empty();
+  }
+
+
+  bool Replay(std::function<bool (std::vector<std::string> const&)> const&
+                  visitor) {
+    CHECK(!replayed_) << "Already replayed";
+    if (mkdir(directory_.c_str(), 0777) != 0 && errno != EEXIST) {
+      LOG(ERROR) << "Failed to create write-ahead log directory `"
+                 << directory_ << "': " << strerror(errno);
+      return false;
+    }
+    Listing listing;
+    if (!List(directory_, &listing)) {
+      LOG(ERROR) << "Failed to list write-ahead log directory `"
+                 << directory_ << "': " << strerror(errno);
+      return false;
+    }
+
+    std::vector<std::string> batch;
+    auto const hand_over_batch = [&visitor, &batch]() {
+      auto const handled = batch.empty() || visitor(batch);
+      batch.clear();
+      return handled;
+    };
+
+    uint64_t sequence = 0;
+    if (!listing.snapshots.empty()) {
+      snapshot_sequence_ = sequence = listing.snapshots.back();
+      auto const replayed = ReadFile(
+          CreateFileName(kSnapshotPrefix, sequence),
+          false,
+          [&batch, &hand_over_batch](uint64_t, std::string record) {
+            batch.push_back(std::move(record));
+            return batch.size() < kReplayBatchSize || hand_over_batch();
+          });
+      if (!replayed)
+        return false;
+    }
+    for (size_t n = 0; n < listing.segments.size(); ++n) {
+      auto const replayed = ReadFile(
+          CreateFileName(kSegmentPrefix, listing.segments[n]),
+          n + 1 == listing.segments.size(),
+          [this, &sequence, &batch, &hand_over_batch](
+              uint64_t record_sequence, std::string record) {
+            // (Those up to the snapshot are in it already.)
+            if (snapshot_sequence_ && record_sequence <= *snapshot_sequence_)
+              return true;
+            if (record_sequence != sequence + 1) {
+              LOG(ERROR) << "Write-ahead log skips from " << sequence
+                         << " to " << record_sequence;
+              return false;
+            }
+            sequence = record_sequence;
+            batch.push_back(std::move(record));
+            return batch.size() < kReplayBatchSize || hand_over_batch();
+          });
+      if (!replayed)
+        return false;
+    }
+    if (!hand_over_batch())
+      return false;
+
+    next_sequence_ = sequence + 1;
+    committed_sequence_ = sequence;
+    replayed_ = true;
+    return true;
+  }
+
+
+  bool Start() {
+    CHECK(replayed_) << "Replay() first";
+    CHECK(!thread_.joinable()) << "Already started";
+    if (!OpenSegment(next_sequence_))
+      return false;
+    thread_ = std::thread{[this]() { Commit(); }};
+    return true;
+  }
+
+
+  uint64_t Append(std::vector<std::string> const& records) {
+    uint64_t sequence;
+    /* lock block */ {
+      std::unique_lock<std::mutex> lock(mutex_);
+      for (auto const& record : records) {
+        CHECK(record.size() <= kMaxRecordSize) << "Record too big to log";
+        AppendRecord(next_sequence_++, record, &pending_);
+      }
+      records_ += records.size();
+      sequence = next_sequence_ - 1;
+    }
+    if (!records.empty())
+      appended_or_stopping_.notify_all();
+    return sequence;
+  }
+
+
+  void WaitForCommit(uint64_t sequence) const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    committed_.wait(lock, [this, sequence]() {
+        return committed_sequence_ >= sequence;
+      });
+  }
+
+
+  bool Checkpoint(
+      std::function<void (std::function<void (std::string const&)> const&)>
+          const& dump) {
+    CHECK(thread_.joinable()) << "Start() first";
+    uint64_t sequence;
+    /* lock block */ {
+      std::unique_lock<std::mutex> lock(mutex_);
+      sequence = next_sequence_ - 1;
+      committed_.wait(lock, [this, sequence]() {
+          return committed_sequence_ == sequence;
+        });
+      if (snapshot_sequence_ && *snapshot_sequence_ == sequence)
+        return true;
+      // From here on, it's a new segment, so that the snapshot makes all
+      // of the others redundant.  (The committer has nothing to commit, so
+      // isn't using the old one.)
+      if (segment_sequence_ != sequence + 1 && !OpenSegment(sequence + 1))
+        return false;
+    }
+
+    auto const name = CreateFileName(kSnapshotPrefix, sequence);
+    uint64_t records;
+    if (!WriteSnapshot(name, dump, &records))
+      return false;
+    /* lock block */ {
+      std::unique_lock<std::mutex> lock(mutex_);
+      snapshot_sequence_ = sequence;
+    }
+    LOG(INFO) << "Wrote write-ahead log snapshot `" << name << "' ("
+              << records << " records)";
+
+    Listing listing;
+    if (List(directory_, &listing)) {
+      for (auto const snapshot : listing.snapshots) {
+        if (snapshot < sequence)
+          Remove(CreateFileName(kSnapshotPrefix, snapshot));
+      }
+      for (auto const segment : listing.segments) {
+        if (segment <= sequence)
+          Remove(CreateFileName(kSegmentPrefix, segment));
+      }
+      for (auto const& temporary : listing.temporaries)
+        Remove(temporary);
+      SyncDirectory(directory_);
+    }
+    return true;
+  }
+
+
+  Stats GetStats() const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return Stats{records_,
+                 commits_,
+                 committed_octets_,
+                 committed_sequence_,
+                 snapshot_sequence_.value_or(0)};
+  }
+
+
+ private:
+  std::string const directory_;
+  bool replayed_;
+  std::thread thread_;
+  mutable std::mutex mutex_;
+  std::condition_variable appended_or_stopping_;
+  mutable std::condition_variable committed_;
+  /** The sequence that the next record appended gets. */
+  uint64_t next_sequence_;
+  /** Records appended but not yet handed to the committer. */
+  std::string pending_;
+  /** The segment being appended to, and the sequence that it starts at. */
+  int fd_;
+  uint64_t segment_sequence_;
+  boost::optional<uint64_t> snapshot_sequence_;
+  bool stopping_;
+  /** @see  WriteAheadLog::Stats. */
+  uint64_t committed_sequence_;
+  uint64_t records_;
+  uint64_t commits_;
+  uint64_t committed_octets_;
+
+
+  std::string GetPath(std::string const& name) const {
+    return directory_ + "/" + name;
+  }
+
+
+  /** The committer's thread. */
+  void Commit() {
+    std::string buffer;
+    for (;;) {
+      uint64_t sequence;
+      int fd;
+      /* lock block */ {
+        std::unique_lock<std::mutex> lock(mutex_);
+        appended_or_stopping_.wait(lock, [this]() {
+            return stopping_ || !pending_.empty();
+          });
+        if (pending_.empty())
+          return;
+        // (Swapped, rather than moved, so both keep their capacity.)
+        buffer.clear();
+        buffer.swap(pending_);
+        sequence = next_sequence_ - 1;
+        fd = fd_;
+      }
+
+      // There's no coming back from either of these: who knows what did or
+      // didn't make it to disk?
+      CHECK(WriteFully(fd, buffer.data(), buffer.size()))
+          << "Failed to write to the write-ahead log: " << strerror(errno);
+      CHECK(fdatasync(fd) == 0)
+          << "Failed to sync the write-ahead log: " << strerror(errno);
+
+      /* lock block */ {
+        std::unique_lock<std::mutex> lock(mutex_);
+        committed_sequence_ = sequence;
+        ++commits_;
+        committed_octets_ += buffer.size();
+      }
+      committed_.notify_all();
+    }
+  }
+
+
+  /** Make the segment starting at @a sequence the one appended to. */
+  bool OpenSegment(uint64_t sequence) {
+    auto const name = CreateFileName(kSegmentPrefix, sequence);
+    auto const fd = open(GetPath(name).c_str(),
+                         O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC,
+                         0666);
+    if (fd < 0 || !SyncDirectory(directory_)) {
+      LOG(ERROR) << "Failed to create write-ahead log segment `" << name
+                 << "': " << strerror(errno);
+      if (fd >= 0)
+        close(fd);
+      return false;
+    }
+    if (fd_ >= 0)
+      close(fd_);
+    fd_ = fd;
+    segment_sequence_ = sequence;
+    return true;
+  }
+
+
+  /**
+   *  Visit every record in @a name in turn (for as long as @a visitor returns
+   *  true).  A torn last record is cut off (with a warning) if
+   *  @a allow_torn_tail, and is an error otherwise.
+   *
+   *  @returns  True iff the whole file was visited.
+   */
+  bool ReadFile(
+      std::string const& name,
+      bool allow_torn_tail,
+      std::function<bool (uint64_t, std::string)> const& visitor) const {
+    auto const fd = open(GetPath(name).c_str(),
+                         (allow_torn_tail ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+    if (fd < 0) {
+      LOG(ERROR) << "Failed to open write-ahead log file `" << name << "': "
+                 << strerror(errno);
+      return false;
+    }
+
+    RecordReader reader{fd};
+    uint64_t sequence;
+    std::string record;
+    auto result = RecordReader::Result::Record;
+    while ((result = reader.Next(&sequence, &record))
+               == RecordReader::Result::Record) {
+      if (!visitor(sequence, std::move(record))) {
+        close(fd);
+        return false;
+      }
+    }
+
+    auto read = result == RecordReader::Result::End;
+    if (result == RecordReader::Result::Failed) {
+      LOG(ERROR) << "Failed to read write-ahead log file `" << name << "': "
+                 << strerror(errno);
+    } else if (result == RecordReader::Result::Torn && !allow_torn_tail) {
+      LOG(ERROR) << "Write-ahead log file `" << name << "' is corrupt at "
+                 << reader.GetOffset();
+    } else if (result == RecordReader::Result::Torn) {
+      LOG(WARNING) << "Cutting off torn record at " << reader.GetOffset()
+                   << " in write-ahead log file `" << name << "'";
+      read = ftruncate(fd, reader.GetOffset()) == 0 && fsync(fd) == 0;
+      LOG_IF(ERROR, !read) << "Failed to cut off torn record: "
+                           << strerror(errno);
+    }
+    close(fd);
+    return read;
+  }
+
+
+  bool WriteSnapshot(
+      std::string const& name,
+      std::function<void (std::function<void (std::string const&)> const&)>
+          const& dump,
+      uint64_t* records) const {
+    auto const temporary_path = GetPath(name) + kTemporarySuffix;
+    auto const fd = open(temporary_path.c_str(),
+                         O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                         0666);
+    auto written = fd >= 0;
+    *records = 0;
+    std::string buffer;
+    buffer.reserve(kBufferSize + kHeaderSize + kMaxRecordSize);
+    dump([fd, &written, records, &buffer](std::string const& record) {
+        CHECK(record.size() <= kMaxRecordSize) << "Record too big to log";
+        AppendRecord(0, record, &buffer);
+        ++*records;
+        if (buffer.size() >= kBufferSize) {
+          written = written && WriteFully(fd, buffer.data(), buffer.size());
+          buffer.clear();
+        }
+      });
+    written = written
+        && WriteFully(fd, buffer.data(), buffer.size())
+        && fsync(fd) == 0
+        && rename(temporary_path.c_str(), GetPath(name).c_str()) == 0
+        && SyncDirectory(directory_);
+    if (!written) {
+      LOG(ERROR) << "Failed to write write-ahead log snapshot `" << name
+                 << "': " << strerror(errno);
+      unlink(temporary_path.c_str());
+    }
+    if (fd >= 0)
+      close(fd);
+    return written;
+  }
+
+
+  void Remove(std::string const& name) const {
+    if (unlink(GetPath(name).c_str()) != 0) {
+      LOG(WARNING) << "Failed to remove write-ahead log file `" << name
+                   << "': " << strerror(errno);
+    }
+  }
+};
+
+
+WriteAheadLog::WriteAheadLog(std::string const& directory) :
+    impl_{new Impl{directory}} {}
+
+
+WriteAheadLog::~WriteAheadLog() = default;
+
+
+bool WriteAheadLog::HasSnapshot() const {
+  return impl_->HasSnapshot();
+}
+
+
+bool WriteAheadLog::Replay(
+    std::function<bool (std::vector<std::string> const&)> const& visitor) {
+  return impl_->Replay(visitor);
+}
+
+
+bool WriteAheadLog::Start() {
+  return impl_->Start();
+}
+
+
+uint64_t WriteAheadLog::Append(std::vector<std::string> const& records) {
+  return impl_->Append(records);
+}
+
+
+void WriteAheadLog::WaitForCommit(uint64_t sequence) const {
+  impl_->WaitForCommit(sequence);
+}
+
+
+bool WriteAheadLog::Checkpoint(
+    std::function<void (std::function<void (std::string const&)> const&)>
+        const& dump) {
+  return impl_->Checkpoint(dump);
+}
+
+
+WriteAheadLog::Stats WriteAheadLog::GetStats() const {
+  return impl_->GetStats();
+}
+
+
+}  // namespace repl
+}  // namespace pplme
@@ -0,0 +1,144 @@
+/**
+ *  @file
+ *  @brief   Definition of pplme::repl::WriteAheadLog, with which a writer
+ *           pplmed keeps the ppl added to (and removed from) it across
+ *           restarts.
+ *  @author  j.ho
+ */
+#ifndef PPLME_LIBPPLMEREPL_WRITEAHEADLOG_H_
+#define PPLME_LIBPPLMEREPL_WRITEAHEADLOG_H_
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <vector>
+#include "libpplmeutils/pimpl.h"
+
+
+namespace pplme {
+namespace repl {
+
+
+/**
+ *  Example:
+ *  @code
+ *  WriteAheadLog wal{"/var/lib/pplme"};
+ *  if (!wal.HasSnapshot())
+ *    LoadTheUsualPpl();
+ *  wal.Replay([](std::vector<std::string> const& records) {
+ *      return ApplyThem(records);
+ *    });
+ *  wal.Start();
+ *  // The writer, having made some mutations:
+ *  wal.WaitForCommit(wal.Append(serialized_ppl_mutations));
+ *  // Every so often, with mutations held off:
+ *  wal.Checkpoint([](std::function<void (std::string const&)> const& write) {
+ *      for (auto const& person : everyone)
+ *        write(SerializedAdditionOf(person));
+ *    });
+ *  @endcode
+ *
+ *  @remarks
+ *  The log is a directory holding a snapshot (a record apiece for everyone
+ *  there was, as of some sequence) and segments (the records appended since,
+ *  numbered from 1 on in the order appended, as per ChangeLog).  Records
+ *  are opaque to the log, though pplmed's are serialized proto::PplMutations.
+ *
+ *  Append() doesn't write anything itself; a thread of the log's own writes
+ *  whatever has been appended since it last did and then fdatasync()s it,
+ *  so that everyone waiting in WaitForCommit() at the time shares the one
+ *  (rather slow) sync: the more that is being appended, the more gets
+ *  committed per sync.  If the disk lets the log down, the process dies,
+ *  since there is no knowing what made it to disk and what didn't.
+ *
+ *  A Checkpoint() writes a new snapshot and throws away the old one, along
+ *  with the segments that it makes redundant, so that the log doesn't grow
+ *  forever (nor does Replay() take forever).  A crash partway through a
+ *  write leaves the last record of the last segment torn; Replay() cuts it
+ *  off (that record was never committed, so never acknowledged).  Anything
+ *  else amiss means the log can't be trusted, and Replay() fails.
+ *
+ *  @note
+ *  This class is safe to use concurrently, except as documented.
+ */
+class WriteAheadLog {
+ public:
+  /** Replay() hands over records in batches of (up to) this many. */
+  static size_t const kReplayBatchSize = 64 * 1024;
+  /** No record may be bigger than this. */
+  static size_t const kMaxRecordSize = 1024 * 1024;
+
+  /** @a directory needn't exist yet (Replay() will make it). */
+  explicit WriteAheadLog(std::string const& directory);
+  /** Commits whatever has been appended. */
+  ~WriteAheadLog();
+
+  WriteAheadLog(WriteAheadLog const&) = delete;
+  WriteAheadLog& operator=(WriteAheadLog const&) = delete;
+
+  /** @returns  True iff there is a snapshot to replay (i.e., there's no need
+                to start from anything else). */
+  bool HasSnapshot() const;
+
+  /**
+   *  Visit the records of the latest snapshot and then the records appended
+   *  since, in order, a batch at a time.  Must be done (once) before Start().
+   *
+   *  @returns  True iff the log was read in full and @a visitor returned
+   *            true for every batch.
+   */
+  bool Replay(std::function<bool (std::vector<std::string> const&)> const&
+                  visitor);
+
+  /** Start a new segment (and the thread that commits to it).  @returns  True
+      iff it was created. */
+  bool Start();
+
+  /** Queue up @a records for committing.  @returns  The sequence of the last
+      of them (or of the last record, if there aren't any). */
+  uint64_t Append(std::vector<std::string> const& records);
+
+  /** Wait until everything up to @a sequence has been committed. */
+  void WaitForCommit(uint64_t sequence) const;
+
+  /**
+   *  Write a new snapshot, of the records that @a dump writes (which should
+   *  add up to everything appended so far), and let go of the old one.
+   *  Nothing may be appended until this returns.
+   *
+   *  @returns  True iff the snapshot was written (or wasn't needed, there
+   *            having been nothing appended since the last one).
+   */
+  bool Checkpoint(
+      std::function<void (std::function<void (std::string const&)> const&)>
+          const& dump);
+
+  /** Running totals since Start(), for the metrics. */
+  struct Stats {
+    /** Records appended. */
+    uint64_t records;
+    /** Syncs done to commit them. */
+    uint64_t commits;
+    /** Octets committed (records plus framing). */
+    uint64_t committed_octets;
+    /** The sequence of the last record committed. */
+    uint64_t sequence;
+    /** The sequence as of the latest snapshot. */
+    uint64_t snapshot_sequence;
+  };
+
+  Stats GetStats() const;
+
+ private:
+  class Impl;
+  utils::Pimpl<Impl> impl_;
+};
+
+
+}  // namespace repl
+}  // namespace pplme
+
+
+#endif  // PPLME_LIBPPLMEREPL_WRITEAHEADLOG_H_
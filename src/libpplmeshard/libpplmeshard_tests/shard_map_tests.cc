@@ -0,0 +1,135 @@
+/**
+ *  @file
+ *  @brief   Tests for pplme::shard::ShardMap.
+ *  @author  j.ho
+ */
+
+
+#include <gtest/gtest.h>
+#include "libpplmeutils/testlettes.h"
+#include "libpplmeshard/shard_map.h"
+
+
+using pplme::core::GeoPosition;
+using pplme::shard::ShardMap;
+
+
+namespace {
+
+
+/** West, east, and a little island that east also looks after. */
+char const kShards[] =
+    "-90:90/-180:0=west:1001,-90:90/0:180=east:1002,10:11/-30:-29=east:1002";
+
+
+GeoPosition CreateGeoPosition(float latitude, float longitude) {
+  return GeoPosition{GeoPosition::DecimalLatitude{latitude},
+                     GeoPosition::DecimalLongitude{longitude}};
+}
+
+
+}  // namespace
+
+
+/**
+ *  @test  Each range should come out as written, with each HOST:PORT made
+ *         into a backend just the once.
+ */
+TEST(ShardMapTest, ParsesAWellFormedMap) {
+  // Act.
+  auto const shard_map = ShardMap::Parse(kShards);
+
+  // Assert.
+  ASSERT_TRUE(shard_map);
+  ASSERT_EQ(2U, shard_map->backends().size());
+  ASSERT_EQ("west", shard_map->backends()[0].host);
+  ASSERT_EQ(1001, shard_map->backends()[0].port);
+  ASSERT_EQ("east", shard_map->backends()[1].host);
+  ASSERT_EQ(1002, shard_map->backends()[1].port);
+  ASSERT_EQ(3U, shard_map->ranges().size());
+  ASSERT_EQ(-180.f, shard_map->ranges()[0].min_longitude);
+  ASSERT_EQ(0.f, shard_map->ranges()[0].max_longitude);
+  ASSERT_EQ(0U, shard_map->ranges()[0].backend);
+  ASSERT_EQ(10.f, shard_map->ranges()[2].min_latitude);
+  ASSERT_EQ(11.f, shard_map->ranges()[2].max_latitude);
+  ASSERT_EQ(1U, shard_map->ranges()[2].backend);
+}
+
+
+PPLME_TESTLETTE_TYPE_BEGIN(ParseTestlette)
+  char const* spec;
+PPLME_TESTLETTE_TYPE_END(ParseTestlette, ShardMapTest_RejectsMalformedMaps)
+
+/**
+ *  @test  Anything that isn't a list of well-formed ranges, each of a
+ *         sensible bit of the world, should be rejected outright.
+ */
+TEST_P(ShardMapTest_RejectsMalformedMaps, Tests) {
+  ASSERT_FALSE(ShardMap::Parse(GetParam().spec));
+}
+
+PPLME_TESTLETTES_BEGIN(ParseTestlette, parse_testlettes)
+  PPLME_TESTLETTE(""),
+  PPLME_TESTLETTE("-90:90/-180:180=localhost:3333,"),
+  PPLME_TESTLETTE("-90:90/-180:180=localhost"),
+  PPLME_TESTLETTE("-90:90/-180:180=:3333"),
+  PPLME_TESTLETTE("-90:90/-180:180=localhost:0"),
+  PPLME_TESTLETTE("-90:90/-180:180=localhost:65536"),
+  PPLME_TESTLETTE("-90:90/-180:180=localhost:33x"),
+  PPLME_TESTLETTE("-90:90/-180=localhost:3333"),
+  PPLME_TESTLETTE("-91:90/-180:180=localhost:3333"),
+  PPLME_TESTLETTE("-90:90/-180:181=localhost:3333"),
+  PPLME_TESTLETTE("10:-10/-180:180=localhost:3333"),
+  PPLME_TESTLETTE("-90:90/nan:180=localhost:3333")
+PPLME_TESTLETTES_END(parse_testlettes, ShardMapTest_RejectsMalformedMaps)
+
+
+PPLME_TESTLETTE_TYPE_BEGIN(GetBackendsForTestlette)
+  float latitude;
+  float longitude;
+  float max_distance;
+  bool should_touch_west;
+  bool should_touch_east;
+PPLME_TESTLETTE_TYPE_END(GetBackendsForTestlette,
+                         ShardMapTest_GetBackendsFor)
+
+/**
+ *  @test  A search should touch those backends (and only those) with a
+ *         range that it might reach, including round the back of the world
+ *         and via a backend's lesser ranges; a max distance of 0 here
+ *         means none, which reaches everywhere.
+ */
+TEST_P(ShardMapTest_GetBackendsFor, Tests) {
+  // Arrange.
+  auto const shard_map = ShardMap::Parse(kShards);
+  ASSERT_TRUE(shard_map);
+  boost::optional<float> max_distance;
+  if (GetParam().max_distance > 0)
+    max_distance = GetParam().max_distance;
+
+  // Act.
+  auto const backends = shard_map->GetBackendsFor(
+      CreateGeoPosition(GetParam().latitude, GetParam().longitude),
+      max_distance);
+
+  // Assert.
+  std::vector<size_t> expected_backends;
+  if (GetParam().should_touch_west)
+    expected_backends.push_back(0);
+  if (GetParam().should_touch_east)
+    expected_backends.push_back(1);
+  ASSERT_EQ(expected_backends, backends);
+}
+
+PPLME_TESTLETTES_BEGIN(GetBackendsForTestlette, get_backends_for_testlettes)
+  PPLME_TESTLETTE(51.5f, -90.f, 50.f, true, false),
+  PPLME_TESTLETTE(51.5f, 90.f, 50.f, false, true),
+  PPLME_TESTLETTE(51.5f, -0.1f, 50.f, true, true),
+  PPLME_TESTLETTE(51.5f, -90.f, 0.f, true, true),
+  PPLME_TESTLETTE(-17.f, 179.9f, 50.f, true, true),
+  PPLME_TESTLETTE(-17.f, -179.9f, 50.f, true, true),
+  PPLME_TESTLETTE(-17.f, -170.f, 50.f, true, false),
+  PPLME_TESTLETTE(10.5f, -29.5f, 50.f, true, true),
+  PPLME_TESTLETTE(20.5f, -29.5f, 50.f, true, false),
+  PPLME_TESTLETTE(89.9f, -90.f, 50.f, true, true)
+PPLME_TESTLETTES_END(get_backends_for_testlettes, ShardMapTest_GetBackendsFor)
@@ -0,0 +1,314 @@
+/**
+ *  @file
+ *  @brief   Tests for pplme::shard::ShardedMatchingPplProvider.
+ *  @author  j.ho
+ */
+
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <vector>
+#include <boost/numeric/conversion/cast.hpp>
+#include <boost/uuid/random_generator.hpp>
+#include <gtest/gtest.h>
+#include "libpplmecore/person.h"
+#include "libpplmecore/ppl_matching_parameters.h"
+#include "libpplmenet/message.h"
+#include "libpplmenet/single_shot_server.h"
+#include "libpplmeproto/convert_geo_position.h"
+#include "libpplmeproto/convert_pplme_response.h"
+#include "libpplmeproto/pplme_response.pb.h"
+#include "libpplmeproto/request.pb.h"
+#include "libpplmeshard/sharded_matching_ppl_provider.h"
+
+
+using pplme::core::GeoPosition;
+using pplme::core::Person;
+using pplme::core::PersonId;
+using pplme::core::PplMatchingParameters;
+using pplme::net::Message;
+using pplme::net::SingleShotServer;
+using pplme::shard::ShardMap;
+using pplme::shard::ShardedMatchingPplProvider;
+
+
+namespace {
+
+
+int const kMaxPpl = 10;
+std::chrono::milliseconds const kShardTimeout{10000};
+unsigned int const kAskers = 4;
+
+/** About a kilometer's worth of latitude. */
+float const kKm = 1 / 111.2f;
+
+
+GeoPosition CreateGeoPosition(float latitude, float longitude) {
+  return GeoPosition{GeoPosition::DecimalLatitude{latitude},
+                     GeoPosition::DecimalLongitude{longitude}};
+}
+
+
+Person CreatePerson(std::string const& name, float latitude, float longitude) {
+  return Person{PersonId{boost::uuids::random_generator()()},
+                name,
+                boost::gregorian::date{1980, 1, 1},
+                CreateGeoPosition(latitude, longitude)};
+}
+
+
+/**
+ *  A pplmed in miniature, running on localhost, that finds whichever of its
+ *  ppl are within the max distance (however old they are), nearest first
+ *  (once @a go, if any, is set off).
+ */
+class FakeShard {
+ public:
+  explicit FakeShard(std::vector<Person> ppl,
+                     std::shared_future<void> go = {}) :
+      ppl_{std::move(ppl)},
+      go_{go},
+      request_count_{0},
+      server_{0,
+              [this](std::string const&,
+                     unsigned short,
+                     Message const& request) {
+                return HandleRequest(request);
+              },
+              true} {
+    server_.Start();
+  }
+
+  unsigned short GetPort() { return server_.GetLocalPort(); }
+  int GetRequestCount() const { return request_count_; }
+
+ private:
+  std::vector<Person> const ppl_;
+  std::shared_future<void> go_;
+  std::atomic<int> request_count_;
+  SingleShotServer server_;
+
+
+  std::unique_ptr<Message> HandleRequest(Message const& request) {
+    ++request_count_;
+    if (go_.valid())
+      go_.wait();
+    pplme::proto::Request request_pb;
+    if (!request_pb.ParseFromArray(request.GetBodyOctets(),
+                                   request.GetBodyLength()))
+      return std::unique_ptr<Message>{};
+    auto const& pplme_request_pb = request_pb.pplme_request();
+    GeoPosition location_of_user;
+    pplme::proto::Convert(pplme_request_pb.location_of_user(),
+                          &location_of_user);
+
+    std::vector<Person> ppl;
+    for (auto const& person : ppl_) {
+      if (!pplme_request_pb.has_max_distance()
+          || pplme::core::ApproxDistanceBetween(location_of_user,
+                                                person.location_of_home())
+              <= pplme_request_pb.max_distance())
+        ppl.push_back(person);
+    }
+    std::stable_sort(
+        ppl.begin(), ppl.end(),
+        [&location_of_user](Person const& lhs, Person const& rhs) {
+          return pplme::core::ApproxDistanceBetween(location_of_user,
+                                                    lhs.location_of_home())
+              < pplme::core::ApproxDistanceBetween(location_of_user,
+                                                   rhs.location_of_home());
+        });
+    if (ppl.size() > pplme_request_pb.limit())
+      ppl.resize(pplme_request_pb.limit());
+
+    pplme::proto::PplmeResponse response_pb;
+    pplme::proto::Convert(ppl, &response_pb);
+    auto const response_size =
+        boost::numeric_cast<uint32_t>(response_pb.ByteSize());
+    auto response_body = Message::CreateBodyBuffer(response_size);
+    response_pb.SerializeWithCachedSizesToArray(response_body.get());
+    return std::unique_ptr<Message>{
+        new Message{std::move(response_body), response_size}};
+  }
+};
+
+
+std::string GetShardRange(std::string const& range, unsigned short port) {
+  return range + "=127.0.0.1:" + std::to_string(port);
+}
+
+
+std::vector<std::string> GetNames(std::vector<Person> const& ppl) {
+  std::vector<std::string> names;
+  for (auto const& person : ppl)
+    names.push_back(person.name());
+  return names;
+}
+
+
+}  // namespace
+
+
+/**
+ *  @test  The nearest ppl should come back nearest first, however they're
+ *         spread over the shards, cut down to the limit.
+ */
+TEST(ShardedMatchingPplProviderTest, MergesTheNearestPplFromEachShard) {
+  // Arrange.
+  FakeShard west{{CreatePerson("W1", 0, -1 * kKm),
+                  CreatePerson("W3", 0, -3 * kKm),
+                  CreatePerson("W5", 0, -5 * kKm)}};
+  FakeShard east{{CreatePerson("E4", 0, 4 * kKm),
+                  CreatePerson("E2", 0, 2 * kKm)}};
+  auto const shard_map = ShardMap::Parse(
+      GetShardRange("-90:90/-180:0", west.GetPort()) + ","
+      + GetShardRange("-90:90/0:180", east.GetPort()));
+  ASSERT_TRUE(shard_map);
+  ShardedMatchingPplProvider provider{
+      *shard_map, kMaxPpl, kShardTimeout, kAskers};
+  PplMatchingParameters parameters{CreateGeoPosition(0, 0), 30};
+  parameters.set_limit(4).set_max_distance(50);
+
+  // Act.
+  auto const ppl = provider.FindMatchingPpl(parameters);
+
+  // Assert.
+  ASSERT_EQ((std::vector<std::string>{"W1", "E2", "W3", "E4"}),
+            GetNames(ppl));
+  ASSERT_EQ(1, west.GetRequestCount());
+  ASSERT_EQ(1, east.GetRequestCount());
+  auto const stats = provider.GetStats();
+  ASSERT_EQ(2U, stats.shard_requests);
+  ASSERT_EQ(0U, stats.shard_failures);
+  ASSERT_EQ(5U, stats.ppl_gathered);
+  ASSERT_EQ(4U, stats.ppl_merged);
+}
+
+
+/**
+ *  @test  Shards whose ranges are nowhere near the search shouldn't be
+ *         bothered, and connections should be reused from one find to the
+ *         next.
+ */
+TEST(ShardedMatchingPplProviderTest, OnlyAsksTheShardsThatTheSearchTouches) {
+  // Arrange.
+  FakeShard west{{CreatePerson("W", 0, -90)}};
+  FakeShard east{{CreatePerson("E", 0, 90)}};
+  auto const shard_map = ShardMap::Parse(
+      GetShardRange("-90:90/-180:0", west.GetPort()) + ","
+      + GetShardRange("-90:90/0:180", east.GetPort()));
+  ASSERT_TRUE(shard_map);
+  ShardedMatchingPplProvider provider{
+      *shard_map, kMaxPpl, kShardTimeout, kAskers};
+  PplMatchingParameters parameters{CreateGeoPosition(0, 90), 30};
+  parameters.set_max_distance(100);
+
+  // Act.
+  auto const first_ppl = provider.FindMatchingPpl(parameters);
+  auto const second_ppl = provider.FindMatchingPpl(parameters);
+
+  // Assert.
+  ASSERT_EQ(std::vector<std::string>{"E"}, GetNames(first_ppl));
+  ASSERT_EQ(std::vector<std::string>{"E"}, GetNames(second_ppl));
+  ASSERT_EQ(0, west.GetRequestCount());
+  ASSERT_EQ(2, east.GetRequestCount());
+}
+
+
+/**
+ *  @test  A shard that's in more than one range (or just in overlapping
+ *         ones) should be asked once, and anyone found twice should be
+ *         counted once.
+ */
+TEST(ShardedMatchingPplProviderTest, CountsEachShardAndPersonOnce) {
+  // Arrange.
+  auto const person = CreatePerson("P", 0, 1 * kKm);
+  FakeShard lots{{person}};
+  FakeShard more{{person}};
+  auto const shard_map = ShardMap::Parse(
+      GetShardRange("-90:0/-180:180", lots.GetPort()) + ","
+      + GetShardRange("0:90/-180:180", lots.GetPort()) + ","
+      + GetShardRange("-90:90/-180:180", more.GetPort()));
+  ASSERT_TRUE(shard_map);
+  ShardedMatchingPplProvider provider{
+      *shard_map, kMaxPpl, kShardTimeout, kAskers};
+  PplMatchingParameters parameters{CreateGeoPosition(0, 0), 30};
+
+  // Act.
+  auto const ppl = provider.FindMatchingPpl(parameters);
+
+  // Assert.
+  ASSERT_EQ(std::vector<std::string>{"P"}, GetNames(ppl));
+  ASSERT_EQ(1, lots.GetRequestCount());
+  ASSERT_EQ(1, more.GetRequestCount());
+}
+
+
+/**
+ *  @test  A shard that can't be reached shouldn't stop the others' ppl from
+ *         being found, but the outcome should own up to being partial.
+ */
+TEST(ShardedMatchingPplProviderTest, MakesDoWithoutADeadShard) {
+  // Arrange.
+  FakeShard alive{{CreatePerson("A", 0, 1 * kKm)}};
+  unsigned short dead_port;
+  /* dead shard block */ {
+    FakeShard dead{{}};
+    dead_port = dead.GetPort();
+  }
+  auto const shard_map = ShardMap::Parse(
+      GetShardRange("-90:90/-180:0", dead_port) + ","
+      + GetShardRange("-90:90/0:180", alive.GetPort()));
+  ASSERT_TRUE(shard_map);
+  ShardedMatchingPplProvider provider{
+      *shard_map, kMaxPpl, kShardTimeout, kAskers};
+  PplMatchingParameters parameters{CreateGeoPosition(0, 0), 30};
+  std::vector<std::string> names;
+
+  // Act.
+  auto const outcome = provider.VisitMatchingPpl(
+      parameters,
+      [&names](Person const& person) { names.push_back(person.name()); });
+
+  // Assert.
+  ASSERT_EQ(std::vector<std::string>{"A"}, names);
+  ASSERT_TRUE(outcome.partial);
+  ASSERT_FALSE(outcome.next_cursor);
+  ASSERT_EQ(1U, provider.GetStats().shard_failures);
+}
+
+
+/**
+ *  @test  A shard that takes its time shouldn't hold up a find past the
+ *         shard timeout, but the outcome should own up to being partial.
+ */
+TEST(ShardedMatchingPplProviderTest, MakesDoWithoutAStalledShard) {
+  // Arrange.
+  std::promise<void> go;
+  FakeShard stalled{{CreatePerson("S", 0, -1 * kKm)}, go.get_future().share()};
+  FakeShard alive{{CreatePerson("A", 0, 1 * kKm)}};
+  auto const shard_map = ShardMap::Parse(
+      GetShardRange("-90:90/-180:0", stalled.GetPort()) + ","
+      + GetShardRange("-90:90/0:180", alive.GetPort()));
+  ASSERT_TRUE(shard_map);
+  ShardedMatchingPplProvider provider{
+      *shard_map, kMaxPpl, std::chrono::milliseconds{100}, kAskers};
+  PplMatchingParameters parameters{CreateGeoPosition(0, 0), 30};
+  std::vector<std::string> names;
+
+  // Act.
+  auto const started = std::chrono::steady_clock::now();
+  auto const outcome = provider.VisitMatchingPpl(
+      parameters,
+      [&names](Person const& person) { names.push_back(person.name()); });
+  auto const took = std::chrono::steady_clock::now() - started;
+  go.set_value();
+
+  // Assert.
+  ASSERT_EQ(std::vector<std::string>{"A"}, names);
+  ASSERT_TRUE(outcome.partial);
+  ASSERT_LT(took, std::chrono::seconds{5});
+}
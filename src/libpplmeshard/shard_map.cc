@@ -0,0 +1,171 @@
+/**
+ *  @file
+ *  @brief   Implementation for pplme::shard::ShardMap.
+ *  @author  j.ho
+ */
+
+
+#include "shard_map.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <boost/math/constants/constants.hpp>
+#include <glog/logging.h>
+
+
+namespace {
+
+
+/** A touch under the real thing (which is more like 111.3), so that search
+    regions are rounded out rather than in. */
+float const kKmPerDegree = 111.0f;
+
+
+bool ParsePort(std::string const& text, unsigned short* port) {
+  if (text.empty()
+      || text.find_first_not_of("0123456789") != std::string::npos)
+    return false;
+  auto const value = strtoul(text.c_str(), nullptr, 10);
+  if (value == 0 || value > 65535)
+    return false;
+  *port = static_cast<unsigned short>(value);
+  return true;
+}
+
+
+bool ParseRange(std::string const& text,
+                pplme::shard::ShardMap::Range* range,
+                pplme::shard::ShardMap::Backend* backend) {
+  int consumed = 0;
+  if (sscanf(text.c_str(), "%f:%f/%f:%f=%n",
+             &range->min_latitude, &range->max_latitude,
+             &range->min_longitude, &range->max_longitude,
+             &consumed) != 4
+      || consumed == 0)
+    return false;
+  // (The negated comparisons also catch NaNs.)
+  if (!(range->min_latitude >= -90 && range->max_latitude <= 90
+        && range->min_latitude <= range->max_latitude
+        && range->min_longitude >= -180 && range->max_longitude <= 180
+        && range->min_longitude <= range->max_longitude))
+    return false;
+
+  auto const addressnport = text.substr(consumed);
+  auto const colon = addressnport.rfind(':');
+  if (colon == std::string::npos || colon == 0)
+    return false;
+  backend->host = addressnport.substr(0, colon);
+  return ParsePort(addressnport.substr(colon + 1), &backend->port);
+}
+
+
+/** Does [min, max] overlap [first, last]? */
+bool Overlaps(float min, float max, float first, float last) {
+  return min <= last && max >= first;
+}
+
+
+}  // namespace
+
+
+namespace pplme {
+namespace shard {
+
+
+boost::optional<ShardMap> ShardMap::Parse(std::string const& spec) {
+  std::vector<Backend> backends;
+  std::vector<Range> ranges;
+
+  std::string::size_type begin = 0;
+  while (begin <= spec.size()) {
+    auto end = spec.find(',', begin);
+    if (end == std::string::npos)
+      end = spec.size();
+
+    Range range;
+    Backend backend;
+    if (!ParseRange(spec.substr(begin, end - begin), &range, &backend)) {
+      LOG(ERROR) << "Invalid shard range `" << spec.substr(begin, end - begin)
+                 << "' (expected MIN_LAT:MAX_LAT/MIN_LON:MAX_LON=HOST:PORT)";
+      return boost::none;
+    }
+    auto const existing = std::find_if(
+        backends.begin(), backends.end(),
+        [&backend](Backend const& that) {
+          return that.host == backend.host && that.port == backend.port;
+        });
+    range.backend = existing - backends.begin();
+    if (existing == backends.end())
+      backends.push_back(backend);
+    ranges.push_back(range);
+
+    begin = end + 1;
+  }
+
+  return ShardMap{std::move(backends), std::move(ranges)};
+}
+
+
+std::vector<size_t> ShardMap::GetBackendsFor(
+    core::GeoPosition location,
+    boost::optional<float> max_distance) const {
+  auto const latitude = location.latitude().value();
+  auto const longitude = location.longitude().value();
+
+  // Round the search region out to a box; if there's no max distance, or if
+  // the box reaches a pole (or is just plain huge), then it's every
+  // longitude.
+  auto first_latitude = -90.f;
+  auto last_latitude = 90.f;
+  bool all_longitudes = true;
+  auto first_longitude = -180.f;
+  auto last_longitude = 180.f;
+  if (max_distance) {
+    auto const latitude_delta = *max_distance / kKmPerDegree;
+    first_latitude = latitude - latitude_delta;
+    last_latitude = latitude + latitude_delta;
+    // Degrees of longitude are skinniest at whichever end of the box is
+    // furthest from the equator.
+    auto const furthest_latitude =
+        std::max(fabsf(first_latitude), fabsf(last_latitude));
+    if (furthest_latitude < 89.9f) {
+      using boost::math::constants::pi;
+      auto const longitude_delta = latitude_delta
+          / cosf(furthest_latitude * pi<float>() / 180);
+      if (longitude_delta < 180) {
+        all_longitudes = false;
+        first_longitude = longitude - longitude_delta;
+        last_longitude = longitude + longitude_delta;
+      }
+    }
+  }
+
+  std::vector<bool> touched(backends_.size(), false);
+  for (auto const& range : ranges_) {
+    if (!Overlaps(range.min_latitude, range.max_latitude,
+                  first_latitude, last_latitude))
+      continue;
+    // The box may hang off either side of the antimeridian, in which case
+    // that bit of it is round the other side of the world.
+    if (all_longitudes
+        || Overlaps(range.min_longitude, range.max_longitude,
+                    first_longitude, last_longitude)
+        || Overlaps(range.min_longitude, range.max_longitude,
+                    first_longitude + 360, last_longitude + 360)
+        || Overlaps(range.min_longitude, range.max_longitude,
+                    first_longitude - 360, last_longitude - 360))
+      touched[range.backend] = true;
+  }
+
+  std::vector<size_t> touched_backends;
+  for (size_t backend = 0; backend < touched.size(); ++backend) {
+    if (touched[backend])
+      touched_backends.push_back(backend);
+  }
+  return touched_backends;
+}
+
+
+}  // namespace shard
+}  // namespace pplme
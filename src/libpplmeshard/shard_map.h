@@ -0,0 +1,99 @@
+/**
+ *  @file
+ *  @brief   Definition of pplme::shard::ShardMap, which says which pplmed
+ *           (shard) looks after which ppl, by where they live.
+ *  @author  j.ho
+ */
+#ifndef PPLME_LIBPPLMESHARD_SHARDMAP_H_
+#define PPLME_LIBPPLMESHARD_SHARDMAP_H_
+
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <boost/optional.hpp>
+#include "libpplmecore/geo_position.h"
+
+
+namespace pplme {
+namespace shard {
+
+
+/**
+ *  Example:
+ *  @code
+ *  auto const shard_map = ShardMap::Parse(
+ *      "-90:90/-180:0=west.example.com:3333,"
+ *      "-90:90/0:180=east.example.com:3333");
+ *  for (auto backend : shard_map->GetBackendsFor(location_of_user, 50.f))
+ *    // [...] Ask shard_map->backends()[backend] for ppl.
+ *  @endcode
+ *
+ *  @remarks
+ *  Each range is a box of latitude and longitude (inclusive at both ends,
+ *  and not wrapping round the antimeridian; a shard that does is just two
+ *  ranges with the same backend), and it's up to whoever loads up the
+ *  shards to make sure that each shard has the ppl that live in its ranges.
+ *  Ranges may overlap (anyone found by more than one shard is only counted
+ *  the once), but ppl that live outside all of them will never be found.
+ */
+class ShardMap {
+ public:
+  /** Where a shard can be asked for ppl. */
+  struct Backend {
+    std::string host;
+    unsigned short port;
+  };
+
+  /** A box of the world, and the backend that looks after it. */
+  struct Range {
+    float min_latitude;
+    float max_latitude;
+    float min_longitude;
+    float max_longitude;
+    /** Index into backends(). */
+    size_t backend;
+  };
+
+  ShardMap(std::vector<Backend> backends, std::vector<Range> ranges) :
+      backends_{std::move(backends)}, ranges_{std::move(ranges)} {}
+
+  /**
+   *  Parse a shard map from a comma-separated list of ranges, each of the
+   *  form `MIN_LAT:MAX_LAT/MIN_LON:MAX_LON=HOST:PORT'.
+   *
+   *  @returns  The shard map, or none if @a spec isn't one (or has no ranges
+   *            in it at all).
+   */
+  static boost::optional<ShardMap> Parse(std::string const& spec);
+
+  /** Each distinct HOST:PORT, in the order that they first appear. */
+  std::vector<Backend> const& backends() const { return backends_; }
+  std::vector<Range> const& ranges() const { return ranges_; }
+
+  /**
+   *  @returns  The indices (into backends(), in ascending order, and each
+   *            just the once) of those backends with any range that a
+   *            search of up to @a max_distance km around @a location might
+   *            reach, which is every backend if there's no @a max_distance.
+   *
+   *  @remarks
+   *  The search region is rounded out to a box of latitude and longitude,
+   *  so a backend might be asked when it can't actually have anyone close
+   *  enough, but never the other way around.
+   */
+  std::vector<size_t> GetBackendsFor(core::GeoPosition location,
+                                     boost::optional<float> max_distance)
+      const;
+
+ private:
+  std::vector<Backend> backends_;
+  std::vector<Range> ranges_;
+};
+
+
+}  // namespace shard
+}  // namespace pplme
+
+
+#endif  // PPLME_LIBPPLMESHARD_SHARDMAP_H_
@@ -0,0 +1,390 @@
+/**
+ *  @file
+ *  @brief   Implementation for pplme::shard::ShardedMatchingPplProvider.
+ *  @author  j.ho
+ */
+
+
+#include "sharded_matching_ppl_provider.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <boost/numeric/conversion/cast.hpp>
+#include <glog/logging.h>
+#include "libpplmecore/person.h"
+#include "libpplmecore/ppl_matching_parameters.h"
+#include "libpplmenet/client.h"
+#include "libpplmenet/message.h"
+#include "libpplmeproto/convert_geo_position.h"
+#include "libpplmeproto/convert_pplme_response.h"
+#include "libpplmeproto/pplme_response.pb.h"
+#include "libpplmeproto/request.pb.h"
+#include "libpplmeutils/noddy_worker_pool.h"
+
+
+namespace {
+
+
+/** The latest PplmeResponse version that we know how to read (the compact
+    one is the less work for the shards to make, and for us to send). */
+uint32_t const kMaxResponseVersion = 2;
+
+
+}  // namespace
+
+
+namespace pplme {
+namespace shard {
+
+
+class ShardedMatchingPplProvider::Impl {
+ public:
+  Impl(ShardMap shard_map,
+       int max_ppl,
+       std::chrono::milliseconds shard_timeout,
+       unsigned int askers) :
+      shard_map_{std::move(shard_map)},
+      max_ppl_{boost::numeric_cast<unsigned int>(max_ppl)},
+      shard_timeout_{shard_timeout},
+      shard_requests_{0},
+      shard_failures_{0},
+      ppl_gathered_{0},
+      ppl_merged_{0},
+      askers_{askers, {}} {
+    for (size_t n = 0; n < shard_map_.backends().size(); ++n)
+      idle_clients_.emplace_back(new IdleClients);
+  }
+
+
+  std::pair<std::vector<core::Person>, core::PplMatchingOutcome>
+  FindMatchingPpl(core::PplMatchingParameters const& parameters) const {
+    std::pair<std::vector<core::Person>, core::PplMatchingOutcome> result;
+    auto& ppl = result.first;
+    auto& outcome = result.second;
+
+    auto const limit =
+        std::min(parameters.limit().value_or(max_ppl_), max_ppl_);
+    auto const backends = shard_map_.GetBackendsFor(
+        parameters.location_of_user(), parameters.max_distance());
+    if (limit == 0 || backends.empty())
+      return result;
+
+    // However long the find has, the shards only get so long.
+    auto const now = std::chrono::steady_clock::now();
+    auto deadline = now + shard_timeout_;
+    if (parameters.deadline() && *parameters.deadline() < deadline)
+      deadline = *parameters.deadline();
+    auto const time_left =
+        std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now);
+    if (time_left.count() <= 0) {
+      outcome.partial = true;
+      return result;
+    }
+
+    // Scatter (by way of the askers)...
+    auto const scatter = std::make_shared<Scatter>(
+        backends.size(), CreateRequest(parameters, limit, time_left));
+    for (size_t n = 0; n < backends.size(); ++n) {
+      auto const backend = backends[n];
+      askers_.QueueWorklette([this, scatter, n, backend]() {
+          auto shard_result = AskShard(backend, scatter.get(), n);
+          std::unique_lock<std::mutex> lock(scatter->mutex);
+          scatter->shard_results[n] = std::move(shard_result);
+          scatter->answered[n] = true;
+          ++scatter->answered_count;
+          scatter->answer.notify_all();
+        });
+    }
+
+    // ...wait for the shards for as long as we can (hanging up on any that
+    // are late, so that their askers don't wait on them forever)...
+    std::vector<ShardResult> shard_results(backends.size());
+    /* lock block */ {
+      std::unique_lock<std::mutex> lock(scatter->mutex);
+      scatter->answer.wait_until(lock, deadline, [&scatter]() {
+          return scatter->answered_count == scatter->answered.size();
+        });
+      scatter->late = true;
+      for (size_t n = 0; n < backends.size(); ++n) {
+        if (scatter->answered[n])
+          shard_results[n] = std::move(scatter->shard_results[n]);
+        else {
+          shard_results[n].partial = true;
+          if (scatter->clients[n])
+            scatter->clients[n]->Hangup();
+        }
+      }
+    }
+
+    // ...and gather: nearest first (and, for those just as near, in the
+    // order that the shards and then each shard had them).
+    struct Candidate {
+      float distance;
+      core::Person const* person;
+    };
+    std::vector<Candidate> candidates;
+    for (auto const& shard_result : shard_results) {
+      outcome.partial = outcome.partial || shard_result.partial;
+      for (auto const& person : shard_result.ppl) {
+        candidates.push_back(Candidate{
+            core::ApproxDistanceBetween(parameters.location_of_user(),
+                                        person.location_of_home()),
+            &person});
+      }
+    }
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](Candidate const& lhs, Candidate const& rhs) {
+                       return lhs.distance < rhs.distance;
+                     });
+    for (auto const& candidate : candidates) {
+      if (ppl.size() == limit)
+        break;
+      // Overlapping ranges can mean the same Person from more than one
+      // shard.
+      auto const& id = candidate.person->id();
+      if (std::none_of(ppl.begin(), ppl.end(),
+                       [&id](core::Person const& person) {
+                         return person.id().value() == id.value();
+                       }))
+        ppl.push_back(*candidate.person);
+    }
+
+    ppl_gathered_ += candidates.size();
+    ppl_merged_ += ppl.size();
+    return result;
+  }
+
+
+  Stats GetStats() const {
+    return Stats{shard_requests_, shard_failures_, ppl_gathered_, ppl_merged_};
+  }
+
+
+ private:
+  /** Connections to a shard that aren't in use right now. */
+  struct IdleClients {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<net::Client>> clients;
+  };
+
+  struct ShardResult {
+    std::vector<core::Person> ppl;
+    /** True iff the shard came to nothing or ran out of time. */
+    bool partial = false;
+  };
+
+  /** A find's asking of its shards, as shared with its askers (which may
+      outlive the find, if they're late). */
+  struct Scatter {
+    Scatter(size_t shard_count, std::unique_ptr<net::Message> request) :
+        request{std::move(request)},
+        shard_results(shard_count),
+        answered(shard_count, false),
+        answered_count{0},
+        clients(shard_count, nullptr),
+        late{false} {}
+
+    /** The same for every shard. */
+    std::unique_ptr<net::Message> const request;
+    std::mutex mutex;
+    std::condition_variable answer;
+    /** Indexed as per the find's shards (as are the rest). */
+    std::vector<ShardResult> shard_results;
+    std::vector<bool> answered;
+    size_t answered_count;
+    /** Whichever client each shard is being asked over right now. */
+    std::vector<net::Client*> clients;
+    /** Whether the find is done waiting. */
+    bool late;
+  };
+
+  ShardMap const shard_map_;
+  unsigned int const max_ppl_;
+  std::chrono::milliseconds const shard_timeout_;
+  /** Indexed as per ShardMap::backends(). */
+  std::vector<std::unique_ptr<IdleClients>> idle_clients_;
+  /** @see  ShardedMatchingPplProvider::Stats. */
+  mutable std::atomic<uint64_t> shard_requests_;
+  mutable std::atomic<uint64_t> shard_failures_;
+  mutable std::atomic<uint64_t> ppl_gathered_;
+  mutable std::atomic<uint64_t> ppl_merged_;
+  /** N.B. last, so that they're done before everything that they use is
+      destroyed. */
+  mutable utils::NoddyWorkerPool askers_;
+
+
+  /** @returns  The PplmeRequest to send to each shard (which is the same
+                for all of them). */
+  static std::unique_ptr<net::Message> CreateRequest(
+      core::PplMatchingParameters const& parameters,
+      unsigned int limit,
+      std::chrono::milliseconds time_left) {
+    // Each Person's location of home is what the merging goes by, so ask
+    // for the whole Person (which is what no mask means), whatever the
+    // client wanted.
+    proto::Request request_pb;
+    request_pb.set_max_response_version(kMaxResponseVersion);
+    auto& pplme_request_pb = *request_pb.mutable_pplme_request();
+    proto::Convert(parameters.location_of_user(),
+                   pplme_request_pb.mutable_location_of_user());
+    pplme_request_pb.set_age_of_user(parameters.age_of_user());
+    pplme_request_pb.set_limit(limit);
+    if (parameters.max_distance())
+      pplme_request_pb.set_max_distance(*parameters.max_distance());
+    if (parameters.min_age())
+      pplme_request_pb.set_min_age(*parameters.min_age());
+    if (parameters.max_age())
+      pplme_request_pb.set_max_age(*parameters.max_age());
+    pplme_request_pb.set_deadline_ms(
+        boost::numeric_cast<uint32_t>(time_left.count()));
+
+    auto const request_size =
+        boost::numeric_cast<uint32_t>(request_pb.ByteSize());
+    auto request_body = net::Message::CreateBodyBuffer(request_size);
+    request_pb.SerializeWithCachedSizesToArray(request_body.get());
+    return std::unique_ptr<net::Message>{
+        new net::Message{std::move(request_body), request_size}};
+  }
+
+
+  /** Ask @a backend (the find's @a n'th shard) for @a scatter's ppl. */
+  ShardResult AskShard(size_t backend, Scatter* scatter, size_t n) const {
+    ++shard_requests_;
+    ShardResult result;
+    auto const& address = shard_map_.backends()[backend];
+
+    auto const response = SendRequest(backend, scatter, n);
+    proto::PplmeResponse response_pb;
+    if (!response) {
+      LOG(WARNING) << "No response (in time) from shard "
+                   << address.host << ":" << address.port;
+      result.partial = true;
+    } else if (!response_pb.ParseFromArray(response->GetBodyOctets(),
+                                           response->GetBodyLength())
+               || !proto::Convert(response_pb, &result.ppl)) {
+      LOG(WARNING) << "Invalid response from shard "
+                   << address.host << ":" << address.port;
+      result.ppl.clear();
+      result.partial = true;
+    } else if (response_pb.busy()) {
+      LOG(WARNING) << "Shard " << address.host << ":" << address.port
+                   << " is too busy";
+      result.partial = true;
+    } else {
+      result.partial = response_pb.partial();
+      return result;
+    }
+
+    ++shard_failures_;
+    return result;
+  }
+
+
+  /** Send @a scatter's request (as its @a n'th shard) over an idle
+      connection to @a backend, if there is one, or else (or if that
+      connection turns out to have been hung up on) over a new one; either
+      way, the connection is kept for next time if it worked.  Nothing is
+      sent once the find is done waiting. */
+  std::unique_ptr<net::Message> SendRequest(
+      size_t backend, Scatter* scatter, size_t n) const {
+    if (IsLate(scatter))
+      return nullptr;
+
+    auto& idle_clients = *idle_clients_[backend];
+    std::unique_ptr<net::Client> client;
+    /* lock block */ {
+      std::unique_lock<std::mutex> lock(idle_clients.mutex);
+      if (!idle_clients.clients.empty()) {
+        client = std::move(idle_clients.clients.back());
+        idle_clients.clients.pop_back();
+      }
+    }
+
+    std::unique_ptr<net::Message> response;
+    if (client)
+      response = SendRequestUnlessLate(client.get(), scatter, n);
+    if (!response && !IsLate(scatter)) {
+      auto const& address = shard_map_.backends()[backend];
+      client.reset(new net::Client{address.host, address.port});
+      if (!client->Connect())
+        return response;
+      response = SendRequestUnlessLate(client.get(), scatter, n);
+    }
+
+    if (response) {
+      std::unique_lock<std::mutex> lock(idle_clients.mutex);
+      idle_clients.clients.push_back(std::move(client));
+    }
+    return response;
+  }
+
+
+  /** Send @a scatter's request (as its @a n'th shard) over @a client, so
+      long as the find isn't done waiting (or, if it's done waiting
+      meanwhile, hangs up on @a client).  @returns  The response, if it was
+      in time. */
+  static std::unique_ptr<net::Message> SendRequestUnlessLate(
+      net::Client* client, Scatter* scatter, size_t n) {
+    /* lock block */ {
+      std::unique_lock<std::mutex> lock(scatter->mutex);
+      if (scatter->late)
+        return nullptr;
+      scatter->clients[n] = client;
+    }
+
+    auto response = client->SendRequest(*scatter->request);
+
+    std::unique_lock<std::mutex> lock(scatter->mutex);
+    scatter->clients[n] = nullptr;
+    // (If it's late, then client may well have been hung up on, so it's no
+    // use for next time, and the find doesn't want the response anyway.)
+    if (scatter->late)
+      response.reset();
+    return response;
+  }
+
+
+  static bool IsLate(Scatter* scatter) {
+    std::unique_lock<std::mutex> lock(scatter->mutex);
+    return scatter->late;
+  }
+};
+
+
+ShardedMatchingPplProvider::ShardedMatchingPplProvider(
+    ShardMap shard_map,
+    int max_ppl,
+    std::chrono::milliseconds shard_timeout,
+    unsigned int askers) :
+    impl_{new Impl{std::move(shard_map), max_ppl, shard_timeout, askers}} {}
+
+
+ShardedMatchingPplProvider::~ShardedMatchingPplProvider() = default;
+
+
+std::vector<core::Person> ShardedMatchingPplProvider::FindMatchingPpl(
+    core::PplMatchingParameters const& parameters) const {
+  return impl_->FindMatchingPpl(parameters).first;
+}
+
+
+core::PplMatchingOutcome ShardedMatchingPplProvider::VisitMatchingPpl(
+    core::PplMatchingParameters const& parameters,
+    std::function<void (core::Person const&)> const& visitor) const {
+  auto const result = impl_->FindMatchingPpl(parameters);
+  for (auto const& person : result.first)
+    visitor(person);
+  return result.second;
+}
+
+
+ShardedMatchingPplProvider::Stats ShardedMatchingPplProvider::GetStats()
+    const {
+  return impl_->GetStats();
+}
+
+
+}  // namespace shard
+}  // namespace pplme
@@ -0,0 +1,107 @@
+/**
+ *  @file
+ *  @brief   Definition of pplme::shard::ShardedMatchingPplProvider, which
+ *           finds ppl by asking the shards (other pplmeds) that have them.
+ *  @author  j.ho
+ */
+#ifndef PPLME_LIBPPLMESHARD_SHARDEDMATCHINGPPLPROVIDER_H_
+#define PPLME_LIBPPLMESHARD_SHARDEDMATCHINGPPLPROVIDER_H_
+
+
+#include <stdint.h>
+#include <chrono>
+#include <vector>
+#include "libpplmecore/matching_ppl_provider.h"
+#include "libpplmeutils/pimpl.h"
+#include "shard_map.h"
+
+
+namespace pplme {
+namespace shard {
+
+
+/**
+ *  Example:
+ *  @code
+ *  ShardedMatchingPplProvider provider{
+ *      *ShardMap::Parse(shards), 10, std::chrono::seconds{1}, 64};
+ *  auto const ppl = provider.FindMatchingPpl(parameters);
+ *  @endcode
+ *
+ *  @remarks
+ *  Each find is scattered to those shards whose ranges the search region
+ *  touches (as per ShardMap::GetBackendsFor()), all at once (by way of a
+ *  pool of askers, each asking one shard at a time), each being asked for
+ *  as many ppl as the find wants; whatever comes back is then
+ *  merged, nearest first, and cut down to the limit.  Each shard's own
+ *  nearest ppl are the only ones of its ppl that can make the overall
+ *  nearest, so nobody is missed.  (Shards find ppl a ring of cells at a
+ *  time, so "nearest" is to within a cell, both for them and hence for the
+ *  merged ppl.)
+ *
+ *  Connections to each shard are kept and reused, so shards should be run
+ *  with --keep_alive (without it, every other request finds its connection
+ *  hung up on and has to make a new one).
+ *
+ *  If a shard can't be reached, is too busy, or doesn't answer in time (by
+ *  the find's deadline or within the shard timeout, whichever is sooner),
+ *  then the find makes do with whoever the other shards found, and says
+ *  that it's partial; a shard that is late is hung up on, so that its asker
+ *  is free for the next find.  The time left is passed on to the shards, so
+ *  that they needn't bother with what won't be waited for.
+ *
+ *  Pagination isn't supported: any cursor is ignored, and there's never a
+ *  next one.  A shard's cursor only means anything to that shard, so paging
+ *  through the merged ppl would need a cursor per shard.
+ *
+ *  @note
+ *  This class is safe to use concurrently.
+ */
+class ShardedMatchingPplProvider : public core::MatchingPplProvider {
+ public:
+  /** @param max_ppl caps how many ppl a find may ask for.
+      @param shard_timeout is the longest that a find waits on the shards.
+      @param askers is how many shards may be being asked at once (across
+             all finds); any more wait their turn. */
+  ShardedMatchingPplProvider(ShardMap shard_map,
+                             int max_ppl,
+                             std::chrono::milliseconds shard_timeout,
+                             unsigned int askers);
+  ~ShardedMatchingPplProvider();
+
+  ShardedMatchingPplProvider(ShardedMatchingPplProvider const&) = delete;
+  ShardedMatchingPplProvider& operator=(ShardedMatchingPplProvider const&) =
+      delete;
+
+  std::vector<core::Person>
+  FindMatchingPpl(core::PplMatchingParameters const& parameters) const override;
+
+  core::PplMatchingOutcome VisitMatchingPpl(
+      core::PplMatchingParameters const& parameters,
+      std::function<void (core::Person const&)> const& visitor) const override;
+
+  /** Running totals across all finds so far, for the metrics. */
+  struct Stats {
+    /** Requests sent to shards, and how many of those came to nothing
+        (including busy responses). */
+    uint64_t shard_requests;
+    uint64_t shard_failures;
+    /** Ppl that came back from shards, and those of them that made the
+        cut. */
+    uint64_t ppl_gathered;
+    uint64_t ppl_merged;
+  };
+
+  Stats GetStats() const;
+
+ private:
+  class Impl;
+  utils::Pimpl<Impl> impl_;
+};
+
+
+}  // namespace shard
+}  // namespace pplme
+
+
+#endif  // PPLME_LIBPPLMESHARD_SHARDEDMATCHINGPPLPROVIDER_H_
@@ -0,0 +1,87 @@
+/**
+ *  @file
+ *  @brief   Implementation for pplme::utils::AdmissionController.
+ *  @author  j.ho
+ */
+
+
+#include "admission_controller.h"
+
+
+namespace pplme {
+namespace utils {
+
+
+AdmissionController::Ticket&
+AdmissionController::Ticket::operator=(Ticket&& that) {
+  if (this != &that) {
+    if (admission_controller_)
+      admission_controller_->Release();
+    admission_controller_ = that.admission_controller_;
+    that.admission_controller_ = nullptr;
+  }
+  return *this;
+}
+
+
+AdmissionController::Ticket::~Ticket() {
+  if (admission_controller_)
+    admission_controller_->Release();
+}
+
+
+AdmissionController::AdmissionController(unsigned int max_in_flight,
+                                         Clock::duration max_queue_time) :
+    max_in_flight_{max_in_flight},
+    max_queue_time_{max_queue_time},
+    in_flight_{0},
+    queued_{0},
+    admitted_count_{0},
+    rejected_count_{0} {}
+
+
+AdmissionController::Ticket AdmissionController::Admit() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto const has_room = [this]() {
+    return max_in_flight_ == 0 || in_flight_ < max_in_flight_;
+  };
+  if (!has_room()) {
+    ++queued_;
+    condvar_.wait_for(lock, max_queue_time_, has_room);
+    --queued_;
+  }
+
+  if (!has_room()) {
+    ++rejected_count_;
+    return Ticket{};
+  }
+
+  ++in_flight_;
+  ++admitted_count_;
+  return Ticket{this};
+}
+
+
+AdmissionController::Stats AdmissionController::GetStats() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return Stats{
+      max_in_flight_,
+      max_queue_time_,
+      in_flight_,
+      queued_,
+      admitted_count_,
+      rejected_count_};
+}
+
+
+void AdmissionController::Release() {
+  /* lock block */ {
+    std::unique_lock<std::mutex> lock(mutex_);
+    --in_flight_;
+  }
+  condvar_.notify_one();
+}
+
+
+}  // namespace utils
+}  // namespace pplme
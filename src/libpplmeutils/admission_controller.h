@@ -0,0 +1,119 @@
+/**
+ *  @file
+ *  @brief   Definition of pplme::utils::AdmissionController, which bounds how
+ *           many requests are being worked on at once.
+ *  @author  j.ho
+ */
+#ifndef PPLME_LIBPPLMEUTILS_ADMISSIONCONTROLLER_H_
+#define PPLME_LIBPPLMEUTILS_ADMISSIONCONTROLLER_H_
+
+
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+
+namespace pplme {
+namespace utils {
+
+
+/**
+ *  Example:
+ *  @code
+ *  AdmissionController admission_controller{64, std::chrono::milliseconds{50}};
+ *  // [...]
+ *  auto const ticket = admission_controller.Admit();
+ *  if (!ticket)
+ *    return TooBusyResponse();
+ *  // [...] Do the actual work; the slot is given back when ticket goes.
+ *  @endcode
+ *
+ *  @remarks
+ *  At most max_in_flight tickets are outstanding at any one time.  Anyone
+ *  who turns up when they're all taken waits for up to max_queue_time for
+ *  one to come back, and is turned away if none does; better to tell a few
+ *  clients to go away quickly than to have everyone's requests pile up
+ *  behind each other until nobody gets an answer in time.
+ *
+ *  @note
+ *  This class is safe to use concurrently.  It must outlive its tickets.
+ */
+class AdmissionController {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  /** A slot for one request, which is given back upon destruction. */
+  class Ticket {
+   public:
+    Ticket() : admission_controller_{nullptr} {}
+    Ticket(Ticket&& that) : admission_controller_{that.admission_controller_} {
+      that.admission_controller_ = nullptr;
+    }
+    Ticket& operator=(Ticket&& that);
+    ~Ticket();
+
+    Ticket(Ticket const&) = delete;
+    Ticket& operator=(Ticket const&) = delete;
+
+    /** @returns  true iff this ticket was actually admitted. */
+    explicit operator bool() const { return admission_controller_ != nullptr; }
+
+   private:
+    friend class AdmissionController;
+
+    explicit Ticket(AdmissionController* admission_controller) :
+        admission_controller_{admission_controller} {}
+
+    AdmissionController* admission_controller_;
+  };
+
+  /** What the admission controller has been up to, for the metrics. */
+  struct Stats {
+    unsigned int max_in_flight;
+    Clock::duration max_queue_time;
+    /** How many tickets are currently outstanding. */
+    unsigned int in_flight;
+    /** How many are currently waiting for one. */
+    unsigned int queued;
+    /** Since construction. */
+    uint64_t admitted_count;
+    uint64_t rejected_count;
+  };
+
+  /** A @a max_in_flight of 0 means no limit. */
+  AdmissionController(unsigned int max_in_flight,
+                      Clock::duration max_queue_time);
+
+  AdmissionController(AdmissionController const&) = delete;
+  AdmissionController& operator=(AdmissionController const&) = delete;
+
+  /**
+   *  Wait (for no longer than max_queue_time) for a slot.
+   *
+   *  @returns  The ticket for the slot, or an empty ticket if there isn't
+   *            one to be had.
+   */
+  Ticket Admit();
+
+  Stats GetStats() const;
+
+ private:
+  unsigned int const max_in_flight_;
+  Clock::duration const max_queue_time_;
+  mutable std::mutex mutex_;
+  std::condition_variable condvar_;
+  unsigned int in_flight_;
+  unsigned int queued_;
+  uint64_t admitted_count_;
+  uint64_t rejected_count_;
+
+  void Release();
+};
+
+
+}  // namespace utils
+}  // namespace pplme
+
+
+#endif  // PPLME_LIBPPLMEUTILS_ADMISSIONCONTROLLER_H_
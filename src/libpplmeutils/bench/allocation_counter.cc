@@ -0,0 +1,76 @@
+/**
+ *  @file
+ *  @brief   Replacement global operator new/delete that count allocations,
+ *           and keep tabs on how much is in use.
+ *  @author  j.ho
+ *
+ *  N.B. This isn't part of libpplmeutils proper (were it in the archive, it
+ *  would be pulled in to satisfy operator new for everyone); benchmarks that
+ *  want it say so with bench_extra_objs (see common.mk).
+ */
+
+
+#include "allocation_counter.h"
+#include <malloc.h>
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+
+
+namespace {
+
+
+std::atomic<uint64_t> g_allocation_count{0};
+std::atomic<int64_t> g_heap_octets_in_use{0};
+
+
+}  // namespace
+
+
+// N.B. These live in their own translation unit so that the compiler can't
+//      see through them (and then get upset about new/free mismatches).
+//      malloc_usable_size() is used on the way in and out so that the two
+//      sides agree regardless of whether a sized delete gets called.
+void* operator new(std::size_t size) {
+  g_allocation_count.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = malloc(size ? size : 1)) {
+    g_heap_octets_in_use.fetch_add(
+        malloc_usable_size(p), std::memory_order_relaxed);
+    return p;
+  }
+  throw std::bad_alloc{};
+}
+
+
+void operator delete(void* p) noexcept {
+  if (p) {
+    g_heap_octets_in_use.fetch_sub(
+        malloc_usable_size(p), std::memory_order_relaxed);
+  }
+  free(p);
+}
+
+
+void operator delete(void* p, std::size_t) noexcept {
+  operator delete(p);
+}
+
+
+namespace pplme {
+namespace utils {
+namespace bench {
+
+
+uint64_t GetAllocationCount() {
+  return g_allocation_count.load(std::memory_order_relaxed);
+}
+
+
+int64_t GetHeapOctetsInUse() {
+  return g_heap_octets_in_use.load(std::memory_order_relaxed);
+}
+
+
+}  // namespace bench
+}  // namespace utils
+}  // namespace pplme
@@ -0,0 +1,34 @@
+/**
+ *  @file
+ *  @brief   Tracking of what the global operator new has handed out, for the
+ *           benefit of benchmarks that care about how much they allocate
+ *           (and how much memory things take).
+ *  @author  j.ho
+ */
+#ifndef PPLME_LIBPPLMEUTILSBENCH_ALLOCATIONCOUNTER_H_
+#define PPLME_LIBPPLMEUTILSBENCH_ALLOCATIONCOUNTER_H_
+
+
+#include <stdint.h>
+
+
+namespace pplme {
+namespace utils {
+namespace bench {
+
+
+/** @returns  The number of global operator new calls made by this process. */
+uint64_t GetAllocationCount();
+
+/** @returns  The number of octets currently allocated via the global
+              operator new (as malloc() sees it, i.e., including its
+              rounding up). */
+int64_t GetHeapOctetsInUse();
+
+
+}  // namespace bench
+}  // namespace utils
+}  // namespace pplme
+
+
+#endif  // PPLME_LIBPPLMEUTILSBENCH_ALLOCATIONCOUNTER_H_
@@ -0,0 +1,180 @@
+/**
+ *  @file
+ *  @brief   Implementation for pplme::utils::HugePageArena.
+ *  @author  j.ho
+ */
+
+
+#include "huge_page_arena.h"
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <glog/logging.h>
+
+
+namespace {
+
+
+size_t const kHugePageSize = 2 * 1024 * 1024;
+
+
+size_t RoundUp(size_t size, size_t multiple) {
+  return (size + multiple - 1) / multiple * multiple;
+}
+
+
+}  // namespace
+
+
+namespace pplme {
+namespace utils {
+
+
+size_t const HugePageArena::kDefaultChunkSize;
+size_t const HugePageArena::kMinSizeClass;
+size_t const HugePageArena::kSizeClassCount;
+
+
+HugePageArena::HugePageArena(size_t chunk_size) :
+    chunk_size_{RoundUp(std::max<size_t>(chunk_size, 1), kHugePageSize)},
+    next_{nullptr},
+    end_{nullptr},
+    try_huge_tlb_{true},
+    stats_{0, 0, 0, 0} {
+  free_lists_.fill(nullptr);
+}
+
+
+HugePageArena::~HugePageArena() {
+  for (auto const& chunk : chunks_)
+    Unmap(chunk);
+  for (auto const& big_mapping : big_mappings_)
+    Unmap(big_mapping.second);
+}
+
+
+void* HugePageArena::Allocate(size_t size) {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  if (!IsChunked(size)) {
+    auto const mapping = Map(RoundUp(size, kHugePageSize));
+    big_mappings_.emplace(mapping.address, mapping);
+    stats_.allocated_octets += mapping.size;
+    return mapping.address;
+  }
+
+  auto const size_class = GetSizeClass(size);
+  auto const class_size = size_t{1} << size_class;
+  stats_.allocated_octets += class_size;
+
+  // Recycle if we can, ...
+  auto& free_list = free_lists_[size_class];
+  if (free_list) {
+    auto const memory = free_list;
+    free_list = *static_cast<void**>(memory);
+    return memory;
+  }
+
+  // ...and if not, carve off the end of the latest chunk (or a new one, if
+  // that's not got enough left; whatever it has left is lost to the cause).
+  if (static_cast<size_t>(end_ - next_) < class_size) {
+    auto const chunk = Map(chunk_size_);
+    chunks_.push_back(chunk);
+    next_ = static_cast<char*>(chunk.address);
+    end_ = next_ + chunk.size;
+  }
+  auto const memory = next_;
+  next_ += class_size;
+  return memory;
+}
+
+
+void HugePageArena::Deallocate(void* memory, size_t size) {
+  if (!memory)
+    return;
+
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  if (!IsChunked(size)) {
+    auto const big_mapping = big_mappings_.find(memory);
+    CHECK(big_mapping != big_mappings_.end());
+    stats_.allocated_octets -= big_mapping->second.size;
+    Unmap(big_mapping->second);
+    big_mappings_.erase(big_mapping);
+    return;
+  }
+
+  auto const size_class = GetSizeClass(size);
+  stats_.allocated_octets -= size_t{1} << size_class;
+  auto& free_list = free_lists_[size_class];
+  *static_cast<void**>(memory) = free_list;
+  free_list = memory;
+}
+
+
+HugePageArena::Stats HugePageArena::GetStats() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+
+size_t HugePageArena::GetSizeClass(size_t size) {
+  auto size_class = kMinSizeClass;
+  while ((size_t{1} << size_class) < size)
+    ++size_class;
+  return size_class;
+}
+
+
+bool HugePageArena::IsChunked(size_t size) const {
+  return size <= chunk_size_ / 2;
+}
+
+
+HugePageArena::Mapping HugePageArena::Map(size_t size) {
+  Mapping mapping{nullptr, size, false, false};
+
+  if (try_huge_tlb_) {
+    auto const memory = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (memory != MAP_FAILED) {
+      mapping.address = memory;
+      mapping.huge_tlb = true;
+    } else {
+      VLOG(1) << "No huge pages to be had (" << strerror(errno)
+              << "); falling back to transparent ones";
+      try_huge_tlb_ = false;
+    }
+  }
+
+  if (!mapping.address) {
+    auto const memory = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+      throw std::bad_alloc{};
+    mapping.address = memory;
+    mapping.transparent_huge = madvise(memory, size, MADV_HUGEPAGE) == 0;
+  }
+
+  stats_.mapped_octets += size;
+  if (mapping.huge_tlb)
+    stats_.huge_tlb_octets += size;
+  if (mapping.transparent_huge)
+    stats_.transparent_huge_octets += size;
+  return mapping;
+}
+
+
+void HugePageArena::Unmap(Mapping const& mapping) {
+  CHECK(munmap(mapping.address, mapping.size) == 0) << strerror(errno);
+  stats_.mapped_octets -= mapping.size;
+  if (mapping.huge_tlb)
+    stats_.huge_tlb_octets -= mapping.size;
+  if (mapping.transparent_huge)
+    stats_.transparent_huge_octets -= mapping.size;
+}
+
+
+}  // namespace utils
+}  // namespace pplme
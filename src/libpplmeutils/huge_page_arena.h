@@ -0,0 +1,173 @@
+/**
+ *  @file
+ *  @brief   Definition of pplme::utils::HugePageArena, an allocator of memory
+ *           that lives (if at all possible) on huge pages, and of
+ *           pplme::utils::ArenaAllocator, which lets containers use one.
+ *  @author  j.ho
+ */
+#ifndef PPLME_LIBPPLMEUTILS_HUGEPAGEARENA_H_
+#define PPLME_LIBPPLMEUTILS_HUGEPAGEARENA_H_
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <array>
+#include <map>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+
+namespace pplme {
+namespace utils {
+
+
+/**
+ *  Example:
+ *  @code
+ *  HugePageArena arena;
+ *  std::vector<Foo, ArenaAllocator<Foo>> foos{ArenaAllocator<Foo>{&arena}};
+ *  foos.resize(10000000);
+ *  // [...]
+ *  LOG(INFO) << "foos: " << arena.GetStats().allocated_octets << " octets";
+ *  @endcode
+ *
+ *  @remarks
+ *  Memory is mapped a chunk at a time, and then handed out from there.  Each
+ *  chunk is mapped with MAP_HUGETLB if there are huge pages to be had; if
+ *  not, it's madvise()d MADV_HUGEPAGE, so that transparent huge pages can
+ *  take it on; and if not even that, then it's just plain old pages (which is
+ *  no worse than the heap).  Either way, there are far fewer pages for the
+ *  TLB to keep track of than there would be if everything were scattered all
+ *  over the heap.
+ *
+ *  Freed memory goes on a free list for its size (sizes are rounded up to
+ *  powers of two), to be handed out again, but is never given back to the
+ *  OS until the arena goes; anything too big to be worth chunking gets
+ *  mapped (and unmapped) all by itself.
+ *
+ *  @note
+ *  This class is safe to use concurrently.  It must outlive everything
+ *  allocated from it.
+ */
+class HugePageArena {
+ public:
+  /** What the arena has been up to, for the metrics. */
+  struct Stats {
+    /** Mapped from the OS, all told, and how much of that is on explicit
+        (MAP_HUGETLB) huge pages, and how much is madvise()d towards
+        transparent ones. */
+    uint64_t mapped_octets;
+    uint64_t huge_tlb_octets;
+    uint64_t transparent_huge_octets;
+    /** Currently allocated (rounded up as per the free lists). */
+    uint64_t allocated_octets;
+  };
+
+  HugePageArena() : HugePageArena{kDefaultChunkSize} {}
+  /** @a chunk_size is rounded up to a multiple of 2MiB (a huge page). */
+  explicit HugePageArena(size_t chunk_size);
+  ~HugePageArena();
+
+  HugePageArena(HugePageArena const&) = delete;
+  HugePageArena& operator=(HugePageArena const&) = delete;
+
+  /** @returns  @a size octets, aligned for anything; throws std::bad_alloc
+                if the OS won't give us any more. */
+  void* Allocate(size_t size);
+
+  /** Give back @a size octets at @a memory, as returned by Allocate(size). */
+  void Deallocate(void* memory, size_t size);
+
+  Stats GetStats() const;
+
+  static size_t const kDefaultChunkSize = 64 * 1024 * 1024;
+
+ private:
+  struct Mapping {
+    void* address;
+    size_t size;
+    bool huge_tlb;
+    bool transparent_huge;
+  };
+
+  /** A free list for each power of two from 16 octets to half a chunk. */
+  static size_t const kMinSizeClass = 4;
+  static size_t const kSizeClassCount = 32;
+
+  size_t const chunk_size_;
+  mutable std::mutex mutex_;
+  std::vector<Mapping> chunks_;
+  /** Those allocations too big to be worth chunking, by address. */
+  std::map<void*, Mapping> big_mappings_;
+  /** The unused remainder of the latest chunk. */
+  char* next_;
+  char* end_;
+  std::array<void*, kSizeClassCount> free_lists_;
+  /** Once the OS says no to MAP_HUGETLB, we stop asking. */
+  bool try_huge_tlb_;
+  Stats stats_;
+
+  static size_t GetSizeClass(size_t size);
+  bool IsChunked(size_t size) const;
+  /** Must be called with the mutex held, as must Unmap(). */
+  Mapping Map(size_t size);
+  void Unmap(Mapping const& mapping);
+};
+
+
+/**
+ *  A standard-library-friendly allocator that allocates from a
+ *  HugePageArena.
+ */
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+  // Containers take their arena with them when moved or swapped, which is
+  // what makes a default-constructed (arena-less) one usable as somewhere to
+  // move one to.
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  /** Not good for allocating anything until it's been assigned an arena. */
+  ArenaAllocator() : arena_{nullptr} {}
+
+  explicit ArenaAllocator(HugePageArena* arena) : arena_{arena} {}
+
+  template <typename U>
+  ArenaAllocator(ArenaAllocator<U> const& that) : arena_{that.arena()} {}
+
+  T* allocate(size_t count) {
+    return static_cast<T*>(arena_->Allocate(count * sizeof(T)));
+  }
+
+  void deallocate(T* memory, size_t count) {
+    arena_->Deallocate(memory, count * sizeof(T));
+  }
+
+  HugePageArena* arena() const { return arena_; }
+
+ private:
+  HugePageArena* arena_;
+};
+
+
+template <typename T, typename U>
+bool operator==(ArenaAllocator<T> const& lhs, ArenaAllocator<U> const& rhs) {
+  return lhs.arena() == rhs.arena();
+}
+
+
+template <typename T, typename U>
+bool operator!=(ArenaAllocator<T> const& lhs, ArenaAllocator<U> const& rhs) {
+  return !(lhs == rhs);
+}
+
+
+}  // namespace utils
+}  // namespace pplme
+
+
+#endif  // PPLME_LIBPPLMEUTILS_HUGEPAGEARENA_H_
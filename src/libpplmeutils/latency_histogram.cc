@@ -0,0 +1,115 @@
+/**
+ *  @file
+ *  @brief   Implementation for pplme::utils::LatencyHistogram.
+ *  @author  j.ho
+ */
+
+
+#include "latency_histogram.h"
+#include <math.h>
+#include <algorithm>
+
+
+namespace pplme {
+namespace utils {
+
+
+unsigned int const LatencyHistogram::kSubBucketCount;
+unsigned int const LatencyHistogram::kMaxMagnitude;
+unsigned int const LatencyHistogram::kBucketCount;
+
+
+LatencyHistogram::LatencyHistogram() :
+    count_{0},
+    max_{0} {
+  for (auto& bucket : buckets_)
+    bucket = 0;
+}
+
+
+void LatencyHistogram::Record(std::chrono::steady_clock::duration latency) {
+  auto const microseconds = static_cast<uint64_t>(std::max<int64_t>(
+      0, std::chrono::duration_cast<Duration>(latency).count()));
+  buckets_[GetBucketIndex(microseconds)].fetch_add(
+      1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+
+  auto max = max_.load(std::memory_order_relaxed);
+  while (microseconds > max
+         && !max_.compare_exchange_weak(
+                max, microseconds, std::memory_order_relaxed)) {}
+}
+
+
+uint64_t LatencyHistogram::GetCount() const {
+  return count_.load(std::memory_order_relaxed);
+}
+
+
+LatencyHistogram::Duration LatencyHistogram::GetPercentile(
+    double percentile) const {
+  auto const count = GetCount();
+  if (count == 0)
+    return Duration{0};
+
+  auto const wanted = std::max<uint64_t>(
+      1, static_cast<uint64_t>(ceil(percentile / 100 * count)));
+  uint64_t so_far = 0;
+  for (unsigned int index = 0; index < kBucketCount; ++index) {
+    so_far += buckets_[index].load(std::memory_order_relaxed);
+    if (so_far >= wanted) {
+      // No point claiming more than was ever actually seen.
+      return Duration{static_cast<Duration::rep>(
+          std::min(GetBucketUpperBound(index), max_.load()))};
+    }
+  }
+
+  return GetMax();
+}
+
+
+LatencyHistogram::Duration LatencyHistogram::GetMax() const {
+  return Duration{static_cast<Duration::rep>(max_.load())};
+}
+
+
+unsigned int LatencyHistogram::GetBucketIndex(uint64_t microseconds) {
+  if (microseconds < kSubBucketCount)
+    return static_cast<unsigned int>(microseconds);
+
+  // Keep the top four bits (the first of which is always set).
+  unsigned int magnitude = 63 - __builtin_clzll(microseconds);
+  if (magnitude > kMaxMagnitude)
+    return kBucketCount - 1;
+  auto const sub_bucket =
+      static_cast<unsigned int>(microseconds >> (magnitude - 3));
+  return kSubBucketCount
+      + (magnitude - 4) * (kSubBucketCount / 2)
+      + (sub_bucket - kSubBucketCount / 2);
+}
+
+
+uint64_t LatencyHistogram::GetBucketUpperBound(unsigned int index) {
+  if (index < kSubBucketCount)
+    return index;
+
+  auto const magnitude = 4 + (index - kSubBucketCount) / (kSubBucketCount / 2);
+  auto const sub_bucket =
+      kSubBucketCount / 2 + (index - kSubBucketCount) % (kSubBucketCount / 2);
+  return ((uint64_t{sub_bucket} + 1) << (magnitude - 3)) - 1;
+}
+
+
+std::ostream& operator<<(std::ostream& stream,
+                         LatencyHistogram const& histogram) {
+  return stream << "count=" << histogram.GetCount()
+                << " p50=" << histogram.GetPercentile(50).count()
+                << "us p90=" << histogram.GetPercentile(90).count()
+                << "us p99=" << histogram.GetPercentile(99).count()
+                << "us p99.9=" << histogram.GetPercentile(99.9).count()
+                << "us max=" << histogram.GetMax().count() << "us";
+}
+
+
+}  // namespace utils
+}  // namespace pplme
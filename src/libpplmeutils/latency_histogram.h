@@ -0,0 +1,94 @@
+/**
+ *  @file
+ *  @brief   Definition of pplme::utils::LatencyHistogram, a lock-free,
+ *           fixed-precision histogram of durations.
+ *  @author  j.ho
+ */
+#ifndef PPLME_LIBPPLMEUTILS_LATENCYHISTOGRAM_H_
+#define PPLME_LIBPPLMEUTILS_LATENCYHISTOGRAM_H_
+
+
+#include <stdint.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+
+
+namespace pplme {
+namespace utils {
+
+
+/**
+ *  Example:
+ *  @code
+ *  LatencyHistogram find_time;
+ *  // [...]
+ *  auto const then = std::chrono::steady_clock::now();
+ *  FindAllTheThings();
+ *  find_time.Record(std::chrono::steady_clock::now() - then);
+ *  // [...]
+ *  LOG(INFO) << "find_time: " << find_time;
+ *  @endcode
+ *
+ *  @remarks
+ *  This is HDR-ish: durations are recorded in microseconds into buckets that
+ *  are exact below kSubBucketCount, and then kSubBucketCount/2 to each
+ *  power of two beyond that, so any percentile is out by no more than one
+ *  part in kSubBucketCount/2 (i.e., 12.5%), all the way from a microsecond
+ *  up to over a day (beyond which everything is lumped in together, but if
+ *  we're timing things in days then we have bigger problems).
+ *
+ *  @note
+ *  This class is safe to use concurrently; recording is just a couple of
+ *  relaxed atomic increments, so it's fine for hot paths.  Readings taken
+ *  whilst others are recording are merely approximately consistent.
+ */
+class LatencyHistogram {
+ public:
+  using Duration = std::chrono::microseconds;
+
+  static unsigned int const kSubBucketCount = 16;
+
+  LatencyHistogram();
+
+  LatencyHistogram(LatencyHistogram const&) = delete;
+  LatencyHistogram& operator=(LatencyHistogram const&) = delete;
+
+  void Record(std::chrono::steady_clock::duration latency);
+
+  uint64_t GetCount() const;
+
+  /** @returns  The (upper bound of the bucket of the) latency that
+                @a percentile percent of recordings are no greater than, or
+                zero if there aren't any. */
+  Duration GetPercentile(double percentile) const;
+
+  /** @returns  The greatest latency recorded (exactly). */
+  Duration GetMax() const;
+
+ private:
+  /** Enough powers of two for 2^37us, which is a day and a half. */
+  static unsigned int const kMaxMagnitude = 37;
+  static unsigned int const kBucketCount =
+      kSubBucketCount + (kMaxMagnitude - 3) * (kSubBucketCount / 2);
+
+  std::array<std::atomic<uint64_t>, kBucketCount> buckets_;
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> max_;
+
+  static unsigned int GetBucketIndex(uint64_t microseconds);
+  static uint64_t GetBucketUpperBound(unsigned int index);
+};
+
+
+/** Summarize @a histogram as its count, the usual percentiles, and max. */
+std::ostream& operator<<(std::ostream& stream,
+                         LatencyHistogram const& histogram);
+
+
+}  // namespace utils
+}  // namespace pplme
+
+
+#endif  // PPLME_LIBPPLMEUTILS_LATENCYHISTOGRAM_H_
@@ -0,0 +1,98 @@
+/**
+ *  @file
+ *  @brief   Tests for pplme::utils::AdmissionController.
+ *  @author  j.ho
+ */
+
+
+#include <chrono>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+#include "libpplmeutils/admission_controller.h"
+
+
+using pplme::utils::AdmissionController;
+
+
+/**
+ *  @test  Tickets should be handed out until they run out, and then nobody
+ *         else should get in until one comes back.
+ */
+TEST(AdmissionControllerTest, AdmitsUpToMaxInFlight) {
+  // Arrange.
+  AdmissionController admission_controller{2, std::chrono::milliseconds{1}};
+
+  // Act.
+  auto first = admission_controller.Admit();
+  auto second = admission_controller.Admit();
+  auto const third = admission_controller.Admit();
+  auto const full_stats = admission_controller.GetStats();
+  first = AdmissionController::Ticket{};
+  auto const fourth = admission_controller.Admit();
+
+  // Assert.
+  ASSERT_FALSE(first);
+  ASSERT_TRUE(static_cast<bool>(second));
+  ASSERT_FALSE(third);
+  ASSERT_TRUE(static_cast<bool>(fourth));
+  ASSERT_EQ(2U, full_stats.in_flight);
+  ASSERT_EQ(0U, full_stats.queued);
+  ASSERT_EQ(2U, full_stats.admitted_count);
+  ASSERT_EQ(1U, full_stats.rejected_count);
+  auto const stats = admission_controller.GetStats();
+  ASSERT_EQ(2U, stats.max_in_flight);
+  ASSERT_EQ(2U, stats.in_flight);
+  ASSERT_EQ(3U, stats.admitted_count);
+}
+
+
+/**
+ *  @test  Someone waiting for a ticket should get the next one that comes
+ *         back (if it comes back in time).
+ */
+TEST(AdmissionControllerTest, QueuedAdmitGetsReleasedTicket) {
+  // Arrange.
+  AdmissionController admission_controller{1, std::chrono::seconds{10}};
+  auto ticket = admission_controller.Admit();
+  ASSERT_TRUE(static_cast<bool>(ticket));
+
+  // Act.
+  AdmissionController::Ticket queued_ticket;
+  std::thread queuer{[&admission_controller, &queued_ticket]() {
+      queued_ticket = admission_controller.Admit();
+    }};
+  while (admission_controller.GetStats().queued == 0)
+    std::this_thread::yield();
+  ticket = AdmissionController::Ticket{};
+  queuer.join();
+
+  // Assert.
+  ASSERT_TRUE(static_cast<bool>(queued_ticket));
+  auto const stats = admission_controller.GetStats();
+  ASSERT_EQ(1U, stats.in_flight);
+  ASSERT_EQ(0U, stats.queued);
+  ASSERT_EQ(0U, stats.rejected_count);
+}
+
+
+/**
+ *  @test  No limit means no limit.
+ */
+TEST(AdmissionControllerTest, ZeroMaxInFlightIsUnlimited) {
+  // Arrange.
+  AdmissionController admission_controller{0, std::chrono::seconds{0}};
+
+  // Act.
+  std::vector<AdmissionController::Ticket> tickets;
+  for (int n = 0; n < 1000; ++n)
+    tickets.push_back(admission_controller.Admit());
+
+  // Assert.
+  for (auto const& ticket : tickets)
+    ASSERT_TRUE(static_cast<bool>(ticket));
+  ASSERT_EQ(1000U, admission_controller.GetStats().in_flight);
+  tickets.clear();
+  ASSERT_EQ(0U, admission_controller.GetStats().in_flight);
+}
@@ -0,0 +1,108 @@
+/**
+ *  @file
+ *  @brief   Tests for pplme::utils::HugePageArena.
+ *  @author  j.ho
+ */
+
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <gtest/gtest.h>
+#include "libpplmeutils/huge_page_arena.h"
+
+
+using pplme::utils::ArenaAllocator;
+using pplme::utils::HugePageArena;
+
+
+/**
+ *  @test  Allocations should be usable, suitably aligned, and accounted for
+ *         (rounded up to their size class), and whatever sort of pages the
+ *         arena ended up with should add up to no more than it mapped.
+ */
+TEST(HugePageArenaTest, AllocationsAreAccountedFor) {
+  // Arrange.
+  HugePageArena arena;
+
+  // Act.
+  auto const little = arena.Allocate(10);
+  auto const bigger = arena.Allocate(1000);
+  memset(little, 0x11, 10);
+  memset(bigger, 0x22, 1000);
+  auto const stats = arena.GetStats();
+
+  // Assert.
+  ASSERT_EQ(0U, reinterpret_cast<uintptr_t>(little) % alignof(max_align_t));
+  ASSERT_EQ(0U, reinterpret_cast<uintptr_t>(bigger) % alignof(max_align_t));
+  ASSERT_EQ(16U + 1024U, stats.allocated_octets);
+  ASSERT_EQ(HugePageArena::kDefaultChunkSize, stats.mapped_octets);
+  ASSERT_LE(stats.huge_tlb_octets + stats.transparent_huge_octets,
+            stats.mapped_octets);
+  arena.Deallocate(little, 10);
+  arena.Deallocate(bigger, 1000);
+  ASSERT_EQ(0U, arena.GetStats().allocated_octets);
+}
+
+
+/**
+ *  @test  Freed memory should be handed out again to the next allocation of
+ *         its size class, rather than eating into the chunk.
+ */
+TEST(HugePageArenaTest, FreedMemoryIsRecycled) {
+  // Arrange.
+  HugePageArena arena;
+  auto const first = arena.Allocate(100);
+  arena.Deallocate(first, 100);
+
+  // Act.
+  auto const second = arena.Allocate(128);
+  auto const third = arena.Allocate(100);
+
+  // Assert.
+  ASSERT_EQ(first, second);
+  ASSERT_NE(first, third);
+  ASSERT_EQ(256U, arena.GetStats().allocated_octets);
+}
+
+
+/**
+ *  @test  Anything over half a chunk should get a mapping of its own, which
+ *         should go again when it's freed.
+ */
+TEST(HugePageArenaTest, BigAllocationsAreMappedByThemselves) {
+  // Arrange.
+  size_t const kChunkSize = 2 * 1024 * 1024;
+  HugePageArena arena{kChunkSize};
+
+  // Act.
+  auto const big = arena.Allocate(3 * kChunkSize);
+  memset(big, 0x33, 3 * kChunkSize);
+  auto const stats = arena.GetStats();
+  arena.Deallocate(big, 3 * kChunkSize);
+
+  // Assert.
+  ASSERT_EQ(3 * kChunkSize, stats.allocated_octets);
+  ASSERT_EQ(3 * kChunkSize, stats.mapped_octets);
+  ASSERT_EQ(0U, arena.GetStats().allocated_octets);
+  ASSERT_EQ(0U, arena.GetStats().mapped_octets);
+}
+
+
+/**
+ *  @test  Containers should be able to live in an arena.
+ */
+TEST(HugePageArenaTest, ContainersCanUseAnArenaAllocator) {
+  // Arrange.
+  HugePageArena arena;
+  std::vector<int, ArenaAllocator<int>> ints{ArenaAllocator<int>{&arena}};
+
+  // Act.
+  for (int n = 0; n < 100000; ++n)
+    ints.push_back(n);
+
+  // Assert.
+  ASSERT_EQ(99999, ints.back());
+  ASSERT_LE(100000U * sizeof(int), arena.GetStats().allocated_octets);
+  ASSERT_EQ(ArenaAllocator<char>{&arena}, ints.get_allocator());
+}
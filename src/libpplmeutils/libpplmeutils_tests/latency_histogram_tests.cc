@@ -0,0 +1,118 @@
+/**
+ *  @file
+ *  @brief   Tests for pplme::utils::LatencyHistogram.
+ *  @author  j.ho
+ */
+
+
+#include <chrono>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "libpplmeutils/latency_histogram.h"
+
+
+using pplme::utils::LatencyHistogram;
+using std::chrono::microseconds;
+
+
+/**
+ *  @test  An empty histogram should have nothing to say for itself.
+ */
+TEST(LatencyHistogramTest, EmptyIsAllZeroes) {
+  // Arrange.
+  LatencyHistogram histogram;
+
+  // Act/Assert.
+  ASSERT_EQ(0U, histogram.GetCount());
+  ASSERT_EQ(0, histogram.GetPercentile(50).count());
+  ASSERT_EQ(0, histogram.GetMax().count());
+}
+
+
+/**
+ *  @test  Small latencies should be recorded exactly.
+ */
+TEST(LatencyHistogramTest, SmallLatenciesAreExact) {
+  // Arrange.
+  LatencyHistogram histogram;
+
+  // Act.
+  for (int n = 1; n <= 10; ++n)
+    histogram.Record(microseconds{n});
+
+  // Assert.
+  ASSERT_EQ(10U, histogram.GetCount());
+  ASSERT_EQ(5, histogram.GetPercentile(50).count());
+  ASSERT_EQ(9, histogram.GetPercentile(90).count());
+  ASSERT_EQ(10, histogram.GetPercentile(100).count());
+  ASSERT_EQ(10, histogram.GetMax().count());
+}
+
+
+/**
+ *  @test  Percentiles of big latencies should be within 12.5% (and never
+ *         under), from microseconds to hours.
+ */
+TEST(LatencyHistogramTest, PercentilesAreWithinPrecision) {
+  for (int64_t latency = 17;
+       latency < 10000000000LL;
+       latency = latency * 3 + 1) {
+    // Arrange.
+    LatencyHistogram histogram;
+
+    // Act.
+    histogram.Record(microseconds{1});
+    histogram.Record(microseconds{latency});
+    histogram.Record(microseconds{latency * 2});
+
+    // Assert.
+    auto const p50 = histogram.GetPercentile(50).count();
+    ASSERT_LE(latency, p50);
+    ASSERT_GE(latency * 1.125, p50) << latency;
+    ASSERT_EQ(latency * 2, histogram.GetPercentile(100).count());
+    ASSERT_EQ(1, histogram.GetPercentile(1).count());
+  }
+}
+
+
+/**
+ *  @test  Recording from several threads at once shouldn't lose anything.
+ */
+TEST(LatencyHistogramTest, ConcurrentRecordingCountsEverything) {
+  // Arrange.
+  LatencyHistogram histogram;
+  std::vector<std::thread> threads;
+
+  // Act.
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&histogram, t]() {
+        for (int n = 0; n < 10000; ++n)
+          histogram.Record(microseconds{n * (t + 1)});
+      });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  // Assert.
+  ASSERT_EQ(40000U, histogram.GetCount());
+  ASSERT_EQ(39996, histogram.GetMax().count());
+}
+
+
+/**
+ *  @test  The summary should mention the count and the percentiles.
+ */
+TEST(LatencyHistogramTest, Summarizes) {
+  // Arrange.
+  LatencyHistogram histogram;
+  histogram.Record(microseconds{3});
+  std::ostringstream oss;
+
+  // Act.
+  oss << histogram;
+
+  // Assert.
+  ASSERT_EQ("count=1 p50=3us p90=3us p99=3us p99.9=3us max=3us", oss.str());
+}
@@ -0,0 +1,47 @@
+/**
+ *  @file
+ *  @brief   Tests for pplme::utils' memory odds and ends.
+ *  @author  j.ho
+ */
+
+
+#include <gtest/gtest.h>
+#include "libpplmeutils/memory_info.h"
+
+
+using pplme::utils::GetAvailableMemory;
+using pplme::utils::ParseMemAvailable;
+
+
+/**
+ *  @test  MemAvailable should be found (and converted to octets) wherever it
+ *         is in /proc/meminfo, and not made up when it isn't there.
+ */
+TEST(MemoryInfoTest, ParseMemAvailableFindsItOrNot) {
+  // Act.
+  auto const available = ParseMemAvailable(
+      "MemTotal:       16307452 kB\n"
+      "MemFree:         1234567 kB\n"
+      "MemAvailable:    8153726 kB\n"
+      "HugePages_Total:       0\n");
+
+  // Assert.
+  ASSERT_TRUE(available);
+  ASSERT_EQ(uint64_t{8153726} * 1024, *available);
+  ASSERT_FALSE(ParseMemAvailable("MemTotal:       16307452 kB\n"));
+  ASSERT_FALSE(ParseMemAvailable("MemAvailable:    lots\n"));
+  ASSERT_FALSE(ParseMemAvailable(""));
+}
+
+
+/**
+ *  @test  This machine, at least, should have some memory to spare.
+ */
+TEST(MemoryInfoTest, ThereIsSomeMemoryAvailable) {
+  // Act.
+  auto const available = GetAvailableMemory();
+
+  // Assert.
+  ASSERT_TRUE(available);
+  ASSERT_GT(*available, 0U);
+}
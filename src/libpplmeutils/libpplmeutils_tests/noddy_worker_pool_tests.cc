@@ -0,0 +1,56 @@
+/**
+ *  @file
+ *  @brief   Tests for pplme::utils::NoddyWorkerPool.
+ *  @author  j.ho
+ */
+
+
+#include <chrono>
+#include <future>
+#include <vector>
+#include <gtest/gtest.h>
+#include "libpplmeutils/noddy_worker_pool.h"
+
+
+using pplme::utils::NoddyWorkerPool;
+
+
+/**
+ *  @test  Every worklette queued should get done, by one worker or another.
+ */
+TEST(NoddyWorkerPoolTest, DoesEveryWorklette) {
+  // Arrange.
+  int const kWorklettes = 100;
+  NoddyWorkerPool workers{4, {}};
+  std::vector<std::promise<int>> done(kWorklettes);
+
+  // Act.
+  for (int n = 0; n < kWorklettes; ++n)
+    workers.QueueWorklette([n, &done]() { done[n].set_value(n); });
+
+  // Assert.
+  for (int n = 0; n < kWorklettes; ++n)
+    ASSERT_EQ(n, done[n].get_future().get());
+}
+
+
+/**
+ *  @test  A worklette that's held up shouldn't hold up the rest, so long as
+ *         there are other workers to do them.
+ */
+TEST(NoddyWorkerPoolTest, HeldUpWorkletteDoesNotHoldUpTheRest) {
+  // Arrange.
+  NoddyWorkerPool workers{2, {}};
+  std::promise<void> go;
+  auto const went = go.get_future().share();
+  std::promise<void> done;
+
+  // Act.
+  workers.QueueWorklette([went]() { went.wait(); });
+  workers.QueueWorklette([&done]() { done.set_value(); });
+  auto const status = done.get_future().wait_for(std::chrono::seconds{10});
+  go.set_value();
+
+  // Assert.
+  ASSERT_EQ(std::future_status::ready, status);
+}
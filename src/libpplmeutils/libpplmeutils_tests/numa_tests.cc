@@ -0,0 +1,65 @@
+/**
+ *  @file
+ *  @brief   Tests for pplme::utils' NUMA odds and ends.
+ *  @author  j.ho
+ */
+
+
+#include <thread>
+#include <gtest/gtest.h>
+#include "libpplmeutils/numa.h"
+
+
+using pplme::utils::GetNumaNodeCpus;
+using pplme::utils::ParseCpuList;
+using pplme::utils::PinThisThreadToCpus;
+
+
+/**
+ *  @test  CPU lists should be parsed the way the kernel writes them.
+ */
+TEST(NumaTest, ParseCpuListParsesRangesAndSingletons) {
+  // Act.
+  auto const cpus = ParseCpuList("8,0-3,10-11\n");
+
+  // Assert.
+  ASSERT_TRUE(cpus);
+  ASSERT_EQ((std::vector<int>{0, 1, 2, 3, 8, 10, 11}), *cpus);
+  ASSERT_TRUE(ParseCpuList(""));
+  ASSERT_TRUE(ParseCpuList("")->empty());
+}
+
+
+/**
+ *  @test  Anything that isn't a CPU list shouldn't pass for one.
+ */
+TEST(NumaTest, ParseCpuListRejectsRubbish) {
+  // Act/Assert.
+  ASSERT_FALSE(ParseCpuList("0-"));
+  ASSERT_FALSE(ParseCpuList("3-1"));
+  ASSERT_FALSE(ParseCpuList("0,,1"));
+  ASSERT_FALSE(ParseCpuList("one"));
+  ASSERT_FALSE(ParseCpuList("-1"));
+}
+
+
+/**
+ *  @test  Every machine has at least one node with a CPU on it, and a thread
+ *         should be able to pin itself to the first one's CPUs.
+ */
+TEST(NumaTest, ThereIsAlwaysANodeToPinTo) {
+  // Arrange.
+  auto const nodes = GetNumaNodeCpus();
+  bool pinned = false;
+
+  // Act.
+  std::thread{[&nodes, &pinned]() {
+      pinned = PinThisThreadToCpus(nodes.at(0));
+    }}.join();
+
+  // Assert.
+  ASSERT_LE(1U, nodes.size());
+  ASSERT_FALSE(nodes[0].empty());
+  ASSERT_TRUE(pinned);
+  ASSERT_FALSE(PinThisThreadToCpus({}));
+}
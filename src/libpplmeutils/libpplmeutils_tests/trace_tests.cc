@@ -0,0 +1,71 @@
+/**
+ *  @file
+ *  @brief   Tests for pplme::utils::Trace.
+ *  @author  j.ho
+ */
+
+
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <gtest/gtest.h>
+#include "libpplmeutils/trace.h"
+
+
+using pplme::utils::Trace;
+
+
+/**
+ *  @test  An empty trace should still be a valid trace.
+ */
+TEST(TraceTest, EmptyTraceIsValidJson) {
+  // Arrange.
+  Trace trace;
+  std::ostringstream oss;
+
+  // Act.
+  trace.WriteJson(oss);
+
+  // Assert.
+  ASSERT_EQ(0U, trace.GetSpanCount());
+  ASSERT_EQ("{\"traceEvents\":[\n],\"displayTimeUnit\":\"ms\"}\n", oss.str());
+}
+
+
+/**
+ *  @test  Spans should come out as complete events, relative to when the
+ *         trace was created, with their args, and attributed to whichever
+ *         thread added them.
+ */
+TEST(TraceTest, WritesSpansAsCompleteEvents) {
+  // Arrange.
+  Trace trace;
+  auto const begin = Trace::Clock::now() + std::chrono::seconds(1);
+  auto const end = begin + std::chrono::microseconds(250);
+
+  // Act.
+  trace.AddSpan("Ring", begin, end, {{"ring", 3}, {"cells", 12}});
+  std::thread{[&trace, begin, end]() {
+      trace.AddSpan("Cell", begin, end);
+    }}.join();
+  std::ostringstream oss;
+  trace.WriteJson(oss);
+
+  // Assert.
+  auto const json = oss.str();
+  ASSERT_EQ(2U, trace.GetSpanCount());
+  auto const ring = json.find(
+      "{\"name\":\"Ring\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":");
+  ASSERT_NE(std::string::npos, ring);
+  ASSERT_NE(std::string::npos,
+            json.find(",\"dur\":250,\"args\":{\"ring\":3,\"cells\":12}}",
+                      ring));
+  ASSERT_NE(std::string::npos,
+            json.find("{\"name\":\"Cell\",\"ph\":\"X\",\"pid\":1,\"tid\":2,"));
+  // A second after the trace began (plus however long it took us to get
+  // here).
+  auto const ts = std::stoll(json.substr(json.find("\"ts\":") + 5));
+  ASSERT_LE(1000000, ts);
+  ASSERT_GT(1100000, ts);
+}
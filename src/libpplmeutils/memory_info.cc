@@ -0,0 +1,54 @@
+/**
+ *  @file
+ *  @brief   Definitions of pplme::utils' memory odds and ends.
+ *  @author  j.ho
+ */
+
+
+#include "memory_info.h"
+#include <fstream>
+#include <sstream>
+
+
+namespace {
+
+
+char const kMeminfoFile[] = "/proc/meminfo";
+
+
+}  // namespace
+
+
+namespace pplme {
+namespace utils {
+
+
+boost::optional<uint64_t> ParseMemAvailable(std::string const& meminfo) {
+  // Each line goes "Name:   <value> kB" (bar a few that have no units).
+  std::istringstream lines{meminfo};
+  std::string line;
+  while (std::getline(lines, line)) {
+    std::istringstream fields{line};
+    std::string name;
+    uint64_t value;
+    std::string units;
+    if (!(fields >> name) || name != "MemAvailable:")
+      continue;
+    if (!(fields >> value >> units) || units != "kB")
+      return boost::none;
+    return value * 1024;
+  }
+  return boost::none;
+}
+
+
+boost::optional<uint64_t> GetAvailableMemory() {
+  std::ifstream meminfo_file{kMeminfoFile};
+  std::ostringstream meminfo;
+  meminfo << meminfo_file.rdbuf();
+  return ParseMemAvailable(meminfo.str());
+}
+
+
+}  // namespace utils
+}  // namespace pplme
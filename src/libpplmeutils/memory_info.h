@@ -0,0 +1,41 @@
+/**
+ *  @file
+ *  @brief   Declarations of pplme::utils' memory odds and ends, for finding
+ *           out how much room there is for more ppl.
+ *  @author  j.ho
+ */
+#ifndef PPLME_LIBPPLMEUTILS_MEMORYINFO_H_
+#define PPLME_LIBPPLMEUTILS_MEMORYINFO_H_
+
+
+#include <stdint.h>
+#include <string>
+#include <boost/optional.hpp>
+
+
+namespace pplme {
+namespace utils {
+
+
+/**
+ *  @returns  The octets that @a meminfo (the contents of /proc/meminfo) says
+ *            are available (its MemAvailable, which is free memory plus
+ *            whatever the kernel reckons it could reclaim without swapping),
+ *            or boost::none if it doesn't say.
+ */
+boost::optional<uint64_t> ParseMemAvailable(std::string const& meminfo);
+
+
+/**
+ *  @returns  The octets of memory available, as per /proc/meminfo, or
+ *            boost::none on a machine that won't tell us (or whose kernel
+ *            predates MemAvailable).
+ */
+boost::optional<uint64_t> GetAvailableMemory();
+
+
+}  // namespace utils
+}  // namespace pplme
+
+
+#endif  // PPLME_LIBPPLMEUTILS_MEMORYINFO_H_
@@ -0,0 +1,74 @@
+/**
+ *  @file
+ *  @brief   Implementation for pplme::utils::NoddyWorkerPool.
+ *  @author  j.ho
+ */
+
+
+#include "noddy_worker_pool.h"
+#include "numa.h"
+
+
+namespace pplme {
+namespace utils {
+
+
+NoddyWorkerPool::NoddyWorkerPool(unsigned int worker_count,
+                                 std::vector<int> const& cpus) {
+  for (unsigned n = 0; n < worker_count; ++n) {
+    workers_.emplace_back([this, cpus]() {
+        if (!cpus.empty())
+          PinThisThreadToCpus(cpus);
+        StartWorking();
+      });
+  }
+}
+
+
+NoddyWorkerPool::~NoddyWorkerPool() {
+  /* lock block */ {
+    std::unique_lock<std::mutex> lock(work_mutex_);
+    die_ = true;
+    work_or_die_.notify_all();
+  }
+  for (auto& worker : workers_)
+    worker.join();
+}
+
+
+void NoddyWorkerPool::QueueWorklette(std::function<void()> worklette) {
+  std::unique_lock<std::mutex> lock(work_mutex_);
+  work_.push_back(worklette);
+  work_or_die_.notify_all();
+}
+
+
+void NoddyWorkerPool::StartWorking() {
+  for (;;) {
+    std::function<void()> worklette;
+
+    /* lock block */ {
+      std::unique_lock<std::mutex> lock(work_mutex_);
+      if (die_)
+        break;
+      else if (work_.empty())
+        work_or_die_.wait(lock);
+
+      if (die_)
+        break;
+
+      if (!work_.empty()) {
+        worklette = work_.front();
+        work_.pop_front();
+      }
+    }
+
+    // Don't want to be holding locks while doing work!
+    if (worklette)
+      worklette();
+  }
+}
+
+
+}  // namespace utils
+}  // namespace pplme
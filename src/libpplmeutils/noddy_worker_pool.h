@@ -0,0 +1,67 @@
+/**
+ *  @file
+ *  @brief   Definition of pplme::utils::NoddyWorkerPool, a fixed number of
+ *           threads that work through a queue of worklettes.
+ *  @author  j.ho
+ */
+#ifndef PPLME_LIBPPLMEUTILS_NODDYWORKERPOOL_H_
+#define PPLME_LIBPPLMEUTILS_NODDYWORKERPOOL_H_
+
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace pplme {
+namespace utils {
+
+
+/**
+ *  Example:
+ *  @code
+ *  NoddyWorkerPool workers{4, {}};
+ *  for (auto const& thing : things)
+ *    workers.QueueWorklette([&thing]() { DoTheThing(thing); });
+ *  @endcode
+ *
+ *  @remarks
+ *  Worklettes are done in the order that they're queued, by whichever
+ *  worker is free first; there's no telling when they're done, so anyone
+ *  that cares has to say so themselves.  Destruction waits for the
+ *  worklettes under way (but not for those still queued, which are
+ *  dropped).
+ *
+ *  @note
+ *  This class is safe to use concurrently.
+ */
+class NoddyWorkerPool {
+ public:
+  /** @param  cpus (if any) are where the workers are to stay. */
+  NoddyWorkerPool(unsigned int worker_count, std::vector<int> const& cpus);
+  ~NoddyWorkerPool();
+
+  NoddyWorkerPool(NoddyWorkerPool const&) = delete;
+  NoddyWorkerPool& operator=(NoddyWorkerPool const&) = delete;
+
+  void QueueWorklette(std::function<void()> worklette);
+
+ private:
+  std::vector<std::thread> workers_;
+  std::mutex work_mutex_;
+  std::condition_variable work_or_die_;
+  std::deque<std::function<void()>> work_;
+  bool die_{false};
+
+  void StartWorking();
+};
+
+
+}  // namespace utils
+}  // namespace pplme
+
+
+#endif  // PPLME_LIBPPLMEUTILS_NODDYWORKERPOOL_H_
@@ -0,0 +1,131 @@
+/**
+ *  @file
+ *  @brief   Definitions of pplme::utils' NUMA odds and ends.
+ *  @author  j.ho
+ */
+
+
+#include "numa.h"
+#include <ctype.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <fstream>
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <glog/logging.h>
+
+
+namespace {
+
+
+char const kSysfsNodeDirectory[] = "/sys/devices/system/node";
+
+
+/** @returns  @a text as a CPU number, or -1 if it isn't one. */
+int ParseCpu(std::string const& text) {
+  if (text.empty()
+      || text.size() > 6
+      || !std::all_of(begin(text), end(text), ::isdigit))
+    return -1;
+  return std::stoi(text);
+}
+
+
+}  // namespace
+
+
+namespace pplme {
+namespace utils {
+
+
+boost::optional<std::vector<int>> ParseCpuList(std::string const& cpu_list) {
+  auto const trimmed = boost::algorithm::trim_copy(cpu_list);
+  std::vector<int> cpus;
+  if (trimmed.empty())
+    return cpus;
+
+  std::vector<std::string> ranges;
+  boost::algorithm::split(ranges, trimmed, boost::algorithm::is_any_of(","));
+  for (auto const& range : ranges) {
+    auto const dash = range.find('-');
+    auto const first = ParseCpu(range.substr(0, dash));
+    auto const last = dash == std::string::npos ?
+        first : ParseCpu(range.substr(dash + 1));
+    if (first < 0 || last < first)
+      return boost::none;
+    for (auto cpu = first; cpu <= last; ++cpu)
+      cpus.push_back(cpu);
+  }
+
+  std::sort(begin(cpus), end(cpus));
+  cpus.erase(std::unique(begin(cpus), end(cpus)), end(cpus));
+  return cpus;
+}
+
+
+std::vector<std::vector<int>> GetNumaNodeCpus() {
+  std::vector<std::vector<int>> nodes;
+  for (int node = 0; ; ++node) {
+    std::ifstream cpulist_file{std::string{kSysfsNodeDirectory} + "/node"
+                               + std::to_string(node) + "/cpulist"};
+    std::string cpulist;
+    if (!cpulist_file || !std::getline(cpulist_file, cpulist))
+      break;
+    auto cpus = ParseCpuList(cpulist);
+    if (!cpus) {
+      LOG(WARNING) << "Failed to parse CPUs of NUMA node " << node << ": `"
+                   << cpulist << "'";
+      break;
+    }
+    // Memory-only nodes are no use to anyone looking for somewhere to run.
+    if (!cpus->empty())
+      nodes.push_back(std::move(*cpus));
+  }
+
+  if (nodes.empty()) {
+    // Whichever CPUs we're allowed on, then.
+    std::vector<int> cpus;
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0) {
+      for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &cpu_set))
+          cpus.push_back(cpu);
+      }
+    }
+    if (cpus.empty())
+      cpus.push_back(0);
+    nodes.push_back(std::move(cpus));
+  }
+
+  return nodes;
+}
+
+
+bool PinThisThreadToCpus(std::vector<int> const& cpus) {
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (auto cpu : cpus) {
+    if (cpu >= 0 && cpu < CPU_SETSIZE)
+      CPU_SET(cpu, &cpu_set);
+  }
+  if (CPU_COUNT(&cpu_set) == 0)
+    return false;
+
+  auto const error =
+      pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+  if (error != 0) {
+    LOG(WARNING) << "Failed to pin thread to " << cpus.size() << " CPUs: "
+                 << strerror(error);
+    return false;
+  }
+  return true;
+}
+
+
+}  // namespace utils
+}  // namespace pplme
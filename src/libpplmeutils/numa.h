@@ -0,0 +1,52 @@
+/**
+ *  @file
+ *  @brief   Declarations of pplme::utils' NUMA odds and ends, for finding out
+ *           which CPUs belong to which node, and for staying put on one.
+ *  @author  j.ho
+ */
+#ifndef PPLME_LIBPPLMEUTILS_NUMA_H_
+#define PPLME_LIBPPLMEUTILS_NUMA_H_
+
+
+#include <string>
+#include <vector>
+#include <boost/optional.hpp>
+
+
+namespace pplme {
+namespace utils {
+
+
+/**
+ *  @returns  The CPUs in @a cpu_list, which is in the kernel's "0-3,8,10-11"
+ *            format (as found in /sys/devices/system/node/node<n>/cpulist),
+ *            in ascending order; or boost::none if it's not in that format.
+ */
+boost::optional<std::vector<int>> ParseCpuList(std::string const& cpu_list);
+
+
+/**
+ *  @returns  The CPUs of each NUMA node, as per sysfs, indexed by node.
+ *
+ *  @remarks
+ *  A machine that doesn't know what NUMA is (or that won't tell us) is
+ *  reported as one node with every CPU on it, which is true enough.
+ */
+std::vector<std::vector<int>> GetNumaNodeCpus();
+
+
+/**
+ *  Pin the calling thread to @a cpus (e.g., a node's, from GetNumaNodeCpus()),
+ *  so that it, and (courtesy of the kernel's first-touch policy) any memory
+ *  that it's the first to touch, stays on their node.
+ *
+ *  @returns  true iff the thread was pinned.
+ */
+bool PinThisThreadToCpus(std::vector<int> const& cpus);
+
+
+}  // namespace utils
+}  // namespace pplme
+
+
+#endif  // PPLME_LIBPPLMEUTILS_NUMA_H_
@@ -0,0 +1,77 @@
+/**
+ *  @file
+ *  @brief   Implementation for pplme::utils::Trace.
+ *  @author  j.ho
+ */
+
+
+#include "trace.h"
+
+
+namespace {
+
+
+int64_t ToMicroseconds(std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(duration)
+      .count();
+}
+
+
+}  // namespace
+
+
+namespace pplme {
+namespace utils {
+
+
+Trace::Trace(Clock::time_point epoch) : epoch_{epoch} {}
+
+
+void Trace::AddSpan(char const* name,
+                    Clock::time_point begin,
+                    Clock::time_point end,
+                    Args args) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto const thread = threads_.emplace(
+      std::this_thread::get_id(),
+      static_cast<unsigned int>(threads_.size() + 1)).first->second;
+  spans_.push_back(Span{name, begin, end, thread, std::move(args)});
+}
+
+
+std::size_t Trace::GetSpanCount() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return spans_.size();
+}
+
+
+void Trace::WriteJson(std::ostream& stream) const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  // N.B. names and arg keys are ours (and hence need no escaping).
+  stream << "{\"traceEvents\":[";
+  char const* separator = "\n";
+  for (auto const& span : spans_) {
+    stream << separator
+           << "{\"name\":\"" << span.name << "\""
+           << ",\"ph\":\"X\",\"pid\":1"
+           << ",\"tid\":" << span.thread
+           << ",\"ts\":" << ToMicroseconds(span.begin - epoch_)
+           << ",\"dur\":" << ToMicroseconds(span.end - span.begin);
+    if (!span.args.empty()) {
+      stream << ",\"args\":{";
+      char const* arg_separator = "";
+      for (auto const& arg : span.args) {
+        stream << arg_separator << "\"" << arg.first << "\":" << arg.second;
+        arg_separator = ",";
+      }
+      stream << "}";
+    }
+    stream << "}";
+    separator = ",\n";
+  }
+  stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+
+}  // namespace utils
+}  // namespace pplme
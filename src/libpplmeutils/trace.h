@@ -0,0 +1,96 @@
+/**
+ *  @file
+ *  @brief   Definition of pplme::utils::Trace, which records timestamped
+ *           spans for a single request and writes them out as Chrome
+ *           trace-event JSON.
+ *  @author  j.ho
+ */
+#ifndef PPLME_LIBPPLMEUTILS_TRACE_H_
+#define PPLME_LIBPPLMEUTILS_TRACE_H_
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+namespace pplme {
+namespace utils {
+
+
+/**
+ *  Example:
+ *  @code
+ *  auto const trace = std::make_shared<Trace>();
+ *  // [...]
+ *  auto const begin = Trace::Clock::now();
+ *  auto const found = FindAllTheThings();
+ *  trace->AddSpan("Find", begin, Trace::Clock::now(), {{"found", found}});
+ *  // [...]
+ *  std::ofstream json{"find.json"};
+ *  trace->WriteJson(json);
+ *  @endcode
+ *
+ *  The JSON can then be loaded into chrome://tracing (or Perfetto, or
+ *  whatever else groks the trace-event format) for a proper look.
+ *
+ *  @remarks
+ *  Tracing is opt-in per request, so the cost of tracing being off is that
+ *  of checking for a null Trace; hence there's no attempt to make recording
+ *  itself especially cheap (it takes a lock, for one).
+ *
+ *  @note
+ *  This class is safe to use concurrently; each span is attributed to
+ *  whichever thread added it.  Names and arg keys are not copied, so they
+ *  must outlive the Trace (i.e., they should be string literals).
+ */
+class Trace {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Args = std::vector<std::pair<char const*, int64_t>>;
+
+  /** Timestamps are written relative to @a epoch. */
+  explicit Trace(Clock::time_point epoch = Clock::now());
+
+  Trace(Trace const&) = delete;
+  Trace& operator=(Trace const&) = delete;
+
+  /** Record that @a name took from @a begin to @a end. */
+  void AddSpan(char const* name,
+               Clock::time_point begin,
+               Clock::time_point end,
+               Args args = Args{});
+
+  std::size_t GetSpanCount() const;
+
+  /** Write everything recorded so far as a trace-event JSON object. */
+  void WriteJson(std::ostream& stream) const;
+
+ private:
+  struct Span {
+    char const* name;
+    Clock::time_point begin;
+    Clock::time_point end;
+    unsigned int thread;
+    Args args;
+  };
+
+  Clock::time_point const epoch_;
+  mutable std::mutex mutex_;
+  std::vector<Span> spans_;
+  /** Small, stable numbers for the threads that have added spans. */
+  std::map<std::thread::id, unsigned int> threads_;
+};
+
+
+}  // namespace utils
+}  // namespace pplme
+
+
+#endif  // PPLME_LIBPPLMEUTILS_TRACE_H_
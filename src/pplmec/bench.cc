@@ -0,0 +1,387 @@
+/**
+ *  @file
+ *  @brief   Definition of pplme::Bench() and friends.
+ *  @author  j.ho
+ */
+
+
+#include "bench.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/date_time/gregorian/gregorian.hpp>
+#include <boost/numeric/conversion/cast.hpp>
+#include <glog/logging.h>
+#include "libpplmecore/person.h"
+#include "libpplmeengine/ppl_repository.h"
+#include "libpplmeengine/ppl_slurper.h"
+#include "libpplmenet/client.h"
+#include "libpplmenet/message.h"
+#include "libpplmeproto/convert_person_field_mask.h"
+#include "libpplmeproto/pplme_response.pb.h"
+#include "libpplmeproto/request.pb.h"
+#include "libpplmeutils/latency_histogram.h"
+
+
+namespace {
+
+
+using Clock = std::chrono::steady_clock;
+
+
+/** So that benches are repeatable. */
+unsigned int const kSeed = 20141108;
+
+
+int GetRandomAge(std::default_random_engine& random_engine) {
+  return std::uniform_int_distribution<int>{18, 100}(random_engine);
+}
+
+
+/** Collects a BenchUser for each Person that a PplSlurper finds. */
+class BenchUserRepository : public pplme::engine::PplRepository {
+ public:
+  BenchUserRepository(boost::optional<int> age,
+                      std::vector<pplme::BenchUser>* users) :
+      age_{age},
+      today_{boost::gregorian::day_clock::local_day()},
+      users_{users} {}
+
+  void AddPerson(std::unique_ptr<pplme::core::Person> person) override {
+    auto const& location = person->location_of_home();
+    users_->push_back(pplme::BenchUser{
+        location.latitude().value(),
+        location.longitude().value(),
+        age_ ? *age_ : static_cast<int>(
+            (today_ - person->date_of_birth()).days() / 365.24)});
+  }
+
+ private:
+  boost::optional<int> age_;
+  boost::gregorian::date today_;
+  std::vector<pplme::BenchUser>* users_;
+};
+
+
+/**
+ *  The guts of Bench(): each connection gets its own thread, which Run()s
+ *  requests through it until time is up, and then the results are Report()ed.
+ */
+class LoadGenerator {
+ public:
+  LoadGenerator(std::string const& address,
+                unsigned short port,
+                std::vector<pplme::BenchUser> const& users,
+                unsigned int connections,
+                double qps,
+                unsigned int duration_s,
+                bool keep_alive,
+                pplme::net::Backend backend,
+                pplme::proto::Request const& request_template) :
+      address_{address},
+      port_{port},
+      users_{users},
+      connections_{connections},
+      qps_{qps},
+      keep_alive_{keep_alive},
+      backend_{backend},
+      request_template_{request_template},
+      start_{Clock::now()},
+      stop_{start_ + std::chrono::seconds(duration_s)} {}
+
+
+  void Run(unsigned int connection) {
+    std::unique_ptr<pplme::net::Client> client;
+
+    for (uint64_t n = 0; ; ++n) {
+      // In an open loop, the connections take it in turns to send the
+      // requests that are due every 1/qps seconds.
+      auto const now = Clock::now();
+      auto const scheduled = qps_ > 0 ?
+          start_ + GetScheduleOffset(n * connections_ + connection) : now;
+      if (scheduled >= stop_)
+        break;
+      if (scheduled + std::chrono::milliseconds(1) < now)
+        ++late_count_;
+
+      auto const request = CreateRequest(
+          users_[next_user_.fetch_add(1) % users_.size()]);
+      std::this_thread::sleep_until(scheduled);
+
+      if (!client) {
+        client.reset(new pplme::net::Client{address_, port_, backend_});
+        if (!client->Connect()) {
+          ++failed_count_;
+          client.reset();
+          continue;
+        }
+        ++connect_count_;
+      }
+
+      // Closed loop, a request is due when it's sent (building it, and
+      // connecting, aren't the server's fault).
+      auto const sent = Clock::now();
+      auto const due = qps_ > 0 ? scheduled : sent;
+      auto const response = client->SendRequest(*request);
+      auto const received = Clock::now();
+      if (!response || !keep_alive_)
+        client.reset();
+      if (!response) {
+        ++failed_count_;
+        continue;
+      }
+
+      // Measuring from when the request was due (rather than sent) is the
+      // coordinated omission correction; closed loop, they're one and the
+      // same (see above).
+      latency_.Record(received - due);
+      service_time_.Record(received - sent);
+
+      pplme::proto::PplmeResponse response_pb;
+      if (!response_pb.ParseFromArray(response->GetBodyOctets(),
+                                      response->GetHeader().GetBodyLength())) {
+        ++failed_count_;
+      } else if (response_pb.busy()) {
+        ++busy_count_;
+      } else if (response_pb.partial()) {
+        ++partial_count_;
+      }
+    }
+  }
+
+
+  void Report(Clock::duration elapsed) const {
+    auto const seconds = std::chrono::duration<double>(elapsed).count();
+    auto const responses = latency_.GetCount();
+    std::cout << "pplMe bench: " << responses << " responses in "
+              << seconds << "s (" << responses / seconds << "/s) over "
+              << connections_ << " connections, ";
+    if (qps_ > 0)
+      std::cout << "open loop at " << qps_ << "/s" << std::endl;
+    else
+      std::cout << "closed loop" << std::endl;
+    std::cout << "pplMe bench: " << failed_count_ << " failed, "
+              << busy_count_ << " busy, "
+              << partial_count_ << " partial; "
+              << connect_count_ << " connects" << std::endl;
+    if (failed_count_ > 0 && keep_alive_) {
+      std::cout << "pplMe bench: (if the failures were second and "
+                << "subsequent requests, is pplmed running with "
+                << "--keep_alive?)" << std::endl;
+    }
+    std::cout << "pplMe bench: latency: " << latency_ << std::endl;
+    if (qps_ > 0) {
+      std::cout << "pplMe bench: service time: " << service_time_
+                << std::endl;
+      if (late_count_ > 0) {
+        std::cout << "pplMe bench: " << late_count_ << " requests went out "
+                  << "late (the latencies account for it, but more "
+                  << "connections might be in order)" << std::endl;
+      }
+    }
+  }
+
+
+  bool HasFailures() const {
+    return failed_count_ > 0;
+  }
+
+
+ private:
+  std::string const address_;
+  unsigned short const port_;
+  std::vector<pplme::BenchUser> const& users_;
+  unsigned int const connections_;
+  double const qps_;
+  bool const keep_alive_;
+  pplme::net::Backend const backend_;
+  /** Everything but the user. */
+  pplme::proto::Request const request_template_;
+  Clock::time_point const start_;
+  Clock::time_point const stop_;
+
+  std::atomic<uint64_t> next_user_{0};
+  std::atomic<uint64_t> failed_count_{0};
+  std::atomic<uint64_t> busy_count_{0};
+  std::atomic<uint64_t> partial_count_{0};
+  std::atomic<uint64_t> connect_count_{0};
+  std::atomic<uint64_t> late_count_{0};
+  /** From when each request was due (open loop) or sent (closed loop). */
+  pplme::utils::LatencyHistogram latency_;
+  /** From when each request was actually sent. */
+  pplme::utils::LatencyHistogram service_time_;
+
+
+  Clock::duration GetScheduleOffset(uint64_t slot) const {
+    return std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(slot / qps_));
+  }
+
+
+  std::unique_ptr<pplme::net::Message> CreateRequest(
+      pplme::BenchUser const& user) const {
+    auto request_pb = request_template_;
+    auto pplme_request_pb = request_pb.mutable_pplme_request();
+    pplme_request_pb->mutable_location_of_user()->set_latitude(user.latitude);
+    pplme_request_pb->mutable_location_of_user()->set_longitude(
+        user.longitude);
+    pplme_request_pb->set_age_of_user(user.age);
+
+    auto const request_size =
+        boost::numeric_cast<uint32_t>(request_pb.ByteSize());
+    auto request_body = pplme::net::Message::CreateBodyBuffer(request_size);
+    request_pb.SerializeWithCachedSizesToArray(request_body.get());
+    return std::unique_ptr<pplme::net::Message>{
+        new pplme::net::Message{std::move(request_body), request_size}};
+  }
+};
+
+
+}  // namespace
+
+
+namespace pplme {
+
+
+std::vector<BenchUser> CreateUniformBenchUsers(
+    std::size_t count, boost::optional<int> age) {
+  std::default_random_engine random_engine{kSeed};
+  std::uniform_real_distribution<float> random_latitude{-90, 90};
+  std::uniform_real_distribution<float> random_longitude{-180, 180};
+
+  std::vector<BenchUser> users;
+  for (std::size_t n = 0; n < count; ++n) {
+    auto const latitude = random_latitude(random_engine);
+    auto const longitude = random_longitude(random_engine);
+    users.push_back(BenchUser{
+        latitude, longitude, age ? *age : GetRandomAge(random_engine)});
+  }
+  return users;
+}
+
+
+bool LoadPpldataBenchUsers(
+    std::string const& ppldata_filename,
+    boost::optional<int> age,
+    std::vector<BenchUser>* users) {
+  BenchUserRepository repository{age, users};
+  if (!engine::PplSlurper{ppldata_filename}.Populate(&repository))
+    return false;
+
+  // The dataset may well be in some sort of order, and we don't want to
+  // bench the server with everyone from Aberdeen followed by everyone from
+  // Aberystwyth.
+  std::shuffle(users->begin(), users->end(),
+               std::default_random_engine{kSeed});
+  return true;
+}
+
+
+bool LoadReplayBenchUsers(
+    std::string const& filename,
+    boost::optional<int> age,
+    std::vector<BenchUser>* users) {
+  std::ifstream file{filename};
+  if (!file) {
+    LOG(ERROR) << "Failed to open `" << filename << "'";
+    return false;
+  }
+
+  std::default_random_engine random_engine{kSeed};
+  std::string line;
+  int line_num = 0;
+  while (std::getline(file, line)) {
+    ++line_num;
+    boost::algorithm::trim(line);
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    std::vector<std::string> columns;
+    boost::algorithm::split(columns, line, boost::algorithm::is_any_of(","));
+    try {
+      if (columns.size() < 2 || columns.size() > 3)
+        throw std::invalid_argument{"wrong number of columns"};
+      BenchUser user{
+          std::stof(columns[0]),
+          std::stof(columns[1]),
+          columns.size() == 3 ? std::stoi(columns[2]) :
+              age ? *age : GetRandomAge(random_engine)};
+      if (   user.latitude < -90 || user.latitude > 90
+          || user.longitude < -180 || user.longitude > 180
+          || user.age < 0) {
+        throw std::out_of_range{"not of this world"};
+      }
+      users->push_back(user);
+    } catch (std::logic_error const& error) {
+      LOG(ERROR) << "Failed to parse line " << line_num << " of `"
+                 << filename << "': " << error.what();
+      return false;
+    }
+  }
+
+  return !file.bad();
+}
+
+
+bool Bench(
+    std::string const& pplme_server_address,
+    unsigned short pplme_server_port,
+    std::vector<BenchUser> const& users,
+    unsigned int connections,
+    double qps,
+    unsigned int duration_s,
+    bool keep_alive,
+    net::Backend backend,
+    int max_response_version,
+    boost::optional<core::PersonFields> const& fields,
+    int limit,
+    boost::optional<float> max_distance,
+    boost::optional<unsigned int> deadline_ms) {
+  CHECK(!users.empty());
+  CHECK(connections > 0);
+
+  proto::Request request_pb;
+  request_pb.set_max_response_version(max_response_version);
+  auto pplme_request_pb = request_pb.mutable_pplme_request();
+  if (fields)
+    proto::Convert(*fields, pplme_request_pb->mutable_person_fields());
+  if (limit > 0)
+    pplme_request_pb->set_limit(limit);
+  if (max_distance)
+    pplme_request_pb->set_max_distance(*max_distance);
+  if (deadline_ms)
+    pplme_request_pb->set_deadline_ms(*deadline_ms);
+
+  LoadGenerator load_generator{
+      pplme_server_address,
+      pplme_server_port,
+      users,
+      connections,
+      qps,
+      duration_s,
+      keep_alive,
+      backend,
+      request_pb};
+  auto const start = Clock::now();
+  std::vector<std::thread> threads;
+  for (unsigned int connection = 0; connection < connections; ++connection) {
+    threads.emplace_back([&load_generator, connection]() {
+        load_generator.Run(connection);
+      });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  load_generator.Report(Clock::now() - start);
+  return !load_generator.HasFailures();
+}
+
+
+}  // namespace pplme
@@ -0,0 +1,110 @@
+/**
+ *  @file
+ *  @brief   Declaration of pplme::Bench(), pplmec's load generator, along
+ *           with the various ways of making up users for it to send.
+ *  @author  j.ho
+ */
+#ifndef PPLME_PPLMEC_BENCH_H_
+#define PPLME_PPLMEC_BENCH_H_
+
+
+#include <string>
+#include <vector>
+#include <boost/optional.hpp>
+#include "libpplmecore/person_fields.h"
+#include "libpplmenet/backend.h"
+
+
+namespace pplme {
+
+
+/** Who Bench() pretends to be when sending a request. */
+struct BenchUser {
+  float latitude;
+  float longitude;
+  int age;
+};
+
+
+/**
+ *  @returns  @a count users spread uniformly (in degrees) over the world,
+ *            who are all @a age if it's set, or 18 to 100 otherwise.
+ */
+std::vector<BenchUser> CreateUniformBenchUsers(
+    std::size_t count, boost::optional<int> age);
+
+
+/**
+ *  Populate @a users with one user per Person in @a ppldata_filename (a CSV
+ *  file as slurped by pplmed), in a random order, so that the users are
+ *  wherever the dataset has ppl.  They are each as old as their Person,
+ *  unless @a age is set.
+ *
+ *  @returns  true iff the file was fully parsed.
+ */
+bool LoadPpldataBenchUsers(
+    std::string const& ppldata_filename,
+    boost::optional<int> age,
+    std::vector<BenchUser>* users);
+
+
+/**
+ *  Populate @a users from @a filename, which has a line of
+ *  "<latitude>,<longitude>[,<age>]" per user (blank lines and lines starting
+ *  with '#' are ignored), so that they can be replayed in order.  Users
+ *  without an age are @a age if it's set, or 18 to 100 otherwise.
+ *
+ *  @returns  true iff the file was fully parsed.
+ */
+bool LoadReplayBenchUsers(
+    std::string const& filename,
+    boost::optional<int> age,
+    std::vector<BenchUser>* users);
+
+
+/**
+ *  Hammer a pplMe server with requests from @a users (going round them in
+ *  order, and back to the start if need be) for @a duration_s seconds over
+ *  @a connections concurrent connections, and then report the throughput
+ *  and latencies.
+ *
+ *  If @a qps is positive, then requests are sent on a fixed schedule of that
+ *  many per second overall (i.e., open loop), and each one's latency is
+ *  measured from when it was meant to be sent, rather than from when it
+ *  actually was; that way, a server that stalls is charged for all of the
+ *  requests that should have been sent during the stall (i.e., the
+ *  latencies are corrected for coordinated omission).  Otherwise, each
+ *  connection sends its next request as soon as it has the response to its
+ *  last one (i.e., closed loop), which measures how much the server can
+ *  take, but not how long users would wait at a given load.
+ *
+ *  @param  keep_alive is whether to send all of a connection's requests
+ *          over one TCP/IP connection (which needs pplmed --keep_alive), or
+ *          to connect afresh for each request.
+ *  @param  backend is how the connections do their I/O.
+ *
+ *  The rest of the parameters are as per Pplme().
+ *
+ *  @return  true iff every request got a response (even if it was a busy
+ *           one).
+ */
+bool Bench(
+    std::string const& pplme_server_address,
+    unsigned short pplme_server_port,
+    std::vector<BenchUser> const& users,
+    unsigned int connections,
+    double qps,
+    unsigned int duration_s,
+    bool keep_alive,
+    net::Backend backend,
+    int max_response_version,
+    boost::optional<core::PersonFields> const& fields,
+    int limit,
+    boost::optional<float> max_distance,
+    boost::optional<unsigned int> deadline_ms);
+
+
+}  // namespace pplme
+
+
+#endif  // PPLME_PPLMEC_BENCH_H_
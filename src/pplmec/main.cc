@@ -6,14 +6,51 @@
 
 
 #include <stdlib.h>
+#include <boost/algorithm/hex.hpp>
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
 #include <gflags/gflags.h>
 #include <glog/logging.h>
+#include "bench.h"
+#include "mutate_ppl.h"
 #include "pplme.h"
+#include "reload.h"
 
 
 using google::RegisterFlagValidator;
 
 
+namespace {
+
+
+/** Parse @a value, e.g., "name,distance", into @a fields (where "id" is
+    allowed but redundant).  Returns false IFF @a value is gibberish. */
+bool ParsePersonFields(std::string const& value,
+                       pplme::core::PersonFields* fields) {
+  using pplme::core::PersonField;
+  std::vector<std::string> names;
+  boost::algorithm::split(names, value, boost::algorithm::is_any_of(","));
+  for (auto const& name : names) {
+    if (name == "id")
+      continue;
+    else if (name == "name")
+      fields->Add(PersonField::Name);
+    else if (name == "date_of_birth")
+      fields->Add(PersonField::DateOfBirth);
+    else if (name == "location_of_home")
+      fields->Add(PersonField::LocationOfHome);
+    else if (name == "distance")
+      fields->Add(PersonField::Distance);
+    else
+      return false;
+  }
+  return true;
+}
+
+
+}  // namespace
+
+
 DEFINE_string(server,
               "localhost",
               "address of the pplMe server");
@@ -60,21 +97,299 @@ extern bool const age_validation_registrar = RegisterFlagValidator(
     });
 
 
+DEFINE_int32(max_response_version,
+             2,
+             "latest PplmeResponse version to ask the server for");
+extern bool const max_response_version_validation_registrar =
+    RegisterFlagValidator(
+        &FLAGS_max_response_version,
+        [](char const*, int32_t value) {
+          return value >= 1;
+        });
+
+
+DEFINE_string(fields,
+              "",
+              "comma-separated subset of id, name, date_of_birth, "
+              "location_of_home, and distance to ask for (default: all of "
+              "each Person)");
+extern bool const fields_validation_registrar = RegisterFlagValidator(
+    &FLAGS_fields,
+    [](char const*, std::string const& value) {
+      pplme::core::PersonFields fields;
+      return value.empty() || ParsePersonFields(value, &fields);
+    });
+
+
+DEFINE_int32(limit,
+             0,
+             "most ppl wanted (default: as many as the server will give)");
+extern bool const limit_validation_registrar = RegisterFlagValidator(
+    &FLAGS_limit,
+    [](char const*, int32_t value) {
+      return value >= 0;
+    });
+
+DEFINE_string(cursor,
+              "",
+              "where to carry on from, as given by a previous pplmec with "
+              "the same latitude, longitude, and age");
+extern bool const cursor_validation_registrar = RegisterFlagValidator(
+    &FLAGS_cursor,
+    [](char const*, std::string const& value) {
+      try {
+        boost::algorithm::unhex(value);
+        return true;
+      } catch (boost::algorithm::hex_decode_error const&) {
+        return false;
+      }
+    });
+
+
+DEFINE_double(max_distance,
+              0,
+              "furthest (in km) that ppl may live from the user (default: "
+              "anywhere)");
+extern bool const max_distance_validation_registrar = RegisterFlagValidator(
+    &FLAGS_max_distance,
+    [](char const*, double value) {
+      return value >= 0;
+    });
+
+DEFINE_int32(min_age,
+             -1,
+             "youngest ppl wanted (default: as per the server)");
+extern bool const min_age_validation_registrar = RegisterFlagValidator(
+    &FLAGS_min_age,
+    [](char const*, int32_t value) {
+      return value >= -1;
+    });
+
+DEFINE_int32(max_age,
+             -1,
+             "oldest ppl wanted (default: as per the server)");
+extern bool const max_age_validation_registrar = RegisterFlagValidator(
+    &FLAGS_max_age,
+    [](char const*, int32_t value) {
+      return value >= -1;
+    });
+
+DEFINE_int32(deadline_ms,
+             0,
+             "how long (in ms) the server has to find ppl before returning "
+             "whoever it has found so far (default: however long it takes)");
+extern bool const deadline_ms_validation_registrar = RegisterFlagValidator(
+    &FLAGS_deadline_ms,
+    [](char const*, int32_t value) {
+      return value >= 0;
+    });
+
+DEFINE_bool(trace,
+            false,
+            "ask the server to trace this request (and save it as Chrome "
+            "trace-event JSON in its --trace_dir)");
+
+
+DEFINE_bool(bench,
+            false,
+            "rather than sending one request and showing the results, load "
+            "the server up with lots of requests and report how it coped");
+
+DEFINE_int32(bench_connections,
+             8,
+             "number of concurrent connections to bench over");
+extern bool const bench_connections_validation_registrar =
+    RegisterFlagValidator(
+        &FLAGS_bench_connections,
+        [](char const*, int32_t value) {
+          return value > 0;
+        });
+
+DEFINE_double(bench_qps,
+              0,
+              "requests per second to send, on a fixed schedule (default: "
+              "each connection sends as soon as it has its last response)");
+extern bool const bench_qps_validation_registrar = RegisterFlagValidator(
+    &FLAGS_bench_qps,
+    [](char const*, double value) {
+      return value >= 0;
+    });
+
+DEFINE_int32(bench_duration,
+             10,
+             "how long (in seconds) to bench for");
+extern bool const bench_duration_validation_registrar = RegisterFlagValidator(
+    &FLAGS_bench_duration,
+    [](char const*, int32_t value) {
+      return value > 0;
+    });
+
+DEFINE_bool(bench_keep_alive,
+            true,
+            "send all of each connection's requests over one TCP/IP "
+            "connection (which needs pplmed --keep_alive)");
+
+DEFINE_string(bench_net_backend,
+              "epoll",
+              "how the bench's connections do their I/O: epoll or io_uring "
+              "(which falls back to epoll where it isn't to be had)");
+extern bool const bench_net_backend_validation_registrar =
+    RegisterFlagValidator(
+        &FLAGS_bench_net_backend,
+        [](char const*, std::string const& value) {
+          return !!pplme::net::ParseBackend(value);
+        });
+
+DEFINE_string(bench_locations,
+              "uniform",
+              "where the bench's users are: uniform (all over the world), "
+              "ppldata (wherever the ppl in --bench_locations_file, a pplmed "
+              "--ppldata CSV file, are), or replay (each line of "
+              "--bench_locations_file in turn, as latitude,longitude[,age])");
+extern bool const bench_locations_validation_registrar =
+    RegisterFlagValidator(
+        &FLAGS_bench_locations,
+        [](char const*, std::string const& value) {
+          return value == "uniform" || value == "ppldata" || value == "replay";
+        });
+
+DEFINE_string(bench_locations_file,
+              "",
+              "file for --bench_locations=ppldata or replay");
+
+DEFINE_string(add_ppl,
+              "",
+              "rather than finding ppl, add those in this file (a pplmed "
+              "--ppldata CSV file) to a pplmed --writer");
+
+DEFINE_string(remove_ppl,
+              "",
+              "rather than finding ppl, remove those in this file (a pplmed "
+              "--ppldata CSV file) from a pplmed --writer");
+
+DEFINE_bool(reload,
+            false,
+            "rather than finding ppl, have the server load its dataset afresh "
+            "(from --reload_ppldata, if given) and swap it in for the one "
+            "that it's serving, once it's loaded");
+
+DEFINE_string(reload_ppldata,
+              "",
+              "for --reload, a pplmed --ppldata CSV file (on the server's "
+              "machine) to load instead of whatever the server loaded last");
+
+
+namespace {
+
+
+/** How many users to make up for --bench_locations=uniform (before they
+    start repeating themselves). */
+std::size_t const kUniformBenchUserCount = 65536;
+
+
+int Bench(boost::optional<pplme::core::PersonFields> const& fields) {
+  auto const age = boost::make_optional(FLAGS_age >= 0, FLAGS_age);
+  std::vector<pplme::BenchUser> users;
+  if (FLAGS_bench_locations == "uniform")
+    users = pplme::CreateUniformBenchUsers(kUniformBenchUserCount, age);
+  else if (   (FLAGS_bench_locations == "ppldata"
+               && !pplme::LoadPpldataBenchUsers(
+                      FLAGS_bench_locations_file, age, &users))
+           || (FLAGS_bench_locations == "replay"
+               && !pplme::LoadReplayBenchUsers(
+                      FLAGS_bench_locations_file, age, &users))) {
+    std::cerr << "Failed to load bench locations from `"
+              << FLAGS_bench_locations_file << "' (check logs for details)"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (users.empty()) {
+    std::cerr << "No bench locations to be had" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  auto const ok = pplme::Bench(
+      FLAGS_server,
+      FLAGS_port,
+      users,
+      FLAGS_bench_connections,
+      FLAGS_bench_qps,
+      FLAGS_bench_duration,
+      FLAGS_bench_keep_alive,
+      *pplme::net::ParseBackend(FLAGS_bench_net_backend),
+      FLAGS_max_response_version,
+      fields,
+      FLAGS_limit,
+      boost::make_optional<float>(FLAGS_max_distance > 0, FLAGS_max_distance),
+      boost::make_optional<unsigned int>(FLAGS_deadline_ms > 0,
+                                         FLAGS_deadline_ms));
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+}  // namespace
+
+
 int main(int argc, char* argv[]) {
   std::string usage{"pplmec, the pplMe client.  Sample usage:\n"};
   usage += argv[0];
-  usage += " --latitude 12.34 --longitude --56.789 --age 100";
+  usage += " --latitude 12.34 --longitude --56.789 --age 100\n";
+  usage += "or, to load test a server:\n";
+  usage += argv[0];
+  usage += " --bench --bench_qps 1000 --bench_duration 30\n";
+  usage += "or, to add ppl to a writer server:\n";
+  usage += argv[0];
+  usage += " --add_ppl more-pplMe-data.csv\n";
+  usage += "or, to have a server swap in a new dataset:\n";
+  usage += argv[0];
+  usage += " --reload --reload_ppldata /data/new-pplMe-data.csv";
   google::SetUsageMessage(usage);
   google::ParseCommandLineFlags(&argc, &argv, true);
 
   google::InitGoogleLogging(argv[0]);
 
+  boost::optional<pplme::core::PersonFields> fields;
+  if (!FLAGS_fields.empty()) {
+    fields = pplme::core::PersonFields{};
+    ParsePersonFields(FLAGS_fields, &*fields);
+  }
+
+  if (FLAGS_bench)
+    return Bench(fields);
+
+  if (FLAGS_reload) {
+    auto const reloading =
+        pplme::Reload(FLAGS_server, FLAGS_port, FLAGS_reload_ppldata);
+    return reloading ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  if (!FLAGS_add_ppl.empty() || !FLAGS_remove_ppl.empty()) {
+    auto const mutated = pplme::MutatePpl(
+        FLAGS_server,
+        FLAGS_port,
+        FLAGS_add_ppl.empty() ? FLAGS_remove_ppl : FLAGS_add_ppl,
+        FLAGS_add_ppl.empty() ? pplme::core::PplMutation::Kind::Remove :
+                                pplme::core::PplMutation::Kind::Add);
+    return mutated ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
   auto pplmed = pplme::Pplme(
       FLAGS_server,
       FLAGS_port,
       FLAGS_latitude,
       FLAGS_longitude,
-      FLAGS_age);
+      FLAGS_age,
+      FLAGS_max_response_version,
+      fields,
+      FLAGS_limit,
+      boost::algorithm::unhex(FLAGS_cursor),
+      boost::make_optional<float>(FLAGS_max_distance > 0, FLAGS_max_distance),
+      boost::make_optional(FLAGS_min_age >= 0, FLAGS_min_age),
+      boost::make_optional(FLAGS_max_age >= 0, FLAGS_max_age),
+      boost::make_optional<unsigned int>(FLAGS_deadline_ms > 0,
+                                         FLAGS_deadline_ms),
+      FLAGS_trace);
   
   return pplmed ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,140 @@
+/**
+ *  @file
+ *  @brief   Definition of pplme::MutatePpl().
+ *  @author  j.ho
+ */
+
+
+#include "mutate_ppl.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <boost/numeric/conversion/cast.hpp>
+#include <glog/logging.h>
+#include "libpplmecore/person.h"
+#include "libpplmeengine/ppl_repository.h"
+#include "libpplmeengine/ppl_slurper.h"
+#include "libpplmenet/client.h"
+#include "libpplmenet/message.h"
+#include "libpplmeproto/convert_ppl_mutation.h"
+#include "libpplmeproto/ppl_mutation.pb.h"
+#include "libpplmeproto/request.pb.h"
+
+
+namespace {
+
+
+/** Comfortably inside net::Message::kMaxBodyLength, even with long names. */
+size_t const kPplPerRequest = 1000;
+
+/** How often (and how long apart) to try a batch again if the server is
+    too busy for it. */
+int const kBusyRetries = 10;
+std::chrono::milliseconds const kBusyRetryInterval{100};
+
+
+/** Just holds on to everyone, for sending in batches. */
+class PplCollector : public pplme::engine::PplRepository {
+ public:
+  void AddPerson(std::unique_ptr<pplme::core::Person> person) override {
+    ppl.push_back(std::move(person));
+  }
+
+  std::vector<std::unique_ptr<pplme::core::Person>> ppl;
+};
+
+
+}  // namespace
+
+
+namespace pplme {
+
+
+bool MutatePpl(
+    std::string const& pplme_server_address,
+    unsigned short pplme_server_port,
+    std::string const& ppldata_filename,
+    core::PplMutation::Kind kind) {
+  PplCollector ppl_collector;
+  if (!engine::PplSlurper{ppldata_filename}.Populate(&ppl_collector)) {
+    std::cerr << "Failed to load ppl data from `" << ppldata_filename << "'"
+              << std::endl;
+    return false;
+  }
+
+  auto const& ppl = ppl_collector.ppl;
+  uint64_t sequence = 0;
+  for (size_t first = 0; first < ppl.size(); first += kPplPerRequest) {
+    proto::Request request_pb;
+    for (auto n = first; n < std::min(first + kPplPerRequest, ppl.size());
+         ++n) {
+      proto::Convert(core::PplMutation{kind, *ppl[n]},
+                     request_pb.add_ppl_mutations());
+    }
+    auto const request_size =
+        boost::numeric_cast<uint32_t>(request_pb.ByteSize());
+    auto request_body = net::Message::CreateBodyBuffer(request_size);
+    request_pb.SerializeWithCachedSizesToArray(request_body.get());
+    net::Message request{std::move(request_body), request_size};
+
+    proto::PplMutationResponse response_pb;
+    for (int tries = 0; tries == 0 || response_pb.busy(); ++tries) {
+      if (tries > kBusyRetries) {
+        std::cerr << "pplMe server "
+                  << pplme_server_address << ":" << pplme_server_port
+                  << " is too busy right now; try again in a bit"
+                  << std::endl;
+        return false;
+      }
+      if (tries > 0)
+        std::this_thread::sleep_for(kBusyRetryInterval);
+
+      // A connection per request, since the server might not keep them
+      // alive.
+      net::Client client{pplme_server_address, pplme_server_port};
+      if (!client.Connect()) {
+        std::cerr << "Failed to connect to pplMe server "
+                  << pplme_server_address << ":" << pplme_server_port
+                  << std::endl;
+        return false;
+      }
+      auto const response = client.SendRequest(request);
+      if (!response) {
+        std::cerr << "pplMe request to "
+                  << pplme_server_address << ":" << pplme_server_port
+                  << " failed (check logs for details)"
+                  << std::endl;
+        return false;
+      }
+      response_pb.Clear();
+      if (!response_pb.ParseFromArray(response->GetBodyOctets(),
+                                      response->GetHeader().GetBodyLength())) {
+        std::cerr << "Invalid pplMe response received from "
+                  << pplme_server_address << ":" << pplme_server_port
+                  << std::endl;
+        return false;
+      }
+    }
+    if (response_pb.rejected()) {
+      std::cerr << "pplMe server "
+                << pplme_server_address << ":" << pplme_server_port
+                << " rejected the ppl from #" << first + 1
+                << " on (is it a writer?)" << std::endl;
+      return false;
+    }
+    sequence = response_pb.sequence();
+    VLOG(1) << "Ppl up to #" << std::min(first + kPplPerRequest, ppl.size())
+            << " made it as far as " << sequence;
+  }
+
+  std::cout << "pplMe: " << (kind == core::PplMutation::Kind::Add ?
+                                 "added " : "removed ")
+            << ppl.size() << " ppl (as of change " << sequence << ")"
+            << std::endl;
+  return true;
+}
+
+
+}  // namespace pplme
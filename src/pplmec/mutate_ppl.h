@@ -0,0 +1,37 @@
+/**
+ *  @file
+ *  @brief   Declaration of pplme::MutatePpl(), with which pplmec adds ppl to
+ *           (or removes them from) a writer pplmed.
+ *  @author  j.ho
+ */
+#ifndef PPLME_PPLMEC_MUTATEPPL_H_
+#define PPLME_PPLMEC_MUTATEPPL_H_
+
+
+#include <string>
+#include "libpplmecore/ppl_mutation.h"
+
+
+namespace pplme {
+
+
+/**
+ *  Add (or remove, as per @a kind) each Person in @a ppldata_filename (a CSV
+ *  file as slurped by pplmed) to (or from) the writer pplmed at
+ *  @a pplme_server_address:@a pplme_server_port, a batch at a time, each
+ *  batch being made all or none.  (Only the ids and locations of home
+ *  matter for removals.)
+ *
+ *  @return  true iff every batch was made.
+ */
+bool MutatePpl(
+    std::string const& pplme_server_address,
+    unsigned short pplme_server_port,
+    std::string const& ppldata_filename,
+    core::PplMutation::Kind kind);
+
+
+}  // namespace pplme
+
+
+#endif  // PPLME_PPLMEC_MUTATEPPL_H_
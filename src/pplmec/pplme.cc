@@ -6,19 +6,134 @@
 
 
 #include "pplme.h"
+#include <algorithm>
 #include <chrono>
 #include <iostream>
+#include <boost/algorithm/hex.hpp>
 #include <boost/date_time/gregorian/gregorian.hpp>
 #include <boost/numeric/conversion/cast.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_io.hpp>
 #include <glog/logging.h>
 #include "libpplmecore/person.h"
 #include "libpplmenet/client.h"
 #include "libpplmenet/message.h"
-#include "libpplmeproto/convert_person.h"
+#include "libpplmeproto/compact_ppl.pb.h"
+#include "libpplmeproto/convert_date.h"
+#include "libpplmeproto/convert_person_field_mask.h"
+#include "libpplmeproto/convert_pplme_response.h"
+#include "libpplmeproto/convert_uuid.h"
+#include "libpplmeproto/person.pb.h"
 #include "libpplmeproto/pplme_response.pb.h"
 #include "libpplmeproto/request.pb.h"
 
 
+namespace {
+
+
+int GetAgeInYears(boost::gregorian::date date_of_birth) {
+  auto age = boost::gregorian::day_clock::local_day() - date_of_birth;
+  // From memory....  &:S
+  return age.days() / 365.24;
+}
+
+
+/** Output whichever bits of a (projected) Person we were sent. */
+void OutputPersonEntry(
+    boost::uuids::uuid const& id,
+    std::string const* name,
+    boost::optional<boost::gregorian::date> const& date_of_birth,
+    pplme::proto::GeoPosition const* location_of_home,
+    boost::optional<float> const& distance) {
+  std::cout << id;
+  if (name)
+    std::cout << " " << *name;
+  if (date_of_birth)
+    std::cout << ", " << GetAgeInYears(*date_of_birth);
+  if (location_of_home) {
+    std::cout << " @ " << location_of_home->latitude() << ", "
+              << location_of_home->longitude();
+  }
+  if (distance)
+    std::cout << " (~" << *distance << "km away)";
+  std::cout << std::endl;
+}
+
+
+/** Output a response to a request with a PersonFieldMask, i.e., one whose
+    ppl may be missing anything other than their ids.  Returns false IFF the
+    response doesn't make sense. */
+bool OutputProjectedPpl(pplme::proto::PplmeResponse const& response_pb) {
+  using boost::gregorian::date;
+  auto const& compact_pb = response_pb.compact_ppl();
+  if (compact_pb.ids().size() % 16 != 0)
+    return false;
+  auto const compact_count = compact_pb.ids().size() / 16;
+
+  auto const count = response_pb.ppl_size() + compact_count;
+  if (count == 0) {
+    std::cout << "pplMe: no matching ppl found :(" << std::endl;
+    return true;
+  }
+  std::cout << "pplMe: you have " << count << " potential friends :)"
+            << std::endl;
+
+  for (auto const& person_pb : response_pb.ppl()) {
+    boost::uuids::uuid id;
+    if (!pplme::proto::Convert(person_pb.id(), &id))
+      return false;
+    boost::optional<date> date_of_birth;
+    if (person_pb.has_date_of_birth()) {
+      date dob;
+      if (!pplme::proto::Convert(person_pb.date_of_birth(), &dob))
+        return false;
+      date_of_birth = dob;
+    }
+    OutputPersonEntry(
+        id,
+        person_pb.has_name() ? &person_pb.name() : nullptr,
+        date_of_birth,
+        person_pb.has_location_of_home() ?
+            &person_pb.location_of_home() : nullptr,
+        person_pb.has_distance() ?
+            boost::make_optional(person_pb.distance()) : boost::none);
+  }
+
+  for (int n = 0; n < static_cast<int>(compact_count); ++n) {
+    boost::uuids::uuid id;
+    std::copy(compact_pb.ids().begin() + n * 16,
+              compact_pb.ids().begin() + (n + 1) * 16,
+              id.begin());
+    boost::optional<date> date_of_birth;
+    if (n < compact_pb.dates_of_birth_size()) {
+      date dob;
+      if (!pplme::proto::UnpackYmd(compact_pb.dates_of_birth(n), &dob))
+        return false;
+      date_of_birth = dob;
+    }
+    pplme::proto::GeoPosition location_of_home;
+    auto const has_location_of_home =
+        n < compact_pb.latitudes_size() && n < compact_pb.longitudes_size();
+    if (has_location_of_home) {
+      location_of_home.set_latitude(compact_pb.latitudes(n));
+      location_of_home.set_longitude(compact_pb.longitudes(n));
+    }
+    OutputPersonEntry(
+        id,
+        n < compact_pb.names_size() ? &compact_pb.names(n) : nullptr,
+        date_of_birth,
+        has_location_of_home ? &location_of_home : nullptr,
+        n < compact_pb.distances_size() ?
+            boost::make_optional(compact_pb.distances(n)) : boost::none);
+  }
+
+  return true;
+}
+
+
+}  // namespace
+
+
 namespace pplme {
 
 
@@ -27,7 +142,16 @@ bool Pplme(
     unsigned short pplme_server_port,
     float users_latitude,
     float users_longitude,
-    int users_age) {
+    int users_age,
+    int max_response_version,
+    boost::optional<core::PersonFields> const& fields,
+    int limit,
+    std::string const& cursor,
+    boost::optional<float> max_distance,
+    boost::optional<int> min_age,
+    boost::optional<int> max_age,
+    boost::optional<unsigned int> deadline_ms,
+    bool trace) {
 
   // Create client and connect to server.
   net::Client client{pplme_server_address, pplme_server_port};
@@ -45,13 +169,32 @@ bool Pplme(
   location_of_user->set_latitude(users_latitude);
   location_of_user->set_longitude(users_longitude);
   request_pb.mutable_pplme_request()->set_age_of_user(users_age);
+  request_pb.set_max_response_version(max_response_version);
+  if (fields) {
+    proto::Convert(
+        *fields, request_pb.mutable_pplme_request()->mutable_person_fields());
+  }
+  if (limit > 0)
+    request_pb.mutable_pplme_request()->set_limit(limit);
+  if (!cursor.empty())
+    request_pb.mutable_pplme_request()->set_cursor(cursor);
+  if (max_distance)
+    request_pb.mutable_pplme_request()->set_max_distance(*max_distance);
+  if (min_age)
+    request_pb.mutable_pplme_request()->set_min_age(*min_age);
+  if (max_age)
+    request_pb.mutable_pplme_request()->set_max_age(*max_age);
+  if (deadline_ms)
+    request_pb.mutable_pplme_request()->set_deadline_ms(*deadline_ms);
+  if (trace)
+    request_pb.mutable_pplme_request()->set_trace(true);
 
   // Serialize PplmeRequest protobuf message into a generic pplMe message.
-  auto request_body = net::Message::CreateBodyBuffer(request_pb.ByteSize());
-  request_pb.SerializeToArray(request_body.get(), request_pb.ByteSize());
-  net::Message request{
-    std::move(request_body),
-    boost::numeric_cast<uint32_t>(request_pb.ByteSize())};
+  auto const request_size =
+      boost::numeric_cast<uint32_t>(request_pb.ByteSize());
+  auto request_body = net::Message::CreateBodyBuffer(request_size);
+  request_pb.SerializeWithCachedSizesToArray(request_body.get());
+  net::Message request{std::move(request_body), request_size};
 
   auto then = std::chrono::high_resolution_clock::now();
   
@@ -78,34 +221,48 @@ bool Pplme(
               << std::endl;
     return false;
   }
+  if (response_pb.busy()) {
+    std::cerr << "pplMe server "
+              << pplme_server_address << ":" << pplme_server_port
+              << " is too busy right now; try again in a bit"
+              << std::endl;
+    return false;
+  }
 
   // Finally, output our results.
   std::cout << "pplMe for user, " << users_age << " @ "
             << users_latitude << ", " << users_longitude
             << std::endl;
-  if (response_pb.ppl_size() > 0) {
+  std::vector<core::Person> ppl;
+  if (fields) {
+    if (!OutputProjectedPpl(response_pb))
+      std::cout << "pplMe: warning: failed to grok ppl results" << std::endl;
+  } else if (!proto::Convert(response_pb, &ppl)) {
+    std::cout << "pplMe: warning: failed to grok ppl results" << std::endl;
+  } else if (!ppl.empty()) {
     std::cout << "pplMe: you have "
-              << response_pb.ppl_size() << " potential friends :)"
+              << ppl.size() << " potential friends :)"
               << std::endl;
-    for (int n = 0; n < response_pb.ppl_size(); ++n) {
-      core::Person person;
-      if (proto::Convert(response_pb.ppl(n), &person)) {
-        auto age =
-            boost::gregorian::day_clock::local_day() - person.date_of_birth();
-        // From memory....  &:S
-        int age_in_years = age.days() / 365.24;
-        std::cout << person.name() << ", " << age_in_years << " @ "
-                  << person.location_of_home().latitude().value() << ", "
-                  << person.location_of_home().longitude().value()
-                  << std::endl;
-      } else {
-        std::cout << "pplMe: warning: failed to grok person result"
-                  << std::endl;
-      }
+    for (auto const& person : ppl) {
+      std::cout << person.name() << ", "
+                << GetAgeInYears(person.date_of_birth()) << " @ "
+                << person.location_of_home().latitude().value() << ", "
+                << person.location_of_home().longitude().value()
+                << std::endl;
     }
   } else
     std::cout << "pplMe: no matching ppl found :(" << std::endl;
 
+  if (response_pb.partial()) {
+    std::cout << "pplMe: the server ran out of time, so that's only who it "
+                 "found so far" << std::endl;
+  }
+  if (response_pb.has_next_cursor()) {
+    std::cout << "pplMe: for more ppl, use --cursor "
+              << boost::algorithm::hex(response_pb.next_cursor())
+              << std::endl;
+  }
+
   return true;
 }
 
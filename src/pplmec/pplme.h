@@ -10,6 +10,8 @@
 
 
 #include <string>
+#include <boost/optional.hpp>
+#include "libpplmecore/person_fields.h"
 
 
 namespace pplme {
@@ -28,6 +30,21 @@ namespace pplme {
  *          user.
  *  @param  users_longitude is the WGS 84 decimal longitude of the requesting
  *          user.
+ *  @param  max_response_version is the latest PplmeResponse version to ask
+ *          the server for (either version can be displayed, regardless).
+ *  @param  fields, if set, are the only fields (in addition to their ids)
+ *          that are wanted for each matching Person; otherwise, the whole of
+ *          each Person is wanted.
+ *  @param  limit, if positive, is the most ppl wanted.
+ *  @param  cursor, if non-empty, is the (raw) next_cursor from a previous
+ *          response, for the next page of ppl.
+ *  @param  max_distance, if set, is how far (in km) from the user that ppl
+ *          may live.
+ *  @param  min_age and @a max_age, if set, are the youngest/oldest ppl
+ *          wanted.
+ *  @param  deadline_ms, if set, is how long (in ms) the server has before
+ *          it should give up and return whoever it has found so far.
+ *  @param  trace is whether to ask the server to trace the request.
  *
  *  @return  true iff the request was successful (which includes the case of
  *           receiving an empty result set).
@@ -37,7 +54,16 @@ bool Pplme(
     unsigned short pplme_server_port,
     float users_latitude,
     float users_longitude,
-    int users_age);
+    int users_age,
+    int max_response_version,
+    boost::optional<core::PersonFields> const& fields,
+    int limit,
+    std::string const& cursor,
+    boost::optional<float> max_distance,
+    boost::optional<int> min_age,
+    boost::optional<int> max_age,
+    boost::optional<unsigned int> deadline_ms,
+    bool trace);
 
 
 }  // namespace pplme
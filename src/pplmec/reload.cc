@@ -0,0 +1,88 @@
+/**
+ *  @file
+ *  @brief   Definition of pplme::Reload().
+ *  @author  j.ho
+ */
+
+
+#include "reload.h"
+#include <iostream>
+#include <boost/numeric/conversion/cast.hpp>
+#include "libpplmenet/client.h"
+#include "libpplmenet/message.h"
+#include "libpplmeproto/reload.pb.h"
+#include "libpplmeproto/request.pb.h"
+
+
+namespace pplme {
+
+
+bool Reload(std::string const& pplme_server_address,
+            unsigned short pplme_server_port,
+            std::string const& ppldata_filename) {
+  proto::Request request_pb;
+  auto& reload_request_pb = *request_pb.mutable_reload_request();
+  if (!ppldata_filename.empty())
+    reload_request_pb.set_ppldata(ppldata_filename);
+  auto const request_size =
+      boost::numeric_cast<uint32_t>(request_pb.ByteSize());
+  auto request_body = net::Message::CreateBodyBuffer(request_size);
+  request_pb.SerializeWithCachedSizesToArray(request_body.get());
+  net::Message request{std::move(request_body), request_size};
+
+  net::Client client{pplme_server_address, pplme_server_port};
+  if (!client.Connect()) {
+    std::cerr << "Failed to connect to pplMe server "
+              << pplme_server_address << ":" << pplme_server_port
+              << std::endl;
+    return false;
+  }
+  auto const response = client.SendRequest(request);
+  proto::ReloadResponse response_pb;
+  if (!response) {
+    std::cerr << "pplMe request to "
+              << pplme_server_address << ":" << pplme_server_port
+              << " failed (check logs for details)"
+              << std::endl;
+    return false;
+  }
+  if (!response_pb.ParseFromArray(response->GetBodyOctets(),
+                                  response->GetHeader().GetBodyLength())) {
+    std::cerr << "Invalid pplMe response received from "
+              << pplme_server_address << ":" << pplme_server_port
+              << std::endl;
+    return false;
+  }
+
+  if (response_pb.rejected()) {
+    std::cerr << "pplMe server "
+              << pplme_server_address << ":" << pplme_server_port
+              << " has no dataset of its own to reload" << std::endl;
+    return false;
+  }
+  if (response_pb.busy()) {
+    std::cerr << "pplMe server "
+              << pplme_server_address << ":" << pplme_server_port
+              << " is already reloading; try again once it's done"
+              << std::endl;
+    return false;
+  }
+
+  uint64_t const kMiB = 1024 * 1024;
+  std::cout << "pplMe: reloading (its ppl take up "
+            << response_pb.storage_octets() / kMiB << "MiB; ";
+  if (response_pb.has_memory_available())
+    std::cout << response_pb.memory_available() / kMiB << "MiB available)";
+  else
+    std::cout << "who knows how much is available)";
+  std::cout << std::endl;
+  if (response_pb.has_memory_available()
+      && response_pb.memory_available() < response_pb.storage_octets()) {
+    std::cout << "pplMe: the new ppl may not fit alongside the old!"
+              << std::endl;
+  }
+  return true;
+}
+
+
+}  // namespace pplme
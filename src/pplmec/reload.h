@@ -0,0 +1,35 @@
+/**
+ *  @file
+ *  @brief   Declaration of pplme::Reload(), with which pplmec has a pplmed
+ *           swap in a fresh dataset.
+ *  @author  j.ho
+ */
+#ifndef PPLME_PPLMEC_RELOAD_H_
+#define PPLME_PPLMEC_RELOAD_H_
+
+
+#include <string>
+
+
+namespace pplme {
+
+
+/**
+ *  Have the pplmed at @a pplme_server_address:@a pplme_server_port load
+ *  @a ppldata_filename (a CSV file on the server's machine, as per pplmed
+ *  --ppldata; or, if empty, whatever it loaded last) in the background, and
+ *  swap it in for the ppl that it has once it's loaded, and say how much
+ *  room it has for doing so.
+ *
+ *  @return  true iff the reload got under way (whether or not it then goes
+ *           on to succeed, which only the server's logs will tell).
+ */
+bool Reload(std::string const& pplme_server_address,
+            unsigned short pplme_server_port,
+            std::string const& ppldata_filename);
+
+
+}  // namespace pplme
+
+
+#endif  // PPLME_PPLMEC_RELOAD_H_
@@ -5,10 +5,15 @@
  */
 
 
+#include <pthread.h>
+#include <signal.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
 #include <iostream>
 #include <gflags/gflags.h>
 #include <glog/logging.h>
+#include "libpplmenet/backend.h"
 #include "server.h"
 
 
@@ -44,9 +49,21 @@ extern bool const grid_resolution_validation_registrar =
           return value > 0 && value <= 100;
         });
 
+DEFINE_int32(grid_partitions,
+             1,
+             "number of partitions (bands of longitude) to split the grid "
+             "into, each with its own workers (0 means one per NUMA node, "
+             "each pinned to its node)");
+extern bool const grid_partitions_validation_registrar =
+    RegisterFlagValidator(
+        &FLAGS_grid_partitions,
+        [](char const*, int32_t value) {
+          return value >= 0 && value <= 361;
+        });
+
 DEFINE_int32(max_ppl,
              10,
-             "maximum number of people to find");
+             "maximum number of people to find per query (or per page)");
 extern bool const max_ppl_validation_registrar =
     RegisterFlagValidator(
         &FLAGS_max_ppl,
@@ -68,6 +85,150 @@ DEFINE_string(ppldata,
               "",
               "path to a CSV file containing data for the pplMe database");
 
+DEFINE_int32(max_in_flight,
+             64,
+             "maximum number of requests to work on at once (0 means no "
+             "limit)");
+extern bool const max_in_flight_validation_registrar =
+    RegisterFlagValidator(
+        &FLAGS_max_in_flight,
+        [](char const*, int32_t value) {
+          return value >= 0;
+        });
+
+DEFINE_int32(max_queue_ms,
+             100,
+             "maximum time (in ms) that a request may wait to be worked on "
+             "before being turned away as busy");
+extern bool const max_queue_ms_validation_registrar =
+    RegisterFlagValidator(
+        &FLAGS_max_queue_ms,
+        [](char const*, int32_t value) {
+          return value >= 0;
+        });
+
+DEFINE_int32(stats_interval,
+             60,
+             "how often (in seconds) to log server stats (0 means never)");
+extern bool const stats_interval_validation_registrar =
+    RegisterFlagValidator(
+        &FLAGS_stats_interval,
+        [](char const*, int32_t value) {
+          return value >= 0;
+        });
+
+DEFINE_string(trace_dir,
+              "/tmp",
+              "directory in which to save traces of requests");
+
+DEFINE_int32(trace_sample_every,
+             0,
+             "trace one in every this many requests, whether they ask for it "
+             "or not (0 means only those that ask for it)");
+extern bool const trace_sample_every_validation_registrar =
+    RegisterFlagValidator(
+        &FLAGS_trace_sample_every,
+        [](char const*, int32_t value) {
+          return value >= 0;
+        });
+
+DEFINE_bool(keep_alive,
+            false,
+            "let clients send more than one request per connection (each "
+            "connection ties up a thread for as long as the client keeps it)");
+
+DEFINE_int32(acceptors,
+             1,
+             "number of sockets (each with a thread of its own) to accept "
+             "connections on, all listening on the one port with "
+             "SO_REUSEPORT, so that the kernel spreads connections across "
+             "them");
+extern bool const acceptors_validation_registrar = RegisterFlagValidator(
+    &FLAGS_acceptors,
+    [](char const*, int32_t value) {
+      return value > 0 && value <= 256;
+    });
+
+DEFINE_string(net_backend,
+              "epoll",
+              "how to accept connections and do their I/O: epoll or io_uring "
+              "(which falls back to epoll where it isn't to be had)");
+extern bool const net_backend_validation_registrar = RegisterFlagValidator(
+    &FLAGS_net_backend,
+    [](char const*, std::string const& value) {
+      return !!pplme::net::ParseBackend(value);
+    });
+
+DEFINE_string(shards,
+              "",
+              "be a coordinator over these shards (other pplmeds, best run "
+              "with --keep_alive), rather than having any ppl of our own: a "
+              "comma-separated list of MIN_LAT:MAX_LAT/MIN_LON:MAX_LON="
+              "HOST:PORT, each shard having those ppl that live in its "
+              "ranges");
+
+DEFINE_int32(shard_timeout_ms,
+             1000,
+             "as a coordinator, the longest (in ms) to wait on the shards "
+             "for a query (or less, if its deadline is sooner), after which "
+             "it makes do with whoever has answered");
+extern bool const shard_timeout_ms_validation_registrar =
+    RegisterFlagValidator(
+        &FLAGS_shard_timeout_ms,
+        [](char const*, int32_t value) {
+          return value > 0;
+        });
+
+DEFINE_int32(shard_askers,
+             64,
+             "as a coordinator, the number of threads that ask the shards "
+             "for ppl (each asking one shard at a time)");
+extern bool const shard_askers_validation_registrar = RegisterFlagValidator(
+    &FLAGS_shard_askers,
+    [](char const*, int32_t value) {
+      return value > 0;
+    });
+
+DEFINE_bool(writer,
+            false,
+            "accept ppl being added and removed (by pplmec --add_ppl and "
+            "--remove_ppl), and keep a change feed of them, starting with the "
+            "database, for read replicas to follow");
+
+DEFINE_string(replicate_from,
+              "",
+              "be a read replica of the writer pplmed at this HOST:PORT, "
+              "following its change feed rather than loading a database of "
+              "our own");
+
+DEFINE_string(wal_dir,
+              "",
+              "as a writer, keep a write-ahead log (and snapshots) of our ppl "
+              "in this directory, and start from there (rather than from the "
+              "database) when restarted");
+
+DEFINE_int32(checkpoint_interval,
+             3600,
+             "how often (in seconds) to snapshot our ppl into the write-ahead "
+             "log, so that it doesn't grow forever (0 means never)");
+extern bool const checkpoint_interval_validation_registrar =
+    RegisterFlagValidator(
+        &FLAGS_checkpoint_interval,
+        [](char const*, int32_t value) {
+          return value >= 0;
+        });
+
+DEFINE_int32(drain_budget_ms,
+             10000,
+             "how long (in ms) to give the requests under way to be answered "
+             "when told to stop (by SIGTERM or SIGINT)");
+extern bool const drain_budget_ms_validation_registrar =
+    RegisterFlagValidator(
+        &FLAGS_drain_budget_ms,
+        [](char const*, int32_t value) {
+          return value >= 0;
+        });
+
 
 int main(int argc, char* argv[]) {
   std::string usage{"pplmed, the pplMe daemon.  Sample usage:\n"};
@@ -78,13 +239,40 @@ int main(int argc, char* argv[]) {
 
   google::InitGoogleLogging(argv[0]);
 
-  pplme::Server server(
-      FLAGS_port,
-      FLAGS_test_database_size,
-      FLAGS_grid_resolution,
-      FLAGS_max_ppl,
-      FLAGS_max_age_difference,
-      FLAGS_ppldata);
+  // The signals that we act upon are blocked before there are any other
+  // threads (which inherit this mask), so that they're left for us to
+  // sigwait() on, rather than interrupting whoever happens to be running.
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGHUP);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  pplme::Server::Options options;
+  options.port = FLAGS_port;
+  options.test_db_size = FLAGS_test_database_size;
+  options.grid_resolution = FLAGS_grid_resolution;
+  options.max_ppl = FLAGS_max_ppl;
+  options.max_age_difference = FLAGS_max_age_difference;
+  options.ppldata_filename = FLAGS_ppldata;
+  options.max_in_flight = FLAGS_max_in_flight;
+  options.max_queue_ms = FLAGS_max_queue_ms;
+  options.stats_interval_s = FLAGS_stats_interval;
+  options.trace_dir = FLAGS_trace_dir;
+  options.trace_sample_every = FLAGS_trace_sample_every;
+  options.keep_alive = FLAGS_keep_alive;
+  options.grid_partitions = FLAGS_grid_partitions;
+  options.shards = FLAGS_shards;
+  options.shard_timeout_ms = FLAGS_shard_timeout_ms;
+  options.shard_askers = FLAGS_shard_askers;
+  options.writer = FLAGS_writer;
+  options.replicate_from = FLAGS_replicate_from;
+  options.wal_dir = FLAGS_wal_dir;
+  options.checkpoint_interval_s = FLAGS_checkpoint_interval;
+  options.acceptors = FLAGS_acceptors;
+  options.net_backend = *pplme::net::ParseBackend(FLAGS_net_backend);
+  pplme::Server server{options};
   if (!server.Go())
   {
     std::cerr << "Failed to start pplMe server (check logs for details)"
@@ -95,8 +283,24 @@ int main(int argc, char* argv[]) {
   std::cout << "pplMe: Server up and running and listening on port "
             << FLAGS_port
             << std::endl;
-  std::cout << "[stdin to continue]" << std::endl;
-  std::cin.get();
-  
+  std::cout << "[SIGHUP to reload, SIGTERM (or ^C) to stop]" << std::endl;
+
+  for (;;) {
+    int signal_number = 0;
+    if (sigwait(&signals, &signal_number) != 0 || signal_number != SIGHUP)
+      break;
+    LOG(INFO) << "Got SIGHUP; reloading";
+    server.Reload();
+  }
+
+  LOG(INFO) << "Stopping; giving the requests under way up to "
+            << FLAGS_drain_budget_ms << "ms";
+  if (!server.Drain(std::chrono::milliseconds{FLAGS_drain_budget_ms})) {
+    // Those that are left get hung up on, which beats waiting forever (as
+    // whoever told us to stop would only lose patience and SIGKILL us).
+    LOG(ERROR) << "Requests still under way; exiting regardless";
+    _exit(EXIT_FAILURE);
+  }
+
   return EXIT_SUCCESS;
 }
@@ -6,19 +6,52 @@
 
 
 #include "server.h"
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
 #include <boost/date_time/gregorian/gregorian.hpp>
 #include <boost/numeric/conversion/cast.hpp>
+#include <boost/optional.hpp>
 #include <boost/uuid/random_generator.hpp>
 #include <glog/logging.h>
+#include <google/protobuf/arena.h>
+#include "libpplmecore/geo_position.h"
+#include "libpplmecore/person.h"
+#include "libpplmecore/ppl_mutation.h"
+#include "libpplmeengine/ppl_repository.h"
 #include "libpplmeengine/ppl_slurper.h"
 #include "libpplmeengine/pplme_matching_ppl_provider.h"
 #include "libpplmenet/message.h"
 #include "libpplmenet/single_shot_server.h"
+#include "libpplmeproto/change_feed.pb.h"
 #include "libpplmeproto/convert_geo_position.h"
 #include "libpplmeproto/convert_person.h"
+#include "libpplmeproto/convert_person_field_mask.h"
+#include "libpplmeproto/convert_ppl_cursor.h"
+#include "libpplmeproto/convert_ppl_mutation.h"
+#include "libpplmeproto/encode_pplme_response.h"
+#include "libpplmeproto/ppl_mutation.pb.h"
 #include "libpplmeproto/pplme_response.pb.h"
+#include "libpplmeproto/reload.pb.h"
 #include "libpplmeproto/request.pb.h"
+#include "libpplmerepl/change_feed_follower.h"
+#include "libpplmerepl/change_log.h"
+#include "libpplmerepl/write_ahead_log.h"
+#include "libpplmeshard/sharded_matching_ppl_provider.h"
+#include "libpplmeutils/admission_controller.h"
+#include "libpplmeutils/latency_histogram.h"
+#include "libpplmeutils/memory_info.h"
+#include "libpplmeutils/trace.h"
 
 
 namespace {
@@ -31,6 +64,43 @@ boost::gregorian::date GetTodaysDate() {
 }
 
 
+/** Big enough that parsing a request never needs the arena to go back to the
+    heap for more blocks. */
+uint32_t const kArenaInitialBlockSize = 4 * 1024;
+
+/** Where we start with the response body; it doubles from here if need be. */
+uint32_t const kInitialResponseBodySize = 64 * 1024;
+
+/** The latest PplmeResponse version that we know how to produce. */
+uint32_t const kMaxResponseVersion = 2;
+
+/** Any fewer test ppl per thread than this, and it's not worth the thread. */
+int const kMinTestPplPerThread = 64 * 1024;
+
+/** How many of a writer's database's ppl go in its change log at once (so
+    that there aren't two copies of the whole lot in the meantime). */
+size_t const kPplPerChangeLogAppend = 64 * 1024;
+
+/** The longest that a replica may have us wait on its behalf (so that it
+    can't hold up our shutting down for long). */
+uint32_t const kMaxChangeFeedWaitMs = 1000;
+
+/** How often a reload looks to see whether the finds still using the old
+    ppl are done with them. */
+std::chrono::milliseconds const kReloadDrainPollInterval{10};
+
+
+/** Just holds on to everyone, for adding in bulk. */
+class PplCollector : public pplme::engine::PplRepository {
+ public:
+  void AddPerson(std::unique_ptr<pplme::core::Person> person) override {
+    ppl.push_back(std::move(person));
+  }
+
+  std::vector<std::unique_ptr<pplme::core::Person>> ppl;
+};
+
+
 }  // namespace
 
 
@@ -39,87 +109,536 @@ namespace pplme {
 
 class Server::Impl {
  public:
-  Impl(
-      int port,
-      int test_db_size,
-      int grid_resolution,
-      int max_ppl,
-      int max_age_difference,
-      std::string const& ppldata_filename) :
-      test_db_size_{test_db_size},
-      ppldata_filename_{ppldata_filename},
-      matching_ppl_provider_{
-          grid_resolution,
-          max_age_difference,
-          max_ppl,
-          boost::none,    
-          &GetTodaysDate},
+  explicit Impl(Options const& options) :
+      test_db_size_{options.test_db_size},
+      ppldata_filename_{options.ppldata_filename},
+      grid_resolution_{options.grid_resolution},
+      max_ppl_{options.max_ppl},
+      max_age_difference_{options.max_age_difference},
+      grid_partitions_{options.grid_partitions},
+      stats_interval_{options.stats_interval_s},
+      trace_dir_{options.trace_dir},
+      trace_sample_every_{
+          boost::numeric_cast<unsigned int>(options.trace_sample_every)},
+      request_count_{0},
+      trace_count_{0},
+      shards_{options.shards},
+      replicate_from_{options.replicate_from},
+      local_ppl_provider_{
+          options.shards.empty() ? CreateLocalPplProvider() : nullptr},
+      sharded_ppl_provider_{CreateShardedPplProvider(options)},
+      change_log_{options.writer ? new repl::ChangeLog : nullptr},
+      wal_{options.wal_dir.empty() ?
+           nullptr : new repl::WriteAheadLog{options.wal_dir}},
+      checkpoint_interval_{options.checkpoint_interval_s},
+      admission_controller_{
+          boost::numeric_cast<unsigned int>(options.max_in_flight),
+          std::chrono::milliseconds(options.max_queue_ms)},
       pplme_requests_server_{
-          boost::numeric_cast<unsigned short>(port),
+          boost::numeric_cast<unsigned short>(options.port),
           std::bind(&Impl::HandlePplmeRequest,
                     this,
                     std::placeholders::_1,
                     std::placeholders::_2,
-                    std::placeholders::_3)} {}
+                    std::placeholders::_3),
+          options.keep_alive,
+          boost::numeric_cast<unsigned int>(options.acceptors),
+          options.net_backend},
+      stopping_{false},
+      reloading_{false},
+      reload_count_{0},
+      reload_failure_count_{0},
+      last_reload_{} {}
 
   
   ~Impl() {
     pplme_requests_server_.Shutdown();
+
+    /* lock block */ {
+      std::unique_lock<std::mutex> lock(stats_mutex_);
+      stopping_ = true;
+    }
+    stats_condvar_.notify_all();
+    if (stats_thread_.joinable())
+      stats_thread_.join();
+    if (checkpoint_thread_.joinable())
+      checkpoint_thread_.join();
+    if (reload_thread_.joinable())
+      reload_thread_.join();
   }
 
   
   bool Go() {
     bool ok = true;
 
-    if (!ppldata_filename_.empty()) {
-      engine::PplSlurper slurper{ppldata_filename_};
-      LOG(INFO) << "Loading ppl data from `" << ppldata_filename_ << "'...";
-      if (!slurper.Populate(&matching_ppl_provider_)) {
-        LOG(ERROR) << "Failed to load ppl data from `"
-                   << ppldata_filename_ << "'";
-        ok = false;
-      }
+    if ((!shards_.empty() + !replicate_from_.empty() + !!change_log_) > 1) {
+      LOG(ERROR) << "A server can be only one of a coordinator, a writer, "
+                    "or a read replica";
+      return false;
+    }
+    if (wal_ && !change_log_) {
+      LOG(ERROR) << "Only a writer can have a write-ahead log";
+      return false;
+    }
+    // With a snapshot to go on, a writer's ppl are whoever it had last time
+    // round, rather than its database.
+    auto const recovering = wal_ && wal_->HasSnapshot();
+
+    if (!shards_.empty()) {
+      // We're a coordinator, so the shards have all the ppl.
+      ok = sharded_ppl_provider_ != nullptr;
+    }
+    else if (!replicate_from_.empty()) {
+      // We're a read replica, so the writer has all the ppl.
+      ok = FollowWriter();
+    }
+    else if (recovering) {
+      LOG(INFO) << "Recovering ppl from the write-ahead log...";
     }
     else {
-      LOG(INFO) << "Generating ppl test data...";
-      PopulateTestDb();
+      ok = Populate(local_ppl_provider_.get(), ppldata_filename_);
     }
+
+    // Whatever has been added (or removed) since the snapshot (or since the
+    // database, if there isn't one yet) goes on top, and then the database
+    // is snapshotted, so that it's never needed again.
+    ok = ok && (!wal_ || (ReplayWal()
+                          && wal_->Start()
+                          && (recovering || Checkpoint())));
     
     ok = ok && pplme_requests_server_.Start();
 
+    if (ok && stats_interval_.count() > 0)
+      stats_thread_ = std::thread{[this]() { LogStatsPeriodically(); }};
+    if (ok && wal_ && checkpoint_interval_.count() > 0)
+      checkpoint_thread_ = std::thread{[this]() { CheckpointPeriodically(); }};
+
     return ok;
   }
 
+
+
+  bool Drain(std::chrono::milliseconds budget) {
+    return pplme_requests_server_.Drain(budget);
+  }
+
+
+  bool Reload() {
+    proto::ReloadResponse response_pb;
+    StartReload(boost::none, "a SIGHUP", &response_pb);
+    return response_pb.started();
+  }
+
   
  private:
   int test_db_size_;
+  /** What we loaded our ppl from (most recently). */
   std::string ppldata_filename_;
-  engine::PplmeMatchingPplProvider matching_ppl_provider_;
+  int grid_resolution_;
+  int max_ppl_;
+  int max_age_difference_;
+  int grid_partitions_;
+  std::chrono::seconds stats_interval_;
+  std::string trace_dir_;
+  unsigned int trace_sample_every_;
+  /** For sampling requests to trace, and for naming the traces. */
+  std::atomic<uint64_t> request_count_;
+  std::atomic<uint64_t> trace_count_;
+  std::string shards_;
+  std::string replicate_from_;
+  /** Exactly one of these is non-null, depending upon whether we have ppl
+      of our own or are coordinating shards that do (@see
+      GetMatchingPplProvider()).  A reload swaps in a whole new
+      local_ppl_provider_, so, while we're serving, it's only to be got at
+      by way of GetLocalPplProvider() (bar by writers and read replicas,
+      which are never reloaded). */
+  std::shared_ptr<engine::PplmeMatchingPplProvider> local_ppl_provider_;
+  std::shared_ptr<shard::ShardedMatchingPplProvider> sharded_ppl_provider_;
+  /** Non-null IFF we're a writer. */
+  std::unique_ptr<repl::ChangeLog> change_log_;
+  /** Non-null IFF we're a writer with somewhere to keep our ppl across
+      restarts. */
+  std::unique_ptr<repl::WriteAheadLog> wal_;
+  std::chrono::seconds checkpoint_interval_;
+  /** So that the change log (and the write-ahead log) have mutations in the
+      order they were made, and so that checkpoints have them to
+      themselves. */
+  std::mutex mutations_mutex_;
+  /** Non-null IFF we're a read replica (and once we've started). */
+  std::unique_ptr<repl::ChangeFeedFollower> change_feed_follower_;
+  /** Let's not bite off more than we can chew. */
+  utils::AdmissionController admission_controller_;
+  /** How long requests waited to be admitted, spent finding ppl, spent
+      encoding them, and took all told (bar sending the response). */
+  utils::LatencyHistogram queue_wait_;
+  utils::LatencyHistogram find_time_;
+  utils::LatencyHistogram encode_time_;
+  utils::LatencyHistogram total_time_;
   net::SingleShotServer pplme_requests_server_;
+  /** For logging stats every stats_interval_, and checkpointing every
+      checkpoint_interval_, until we're stopping_. */
+  std::thread stats_thread_;
+  std::thread checkpoint_thread_;
+  std::mutex stats_mutex_;
+  std::condition_variable stats_condvar_;
+  bool stopping_;
+  /** The latest reload (if any), which happens one at a time, and how
+      they've gone. */
+  std::thread reload_thread_;
+  mutable std::mutex reload_mutex_;
+  bool reloading_;
+  uint64_t reload_count_;
+  uint64_t reload_failure_count_;
+  struct ReloadTimes {
+    /** Loading the new ppl, swapping them in, waiting for finds to be done
+        with the old ppl, and freeing them. */
+    std::chrono::steady_clock::duration load;
+    std::chrono::steady_clock::duration swap;
+    std::chrono::steady_clock::duration drain;
+    std::chrono::steady_clock::duration free;
+  } last_reload_;
+
+
+  std::shared_ptr<engine::PplmeMatchingPplProvider> GetLocalPplProvider()
+      const {
+    return std::atomic_load(&local_ppl_provider_);
+  }
+
+
+  /** @returns  Whichever provider finds ppl for us, held on to for as long
+                as the caller needs it (even if it's reloaded meanwhile). */
+  std::shared_ptr<core::MatchingPplProvider const> GetMatchingPplProvider()
+      const {
+    if (sharded_ppl_provider_)
+      return sharded_ppl_provider_;
+    return GetLocalPplProvider();
+  }
+
+
+  void LogStatsPeriodically() {
+    std::unique_lock<std::mutex> lock(stats_mutex_);
+    while (!stats_condvar_.wait_for(lock,
+                                    stats_interval_,
+                                    [this]() { return stopping_; }))
+      LogStats();
+  }
+
+
+  void CheckpointPeriodically() {
+    std::unique_lock<std::mutex> lock(stats_mutex_);
+    while (!stats_condvar_.wait_for(lock,
+                                    checkpoint_interval_,
+                                    [this]() { return stopping_; })) {
+      // (A checkpoint takes a while, and shouldn't hold up the stats.)
+      lock.unlock();
+      LOG_IF(WARNING, !Checkpoint()) << "Checkpoint failed; will try again";
+      lock.lock();
+    }
+  }
+
+
+  void LogStats() const {
+    auto const admission_stats = admission_controller_.GetStats();
+    LOG(INFO) << "Stats: in_flight=" << admission_stats.in_flight
+              << " max_in_flight=" << admission_stats.max_in_flight
+              << " queued=" << admission_stats.queued
+              << " max_queue_ms="
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     admission_stats.max_queue_time).count()
+              << " admitted=" << admission_stats.admitted_count
+              << " rejected=" << admission_stats.rejected_count;
+    LOG(INFO) << "Stats: queue_wait: " << queue_wait_;
+    LOG(INFO) << "Stats: find_time: " << find_time_;
+    LOG(INFO) << "Stats: encode_time: " << encode_time_;
+    LOG(INFO) << "Stats: total_time: " << total_time_;
+    if (sharded_ppl_provider_) {
+      auto const shard_stats = sharded_ppl_provider_->GetStats();
+      LOG(INFO) << "Stats: shard_requests=" << shard_stats.shard_requests
+                << " shard_failures=" << shard_stats.shard_failures
+                << " ppl_gathered=" << shard_stats.ppl_gathered
+                << " ppl_merged=" << shard_stats.ppl_merged;
+      return;
+    }
+    if (change_log_) {
+      LOG(INFO) << "Stats: change_log_sequence="
+                << change_log_->GetLatestSequence();
+    }
+    if (wal_) {
+      auto const wal_stats = wal_->GetStats();
+      LOG(INFO) << "Stats: wal_sequence=" << wal_stats.sequence
+                << " wal_snapshot_sequence=" << wal_stats.snapshot_sequence
+                << " wal_records=" << wal_stats.records
+                << " wal_commits=" << wal_stats.commits
+                << " wal_committed_octets=" << wal_stats.committed_octets;
+    }
+    if (change_feed_follower_) {
+      auto const status = change_feed_follower_->GetStatus();
+      LOG(INFO) << "Stats: applied_sequence=" << status.applied_sequence
+                << " writer_sequence=" << status.latest_sequence
+                << " behind="
+                << status.latest_sequence - status.applied_sequence
+                << " since_contact_ms=" << status.since_contact.count()
+                << " derailed=" << status.derailed;
+    }
+    /* lock block */ {
+      std::unique_lock<std::mutex> lock(reload_mutex_);
+      if (reload_count_ > 0 || reload_failure_count_ > 0) {
+        using std::chrono::duration_cast;
+        using std::chrono::microseconds;
+        using std::chrono::milliseconds;
+        LOG(INFO) << "Stats: reloads=" << reload_count_
+                  << " reload_failures=" << reload_failure_count_
+                  << " reloading=" << reloading_
+                  << " last_reload_load_ms="
+                  << duration_cast<milliseconds>(last_reload_.load).count()
+                  << " last_reload_swap_us="
+                  << duration_cast<microseconds>(last_reload_.swap).count()
+                  << " last_reload_drain_ms="
+                  << duration_cast<milliseconds>(last_reload_.drain).count()
+                  << " last_reload_free_ms="
+                  << duration_cast<milliseconds>(last_reload_.free).count();
+      }
+    }
+    auto const engine_stats = GetLocalPplProvider()->GetStats();
+    LOG(INFO) << "Stats: cells_visited=" << engine_stats.cells_visited
+              << " cells_skipped=" << engine_stats.cells_skipped
+              << " ppl_scanned=" << engine_stats.ppl_scanned
+              << " ppl_matched=" << engine_stats.ppl_matched;
+    LOG(INFO) << "Stats: storage_octets=" << engine_stats.storage_octets
+              << " storage_mapped_octets="
+              << engine_stats.storage_mapped_octets
+              << " storage_huge_page_octets="
+              << engine_stats.storage_huge_page_octets
+              << " memory_available="
+              << utils::GetAvailableMemory().value_or(0);
+  }
 
   
-  void PopulateTestDb() {
+  /** @returns  Null if there are no shards in @a options (or if they're no
+                good). */
+  static std::unique_ptr<shard::ShardedMatchingPplProvider>
+  CreateShardedPplProvider(Options const& options) {
+    std::unique_ptr<shard::ShardedMatchingPplProvider> provider;
+    auto const& shards = options.shards;
+    if (!shards.empty()) {
+      auto shard_map = shard::ShardMap::Parse(shards);
+      if (shard_map) {
+        LOG(INFO) << "Coordinating " << shard_map->backends().size()
+                  << " shards over " << shard_map->ranges().size()
+                  << " ranges";
+        provider.reset(new shard::ShardedMatchingPplProvider{
+            std::move(*shard_map),
+            options.max_ppl,
+            std::chrono::milliseconds{options.shard_timeout_ms},
+            boost::numeric_cast<unsigned int>(options.shard_askers)});
+      } else {
+        LOG(ERROR) << "Failed to make sense of shards `" << shards << "'";
+      }
+    }
+    return provider;
+  }
+
+
+  /** Start following the writer at replicate_from_, and wait until we've
+      caught up with it. */
+  bool FollowWriter() {
+    auto const colon = replicate_from_.rfind(':');
+    char* end = nullptr;
+    auto const port = colon == std::string::npos ?
+        0 : strtoul(replicate_from_.c_str() + colon + 1, &end, 10);
+    if (colon == 0 || port == 0 || port > 65535 || *end != '\0') {
+      LOG(ERROR) << "Failed to make sense of writer `" << replicate_from_
+                 << "'";
+      return false;
+    }
+
+    change_feed_follower_.reset(new repl::ChangeFeedFollower{
+        replicate_from_.substr(0, colon),
+        boost::numeric_cast<unsigned short>(port),
+        local_ppl_provider_.get()});
+    change_feed_follower_->Start();
+    LOG(INFO) << "Catching up with writer " << replicate_from_ << "...";
+    if (!change_feed_follower_->WaitUntilCaughtUp()) {
+      LOG(ERROR) << "Failed to catch up with writer " << replicate_from_;
+      return false;
+    }
+    LOG(INFO) << "Caught up with writer " << replicate_from_ << " at "
+              << change_feed_follower_->GetStatus().applied_sequence;
+    return true;
+  }
+
+
+  /** If we're a writer, then log @a ppl (our database) as having been added,
+      so that replicas get them along with everything else. */
+  void LogPplAdded(std::vector<std::unique_ptr<core::Person>> const& ppl) {
+    if (!change_log_)
+      return;
+    std::vector<std::string> mutations;
+    for (auto const& person : ppl) {
+      proto::PplMutation mutation_pb;
+      proto::Convert(*person, mutation_pb.mutable_added());
+      mutations.push_back(mutation_pb.SerializeAsString());
+      if (mutations.size() == kPplPerChangeLogAppend) {
+        change_log_->Append(mutations);
+        mutations.clear();
+      }
+    }
+    change_log_->Append(mutations);
+  }
+
+
+  /** Make (and log as having been made) whatever mutations are in the
+      write-ahead log. */
+  bool ReplayWal() {
+    LOG(INFO) << "Replaying the write-ahead log...";
+    auto const then = std::chrono::steady_clock::now();
+    uint64_t replayed = 0;
+    auto const ok = wal_->Replay(
+        [this, &replayed](std::vector<std::string> const& records) {
+          std::vector<core::PplMutation> mutations(records.size());
+          for (size_t n = 0; n < records.size(); ++n) {
+            proto::PplMutation mutation_pb;
+            if (!mutation_pb.ParseFromString(records[n])
+                || !proto::Convert(mutation_pb, &mutations[n])) {
+              LOG(ERROR) << "Invalid ppl mutation in the write-ahead log";
+              return false;
+            }
+          }
+          local_ppl_provider_->ApplyPplMutations(std::move(mutations));
+          change_log_->Append(records);
+          replayed += records.size();
+          return true;
+        });
+    if (!ok) {
+      LOG(ERROR) << "Failed to replay the write-ahead log";
+      return false;
+    }
+    LOG(INFO) << "Replayed " << replayed << " ppl mutations in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - then).count()
+              << "ms";
+    return true;
+  }
+
+
+  /** Snapshot everyone into the write-ahead log (holding off mutations, but
+      not finds, in the meantime). */
+  bool Checkpoint() {
+    std::unique_lock<std::mutex> lock(mutations_mutex_);
+    return wal_->Checkpoint(
+        [this](std::function<void (std::string const&)> const& write) {
+          local_ppl_provider_->VisitAllPpl(
+              [&write](core::Person const& person) {
+                proto::PplMutation mutation_pb;
+                proto::Convert(person, mutation_pb.mutable_added());
+                write(mutation_pb.SerializeAsString());
+              });
+        });
+  }
+
+
+  /** @returns  An empty provider, as per our grid parameters. */
+  std::shared_ptr<engine::PplmeMatchingPplProvider> CreateLocalPplProvider()
+      const {
+    return std::make_shared<engine::PplmeMatchingPplProvider>(
+        grid_resolution_,
+        max_age_difference_,
+        max_ppl_,
+        boost::none,
+        &GetTodaysDate,
+        grid_partitions_);
+  }
+
+
+  /** Fill @a provider with the ppl in @a ppldata_filename, or with test ppl
+      if it's empty.  @returns  False iff the file couldn't be (fully)
+      loaded. */
+  bool Populate(engine::PplmeMatchingPplProvider* provider,
+                std::string const& ppldata_filename) {
+    if (ppldata_filename.empty()) {
+      LOG(INFO) << "Generating ppl test data...";
+      PopulateTestDb(provider);
+      return true;
+    }
+
+    auto ok = true;
+    engine::PplSlurper slurper{ppldata_filename};
+    LOG(INFO) << "Loading ppl data from `" << ppldata_filename << "'...";
+    // Everyone's slurped first and then added in one go (see PopulateTestDb
+    // for why).
+    PplCollector ppl_collector;
+    if (!slurper.Populate(&ppl_collector)) {
+      LOG(ERROR) << "Failed to load ppl data from `"
+                 << ppldata_filename << "'";
+      ok = false;
+    }
+    LogPplAdded(ppl_collector.ppl);
+    provider->AddPpl(std::move(ppl_collector.ppl));
+    return ok;
+  }
+
+
+  void PopulateTestDb(engine::PplmeMatchingPplProvider* provider) {
+    // Making up ppl is the slow bit, so each thread makes up its share (with
+    // its own RNGs), and then they're all added in one go, which sorts each
+    // cell once rather than inserting everyone in order (and which, with a
+    // partitioned grid, puts them on their partitions' NUMA nodes).
+    auto const threads = std::max(1u, std::min(
+        std::thread::hardware_concurrency(),
+        boost::numeric_cast<unsigned int>(
+            std::max(1, test_db_size_ / kMinTestPplPerThread))));
+    auto const today = GetTodaysDate();
+    std::vector<std::vector<std::unique_ptr<core::Person>>> batches(threads);
+    std::vector<std::thread> populators;
+    for (unsigned int n = 0; n < threads; ++n) {
+      populators.emplace_back([this, n, threads, today, &batches]() {
+          int const first = boost::numeric_cast<int>(
+              int64_t{test_db_size_} * n / threads);
+          int const end = boost::numeric_cast<int>(
+              int64_t{test_db_size_} * (n + 1) / threads);
+          batches[n] = CreateTestPpl(first, end, n, today);
+        });
+    }
+    for (auto& populator : populators)
+      populator.join();
+
+    std::vector<std::unique_ptr<core::Person>> ppl;
+    ppl.reserve(test_db_size_);
+    for (auto& batch : batches) {
+      std::move(begin(batch), end(batch), std::back_inserter(ppl));
+      batch.clear();
+    }
+    LogPplAdded(ppl);
+    provider->AddPpl(std::move(ppl));
+  }
+
+
+  /** @returns  Test ppl numbers @a first up to @a end, randomized by
+                @a seed. */
+  static std::vector<std::unique_ptr<core::Person>> CreateTestPpl(
+      int first, int end, unsigned int seed, boost::gregorian::date today) {
     boost::uuids::random_generator random_uuid_generator;
 
-    std::default_random_engine random_engine;
+    std::default_random_engine random_engine{seed};
     std::uniform_int_distribution<int> random_age{-100 * 365, -18 * 365};
     std::uniform_real_distribution<float> random_latitude{-90, 90};
     std::uniform_real_distribution<float> random_longitude{-180, 180};
 
-    for (int i = 0; i < test_db_size_; ++i) {
-      auto random_dob = GetTodaysDate() +
-          boost::gregorian::days{random_age(random_engine)};
+    std::vector<std::unique_ptr<core::Person>> ppl;
+    ppl.reserve(end - first);
+    for (int i = first; i < end; ++i) {
+      auto random_dob =
+          today + boost::gregorian::days{random_age(random_engine)};
       core::GeoPosition random_location{
           core::GeoPosition::DecimalLatitude{random_latitude(random_engine)},
           core::GeoPosition::DecimalLongitude{random_longitude(random_engine)}};
-      std::unique_ptr<core::Person> person{new core::Person{
+      ppl.emplace_back(new core::Person{
           core::PersonId{random_uuid_generator()},
           std::string{u8"John Malkovich " + std::to_string(i)},
-              random_dob,
-                  random_location}};
-
-      matching_ppl_provider_.AddPerson(std::move(person));
+          random_dob,
+          random_location});
     }
+    return ppl;
   }
 
 
@@ -134,13 +653,56 @@ class Server::Impl {
       return oss.str();
     }();
 
-    // First off, do some basic validation on the protobuf request.
-    proto::Request request_pb;
+    // All of the protobuf messages for this request live on a per-request
+    // arena, whose first block is a pooled buffer, so parsing the request is
+    // pointer-bumping rather than a malloc() per submessage.
+    auto arena_block =
+        net::BufferPool::GetDefault().Acquire(kArenaInitialBlockSize);
+    google::protobuf::ArenaOptions arena_options;
+    arena_options.initial_block = reinterpret_cast<char*>(arena_block.get());
+    arena_options.initial_block_size = kArenaInitialBlockSize;
+    google::protobuf::Arena arena{arena_options};
+
+    // Any deadline is relative to now(-ish), rather than to whenever we get
+    // around to actually finding ppl.
+    auto const received = std::chrono::steady_clock::now();
+
+    // First off, see what sort of request it is.
+    auto& request_pb =
+        *google::protobuf::Arena::CreateMessage<proto::Request>(&arena);
     if (!request_pb.ParseFromArray(request.GetBodyOctets(),
                                    request.GetHeader().GetBodyLength())) {
       LOG(WARNING) << "Ignoring malformed request from " << addressnport;
       return std::unique_ptr<net::Message>{};
     }
+    auto const parsed = std::chrono::steady_clock::now();
+    // A replica's request mostly waits for there to be something to tell
+    // it, so it doesn't count against max_in_flight.
+    if (request_pb.has_change_feed_request()) {
+      return HandleChangeFeedRequest(request_pb.change_feed_request(),
+                                     addressnport);
+    }
+    // Nor does a reload (which happens in the background).
+    if (request_pb.has_reload_request())
+      return HandleReloadRequest(request_pb.reload_request(), addressnport);
+
+    // If we're already up to our eyeballs, then say so before doing any real
+    // work (and before the request gets the chance to make matters worse).
+    auto const admission_ticket = admission_controller_.Admit();
+    auto const admitted = std::chrono::steady_clock::now();
+    queue_wait_.Record(admitted - parsed);
+    if (!admission_ticket) {
+      LOG(WARNING) << "Too busy for request from " << addressnport;
+      if (request_pb.ppl_mutations_size() > 0) {
+        proto::PplMutationResponse response_pb;
+        response_pb.set_busy(true);
+        return CreateResponse(response_pb);
+      }
+      return CreateBusyResponse();
+    }
+
+    if (request_pb.ppl_mutations_size() > 0)
+      return HandlePplMutations(request_pb.ppl_mutations(), addressnport);
     if (!request_pb.has_pplme_request()) {
       LOG(WARNING) << "Ignoring unknown request type from " << addressnport;
       return std::unique_ptr<net::Message>{};
@@ -152,54 +714,491 @@ class Server::Impl {
                    << addressnport;
       return std::unique_ptr<net::Message>{};
     }
+    // No mask means the whole of each Person, as it always used to.
+    auto fields = core::PersonFields::AllOfPerson();
+    if (request_pb.pplme_request().has_person_fields()
+        && !proto::Convert(request_pb.pplme_request().person_fields(),
+                           &fields)) {
+      LOG(WARNING) << "Ignoring invalid person fields in PplmeRequest from "
+                   << addressnport;
+      return std::unique_ptr<net::Message>{};
+    }
+    auto const& pplme_request_pb = request_pb.pplme_request();
+    core::PplMatchingParameters parameters{
+        location_of_user, pplme_request_pb.age_of_user()};
+    if (pplme_request_pb.has_limit())
+      parameters.set_limit(pplme_request_pb.limit());
+    if (pplme_request_pb.has_cursor()) {
+      core::PplCursor cursor{0, 0, 0};
+      if (!proto::Convert(pplme_request_pb.cursor(), &cursor)) {
+        LOG(WARNING) << "Ignoring invalid cursor in PplmeRequest from "
+                     << addressnport;
+        return std::unique_ptr<net::Message>{};
+      }
+      parameters.set_cursor(cursor);
+    }
+    if (pplme_request_pb.has_max_distance()) {
+      // (The negated comparison also catches NaN.)
+      if (!(pplme_request_pb.max_distance() > 0)) {
+        LOG(WARNING) << "Ignoring invalid max distance in PplmeRequest from "
+                     << addressnport;
+        return std::unique_ptr<net::Message>{};
+      }
+      parameters.set_max_distance(pplme_request_pb.max_distance());
+    }
+    if (pplme_request_pb.has_min_age())
+      parameters.set_min_age(pplme_request_pb.min_age());
+    if (pplme_request_pb.has_max_age())
+      parameters.set_max_age(pplme_request_pb.max_age());
+    if (parameters.min_age() && parameters.max_age()
+        && *parameters.min_age() > *parameters.max_age()) {
+      LOG(WARNING) << "Ignoring inverted age range in PplmeRequest from "
+                   << addressnport;
+      return std::unique_ptr<net::Message>{};
+    }
+    if (pplme_request_pb.has_deadline_ms()) {
+      parameters.set_deadline(
+          received + std::chrono::milliseconds(pplme_request_pb.deadline_ms()));
+    }
+    auto const request_number = ++request_count_;
+    std::shared_ptr<utils::Trace> trace;
+    if (pplme_request_pb.trace()
+        || (trace_sample_every_ != 0
+            && request_number % trace_sample_every_ == 0)) {
+      trace = std::make_shared<utils::Trace>(received);
+      parameters.set_trace(trace);
+    }
 
-    auto then = std::chrono::high_resolution_clock::now();
+    auto const then = std::chrono::steady_clock::now();
     
     // Okay, the PplmeRequest looks sound, let's see who we can find...
     LOG(INFO) << "Processing request from " << addressnport
               << " from user, " << request_pb.pplme_request().age_of_user()
               << " @ " << location_of_user.latitude()
               << ", " << location_of_user.longitude();
-    auto matching_ppl = matching_ppl_provider_.FindMatchingPpl(
-        core::PplMatchingParameters{
-            location_of_user, request_pb.pplme_request().age_of_user()});
-
-    auto now = std::chrono::high_resolution_clock::now();
-    auto took = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now - then);
-    VLOG(1) << "FindMatchinPpl() took " << took.count();
-    
-    // ...and smash each one into a PplmeResponse.
-    proto::PplmeResponse response_pb;
-    for (auto const& person : matching_ppl) {
-      auto person_pb = response_pb.mutable_ppl()->Add();
-      proto::Convert(person, person_pb);
+    net::BufferPool::Buffer response_body;
+    uint32_t response_size;
+    std::chrono::steady_clock::time_point found;
+    if (std::min(request_pb.max_response_version(), kMaxResponseVersion) >= 2) {
+      response_size = FindAndEncodeCompactPpl(
+          parameters, fields, &response_body, &found);
+    } else {
+      response_size =
+          FindAndEncodePpl(parameters, fields, &response_body, &found);
     }
-    auto response_body = net::Message::CreateBodyBuffer(response_pb.ByteSize());
-    response_pb.SerializeToArray(response_body.get(), response_pb.ByteSize());
+    auto const now = std::chrono::steady_clock::now();
+    find_time_.Record(found - then);
+    encode_time_.Record(now - found);
+    total_time_.Record(now - received);
+    if (trace) {
+      trace->AddSpan("Parse", received, parsed);
+      trace->AddSpan("Queue wait", parsed, admitted);
+      trace->AddSpan("Validate", admitted, then);
+      trace->AddSpan("Encode", found, now, {{"octets", response_size}});
+      trace->AddSpan("Request", received, now);
+      SaveTrace(*trace, addressnport);
+    }
+    auto const took = std::chrono::duration_cast<std::chrono::milliseconds>(
+        now - then);
+    VLOG(1) << "Finding and encoding took " << took.count();
 
     // Finally, return the PplmeResponse framed as a generic pplMe Message.  &%D
     return std::unique_ptr<net::Message>{new net::Message{
-        std::move(response_body),
-        boost::numeric_cast<uint32_t>(response_pb.ByteSize())}};
+        std::move(response_body), response_size}};
+  }
+
+
+  void SaveTrace(utils::Trace const& trace, std::string const& addressnport) {
+    auto const filename = trace_dir_ + "/pplme-trace-"
+        + std::to_string(getpid()) + "-" + std::to_string(++trace_count_)
+        + ".json";
+    std::ofstream json{filename};
+    trace.WriteJson(json);
+    json.close();
+    if (json)
+      LOG(INFO) << "Saved trace of request from " << addressnport
+                << " to `" << filename << "'";
+    else
+      LOG(WARNING) << "Failed to save trace to `" << filename << "'";
+  }
+
+
+  /** Make (all or none of) @a mutations_pb, if we're a writer. */
+  std::unique_ptr<net::Message> HandlePplMutations(
+      google::protobuf::RepeatedPtrField<proto::PplMutation> const&
+          mutations_pb,
+      std::string const& addressnport) {
+    proto::PplMutationResponse response_pb;
+    if (!change_log_) {
+      LOG(WARNING) << "Rejecting ppl mutations from " << addressnport
+                   << " (we're not a writer)";
+      response_pb.set_rejected(true);
+      return CreateResponse(response_pb);
+    }
+
+    // Each mutation is logged as we understood it, rather than as it was
+    // sent, so that replicas understand it the same way.
+    std::vector<core::PplMutation> mutations(mutations_pb.size());
+    std::vector<std::string> logged_mutations;
+    for (int n = 0; n < mutations_pb.size(); ++n) {
+      if (!proto::Convert(mutations_pb.Get(n), &mutations[n])) {
+        LOG(WARNING) << "Rejecting invalid ppl mutation from "
+                     << addressnport;
+        response_pb.set_rejected(true);
+        return CreateResponse(response_pb);
+      }
+      proto::PplMutation logged_mutation_pb;
+      proto::Convert(mutations[n], &logged_mutation_pb);
+      logged_mutations.push_back(logged_mutation_pb.SerializeAsString());
+    }
+
+    uint64_t sequence;
+    uint64_t wal_sequence = 0;
+    /* lock block */ {
+      std::unique_lock<std::mutex> lock(mutations_mutex_);
+      local_ppl_provider_->ApplyPplMutations(std::move(mutations));
+      sequence = change_log_->Append(logged_mutations);
+      if (wal_)
+        wal_sequence = wal_->Append(logged_mutations);
+    }
+    // Not until they're on disk do we say they've been made, but the wait
+    // is outside the lock, so that requests that come in meanwhile share
+    // the same sync.
+    if (wal_)
+      wal_->WaitForCommit(wal_sequence);
+    LOG(INFO) << "Made " << mutations_pb.size() << " ppl mutations from "
+              << addressnport << " (up to " << sequence << ")";
+    response_pb.set_sequence(sequence);
+    return CreateResponse(response_pb);
+  }
+
+
+  /** Tell a replica what's changed, if we're a writer. */
+  std::unique_ptr<net::Message> HandleChangeFeedRequest(
+      proto::ChangeFeedRequest const& change_feed_request_pb,
+      std::string const& addressnport) {
+    proto::ChangeFeedResponse response_pb;
+    if (!change_log_) {
+      LOG(WARNING) << "Rejecting change feed request from " << addressnport
+                   << " (we're not a writer)";
+      response_pb.set_rejected(true);
+      return CreateResponse(response_pb);
+    }
+
+    change_log_->Read(
+        change_feed_request_pb.after_sequence(),
+        std::chrono::milliseconds{std::min(change_feed_request_pb.wait_ms(),
+                                           kMaxChangeFeedWaitMs)},
+        &response_pb);
+    VLOG(1) << "Sending " << response_pb.mutations_size()
+            << " ppl mutations after "
+            << change_feed_request_pb.after_sequence() << " to "
+            << addressnport;
+    return CreateResponse(response_pb);
+  }
+
+
+  /** Start loading a fresh lot of ppl to swap in for ours, if we're neither
+      a coordinator, a writer, nor a read replica. */
+  std::unique_ptr<net::Message> HandleReloadRequest(
+      proto::ReloadRequest const& reload_request_pb,
+      std::string const& addressnport) {
+    proto::ReloadResponse response_pb;
+    StartReload(reload_request_pb.has_ppldata() ?
+                    boost::make_optional(reload_request_pb.ppldata()) :
+                    boost::optional<std::string>{},
+                addressnport,
+                &response_pb);
+    return CreateResponse(response_pb);
+  }
+
+
+  /** Start reloading from @a ppldata_filename (or from wherever we loaded
+      from last), on behalf of @a requester, and say how it went in
+      @a response_pb. */
+  void StartReload(boost::optional<std::string> const& ppldata_filename,
+                   std::string const& requester,
+                   proto::ReloadResponse* response_pb) {
+    if (!GetLocalPplProvider() || change_log_ || !replicate_from_.empty()) {
+      LOG(WARNING) << "Rejecting reload request from " << requester
+                   << " (we've no dataset of our own to reload)";
+      response_pb->set_rejected(true);
+      return;
+    }
+
+    // The old ppl and the new are both in memory until the swap, so it's
+    // worth knowing whether there's room.
+    auto const storage_octets =
+        GetLocalPplProvider()->GetStats().storage_octets;
+    auto const memory_available = utils::GetAvailableMemory();
+    response_pb->set_storage_octets(storage_octets);
+    if (memory_available)
+      response_pb->set_memory_available(*memory_available);
+
+    std::unique_lock<std::mutex> lock(reload_mutex_);
+    if (reloading_) {
+      LOG(WARNING) << "Turning away reload request from " << requester
+                   << " (already reloading)";
+      response_pb->set_busy(true);
+      return;
+    }
+    auto const filename = ppldata_filename.value_or(ppldata_filename_);
+    LOG(INFO) << "Reloading ppl from "
+              << (filename.empty() ? "test data" : "`" + filename + "'")
+              << " for " << requester << " (" << storage_octets
+              << " octets in use, "
+              << (memory_available ?
+                      std::to_string(*memory_available) : "unknown")
+              << " available)";
+    LOG_IF(WARNING, memory_available && *memory_available < storage_octets)
+        << "There may not be room for the new ppl alongside the old";
+    reloading_ = true;
+    // (Any previous reload is done with, bar its thread's exit.)
+    if (reload_thread_.joinable())
+      reload_thread_.join();
+    reload_thread_ = std::thread{[this, filename]() { Reload(filename); }};
+    response_pb->set_started(true);
+  }
+
+
+  /** Load the ppl in @a ppldata_filename (or test ppl), and swap them in for
+      ours. */
+  void Reload(std::string const& ppldata_filename) {
+    auto const then = std::chrono::steady_clock::now();
+    auto provider = CreateLocalPplProvider();
+    if (!Populate(provider.get(), ppldata_filename)) {
+      LOG(ERROR) << "Reload failed; keeping the ppl that we have";
+      std::unique_lock<std::mutex> lock(reload_mutex_);
+      reloading_ = false;
+      ++reload_failure_count_;
+      return;
+    }
+    auto const loaded = std::chrono::steady_clock::now();
+
+    // Finds already under way carry on with the old ppl, which they have
+    // hold of, and finds from here on get the new ones.
+    auto old_provider =
+        std::atomic_exchange(&local_ppl_provider_, std::move(provider));
+    auto const swapped = std::chrono::steady_clock::now();
+
+    // Once the last of those finds lets go, nothing else can get hold of
+    // the old ppl, and they're freed here (rather than holding up some
+    // unlucky find).
+    while (old_provider.use_count() > 1)
+      std::this_thread::sleep_for(kReloadDrainPollInterval);
+    auto const drained = std::chrono::steady_clock::now();
+    old_provider.reset();
+    auto const freed = std::chrono::steady_clock::now();
+
+    ReloadTimes const times{
+        loaded - then, swapped - loaded, drained - swapped, freed - drained};
+    /* lock block */ {
+      std::unique_lock<std::mutex> lock(reload_mutex_);
+      reloading_ = false;
+      ++reload_count_;
+      ppldata_filename_ = ppldata_filename;
+      last_reload_ = times;
+    }
+    LOG(INFO) << "Reloaded ppl (loaded in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     times.load).count()
+              << "ms, swapped in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(
+                     times.swap).count()
+              << "us, old ppl let go of after "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     times.drain).count()
+              << "ms and freed in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     times.free).count()
+              << "ms)";
+  }
+
+
+  static std::unique_ptr<net::Message> CreateBusyResponse() {
+    proto::PplmeResponse response_pb;
+    response_pb.set_busy(true);
+    return CreateResponse(response_pb);
+  }
+
+
+  /** @returns  @a response_pb, framed as a generic pplMe Message. */
+  static std::unique_ptr<net::Message> CreateResponse(
+      google::protobuf::MessageLite const& response_pb) {
+    auto const response_size =
+        boost::numeric_cast<uint32_t>(response_pb.ByteSize());
+    auto response_body = net::Message::CreateBodyBuffer(response_size);
+    response_pb.SerializeWithCachedSizesToArray(response_body.get());
+    return std::unique_ptr<net::Message>{new net::Message{
+        std::move(response_body), response_size}};
+  }
+
+
+  /** Visit each matching Person as a proto::PplEntry with (only) what's
+      needed for @a fields.  In particular, if none of the Person's own
+      fields are wanted then we needn't go anywhere near the Person.
+      Returns the next page's cursor, as encoded for a PplmeResponse (or
+      empty if there is no next page), in @a next_cursor, when the finding
+      was done in @a found, and whether the deadline cut things short. */
+  bool VisitMatchingPplEntries(
+      core::PplMatchingParameters const& parameters,
+      core::PersonFields const& fields,
+      std::function<void (proto::PplEntry const&)> const& unclocked_visitor,
+      std::string* next_cursor,
+      std::chrono::steady_clock::time_point* found) {
+    // The engine finds everyone before visiting anyone, so the first visit
+    // is where finding stops and encoding starts.
+    bool visited = false;
+    auto const visitor = [&](proto::PplEntry const& entry) {
+      if (!visited) {
+        visited = true;
+        *found = std::chrono::steady_clock::now();
+      }
+      unclocked_visitor(entry);
+    };
+    auto const& location_of_user = parameters.location_of_user();
+    auto const wants_distance = fields.Has(core::PersonField::Distance);
+    auto const matching_ppl_provider = GetMatchingPplProvider();
+    core::PplMatchingOutcome outcome;
+    if (fields.NeedsPerson()) {
+      outcome = matching_ppl_provider->VisitMatchingPpl(
+          parameters,
+          [&](core::Person const& person) {
+            visitor(proto::PplEntry{
+                person,
+                wants_distance ?
+                    core::ApproxDistanceBetween(location_of_user,
+                                                person.location_of_home()) :
+                    0.f});
+          });
+    } else {
+      outcome = matching_ppl_provider->VisitMatchingPplIds(
+          parameters,
+          [&](core::PersonId const& id,
+              core::GeoPosition const& location_of_home) {
+            visitor(proto::PplEntry{
+                id,
+                wants_distance ?
+                    core::ApproxDistanceBetween(location_of_user,
+                                                location_of_home) :
+                    0.f});
+          });
+    }
+
+    if (!visited)
+      *found = std::chrono::steady_clock::now();
+    next_cursor->clear();
+    if (outcome.next_cursor)
+      proto::Convert(*outcome.next_cursor, next_cursor);
+    if (outcome.partial)
+      LOG(INFO) << "Ran out of time; returning what we have so far";
+    return outcome.partial;
+  }
+
+
+  /** Make sure that @a response_body, which has @a response_size octets in
+      it already, has room for @a extra_size more. */
+  static void ReserveResponseBody(uint32_t response_size,
+                                  uint32_t extra_size,
+                                  uint32_t* response_capacity,
+                                  net::BufferPool::Buffer* response_body) {
+    if (response_size + extra_size > *response_capacity) {
+      while (response_size + extra_size > *response_capacity)
+        *response_capacity *= 2;
+      auto bigger_body = net::Message::CreateBodyBuffer(*response_capacity);
+      memcpy(bigger_body.get(), response_body->get(), response_size);
+      *response_body = std::move(bigger_body);
+    }
+  }
+
+
+  /** Version 1: each matching Person is encoded as a PplmeResponse `ppl'
+      entry straight out of the engine's storage and into a pooled body
+      buffer, so there are no intermediate core::Person or proto::Person
+      copies along the way. */
+  uint32_t FindAndEncodePpl(core::PplMatchingParameters const& parameters,
+                            core::PersonFields const& fields,
+                            net::BufferPool::Buffer* response_body,
+                            std::chrono::steady_clock::time_point* found) {
+    uint32_t response_capacity = kInitialResponseBodySize;
+    *response_body = net::Message::CreateBodyBuffer(response_capacity);
+    uint32_t response_size = 0;
+    std::string next_cursor;
+    auto const partial = VisitMatchingPplEntries(
+        parameters,
+        fields,
+        [&fields, &response_capacity, response_body, &response_size](
+            proto::PplEntry const& entry) {
+          auto const entry_size = boost::numeric_cast<uint32_t>(
+              proto::GetEncodedPplEntrySize(entry, fields));
+          ReserveResponseBody(
+              response_size, entry_size, &response_capacity, response_body);
+          proto::EncodePplEntry(
+              entry, fields, response_body->get() + response_size);
+          response_size += entry_size;
+        },
+        &next_cursor,
+        found);
+
+    auto const tail_size = GetEncodedTailSize(next_cursor, partial);
+    ReserveResponseBody(
+        response_size, tail_size, &response_capacity, response_body);
+    EncodeTail(next_cursor, partial, response_body->get() + response_size);
+    response_size += tail_size;
+
+    return response_size;
+  }
+
+
+  /** Version 2: the matching ppl are gathered column-wise and then encoded
+      as a PplmeResponse `compact_ppl' in one go. */
+  uint32_t FindAndEncodeCompactPpl(
+      core::PplMatchingParameters const& parameters,
+      core::PersonFields const& fields,
+      net::BufferPool::Buffer* response_body,
+      std::chrono::steady_clock::time_point* found) {
+    proto::CompactPplEncoder encoder{fields};
+    std::string next_cursor;
+    auto const partial = VisitMatchingPplEntries(
+        parameters,
+        fields,
+        [&encoder](proto::PplEntry const& entry) {
+          encoder.Add(entry);
+        },
+        &next_cursor,
+        found);
+    auto const response_size = boost::numeric_cast<uint32_t>(
+        encoder.GetEncodedSize() + GetEncodedTailSize(next_cursor, partial));
+    *response_body = net::Message::CreateBodyBuffer(response_size);
+    EncodeTail(next_cursor, partial, encoder.Encode(response_body->get()));
+    return response_size;
+  }
+
+
+  /** The size of what goes after the ppl, whichever the version. */
+  static uint32_t GetEncodedTailSize(std::string const& next_cursor,
+                                     bool partial) {
+    return boost::numeric_cast<uint32_t>(
+        (next_cursor.empty() ?
+             0 : proto::GetEncodedNextCursorSize(next_cursor))
+        + (partial ? proto::GetEncodedPartialSize() : 0));
+  }
+
+
+  /** Encode what goes after the ppl, whichever the version. */
+  static void EncodeTail(std::string const& next_cursor,
+                         bool partial,
+                         uint8_t* target) {
+    if (!next_cursor.empty())
+      target = proto::EncodeNextCursor(next_cursor, target);
+    if (partial)
+      proto::EncodePartial(target);
   }
 };
 
 
-Server::Server(
-    int port,
-    int test_db_size,
-    int grid_resolution,
-    int max_distance,
-    int max_age_difference,
-    std::string const& ppldata_filename) :
-    impl_{new Impl{
-        port,
-        test_db_size,
-        grid_resolution,
-        max_distance,
-        max_age_difference,
-        ppldata_filename}} {}
+Server::Server(Options const& options) :
+    impl_{new Impl{options}} {}
 
 
 bool Server::Go() {
@@ -207,6 +1206,16 @@ bool Server::Go() {
 }
 
 
+bool Server::Drain(std::chrono::milliseconds budget) {
+  return impl_->Drain(budget);
+}
+
+
+bool Server::Reload() {
+  return impl_->Reload();
+}
+
+
 Server::~Server() = default;
 
 
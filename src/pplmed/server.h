@@ -7,7 +7,9 @@
 #define PPLME_PPLMED_SERVER_H_
 
 
+#include <chrono>
 #include <string>
+#include "libpplmenet/backend.h"
 #include "libpplmeutils/pimpl.h"
 
 
@@ -21,31 +23,88 @@ namespace pplme {
  */
 class Server {
  public:
-  /**
-   *  @param  port is the TCP port to listen on for pplMe Requests.
-   *  @param  test_db_size is the number of random entries that should be
-   *          smashed into the pplMe test database.  This value is ignored if
-   *          @a ppldata is non-empty.
-   *  @param  grid_resolution is the number of cells per decimal degree (in
-   *          each "dimension").
-   *  @param  max_ppl is the maximum number of ppl to return to a query.
-   *  @param  max_age_difference is the maximum number of years difference in
-   *          age for a person to be considered a match.
-   *  @param  ppldata_filename is the name of a CSV file that is used to
-   *          populate the pplMe database.  If empty, then randomized test data
-   *          is used instead.
-   */
-  Server(
-      int port,
-      int test_db_size,
-      int grid_resolution,
-      int max_ppl,
-      int max_age_difference,
-      std::string const& ppldata_filename);
+  /** How a Server goes about its business (by and large, pplmed's flags,
+      and defaulting to the same). */
+  struct Options {
+    /** The TCP port to listen on for pplMe Requests. */
+    int port = 3333;
+    /** The number of random entries that should be smashed into the pplMe
+        test database (ignored if @a ppldata_filename is non-empty). */
+    int test_db_size = 10000000;
+    /** The number of cells per decimal degree (in each "dimension"). */
+    int grid_resolution = 10;
+    /** The maximum number of ppl to return to a query (or to a page of
+        one); requests may ask for fewer, but not more. */
+    int max_ppl = 10;
+    /** The maximum number of years difference in age for a person to be
+        considered a match. */
+    int max_age_difference = 10;
+    /** The name of a CSV file that is used to populate the pplMe database.
+        If empty, then randomized test data is used instead. */
+    std::string ppldata_filename;
+    /** The most requests to work on at once (0 means no limit). */
+    int max_in_flight = 64;
+    /** How long a request may wait for one of those before it's turned
+        away as busy. */
+    int max_queue_ms = 100;
+    /** How often (in seconds) to log the server's stats (0 means never). */
+    int stats_interval_s = 60;
+    /** Where traces of requests are saved, as Chrome trace-event JSON. */
+    std::string trace_dir = "/tmp";
+    /** How often to trace a request even if it didn't ask to be (e.g., 1000
+        means one in every thousand; 0 means never). */
+    int trace_sample_every = 0;
+    /** Whether clients may send more than one request per connection. */
+    bool keep_alive = false;
+    /** How many partitions to split the grid into (0 means one per NUMA
+        node, each on its own node); see engine::PplmeMatchingPplProvider. */
+    int grid_partitions = 1;
+    /** If non-empty, makes this server a coordinator: rather than having any
+        ppl of its own, it asks the shards (other pplmeds) in this
+        shard::ShardMap for them, and all of the database and grid options
+        are ignored. */
+    std::string shards;
+    /** As a coordinator, the longest to wait on the shards for a query;
+        see shard::ShardedMatchingPplProvider. */
+    int shard_timeout_ms = 1000;
+    /** As a coordinator, how many shards may be being asked at once. */
+    int shard_askers = 64;
+    /** Makes this server a writer: ppl may be added to it and removed from
+        it (by way of Request ppl_mutations), and it keeps a
+        repl::ChangeLog of everyone that it has ever had, starting with its
+        database, for read replicas to follow. */
+    bool writer = false;
+    /** If non-empty, is the HOST:PORT of a writer to follow, making this
+        server a read replica of it: the writer's ppl are this server's ppl,
+        so the database options are ignored. */
+    std::string replicate_from;
+    /** If non-empty, is the directory of a writer's repl::WriteAheadLog, so
+        that it keeps its ppl across restarts: once there's a snapshot
+        there, the database options are ignored. */
+    std::string wal_dir;
+    /** How often (in seconds) to snapshot into the write-ahead log (0 means
+        never, bar at the outset). */
+    int checkpoint_interval_s = 3600;
+    /** How many sockets (and threads) to accept connections on; see
+        net::SingleShotServer. */
+    int acceptors = 1;
+    /** How to accept connections and do their I/O. */
+    net::Backend net_backend = net::Backend::Epoll;
+  };
+
+  explicit Server(Options const& options);
   ~Server();
 
   /** Go, pplMe, go! */
   bool Go();
+
+  /** Stop taking requests, and give those under way up to @a budget to be
+      answered.  @returns  True iff they all were. */
+  bool Drain(std::chrono::milliseconds budget);
+
+  /** Start reloading our ppl from wherever we loaded them from last (just as
+      a Request reload_request does).  @returns  True iff it was started. */
+  bool Reload();
   
  private:
   class Impl;
@@ -0,0 +1,296 @@
+/**
+ *  @file
+ *  @brief   Definition of pplme::GeneratePplDataset().
+ *  @author  j.ho
+ */
+
+
+#include "generate_ppl_dataset.h"
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glog/logging.h>
+
+
+namespace {
+
+
+struct Country {
+  float latitude;
+  float longitude;
+  /** Internet users, in millions, which is what ppl are allocated by. */
+  float internet_users;
+  /** In km^2. */
+  float area;
+};
+
+
+/** Roughly the CIA World Factbook's figures (circa when the Python version
+    was written), for the countries that account for the vast majority of
+    Internet users, plus a few chilly ones for the sake of the sqiral. */
+Country const kCountries[] = {
+  { 35.0f,  103.0f, 626.0f,  9596961},  // China
+  { 38.0f,  -97.0f, 277.0f,  9826675},  // United States
+  { 20.0f,   77.0f, 243.0f,  3287263},  // India
+  { 36.0f,  138.0f, 109.0f,   377915},  // Japan
+  {-10.0f,  -55.0f, 108.0f,  8514877},  // Brazil
+  { 60.0f,  100.0f,  84.0f, 17098242},  // Russia
+  { 51.0f,    9.0f,  71.0f,   357022},  // Germany
+  { 10.0f,    8.0f,  67.0f,   923768},  // Nigeria
+  { 54.0f,   -2.0f,  57.0f,   243610},  // United Kingdom
+  { 46.0f,    2.0f,  55.0f,   643801},  // France
+  { 23.0f, -102.0f,  50.0f,  1964375},  // Mexico
+  { 37.0f,  127.5f,  45.0f,    99720},  // South Korea
+  { -5.0f,  120.0f,  42.0f,  1904569},  // Indonesia
+  { 16.2f,  107.8f,  40.0f,   331210},  // Vietnam
+  { 27.0f,   30.0f,  40.0f,  1001450},  // Egypt
+  { 13.0f,  122.0f,  38.0f,   300000},  // Philippines
+  { 39.0f,   35.0f,  36.0f,   783562},  // Turkey
+  { 42.8f,   12.8f,  36.0f,   301340},  // Italy
+  { 40.0f,   -4.0f,  35.0f,   505370},  // Spain
+  { 60.0f,  -95.0f,  33.0f,  9984670},  // Canada
+  { 32.0f,   53.0f,  30.0f,  1648195},  // Iran
+  {-34.0f,  -64.0f,  30.0f,  2780400},  // Argentina
+  {  4.0f,  -72.0f,  27.0f,  1138910},  // Colombia
+  { 52.0f,   20.0f,  25.0f,   312685},  // Poland
+  {-29.0f,   24.0f,  25.0f,  1219090},  // South Africa
+  { 30.0f,   70.0f,  25.0f,   796095},  // Pakistan
+  { 15.0f,  100.0f,  23.0f,   513120},  // Thailand
+  {  2.5f,  112.5f,  20.0f,   329847},  // Malaysia
+  {-27.0f,  133.0f,  20.0f,  7741220},  // Australia
+  { 49.0f,   32.0f,  20.0f,   603550},  // Ukraine
+  { 25.0f,   45.0f,  18.0f,  2149690},  // Saudi Arabia
+  { 32.0f,   -5.0f,  17.0f,   446550},  // Morocco
+  { 24.0f,   90.0f,  17.0f,   143998},  // Bangladesh
+  {  1.0f,   38.0f,  16.0f,   580367},  // Kenya
+  { 52.5f,   5.75f,  16.0f,    41543},  // Netherlands
+  {  8.0f,  -66.0f,  14.0f,   912050},  // Venezuela
+  {-10.0f,  -76.0f,  12.0f,  1285216},  // Peru
+  {-30.0f,  -71.0f,  12.0f,   756102},  // Chile
+  { 62.0f,   15.0f,   9.0f,   450295},  // Sweden
+  { 62.0f,   10.0f,   5.0f,   323802},  // Norway
+  {-41.0f,  174.0f,   4.0f,   267710},  // New Zealand
+  { 65.0f,  -18.0f,   0.3f,   103000},  // Iceland
+  { 72.0f,  -40.0f,  0.04f,  2166086},  // Greenland
+};
+
+
+char const* const kFirstNames[] = {
+  "Ardis", "Borence", "Cecily", "Desmond", "Ethel", "Fergus", "Gwendolyn",
+  "Horatio", "Imelda", "Jasper", "Kezia", "Lancelot", "Mavis", "Norbert",
+  "Ottoline", "Percival", "Queenie", "Rupert", "Sybil", "Tobias", "Ursula",
+  "Vernon", "Wilhelmina", "Xavier", "Yolanda", "Zebedee", "John", "Jo",
+};
+
+
+char const* const kLastNames[] = {
+  "Bergen", "Claddicker", "Malkovich", "Featherstonehaugh", "Ho", "Smith",
+  "Pemberton", "Quigley", "Ramsbottom", "Sidebottom", "Trotter", "Umfreville",
+  "Vavasour", "Winterbottom", "Yelland", "Zouche", "Abernethy", "Blenkinsop",
+  "Cholmondeley", "Dalrymple", "Entwistle", "Fothergill", "Grimshaw",
+  "Higginbottom", "Illingworth", "Jarndyce", "Kettlewell", "Lightfoot",
+};
+
+
+/** Ppl are generated (and written out) in chunks of this many, each from its
+    own RNG, which is what keeps the output the same regardless of how many
+    threads there are. */
+uint64_t const kChunkSize = 64 * 1024;
+
+/** How many chunks may be generated ahead of the one being written, per
+    thread (so that memory use is bounded, even if output is slow). */
+unsigned int const kChunksAheadPerThread = 4;
+
+/** Kilometres per degree of latitude (near enough). */
+double const kKmPerDegree = 111.0;
+
+
+class ChunkGenerator {
+ public:
+  ChunkGenerator(uint64_t count, uint64_t seed, boost::gregorian::date today) :
+      count_{count},
+      seed_{seed},
+      today_{today},
+      country_weights_{[]() {
+          std::vector<double> weights;
+          for (auto const& country : kCountries)
+            weights.push_back(country.internet_users);
+          return weights;
+        }()} {}
+
+
+  uint64_t GetChunkCount() const {
+    return (count_ + kChunkSize - 1) / kChunkSize;
+  }
+
+
+  std::string Generate(uint64_t chunk) const {
+    std::seed_seq seeds{
+        static_cast<uint32_t>(seed_), static_cast<uint32_t>(seed_ >> 32),
+        static_cast<uint32_t>(chunk), static_cast<uint32_t>(chunk >> 32)};
+    std::mt19937_64 random_engine{seeds};
+    std::discrete_distribution<size_t> random_country{
+        country_weights_.begin(), country_weights_.end()};
+    std::uniform_int_distribution<size_t> random_first_name{
+        0, std::extent<decltype(kFirstNames)>::value - 1};
+    std::uniform_int_distribution<size_t> random_last_name{
+        0, std::extent<decltype(kLastNames)>::value - 1};
+    std::uniform_int_distribution<int> random_age{-100 * 365, -18 * 365};
+    std::uniform_real_distribution<double> random_offset{-0.5, 0.5};
+
+    auto const begin = chunk * kChunkSize;
+    auto const end = std::min(count_, begin + kChunkSize);
+    std::string csv;
+    csv.reserve((end - begin) * 96);
+    for (auto n = begin; n < end; ++n) {
+      // A version 4 UUID, as per RFC 4122.
+      uint64_t const id_high =
+          (random_engine() & ~0xf000ULL) | 0x4000ULL;
+      uint64_t const id_low =
+          (random_engine() & ~(3ULL << 62)) | (2ULL << 62);
+
+      auto const& country = kCountries[random_country(random_engine)];
+      double const half_width_km = sqrt(country.area) / 2;
+      auto latitude = country.latitude
+          + 2 * half_width_km * random_offset(random_engine) / kKmPerDegree;
+      latitude = std::max(-90.0, std::min(90.0, latitude));
+      // Degrees of longitude get skinnier away from the equator, but not so
+      // skinny that a country wraps right round the world.
+      auto const km_per_degree_of_longitude = std::max(
+          kKmPerDegree * cos(latitude * M_PI / 180), half_width_km / 180);
+      auto longitude = country.longitude
+          + 2 * half_width_km * random_offset(random_engine)
+              / km_per_degree_of_longitude;
+      if (longitude < -180)
+        longitude += 360;
+      else if (longitude > 180)
+        longitude -= 360;
+
+      auto const dob = (today_ + boost::gregorian::days{
+          random_age(random_engine)}).year_month_day();
+      char const* const first_name =
+          kFirstNames[random_first_name(random_engine)];
+      char const* const last_name =
+          kLastNames[random_last_name(random_engine)];
+
+      char line[256];
+      auto const length = snprintf(
+          line, sizeof(line),
+          "%08x-%04x-%04x-%04x-%012llx,%s %s,%04d-%02d-%02d,%.6f,%.6f\n",
+          static_cast<unsigned int>(id_high >> 32),
+          static_cast<unsigned int>((id_high >> 16) & 0xffff),
+          static_cast<unsigned int>(id_high & 0xffff),
+          static_cast<unsigned int>(id_low >> 48),
+          static_cast<unsigned long long>(id_low & 0xffffffffffffULL),
+          first_name, last_name,
+          static_cast<int>(dob.year), static_cast<int>(dob.month),
+          static_cast<int>(dob.day),
+          latitude, longitude);
+      CHECK(length > 0 && length < static_cast<int>(sizeof(line)));
+      csv.append(line, length);
+    }
+    return csv;
+  }
+
+
+ private:
+  uint64_t const count_;
+  uint64_t const seed_;
+  boost::gregorian::date const today_;
+  std::vector<double> const country_weights_;
+};
+
+
+}  // namespace
+
+
+namespace pplme {
+
+
+bool GeneratePplDataset(
+    uint64_t count,
+    uint64_t seed,
+    unsigned int threads,
+    boost::gregorian::date today,
+    std::ostream& output) {
+  CHECK(threads > 0);
+
+  ChunkGenerator const generator{count, seed, today};
+  auto const chunk_count = generator.GetChunkCount();
+  auto const max_chunks_ahead = threads * kChunksAheadPerThread;
+
+  // The workers generate chunks in whatever order they get to them, and
+  // then this thread writes them out in the right one.
+  std::mutex mutex;
+  std::condition_variable condvar;
+  std::map<uint64_t, std::string> generated;
+  uint64_t next_to_write = 0;
+  bool failed = false;
+  std::atomic<uint64_t> next_to_generate{0};
+
+  std::vector<std::thread> workers;
+  for (unsigned int n = 0; n < threads; ++n) {
+    workers.emplace_back([&]() {
+        for (;;) {
+          auto const chunk = next_to_generate.fetch_add(1);
+          if (chunk >= chunk_count)
+            break;
+
+          /* lock block */ {
+            std::unique_lock<std::mutex> lock(mutex);
+            condvar.wait(lock, [&]() {
+                return failed || chunk < next_to_write + max_chunks_ahead;
+              });
+            if (failed)
+              break;
+          }
+
+          auto csv = generator.Generate(chunk);
+
+          /* lock block */ {
+            std::unique_lock<std::mutex> lock(mutex);
+            generated.emplace(chunk, std::move(csv));
+          }
+          condvar.notify_all();
+        }
+      });
+  }
+
+  while (!failed && next_to_write < chunk_count) {
+    std::string csv;
+    /* lock block */ {
+      std::unique_lock<std::mutex> lock(mutex);
+      condvar.wait(lock, [&]() { return generated.count(next_to_write); });
+      auto const chunk = generated.find(next_to_write);
+      csv = std::move(chunk->second);
+      generated.erase(chunk);
+    }
+
+    output.write(csv.data(), csv.size());
+
+    /* lock block */ {
+      std::unique_lock<std::mutex> lock(mutex);
+      failed = !output;
+      ++next_to_write;
+    }
+    condvar.notify_all();
+  }
+
+  for (auto& worker : workers)
+    worker.join();
+
+  if (failed)
+    LOG(ERROR) << "Failed to write out the dataset";
+  return !failed;
+}
+
+
+}  // namespace pplme
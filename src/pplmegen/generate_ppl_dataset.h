@@ -0,0 +1,47 @@
+/**
+ *  @file
+ *  @brief   Declaration of pplme::GeneratePplDataset(), the essence of
+ *           pplmegen.
+ *  @author  j.ho
+ */
+#ifndef PPLME_PPLMEGEN_GENERATEPPLDATASET_H_
+#define PPLME_PPLMEGEN_GENERATEPPLDATASET_H_
+
+
+#include <stdint.h>
+#include <ostream>
+#include <boost/date_time/gregorian/gregorian_types.hpp>
+
+
+namespace pplme {
+
+
+/**
+ *  Write a dataset of @a count vaguely real-looking ppl to @a output, as CSV
+ *  in the format that pplmed --ppldata (i.e., engine::PplSlurper) groks.
+ *
+ *  Ppl are spread over the world's countries in proportion to how many
+ *  Internet users each has, and then uniformly over each country (which is
+ *  assumed to be a square centred on its middle; cartographers look away
+ *  now), just as generate_pplme_dataset.py does, but from a model that's
+ *  baked in rather than downloaded.  They are aged 18 to 100 as of @a today.
+ *
+ *  @param  seed determines everything about the ppl, so the same seed,
+ *          @a count and @a today give the same dataset, octet for octet.
+ *  @param  threads is how many threads to generate with; this affects how
+ *          long it takes, but not what comes out.
+ *
+ *  @returns  true iff the whole dataset was written.
+ */
+bool GeneratePplDataset(
+    uint64_t count,
+    uint64_t seed,
+    unsigned int threads,
+    boost::gregorian::date today,
+    std::ostream& output);
+
+
+}  // namespace pplme
+
+
+#endif  // PPLME_PPLMEGEN_GENERATEPPLDATASET_H_
@@ -0,0 +1,94 @@
+/**
+ *  @file
+ *  @brief   Entry point for pplmegen, the pplMe dataset generator.
+ *  @author  j.ho
+ */
+
+
+#include <stdlib.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <boost/date_time/gregorian/gregorian.hpp>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include "generate_ppl_dataset.h"
+
+
+using google::RegisterFlagValidator;
+
+
+DEFINE_uint64(count,
+              10000000,
+              "number of ppl to generate");
+
+DEFINE_uint64(seed,
+              1,
+              "seed for the random number generation (the same seed gives "
+              "the same dataset)");
+
+DEFINE_int32(threads,
+             0,
+             "number of threads to generate with (0 means one per core)");
+extern bool const threads_validation_registrar = RegisterFlagValidator(
+    &FLAGS_threads,
+    [](char const*, int32_t value) {
+      return value >= 0;
+    });
+
+DEFINE_string(output,
+              "",
+              "path of the CSV file to write (empty means stdout)");
+
+DEFINE_string(today,
+              "",
+              "the date (YYYY-MM-DD) as of which ppl's ages are reckoned "
+              "(empty means today, which makes for a different dataset "
+              "tomorrow)");
+
+
+int main(int argc, char* argv[]) {
+  std::string usage{"pplmegen, the pplMe dataset generator.  Sample usage:\n"};
+  usage += argv[0];
+  usage += " --count 1000000 --seed 42 --output pplMe-data.csv";
+  google::SetUsageMessage(usage);
+  google::ParseCommandLineFlags(&argc, &argv, true);
+
+  google::InitGoogleLogging(argv[0]);
+
+  boost::gregorian::date today = boost::gregorian::day_clock::local_day();
+  if (!FLAGS_today.empty()) {
+    try {
+      today = boost::gregorian::from_simple_string(FLAGS_today);
+    } catch (std::exception const&) {
+      std::cerr << "Failed to parse --today `" << FLAGS_today << "'"
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  auto threads = static_cast<unsigned int>(FLAGS_threads);
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+
+  std::ofstream output_file;
+  if (!FLAGS_output.empty()) {
+    output_file.open(FLAGS_output, std::ios::binary | std::ios::trunc);
+    if (!output_file) {
+      std::cerr << "Failed to open `" << FLAGS_output << "'" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  std::ostream& output = FLAGS_output.empty() ? std::cout : output_file;
+
+  if (   !pplme::GeneratePplDataset(
+             FLAGS_count, FLAGS_seed, threads, today, output)
+      || !output.flush()) {
+    std::cerr << "Failed to generate pplMe dataset (check logs for details)"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}